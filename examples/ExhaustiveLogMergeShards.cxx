@@ -0,0 +1,121 @@
+/*=========================================================================
+ *
+ *  Copyright NumFOCUS
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *         https://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *=========================================================================*/
+
+// Merge the stream files written by the shards of one exhaustive sweep into
+// an image of the whole lattice, in any format ITK can write.
+
+#include "itkExhaustiveLogShardMerger.h"
+#include "itkImageFileWriter.h"
+
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <vector>
+
+namespace
+{
+template <typename TValue, unsigned int VDimension>
+int
+MergeShards(const std::string & outputFileName, const std::vector<std::string> & shardFileNames)
+{
+  using MergerType = itk::ExhaustiveLogShardMerger<TValue, VDimension>;
+  using WriterType = itk::ImageFileWriter<typename MergerType::OutputImageType>;
+
+  auto merger = MergerType::New();
+  merger->SetFileNames(shardFileNames);
+
+  auto writer = WriterType::New();
+  writer->SetInput(merger->GetOutput());
+  writer->SetFileName(outputFileName);
+  writer->Update();
+
+  std::cout << "Merged " << merger->GetNumberOfRecords() << " records from " << shardFileNames.size()
+            << " shards into " << outputFileName << std::endl;
+  return EXIT_SUCCESS;
+}
+
+template <typename TValue>
+int
+MergeShards(unsigned int dimension, const std::string & outputFileName, const std::vector<std::string> & shardFileNames)
+{
+  switch (dimension)
+  {
+    case 1:
+      return MergeShards<TValue, 1>(outputFileName, shardFileNames);
+    case 2:
+      return MergeShards<TValue, 2>(outputFileName, shardFileNames);
+    case 3:
+      return MergeShards<TValue, 3>(outputFileName, shardFileNames);
+    case 4:
+      return MergeShards<TValue, 4>(outputFileName, shardFileNames);
+    case 5:
+      return MergeShards<TValue, 5>(outputFileName, shardFileNames);
+    case 6:
+      return MergeShards<TValue, 6>(outputFileName, shardFileNames);
+    default:
+      std::cerr << "Sweeps over " << dimension << " parameters are not supported" << std::endl;
+      return EXIT_FAILURE;
+  }
+}
+} // namespace
+
+int
+main(int argc, char * argv[])
+{
+  if (argc < 3)
+  {
+    std::cerr << "Usage: " << argv[0] << " outputImage shardStream [shardStream ...]" << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  const std::string              outputFileName = argv[1];
+  const std::vector<std::string> shardFileNames(argv + 2, argv + argc);
+
+  // The first shard tells which instantiation reads them all
+  std::ifstream stream(shardFileNames[0], std::ios::in | std::ios::binary);
+  if (!stream)
+  {
+    std::cerr << "Cannot open " << shardFileNames[0] << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  try
+  {
+    unsigned int dimension = 0;
+    unsigned int valueSize = 0;
+    bool         isInteger = false;
+    itk::ExhaustiveLogStreamImageSource<double, 1>::ReadSampleDescription(stream, dimension, valueSize, isInteger);
+    stream.close();
+
+    if (!isInteger && valueSize == sizeof(float))
+    {
+      return MergeShards<float>(dimension, outputFileName, shardFileNames);
+    }
+    if (!isInteger && valueSize == sizeof(double))
+    {
+      return MergeShards<double>(dimension, outputFileName, shardFileNames);
+    }
+    std::cerr << (isInteger ? "Integer" : "Floating point") << " samples of " << valueSize
+              << " bytes are not supported" << std::endl;
+  }
+  catch (const itk::ExceptionObject & exception)
+  {
+    std::cerr << exception << std::endl;
+  }
+  return EXIT_FAILURE;
+}
@@ -0,0 +1,224 @@
+/*=========================================================================
+ *
+ *  Copyright NumFOCUS
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *         https://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *=========================================================================*/
+#ifndef itkAdaptiveExhaustiveSearch_h
+#define itkAdaptiveExhaustiveSearch_h
+
+#include "itkMacro.h"
+#include "itkObject.h"
+#include "itkCommandExhaustiveLog.h"
+
+#include <utility>
+#include <vector>
+
+namespace itk
+{
+/**
+ *\class AdaptiveExhaustiveSearch
+ *  \brief Samples a parameter lattice coarse to fine, refining only around the best cells.
+ *
+ * Sampling the whole lattice at the final step size spends most metric evaluations
+ * far from any basin. AdaptiveExhaustiveSearch first runs ExhaustiveOptimizerv4 over
+ * the coarse lattice given by NumberOfSteps and Scales. Each following level divides
+ * the scales by RefinementFactor and re-sweeps, at the finer scales, only a window of
+ * one coarser step on each side of the best cells of the previous level.
+ *
+ * The cells refined are the NumberOfCellsToRefine lowest samples of the previous
+ * level whose value is within RefinementThreshold of that level's minimum. A cell
+ * adjacent to one already selected is skipped, since its window would mostly cover
+ * the same samples, so that the refinement budget spreads over distinct basins.
+ *
+ * The results form a pyramid of CommandExhaustiveLog objects, one per level. All
+ * logs span the same physical region and share its origin, the step size of each
+ * level being that of the previous one divided by RefinementFactor, so that a sample
+ * at index i of one level lies at index i * RefinementFactor of the next. The coarse
+ * log is complete. Finer logs use chunked storage so that only refined regions are
+ * allocated, and hold NumericTraits<TValue>::max() where no sample was taken.
+ * GetValue() returns the sample nearest to a position on the finest level that has
+ * one there.
+ *
+ * StartEvent and EndEvent are invoked on this object before and after the search,
+ * and IterationEvent after each level is completed.
+ *
+ * Template parameters for class AdaptiveExhaustiveSearch:
+ *
+ * - TValue = Element type stored at each location in the level logs.
+ * - TImageDimension = Dimension of image equal to number of transform parameters
+ *
+ * \ingroup ITKOptimizationMonitor
+ */
+template <typename TValue, unsigned int TImageDimension>
+class AdaptiveExhaustiveSearch : public Object
+{
+public:
+  ITK_DISALLOW_COPY_AND_MOVE(AdaptiveExhaustiveSearch);
+
+  using Self = AdaptiveExhaustiveSearch;
+  using Superclass = Object;
+  using Pointer = SmartPointer<Self>;
+  using ConstPointer = SmartPointer<const Self>;
+  itkNewMacro(Self);
+  itkOverrideGetNameOfClassMacro(AdaptiveExhaustiveSearch);
+
+  /** Image dimension */
+  static constexpr unsigned int Dimension = TImageDimension;
+
+  /** Log holding the samples of one level. */
+  using LogType = CommandExhaustiveLog<TValue, TImageDimension>;
+  using LogPointer = typename LogType::Pointer;
+
+  using OptimizerType = typename LogType::OptimizerType;
+  using MetricType = typename OptimizerType::MetricType;
+  using MetricPointer = typename MetricType::Pointer;
+  using MeasureType = typename MetricType::MeasureType;
+
+  using ParametersType = typename LogType::ParametersType;
+  using StepsType = typename LogType::StepsType;
+  using ScalesType = typename LogType::ScalesType;
+  using PointType = typename LogType::PointType;
+  using IndexType = typename LogType::IndexType;
+  using SizeValueType = typename LogType::SizeValueType;
+  using OffsetValueType = typename LogType::OffsetValueType;
+
+  /** Metric evaluated at every sample. */
+  itkSetObjectMacro(Metric, MetricType);
+  itkGetModifiableObjectMacro(Metric, MetricType);
+
+  /** Number of steps on each side of the initial position at the coarse level,
+   *  as in ExhaustiveOptimizerv4. */
+  itkSetMacro(NumberOfSteps, StepsType);
+  itkGetConstReferenceMacro(NumberOfSteps, StepsType);
+
+  /** Parameter scales at the coarse level, as in ExhaustiveOptimizerv4. */
+  itkSetMacro(Scales, ScalesType);
+  itkGetConstReferenceMacro(Scales, ScalesType);
+
+  /** Lattice center. When empty, the parameters of the metric are used
+   *  as ExhaustiveOptimizerv4 does. */
+  itkSetMacro(InitialPosition, ParametersType);
+  itkGetConstReferenceMacro(InitialPosition, ParametersType);
+
+  /** Number of levels including the coarse one. Defaults to 3. */
+  itkSetMacro(NumberOfLevels, unsigned int);
+  itkGetConstMacro(NumberOfLevels, unsigned int);
+
+  /** Ratio of the step sizes of consecutive levels, at least 2. Defaults to 2. */
+  itkSetMacro(RefinementFactor, unsigned int);
+  itkGetConstMacro(RefinementFactor, unsigned int);
+
+  /** Maximum number of cells of a level refined on the next one. Defaults to 4. */
+  itkSetMacro(NumberOfCellsToRefine, SizeValueType);
+  itkGetConstMacro(NumberOfCellsToRefine, SizeValueType);
+
+  /** Only cells whose value exceeds the minimum of their level by at most this
+   *  amount are refined. Defaults to the largest double, refining by count alone. */
+  itkSetMacro(RefinementThreshold, double);
+  itkGetConstMacro(RefinementThreshold, double);
+
+  /** Sample the coarse lattice and refine it level by level. */
+  void
+  StartSearch();
+
+  /** Number of levels sampled so far by the current or last search. */
+  unsigned int
+  GetNumberOfLogs() const
+  {
+    return static_cast<unsigned int>(m_Logs.size());
+  }
+
+  /** Log of a level, the coarse level being 0. */
+  LogType *
+  GetLog(unsigned int level) const;
+
+  /** Number of metric evaluations of the last search, including the evaluation of
+   *  the center that precedes each sweep of ExhaustiveOptimizerv4. */
+  itkGetConstMacro(NumberOfMetricEvaluations, SizeValueType);
+
+  /** Lowest value sampled on any level and its position. Samples of windows that
+   *  extend past the lattice are evaluated but not considered. */
+  itkGetConstMacro(MinimumMetricValue, MeasureType);
+  itkGetConstReferenceMacro(MinimumMetricValuePosition, ParametersType);
+
+  /** Finest level holding a sample nearest to a point. Throws if the point lies
+   *  outside the coarse lattice. */
+  unsigned int
+  GetFinestLevel(const PointType & point) const;
+
+  /** Sample nearest to a point on the finest level that holds one. */
+  const TValue
+  GetValue(const PointType & point) const;
+  const TValue
+  GetValue(const ParametersType & parameters) const;
+
+protected:
+  AdaptiveExhaustiveSearch();
+  ~AdaptiveExhaustiveSearch() override = default;
+
+  void
+  PrintSelf(std::ostream & os, Indent indent) const override;
+
+private:
+  /** Value and lattice offset of a sample evaluated on a level. */
+  using SampleType = std::pair<TValue, OffsetValueType>;
+
+  /** Sweep a window of RefinementFactor steps around a cell of the previous level. */
+  void
+  RefineCell(OptimizerType * optimizer, const IndexType & cell, unsigned int level);
+
+  /** Cells of a level to refine on the next one, in order of increasing value. */
+  std::vector<IndexType>
+  SelectCells(unsigned int level);
+
+  /** Index of the lattice sample nearest to a point on a level. Returns false if
+   *  the point lies outside the lattice. */
+  bool
+  ComputeNearestIndex(const PointType & point, unsigned int level, IndexType & index) const;
+
+  /** Value marking samples of a refined level that were not evaluated. */
+  static TValue
+  GetUnsampledValue()
+  {
+    return NumericTraits<TValue>::max();
+  }
+
+  MetricPointer  m_Metric;
+  StepsType      m_NumberOfSteps;
+  ScalesType     m_Scales;
+  ParametersType m_InitialPosition;
+  unsigned int   m_NumberOfLevels{ 3 };
+  unsigned int   m_RefinementFactor{ 2 };
+  SizeValueType  m_NumberOfCellsToRefine{ 4 };
+  double         m_RefinementThreshold;
+
+  std::vector<LogPointer> m_Logs;
+  SizeValueType           m_NumberOfMetricEvaluations{ 0 };
+  MeasureType             m_MinimumMetricValue;
+  ParametersType          m_MinimumMetricValuePosition;
+
+  /** Samples evaluated on the level being swept. */
+  std::vector<SampleType> m_LevelSamples;
+
+  /** Lattice index of the first window sample on the level being swept. */
+  IndexType m_WindowStart;
+};
+} // namespace itk
+
+#ifndef ITK_MANUAL_INSTANTIATION
+#  include "itkAdaptiveExhaustiveSearch.hxx"
+#endif
+
+#endif // itkAdaptiveExhaustiveSearch_h
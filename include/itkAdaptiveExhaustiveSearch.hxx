@@ -0,0 +1,357 @@
+/*=========================================================================
+ *
+ *  Copyright NumFOCUS
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *         https://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *=========================================================================*/
+
+#ifndef itkAdaptiveExhaustiveSearch_hxx
+#define itkAdaptiveExhaustiveSearch_hxx
+
+#include "itkAdaptiveExhaustiveSearch.h"
+
+#include "itkMath.h"
+
+#include <algorithm>
+#include <cstdlib>
+
+namespace itk
+{
+template <typename TValue, unsigned int TImageDimension>
+AdaptiveExhaustiveSearch<TValue, TImageDimension>::AdaptiveExhaustiveSearch()
+  : m_RefinementThreshold(NumericTraits<double>::max())
+  , m_MinimumMetricValue(NumericTraits<MeasureType>::max())
+{
+  m_NumberOfSteps.SetSize(Dimension);
+  m_NumberOfSteps.Fill(0);
+  m_Scales.SetSize(Dimension);
+  m_Scales.Fill(1.0);
+  m_WindowStart.Fill(0);
+}
+
+template <typename TValue, unsigned int TImageDimension>
+void
+AdaptiveExhaustiveSearch<TValue, TImageDimension>::StartSearch()
+{
+  if (m_Metric.IsNull())
+  {
+    itkExceptionMacro("Metric must be set before searching");
+  }
+  if (m_Metric->GetNumberOfParameters() != Dimension)
+  {
+    itkExceptionMacro("Metric has " << m_Metric->GetNumberOfParameters() << " parameters but the search expects "
+                                    << Dimension);
+  }
+  if (m_NumberOfSteps.Size() != Dimension || m_Scales.Size() != Dimension)
+  {
+    itkExceptionMacro("Expected " << Dimension << " steps and scales but found " << m_NumberOfSteps.Size()
+                                  << " steps and " << m_Scales.Size() << " scales");
+  }
+  if (m_NumberOfLevels < 1)
+  {
+    itkExceptionMacro("At least one level is required");
+  }
+  if (m_RefinementFactor < 2)
+  {
+    itkExceptionMacro("Refinement factor must be at least 2 but is " << m_RefinementFactor);
+  }
+
+  ParametersType center = (m_InitialPosition.Size() == Dimension) ? m_InitialPosition : m_Metric->GetParameters();
+  PointType      centerPoint;
+  for (unsigned int dim = 0; dim < Dimension; dim++)
+  {
+    centerPoint[dim] = center[dim];
+  }
+
+  m_Logs.clear();
+  m_LevelSamples.clear();
+  m_WindowStart.Fill(0);
+  m_NumberOfMetricEvaluations = 0;
+  m_MinimumMetricValue = NumericTraits<MeasureType>::max();
+  m_MinimumMetricValuePosition = center;
+
+  this->InvokeEvent(StartEvent());
+
+  auto optimizer = OptimizerType::New();
+  optimizer->SetMetric(m_Metric);
+
+  // Every evaluation is mapped from the optimizer window into the lattice of the
+  // level being swept. Refined levels are written here; the coarse log observes
+  // the optimizer itself.
+  OptimizerType * sweeping = optimizer.GetPointer();
+  optimizer->AddObserver(IterationEvent(), [this, sweeping](const EventObject &) {
+    ++m_NumberOfMetricEvaluations;
+    const MeasureType value = sweeping->GetCurrentValue();
+
+    LogType *              log = m_Logs.back();
+    const ParametersType & windowIndex = sweeping->GetCurrentIndex();
+    OffsetValueType        offset = 0;
+    OffsetValueType        stride = 1;
+    for (unsigned int dim = 0; dim < Dimension; dim++)
+    {
+      const auto index = m_WindowStart[dim] + static_cast<typename IndexType::IndexValueType>(windowIndex[dim]);
+      const auto size = static_cast<OffsetValueType>(log->GetSize(dim));
+      if (index < 0 || index >= size)
+      {
+        // Windows of cells on the lattice boundary extend past it
+        return;
+      }
+      offset += index * stride;
+      stride *= size;
+    }
+    if (value < m_MinimumMetricValue)
+    {
+      m_MinimumMetricValue = value;
+      m_MinimumMetricValuePosition = sweeping->GetCurrentPosition();
+    }
+    if (m_Logs.size() > 1)
+    {
+      log->SetValueAtOffset(offset, static_cast<TValue>(value));
+    }
+    m_LevelSamples.emplace_back(static_cast<TValue>(value), offset);
+  });
+
+  // Before each sweep, ExhaustiveOptimizerv4 evaluates the metric at the window
+  // center without invoking IterationEvent
+  optimizer->AddObserver(StartEvent(), [this](const EventObject &) { ++m_NumberOfMetricEvaluations; });
+
+  // Coarse level over the whole lattice
+  LogPointer coarse = LogType::New();
+  coarse->SetCenter(centerPoint);
+  m_Logs.push_back(coarse);
+  const unsigned long startTag = optimizer->AddObserver(StartEvent(), coarse);
+  const unsigned long iterationTag = optimizer->AddObserver(IterationEvent(), coarse);
+
+  m_Metric->SetParameters(center);
+  optimizer->SetNumberOfSteps(m_NumberOfSteps);
+  optimizer->SetScales(m_Scales);
+  optimizer->StartOptimization();
+
+  optimizer->RemoveObserver(startTag);
+  optimizer->RemoveObserver(iterationTag);
+  this->InvokeEvent(IterationEvent());
+
+  // Refined levels over windows around the best cells of the previous level
+  StepsType  levelSteps = m_NumberOfSteps;
+  ScalesType levelScales = m_Scales;
+  StepsType  windowSteps(Dimension);
+  windowSteps.Fill(m_RefinementFactor);
+  for (unsigned int level = 1; level < m_NumberOfLevels; level++)
+  {
+    const std::vector<IndexType> cells = this->SelectCells(level - 1);
+
+    for (unsigned int dim = 0; dim < Dimension; dim++)
+    {
+      levelSteps[dim] *= m_RefinementFactor;
+      levelScales[dim] /= m_RefinementFactor;
+    }
+
+    LogPointer log = LogType::New();
+    log->SetCenter(centerPoint);
+    log->UseChunkedStorageOn();
+    log->SetFillValue(GetUnsampledValue());
+    log->Initialize(levelSteps, levelScales);
+    m_Logs.push_back(log);
+
+    optimizer->SetNumberOfSteps(windowSteps);
+    optimizer->SetScales(levelScales);
+    for (const auto & cell : cells)
+    {
+      this->RefineCell(optimizer, cell, level);
+    }
+    this->InvokeEvent(IterationEvent());
+  }
+
+  m_LevelSamples.clear();
+  m_LevelSamples.shrink_to_fit();
+
+  // Leave the metric at the lattice center as found
+  m_Metric->SetParameters(center);
+
+  this->InvokeEvent(EndEvent());
+}
+
+template <typename TValue, unsigned int TImageDimension>
+void
+AdaptiveExhaustiveSearch<TValue, TImageDimension>::RefineCell(OptimizerType *   optimizer,
+                                                              const IndexType & cell,
+                                                              unsigned int      level)
+{
+  const LogType * previous = m_Logs[level - 1];
+  const auto      origin = previous->GetOrigin();
+  const auto      stepSize = previous->GetStepSize();
+  const auto      factor = static_cast<typename IndexType::IndexValueType>(m_RefinementFactor);
+
+  ParametersType cellPosition(Dimension);
+  for (unsigned int dim = 0; dim < Dimension; dim++)
+  {
+    cellPosition[dim] = origin[dim] + cell[dim] * stepSize[dim];
+    m_WindowStart[dim] = (cell[dim] - 1) * factor;
+  }
+
+  m_Metric->SetParameters(cellPosition);
+  optimizer->StartOptimization();
+}
+
+template <typename TValue, unsigned int TImageDimension>
+auto
+AdaptiveExhaustiveSearch<TValue, TImageDimension>::SelectCells(unsigned int level) -> std::vector<IndexType>
+{
+  std::vector<IndexType> cells;
+  if (m_LevelSamples.empty())
+  {
+    return cells;
+  }
+
+  std::sort(m_LevelSamples.begin(), m_LevelSamples.end());
+  const auto minimum = static_cast<double>(m_LevelSamples.front().first);
+
+  const LogType * log = m_Logs[level];
+  for (const auto & sample : m_LevelSamples)
+  {
+    if (cells.size() >= m_NumberOfCellsToRefine || static_cast<double>(sample.first) - minimum > m_RefinementThreshold)
+    {
+      break;
+    }
+
+    IndexType index;
+    auto      remainder = static_cast<SizeValueType>(sample.second);
+    for (unsigned int dim = 0; dim < Dimension; dim++)
+    {
+      index[dim] = static_cast<typename IndexType::IndexValueType>(remainder % log->GetSize(dim));
+      remainder /= log->GetSize(dim);
+    }
+
+    // Windows of adjacent cells overlap mostly, so only the lower one is refined.
+    // Overlapping windows also revisit the same samples.
+    const bool adjacent = std::any_of(cells.begin(), cells.end(), [&index](const IndexType & cell) {
+      for (unsigned int dim = 0; dim < Dimension; dim++)
+      {
+        if (std::abs(index[dim] - cell[dim]) > 1)
+        {
+          return false;
+        }
+      }
+      return true;
+    });
+    if (!adjacent)
+    {
+      cells.push_back(index);
+    }
+  }
+
+  m_LevelSamples.clear();
+  return cells;
+}
+
+template <typename TValue, unsigned int TImageDimension>
+auto
+AdaptiveExhaustiveSearch<TValue, TImageDimension>::GetLog(unsigned int level) const -> LogType *
+{
+  if (level >= m_Logs.size())
+  {
+    itkExceptionMacro("Level " << level << " requested but " << m_Logs.size() << " levels have been sampled");
+  }
+  return m_Logs[level];
+}
+
+template <typename TValue, unsigned int TImageDimension>
+bool
+AdaptiveExhaustiveSearch<TValue, TImageDimension>::ComputeNearestIndex(const PointType & point,
+                                                                       unsigned int      level,
+                                                                       IndexType &       index) const
+{
+  const LogType * log = m_Logs[level];
+  const auto      origin = log->GetOrigin();
+  const auto      stepSize = log->GetStepSize();
+  for (unsigned int dim = 0; dim < Dimension; dim++)
+  {
+    index[dim] = Math::Round<typename IndexType::IndexValueType>((point[dim] - origin[dim]) / stepSize[dim]);
+    if (index[dim] < 0 || index[dim] >= static_cast<typename IndexType::IndexValueType>(log->GetSize(dim)))
+    {
+      return false;
+    }
+  }
+  return true;
+}
+
+template <typename TValue, unsigned int TImageDimension>
+unsigned int
+AdaptiveExhaustiveSearch<TValue, TImageDimension>::GetFinestLevel(const PointType & point) const
+{
+  if (m_Logs.empty())
+  {
+    itkExceptionMacro("No level has been sampled");
+  }
+
+  IndexType index;
+  for (auto level = static_cast<unsigned int>(m_Logs.size() - 1); level > 0; level--)
+  {
+    if (this->ComputeNearestIndex(point, level, index) && m_Logs[level]->GetValue(index) != GetUnsampledValue())
+    {
+      return level;
+    }
+  }
+  if (!this->ComputeNearestIndex(point, 0, index))
+  {
+    itkExceptionMacro("Point " << point << " lies outside the coarse lattice");
+  }
+  return 0;
+}
+
+template <typename TValue, unsigned int TImageDimension>
+const TValue
+AdaptiveExhaustiveSearch<TValue, TImageDimension>::GetValue(const PointType & point) const
+{
+  const unsigned int level = this->GetFinestLevel(point);
+  IndexType          index;
+  this->ComputeNearestIndex(point, level, index);
+  return m_Logs[level]->GetValue(index);
+}
+
+template <typename TValue, unsigned int TImageDimension>
+const TValue
+AdaptiveExhaustiveSearch<TValue, TImageDimension>::GetValue(const ParametersType & parameters) const
+{
+  PointType point;
+  for (unsigned int dim = 0; dim < Dimension; dim++)
+  {
+    point[dim] = parameters[dim];
+  }
+  return GetValue(point);
+}
+
+template <typename TValue, unsigned int TImageDimension>
+void
+AdaptiveExhaustiveSearch<TValue, TImageDimension>::PrintSelf(std::ostream & os, Indent indent) const
+{
+  Superclass::PrintSelf(os, indent);
+
+  os << indent << "NumberOfSteps: " << m_NumberOfSteps << std::endl;
+  os << indent << "Scales: " << m_Scales << std::endl;
+  os << indent << "InitialPosition: " << m_InitialPosition << std::endl;
+  os << indent << "NumberOfLevels: " << m_NumberOfLevels << std::endl;
+  os << indent << "RefinementFactor: " << m_RefinementFactor << std::endl;
+  os << indent << "NumberOfCellsToRefine: " << m_NumberOfCellsToRefine << std::endl;
+  os << indent << "RefinementThreshold: " << m_RefinementThreshold << std::endl;
+  os << indent << "NumberOfLogs: " << m_Logs.size() << std::endl;
+  os << indent << "NumberOfMetricEvaluations: " << m_NumberOfMetricEvaluations << std::endl;
+  os << indent << "MinimumMetricValue: " << m_MinimumMetricValue << std::endl;
+  os << indent << "MinimumMetricValuePosition: " << m_MinimumMetricValuePosition << std::endl;
+  itkPrintSelfObjectMacro(Metric);
+}
+
+} // namespace itk
+
+#endif // itkAdaptiveExhaustiveSearch_hxx
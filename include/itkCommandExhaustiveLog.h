@@ -22,6 +22,20 @@
 #include "itkCommand.h"
 #include "itkImage.h"
 #include "itkExhaustiveOptimizerv4.h"
+#include "itkExhaustiveLogStreamImageSource.h"
+#include "itkExhaustiveLogStreamWriter.h"
+#include "itkExhaustiveLogBatcher.h"
+#include "itkExhaustiveLogReducer.h"
+#include "itkBSplineInterpolateImageFunction.h"
+
+#include <atomic>
+#include <chrono>
+#include <limits>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <utility>
+#include <vector>
 
 namespace itk
 {
@@ -43,12 +57,77 @@ namespace itk
  * less effective. Exhaustive data may also help inform the user in regards to
  * the performance of ongoing optimization, such as overlaying optimizer steps
  * onto an image of the exhaustive parametric region in order to determine whether
- * the optimizer learning rate is appropriate for the region.
+ * the optimizer learning rate is appropriate for the region. CommandTrajectoryLog
+ * records the steps of other optimizers and maps them onto the lattice to that end.
+ *
+ * By default the whole lattice is allocated on StartEvent. A later StartEvent over a
+ * lattice of the same region refills the same buffer rather than allocating another,
+ * unless the previous image is still referenced elsewhere, and a pixel container may
+ * be supplied to hold the lattice (see PixelContainer). When the observer follows a
+ * multi-level registration, the lattice of every level may be kept (see
+ * RetainLevels). For high-dimensional or
+ * partial sweeps the lattice may instead be stored in fixed-size n-dimensional chunks
+ * that are allocated only when their first value is written (see UseChunkedStorage).
+ * Samples that were never written read back as FillValue in either mode.
+ *
+ * Samples may also be appended to a stream file as they arrive (see StreamFileName)
+ * so that an interrupted sweep can be resumed with ResumeStream() and a finished
+ * stream converted with ExhaustiveLogStreamImageSource.
+ *
+ * Summaries of the surface can be maintained as samples arrive instead of scanning
+ * the image afterwards: running minimum, maximum, mean and variance (see
+ * ComputeStatistics), the deepest local minima (see NumberOfLocalMinima) and a
+ * fixed-bin histogram (see NumberOfHistogramBins). Each is off by default, costs
+ * constant time per sample, and may be read while the sweep is running.
+ *
+ * For every pair of parameters, the minimum over all other parameters and the
+ * sample attaining it may likewise be projected onto a 2D image as samples arrive
+ * (see ComputeProjections). With the lattice itself no longer stored (see
+ * StoreLattice), memory then grows with the square of the number of steps per
+ * parameter rather than with its power, which keeps views of 5- or 6-parameter
+ * sweeps affordable.
+ *
+ * A sweep too large for one machine may be split into shards, each process
+ * storing only a sub-box of the lattice (see ShardRegion) filled, for example, by
+ * ParallelExhaustiveSweep. The lattice origin, spacing and size stay those of the
+ * whole sweep, and the data image region starts at the shard index, so that every
+ * shard knows its place in the lattice. Shards streamed to files (see
+ * StreamFileName) are combined by ExhaustiveLogShardMerger.
+ *
+ * Observers that follow a sweep as it runs, such as Python callbacks, may receive
+ * recorded samples in batches (see BatchSize and BatchInterval) rather than on
+ * every optimizer iteration: IterationEvent is then invoked on this object each
+ * time a batch is ready, with the lattice indices and values of its samples in
+ * contiguous buffers. In Python, GetArrayView() gives a NumPy view of the dense
+ * lattice and AddBatchObserver() a callback receiving NumPy views of each batch.
+ * Batches are delivered one at a time without holding the locks taken by
+ * recording threads, and during a ParallelExhaustiveSweep only on the thread
+ * calling StartSweep(), so that observers needing that thread, such as Python
+ * callbacks, neither stall nor deadlock the workers.
+ *
+ * The cost of the sweep itself may be mapped as well (see RecordTiming): the time
+ * elapsed since the previous event, measured with a monotonic clock, is stored for
+ * each sample in an image aligned with the data image, and summarized by the total,
+ * the mean over each slice of the lattice along each parameter and the slowest
+ * samples. ParallelExhaustiveSweep times each metric evaluation instead.
+ *
+ * Many positions may be looked up at once with GetValues(), for example to overlay
+ * an optimizer trajectory or to resample the surface for display, by nearest
+ * sample, multilinear or cubic B-spline interpolation, optionally split across
+ * threads (see NumberOfQueryWorkUnits).
+ *
+ * Several metrics may be logged over one sweep with CommandMultiMetricExhaustiveLog,
+ * which stores one channel per metric at each sample.
+ *
+ * Streaming, batch delivery and online reductions are carried out by collaborators
+ * of the log (ExhaustiveLogStreamWriter, ExhaustiveLogBatcher and
+ * ExhaustiveLogReducer), set up from the settings of the log at each initialization
+ * and handed each recorded sample only when their feature is enabled.
  *
  * Wrapping for this class is limited to available wrappings for the internal
  * itk::Image data array. Users wishing to make use of transforms with large
- * parameter lists may find it necessary to build ITK with custom wrappings to
- * meet their needs.
+ * parameter lists may use CommandVariableDimensionExhaustiveLog, whose dimension
+ * is chosen at run time, or build ITK with custom wrappings to meet their needs.
  *
  * Template parameters for class CommandExhaustiveLog:
  *
@@ -79,6 +158,9 @@ public:
   /** Image used as n-dimensional array with positional aliasing. */
   using ImageType = itk::Image<InternalDataType, Dimension>;
   using ImagePointer = typename ImageType::Pointer;
+  /** Memory holding a dense lattice. */
+  using PixelContainerType = typename ImageType::PixelContainer;
+  using PixelContainerPointer = typename PixelContainerType::Pointer;
 
   /** Type to represent size of array along each dimension. */
   using SizeType = typename ImageType::SizeType;
@@ -86,6 +168,9 @@ public:
 
   /** Discrete values to access pixel location in data image. */
   using IndexType = typename ImageType::IndexType;
+  using IndexValueType = typename ImageType::IndexValueType;
+  /** Box of lattice indices. */
+  using RegionType = typename ImageType::RegionType;
   /** Geometric distance between optimizer samples. */
   using SpacingType = typename ImageType::SpacingType;
   /** Geometric coordinates of a given sample index. */
@@ -93,6 +178,61 @@ public:
 
   /** Default optimizer geometric output type. */
   using ParametersType = typename OptimizerType::ParametersType;
+  /** Metric value reported by the optimizer. */
+  using MeasureType = typename OptimizerType::MeasureType;
+  /** Number of steps on each side of the center along each dimension. */
+  using StepsType = typename OptimizerType::StepsType;
+  /** Distance between samples along each dimension. */
+  using ScalesType = typename OptimizerType::ScalesType;
+
+  /** Linear position of a sample in the data array. */
+  using OffsetValueType = typename ImageType::OffsetValueType;
+
+  /** Collaborators carrying out the optional features on recorded samples. */
+  using CollaboratorType = ExhaustiveLogCollaborator<TValue, TImageDimension>;
+  using StreamWriterType = ExhaustiveLogStreamWriter<TValue, TImageDimension>;
+  using BatcherType = ExhaustiveLogBatcher<TValue, TImageDimension>;
+  using ReducerType = ExhaustiveLogReducer<TValue, TImageDimension>;
+
+  /** Local minimum of the logged surface. */
+  using LocalMinimumType = typename ReducerType::LocalMinimumType;
+  using LocalMinimaContainerType = typename ReducerType::LocalMinimaContainerType;
+
+  /** Sample counts of equal-width bins. */
+  using HistogramType = typename ReducerType::HistogramType;
+
+  /** Seconds elapsed before each sample was recorded. */
+  using TimingImageType = itk::Image<double, Dimension>;
+  using TimingImagePointer = typename TimingImageType::Pointer;
+
+  /** Interpolation between lattice samples for GetValues(). */
+  enum class InterpolationEnum : uint8_t
+  {
+    NearestNeighbor,
+    Linear,
+    BSpline
+  };
+
+  /** Cubic B-spline interpolation of the lattice, its coefficients computed once
+   *  until samples change. */
+  using BSplineInterpolatorType = BSplineInterpolateImageFunction<ImageType, double, double>;
+  using BSplineInterpolatorPointer = typename BSplineInterpolatorType::Pointer;
+
+  /** Sample that took long to record. */
+  struct SlowSampleType
+  {
+    double          ElapsedTime;
+    OffsetValueType Offset;
+    PointType       Position;
+  };
+  using SlowSamplesContainerType = std::vector<SlowSampleType>;
+
+  /** Minimum of the lattice over all parameters but two, and the linear offset of
+   *  the sample attaining it. */
+  using ProjectionImageType = typename ReducerType::ProjectionImageType;
+  using ProjectionImagePointer = typename ProjectionImageType::Pointer;
+  using ProjectionArgminImageType = typename ReducerType::ProjectionArgminImageType;
+  using ProjectionArgminImagePointer = typename ProjectionArgminImageType::Pointer;
 
   /** Observe an event fired by calling object. */
   void
@@ -110,12 +250,437 @@ public:
   const TValue
   GetValue(const ParametersType & parameters) const;
 
+  /** Values at a batch of positions in parameter space, given as numberOfPoints rows
+   *  of Dimension parameters, into values. Positions outside the stored lattice, or
+   *  outside the lattice hull for linear and B-spline interpolation, receive
+   *  OutsideValue. Throws if lattice samples are not stored. */
+  void
+  GetValues(const double *    parameters,
+            SizeValueType     numberOfPoints,
+            double *          values,
+            InterpolationEnum interpolation = InterpolationEnum::NearestNeighbor) const;
+  std::vector<double>
+  GetValues(const std::vector<double> & parameters,
+            InterpolationEnum           interpolation = InterpolationEnum::NearestNeighbor) const;
+
+  /** Value of GetValues() outside the lattice. Defaults to NaN. */
+  itkSetMacro(OutsideValue, double);
+  itkGetConstMacro(OutsideValue, double);
+
+  /** Largest number of work units sharing a batch of GetValues() positions. Batches
+   *  are only split into parts of at least a few thousand positions. Defaults to 1,
+   *  answering on the calling thread. */
+  itkSetClampMacro(NumberOfQueryWorkUnits, unsigned int, 1, ITK_MAX_THREADS);
+  itkGetConstMacro(NumberOfQueryWorkUnits, unsigned int);
+
+  /** Allocate the data array for a lattice of (2 * steps + 1) samples along each
+   *  dimension spaced by the given scales. Called on StartEvent with the optimizer
+   *  settings, or directly by drivers that fill the lattice without an optimizer. */
+  void
+  Initialize(const StepsType & numberOfSteps, const ScalesType & scales);
+
+  /** Set data at a linear offset into the data array, where dimension 0 varies fastest
+   *  as in the optimizer iteration order. Concurrent calls are safe for distinct offsets. */
+  void
+  SetValueAtOffset(const OffsetValueType offset, const InternalDataType & value);
+
+  /** Write samples from numberOfWorkUnits threads with the overload of
+   *  SetValueAtOffset() taking a work unit, until EndConcurrentWrites(). Each work
+   *  unit then keeps its own reductions, merged at EndConcurrentWrites(), so that the
+   *  threads do not contend on every sample. Used by ParallelExhaustiveSweep. */
+  void
+  BeginConcurrentWrites(ThreadIdType numberOfWorkUnits);
+
+  /** Set data at a linear offset from a work unit announced to
+   *  BeginConcurrentWrites(). Concurrent calls are safe for distinct offsets and
+   *  distinct work units. */
+  void
+  SetValueAtOffset(const OffsetValueType offset, const InternalDataType & value, ThreadIdType workUnit);
+
+  /** Merge the reductions of the samples written since BeginConcurrentWrites(). Of
+   *  equal samples, the extremes and projections then report the one at the lowest
+   *  offset. */
+  void
+  EndConcurrentWrites();
+
+  /** Retrieve data at a linear offset into the data array. */
+  const TValue
+  GetValueAtOffset(const OffsetValueType offset) const;
+
+  /** Physical position of the sample at a linear offset into the data array. */
+  PointType
+  ComputePosition(const OffsetValueType offset) const;
+
+  /** Lattice index of the sample at a linear offset into the data array. */
+  IndexType
+  ComputeIndex(const OffsetValueType offset) const
+  {
+    return m_DataImage->ComputeIndex(offset);
+  }
+
   /** Center of exhaustive region is used to compute image origin at initialization */
   itkSetMacro(Center, PointType);
   itkGetMacro(Center, PointType);
-  itkGetConstMacro(DataImage, ImageType *);
 
-  /** Provide const methods to access underlying image parameters */
+  /** Store the lattice in chunks allocated on first write instead of one dense image.
+   *  Takes effect at the next initialization. Off by default. */
+  itkSetMacro(UseChunkedStorage, bool);
+  itkGetConstMacro(UseChunkedStorage, bool);
+  itkBooleanMacro(UseChunkedStorage);
+
+  /** Number of samples along each dimension of a chunk. Zero entries are chosen
+   *  automatically so that a chunk holds on the order of 32k samples. */
+  itkSetMacro(ChunkSize, SizeType);
+  itkGetConstMacro(ChunkSize, SizeType);
+
+  /** Value reported for samples that have not been written. Defaults to zero. */
+  itkSetMacro(FillValue, InternalDataType);
+  itkGetConstMacro(FillValue, InternalDataType);
+
+  /** Container in which to store a dense lattice, for example one taken from a pool
+   *  shared by several observers, or wrapping memory of the caller through
+   *  SetImportPointer(). It is grown if it holds fewer samples than the lattice, and
+   *  its previous contents are overwritten at each initialization, including those
+   *  seen through images returned earlier. Null, the default, allocates the lattice. */
+  itkSetObjectMacro(PixelContainer, PixelContainerType);
+  itkGetModifiableObjectMacro(PixelContainer, PixelContainerType);
+
+  /** Keep the lattice of each initialization, such as each level of a multi-level
+   *  registration, instead of overwriting it at the next one. The image of a finished
+   *  level is kept as it was, without a copy for dense storage. Off by default. */
+  itkSetMacro(RetainLevels, bool);
+  itkGetConstMacro(RetainLevels, bool);
+  itkBooleanMacro(RetainLevels);
+
+  /** Number of levels retained, counting the current one. */
+  unsigned int
+  GetNumberOfLevels() const
+  {
+    return static_cast<unsigned int>(m_LevelImages.size()) + (m_RetainingCurrentLevel ? 1 : 0);
+  }
+
+  /** Lattice of a retained level, in the order of initialization; the last is the
+   *  current lattice as returned by GetImage(). Null for levels whose lattice was not
+   *  stored. */
+  const ImagePointer
+  GetLevelImage(unsigned int level) const;
+
+  /** Forget retained levels, the next initialization starting level zero. */
+  void
+  ClearLevels();
+
+  /** Number of chunks holding memory, or zero for dense storage. */
+  SizeValueType
+  GetNumberOfAllocatedChunks() const
+  {
+    return m_NumberOfAllocatedChunks;
+  }
+
+  /** Keep every sample of the lattice, densely or in chunks. Without it only the
+   *  online reductions, projections and stream file retain samples, and GetImage()
+   *  and GetValue() throw. Takes effect at the next initialization. On by default. */
+  itkSetMacro(StoreLattice, bool);
+  itkGetConstMacro(StoreLattice, bool);
+  itkBooleanMacro(StoreLattice);
+
+  /** Sub-box of the lattice, in lattice indices, to which storage, streaming and
+   *  reductions are restricted. Linear offsets then count samples of the shard in
+   *  data array order, and samples reported by an optimizer outside the shard are
+   *  ignored. Local minima are not searched for in a shard. Takes effect at the
+   *  next initialization, which throws if the shard is not inside the lattice.
+   *  Empty, the default, stores the whole lattice. */
+  itkSetMacro(ShardRegion, RegionType);
+  itkGetConstReferenceMacro(ShardRegion, RegionType);
+
+  /** Append every recorded sample to this file as it arrives, so that the sweep
+   *  survives a crash. The file is recreated at each initialization, except after
+   *  ResumeStream(), when initializing for the lattice of the stream appends to it and
+   *  initializing for another lattice throws, until a stream file is set again. Empty,
+   *  the default, disables streaming. */
+  virtual void
+  SetStreamFileName(const char * fileName)
+  {
+    const std::string name = (fileName != nullptr) ? fileName : "";
+    m_StreamResumed = false;
+    if (name != m_StreamFileName)
+    {
+      m_StreamFileName = name;
+      this->Modified();
+    }
+  }
+  virtual void
+  SetStreamFileName(const std::string & fileName)
+  {
+    this->SetStreamFileName(fileName.c_str());
+  }
+  itkGetStringMacro(StreamFileName);
+
+  /** Number of records between flushes of the stream file. Defaults to 4096. */
+  itkSetMacro(StreamFlushInterval, SizeValueType);
+  itkGetConstMacro(StreamFlushInterval, SizeValueType);
+
+  /** Write buffered records to the stream file. Called on EndEvent. */
+  void
+  FlushStream()
+  {
+    m_StreamWriter->Flush();
+  }
+
+  /** Flush and close the stream file. */
+  void
+  CloseStream();
+
+  /** Rebuild the log from StreamFileName, then keep appending to that file, also
+   *  across later initializations for the same lattice. Returns the number of
+   *  lattice samples absent from the stream, which GetMissingOffsets() lists. */
+  SizeValueType
+  ResumeStream();
+
+  /** Offsets of at most maximumNumberOfOffsets samples that were absent from the
+   *  stream at the last ResumeStream(), in increasing order from first. Listing the
+   *  missing samples a batch at a time, for example to hand each batch to
+   *  ParallelExhaustiveSweep::SetSampleOffsets, keeps memory bounded for large
+   *  lattices. Empty unless the log was resumed since its last initialization. */
+  std::vector<OffsetValueType>
+  GetMissingOffsets(OffsetValueType first, SizeValueType maximumNumberOfOffsets) const;
+
+  /** Deliver recorded samples in batches of this many. Zero, the default, delivers
+   *  no batches unless BatchInterval is set. Takes effect at the next initialization. */
+  itkSetMacro(BatchSize, SizeValueType);
+  itkGetConstMacro(BatchSize, SizeValueType);
+
+  /** Also deliver a batch once this many milliseconds have passed since the last one
+   *  when a sample is recorded. Zero, the default, disables the time limit. Takes
+   *  effect at the next initialization. */
+  itkSetMacro(BatchInterval, double);
+  itkGetConstMacro(BatchInterval, double);
+
+  /** Deliver samples recorded since the last batch, if any, on the calling thread.
+   *  Called on EndEvent and at the end of a ParallelExhaustiveSweep. Must not be
+   *  called by batch observers. */
+  void
+  FlushBatch();
+
+  /** Samples of the batch being delivered, valid while IterationEvent observers of
+   *  this object run: their number, and buffers of their linear offsets, lattice
+   *  indices with Dimension entries per sample, and values. */
+  SizeValueType
+  GetBatchNumberOfSamples() const
+  {
+    return m_Batcher->GetNumberOfSamples();
+  }
+  const OffsetValueType *
+  GetBatchOffsetBuffer() const
+  {
+    return m_Batcher->GetOffsetBuffer();
+  }
+  const IndexValueType *
+  GetBatchIndexBuffer() const
+  {
+    return m_Batcher->GetIndexBuffer();
+  }
+  const InternalDataType *
+  GetBatchValueBuffer() const
+  {
+    return m_Batcher->GetValueBuffer();
+  }
+
+  /** Record the seconds elapsed since the previous event for each sample recorded on
+   *  IterationEvent, or the evaluation time passed to SetElapsedTimeAtOffset(). Takes
+   *  effect at the next initialization. Off by default. */
+  itkSetMacro(RecordTiming, bool);
+  itkGetConstMacro(RecordTiming, bool);
+  itkBooleanMacro(RecordTiming);
+
+  /** Number of slowest samples to keep, or zero, the default, to keep none. Takes
+   *  effect at the next initialization. */
+  itkSetMacro(NumberOfSlowestSamples, SizeValueType);
+  itkGetConstMacro(NumberOfSlowestSamples, SizeValueType);
+
+  /** Set the time taken to evaluate the sample at a linear offset. Concurrent calls
+   *  are safe. Ignored unless timing is recorded. */
+  void
+  SetElapsedTimeAtOffset(const OffsetValueType offset, double seconds);
+
+  /** Seconds elapsed before each sample, zero where none has been timed, in an image
+   *  with the region and geometry of the data image. Null unless timing is recorded.
+   *  Dense regardless of the lattice storage. */
+  TimingImageType *
+  GetTimingImage() const
+  {
+    return m_TimingImage.GetPointer();
+  }
+
+  /** Number of samples timed since initialization and the sum of their times, counting
+   *  every write. */
+  SizeValueType
+  GetNumberOfTimedSamples() const;
+  double
+  GetTotalElapsedTime() const;
+
+  /** Mean time of the samples timed in each slice of the stored region across a
+   *  parameter, zero for slices without any. */
+  std::vector<double>
+  GetMeanElapsedTimePerSlice(unsigned int dim) const;
+
+  /** Slowest samples timed so far, slowest first. */
+  SlowSamplesContainerType
+  GetSlowestSamples() const;
+
+  /** Maintain the running minimum, maximum, mean and variance of recorded samples.
+   *  Takes effect at the next initialization. Off by default. */
+  itkSetMacro(ComputeStatistics, bool);
+  itkGetConstMacro(ComputeStatistics, bool);
+  itkBooleanMacro(ComputeStatistics);
+
+  /** Number of deepest local minima to keep, or zero, the default, to find none.
+   *  A sample is a local minimum if no sample within LocalMinimaRadius lattice steps
+   *  along every dimension is lower; of equal samples the first in lattice order is
+   *  reported. Local minima are found among samples recorded on IterationEvent in
+   *  lattice order, as the optimizer visits them, and are reported once all their
+   *  neighbors have been recorded. Once a sample is written out of lattice order, as
+   *  by SetValueAtOffset() or ParallelExhaustiveSweep, GetLocalMinima() searches the
+   *  stored lattice again instead, where unwritten samples read as FillValue, and
+   *  throws if StoreLattice is off. Takes effect at the next initialization. */
+  itkSetMacro(NumberOfLocalMinima, SizeValueType);
+  itkGetConstMacro(NumberOfLocalMinima, SizeValueType);
+
+  /** Neighborhood radius, in lattice steps, of local minima. Defaults to 1. */
+  itkSetMacro(LocalMinimaRadius, SizeValueType);
+  itkGetConstMacro(LocalMinimaRadius, SizeValueType);
+
+  /** Number of histogram bins spanning [HistogramMinimum, HistogramMaximum), or
+   *  zero, the default, for no histogram. Values outside the range are counted in
+   *  the first or last bin. Takes effect at the next initialization. */
+  itkSetMacro(NumberOfHistogramBins, SizeValueType);
+  itkGetConstMacro(NumberOfHistogramBins, SizeValueType);
+  itkSetMacro(HistogramMinimum, double);
+  itkGetConstMacro(HistogramMinimum, double);
+  itkSetMacro(HistogramMaximum, double);
+  itkGetConstMacro(HistogramMaximum, double);
+
+  /** Maintain the D*(D-1)/2 pairwise minimum projections of the lattice. Takes
+   *  effect at the next initialization. Off by default. */
+  itkSetMacro(ComputeProjections, bool);
+  itkGetConstMacro(ComputeProjections, bool);
+  itkBooleanMacro(ComputeProjections);
+
+  /** Number of projection images, D*(D-1)/2 when projections are computed. */
+  unsigned int
+  GetNumberOfProjections() const
+  {
+    return m_Reducer->GetNumberOfProjections();
+  }
+
+  /** Minimum projection onto the plane of two parameters, the first parameter varying
+   *  along the image x axis. Pixels onto which no sample has been projected hold the
+   *  largest TValue. The image is updated in place as samples arrive. */
+  ProjectionImageType *
+  GetProjectionImage(unsigned int first, unsigned int second) const
+  {
+    return m_Reducer->GetProjectionImage(first, second);
+  }
+
+  /** Linear offset of the sample attaining each pixel of the minimum projection, from
+   *  which ComputePosition() gives the remaining parameters, or -1 where no sample has
+   *  been projected. Of equal samples the first recorded is kept, or of samples
+   *  written concurrently the one at the lowest offset. */
+  ProjectionArgminImageType *
+  GetProjectionArgminImage(unsigned int first, unsigned int second) const
+  {
+    return m_Reducer->GetProjectionArgminImage(first, second);
+  }
+
+  /** Number of samples recorded since initialization, counting every write, when
+   *  statistics or a histogram are maintained. Samples restored by ResumeStream()
+   *  are not included. */
+  SizeValueType
+  GetNumberOfRecordedSamples() const
+  {
+    return m_Reducer->GetNumberOfRecordedSamples();
+  }
+
+  /** Running statistics of recorded samples. Positions are those of the first
+   *  sample found with the extreme value, or of samples written concurrently the one
+   *  at the lowest offset, or the center before any sample; the variance is that of
+   *  the population. */
+  InternalDataType
+  GetMinimumValue() const
+  {
+    return m_Reducer->GetMinimumValue();
+  }
+  PointType
+  GetMinimumPosition() const;
+  InternalDataType
+  GetMaximumValue() const
+  {
+    return m_Reducer->GetMaximumValue();
+  }
+  PointType
+  GetMaximumPosition() const;
+  double
+  GetMean() const
+  {
+    return m_Reducer->GetMean();
+  }
+  double
+  GetVariance() const
+  {
+    return m_Reducer->GetVariance();
+  }
+
+  /** Deepest local minima found so far, lowest first. See NumberOfLocalMinima. */
+  LocalMinimaContainerType
+  GetLocalMinima() const
+  {
+    return m_Reducer->GetLocalMinima();
+  }
+
+  /** Histogram of the samples recorded so far. */
+  HistogramType
+  GetHistogram() const
+  {
+    return m_Reducer->GetHistogram();
+  }
+
+  /** Whether the lattice geometry and storage have been set up. */
+  bool
+  IsInitialized() const
+  {
+    return m_DataImage.IsNotNull();
+  }
+
+  /** Whether the lattice is held in one dense buffer, that of GetDataImage(), which
+   *  may then be read in place. */
+  bool
+  IsStoredDensely() const
+  {
+    return m_Buffer != nullptr;
+  }
+
+  /** Raw pointer to the image returned by GetImage(). */
+  ImageType *
+  GetDataImage() const
+  {
+    return GetImage().GetPointer();
+  }
+
+  /** Region of the lattice stored, either the whole lattice or the shard. */
+  const RegionType
+  GetRegion() const
+  {
+    return m_DataImage->GetLargestPossibleRegion();
+  }
+
+  /** Size of the whole lattice, shard or not. */
+  const SizeType
+  GetLatticeSize() const
+  {
+    return m_WholeLatticeSize;
+  }
+
+  /** Provide const methods to access underlying image parameters. Sizes are
+   *  those of the stored region. */
   const SizeType
   GetSize() const
   {
@@ -131,11 +696,13 @@ public:
   {
     return m_DataImage->GetOrigin();
   }
+
+  /** Data array as an image. With chunked storage a dense copy of the whole lattice
+   *  is materialized, with unwritten samples set to FillValue, and returned again by
+   *  later calls until a sample is written. The copy is shared and must not be
+   *  modified. Concurrent calls are safe, also while samples are written. */
   const ImagePointer
-  GetImage() const
-  {
-    return m_DataImage;
-  }
+  GetImage() const;
 
   /** Get the actual length of the data array in the given dimension.  */
   SizeValueType
@@ -148,7 +715,7 @@ public:
   SizeValueType
   GetNumberOfSteps(const int dim) const
   {
-    return (dim < Dimension) ? ((GetSize()[dim] - 1) / 2) : 0;
+    return (dim < Dimension) ? ((m_WholeLatticeSize[dim] - 1) / 2) : 0;
   }
 
 protected:
@@ -156,22 +723,203 @@ protected:
   ~CommandExhaustiveLog() override;
 
 private:
-  /** Initialize members and data array on registration StartEvent. */
+  /** Initialize members and data array on registration StartEvent, with a step
+   *  size of the optimizer StepLength times its scales. */
   void
   Initialize(const OptimizerType * optimizer);
 
+  /** Record the value reported on IterationEvent. Tracks the linear offset
+   *  of the next sample in optimizer order so that no index arithmetic or
+   *  allocation is needed while the optimizer follows that order. */
+  void
+  RecordIteration(const ParametersType & index, const MeasureType value);
+
   /** Set data at given position. */
   void
   SetValue(const IndexType & index, const InternalDataType & value);
   void
   SetValue(const ParametersType & index, const InternalDataType & value);
 
+  /** Set up geometry for a lattice and storage for a region of it. */
+  void
+  InitializeStorage(const RegionType &  region,
+                    const SizeType &    latticeSize,
+                    const SpacingType & spacing,
+                    const PointType &   origin);
+
+  /** Allocate the dense data image, in PixelContainer if it is free. */
+  void
+  AllocateDataImage();
+
+  /** Set data at a linear offset without handing it to the collaborators. */
+  void
+  StoreValueAtOffset(const OffsetValueType offset, const InternalDataType & value);
+
+  /** Hand a sample to the attached collaborators. */
+  void
+  AddSampleToCollaborators(const OffsetValueType offset, const IndexType * index, const InternalDataType & value)
+  {
+    for (CollaboratorType * collaborator : m_Collaborators)
+    {
+      collaborator->AddSample(offset, index, value);
+    }
+  }
+
+  /** Stop handing samples to a collaborator. */
+  void
+  DetachCollaborator(const CollaboratorType * collaborator);
+
+  /** Allocate the timing image and reset the timing summary. */
+  void
+  InitializeTiming();
+
+  /** Time a sample at an index of the data image. */
+  void
+  RecordElapsedTime(const OffsetValueType offset, const IndexType & index, double seconds);
+
+  /** Reset chunk bookkeeping for a lattice of the given size. */
+  void
+  InitializeChunks(const SizeType & size);
+
+  /** Locate the chunk holding a sample and the sample position within the chunk. */
+  void
+  ComputeChunkLocation(const IndexType & index, SizeValueType & chunk, SizeValueType & offsetInChunk) const;
+
+  /** Buffer of the given chunk, allocated and filled on first access. */
+  InternalDataType *
+  GetOrAllocateChunk(SizeValueType chunk);
+
+  /** Copy all chunks into a dense image. */
+  ImagePointer
+  MaterializeImage() const;
+
+  /** Answer queries [begin, end) of a GetValues() batch. */
+  void
+  EvaluateQueries(const double *                  parameters,
+                  SizeValueType                   begin,
+                  SizeValueType                   end,
+                  double *                        values,
+                  InterpolationEnum               interpolation,
+                  const BSplineInterpolatorType * bspline) const;
+
+  /** Interpolator over the current samples, recomputing coefficients if samples have
+   *  been recorded since they were last computed. */
+  BSplineInterpolatorPointer
+  GetBSplineInterpolator() const;
+
+  /** Mark B-spline coefficients as outdated after a sample is written. Skips the
+   *  store when they already are, so that concurrent writers do not contend. */
+  void
+  MarkSamplesModified()
+  {
+    if (m_BSplineCoefficientsCurrent.load(std::memory_order_relaxed))
+    {
+      m_BSplineCoefficientsCurrent.store(false, std::memory_order_relaxed);
+    }
+  }
+
+  /** Throw unless lattice samples are stored. */
+  void
+  VerifyLatticeStored() const;
+
 private:
   /** Coordinates at center of optimization region; ex. (2.1, -1.05).
    *   Referenced at initialization to set image origin. */
   PointType m_Center;
-  /** n-dimensional array with spacing to store exhaustive values */
+  /** n-dimensional array with spacing to store exhaustive values.
+   *  Holds geometry only, without a buffer, when chunked storage is active. */
   ImagePointer m_DataImage;
+
+  bool             m_UseChunkedStorage{ false };
+  SizeType         m_ChunkSize;
+  InternalDataType m_FillValue;
+
+  /** Optional memory for a dense lattice, and images of finished levels. */
+  PixelContainerPointer     m_PixelContainer;
+  bool                      m_RetainLevels{ false };
+  bool                      m_RetainingCurrentLevel{ false };
+  std::vector<ImagePointer> m_LevelImages;
+
+  /** Chunked storage: owned buffers, their addresses published for lock-free
+   *  reads, and the chunk layout chosen at initialization. */
+  std::vector<std::unique_ptr<InternalDataType[]>>    m_ChunkBuffers;
+  std::unique_ptr<std::atomic<InternalDataType *>[]> m_Chunks;
+  SizeType                                            m_ChunkExtent;
+  SizeType                                            m_ChunkGridSize;
+  SizeValueType                                       m_ChunkLength{ 0 };
+  std::atomic<SizeValueType>                          m_NumberOfAllocatedChunks{ 0 };
+  std::mutex                                          m_ChunkMutex;
+
+  /** Shard geometry: requested region, size of the whole lattice, start of the
+   *  stored region, and whether it is smaller than the lattice. */
+  RegionType m_ShardRegion;
+  SizeType   m_WholeLatticeSize;
+  IndexType  m_LatticeStart;
+  bool       m_Sharded{ false };
+
+  /** Iteration fast path: dense buffer (null for chunked storage), size of the
+   *  stored region, and position of the sample expected on the next IterationEvent. */
+  InternalDataType * m_Buffer{ nullptr };
+  SizeType           m_LatticeSize;
+  IndexType          m_NextIndex;
+  OffsetValueType    m_NextOffset{ 0 };
+
+  /** Collaborators, and those attached at the last initialization, which receive
+   *  every recorded sample in turn. */
+  typename StreamWriterType::Pointer m_StreamWriter;
+  typename BatcherType::Pointer      m_Batcher;
+  typename ReducerType::Pointer      m_Reducer;
+  std::vector<CollaboratorType *>    m_Collaborators;
+
+  /** Streaming settings, and the samples found in the stream at the last resume. */
+  using StreamSourceType = ExhaustiveLogStreamImageSource<TValue, TImageDimension>;
+  std::string       m_StreamFileName;
+  bool              m_StreamResumed{ false };
+  SizeValueType     m_StreamFlushInterval{ 4096 };
+  std::vector<bool> m_StreamCoverage;
+
+  /** Batch delivery settings. */
+  SizeValueType m_BatchSize{ 0 };
+  double        m_BatchInterval{ 0.0 };
+
+  /** Timing: settings, time of the previous event, then the timing image and summary
+   *  guarded by m_TimingMutex. Slice sums and counts of all parameters are
+   *  concatenated, and the slowest samples kept in a min-heap. */
+  bool                                            m_RecordTiming{ false };
+  SizeValueType                                   m_NumberOfSlowestSamples{ 0 };
+  std::chrono::steady_clock::time_point           m_LastEventTime;
+  TimingImagePointer                              m_TimingImage;
+  double *                                        m_TimingBuffer{ nullptr };
+  SizeValueType                                   m_NumberOfTimedSamples{ 0 };
+  double                                          m_TotalElapsedTime{ 0.0 };
+  std::vector<double>                             m_SliceElapsedTimes;
+  std::vector<SizeValueType>                      m_SliceNumberOfTimedSamples;
+  std::vector<std::pair<double, OffsetValueType>> m_SlowestSamplesHeap;
+  mutable std::mutex                              m_TimingMutex;
+
+  /** Online reduction settings. */
+  bool          m_ComputeStatistics{ false };
+  SizeValueType m_NumberOfLocalMinima{ 0 };
+  SizeValueType m_LocalMinimaRadius{ 1 };
+  SizeValueType m_NumberOfHistogramBins{ 0 };
+  double        m_HistogramMinimum{ 0.0 };
+  double        m_HistogramMaximum{ 1.0 };
+  bool          m_ComputeProjections{ false };
+  bool          m_StoreLattice{ true };
+
+  /** Batched queries: settings, then the B-spline interpolator built on demand. */
+  double                             m_OutsideValue{ std::numeric_limits<double>::quiet_NaN() };
+  unsigned int                       m_NumberOfQueryWorkUnits{ 1 };
+  mutable BSplineInterpolatorPointer m_BSplineInterpolator;
+  mutable std::atomic<bool>          m_BSplineCoefficientsCurrent{ false };
+  mutable std::mutex                 m_QueryMutex;
+
+  /** Image materialized from chunked storage by GetImage(), kept for GetDataImage()
+   *  and reused while no sample has been written since. Writers only clear the flag;
+   *  the image is replaced and read under m_MaterializeMutex. */
+  mutable ImagePointer      m_MaterializedImage;
+  mutable std::atomic<bool> m_MaterializedImageCurrent{ false };
+  mutable std::mutex        m_MaterializeMutex;
 };
 } // namespace itk
 
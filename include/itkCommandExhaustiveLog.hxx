@@ -23,6 +23,14 @@
 
 #include "itkCommand.h"
 #include "itkExhaustiveOptimizerv4.h"
+#include "itkMath.h"
+#include "itkMultiThreaderBase.h"
+#include "itkNumericTraits.h"
+
+#include <algorithm>
+#include <cmath>
+#include <fstream>
+#include <functional>
 
 namespace itk
 {
@@ -31,7 +39,16 @@ CommandExhaustiveLog<TValue, TImageDimension>::CommandExhaustiveLog()
 {
   m_Center = PointType();
   m_DataImage = nullptr;
-};
+  m_ChunkSize.Fill(0);
+  m_LatticeSize.Fill(0);
+  m_WholeLatticeSize.Fill(0);
+  m_LatticeStart.Fill(0);
+  m_NextIndex.Fill(0);
+  m_FillValue = NumericTraits<InternalDataType>::ZeroValue();
+  m_StreamWriter = StreamWriterType::New();
+  m_Batcher = BatcherType::New();
+  m_Reducer = ReducerType::New();
+}
 
 template <typename TValue, unsigned int TImageDimension>
 CommandExhaustiveLog<TValue, TImageDimension>::~CommandExhaustiveLog() = default;
@@ -49,33 +66,117 @@ void
 CommandExhaustiveLog<TValue, TImageDimension>::Execute(const itk::Object *      caller,
                                                               const itk::EventObject & event)
 {
-  // Do nothing if event is not recognized
-  if (!itk::StartEvent().CheckEvent(&event) && !itk::IterationEvent().CheckEvent(&event))
+  auto optimizer = static_cast<const OptimizerType *>(caller);
+  if (!optimizer)
   {
     return;
   }
-  else
+
+  // Iterations vastly outnumber other events so they are recognized first.
+  // Do nothing if event is not recognized.
+  if (itk::IterationEvent().CheckEvent(&event))
+  {
+    // Update iteration value without copying the optimizer index
+    RecordIteration(optimizer->GetCurrentIndex(), optimizer->GetCurrentValue());
+  }
+  else if (itk::StartEvent().CheckEvent(&event))
+  {
+    // Initialize at start via optimizer parameters
+    Initialize(optimizer);
+  }
+  else if (itk::EndEvent().CheckEvent(&event))
   {
+    for (CollaboratorType * collaborator : m_Collaborators)
+    {
+      collaborator->Flush();
+    }
+  }
+}
 
-    auto optimizer = static_cast<const OptimizerType *>(caller);
-    if (!optimizer)
+template <typename TValue, unsigned int TImageDimension>
+void
+CommandExhaustiveLog<TValue, TImageDimension>::RecordIteration(const ParametersType & index,
+                                                               const MeasureType      value)
+{
+  // The time since the previous event is charged to this sample
+  double elapsedTime = 0.0;
+  if (m_TimingBuffer != nullptr)
+  {
+    const auto now = std::chrono::steady_clock::now();
+    elapsedTime = std::chrono::duration<double>(now - m_LastEventTime).count();
+    m_LastEventTime = now;
+  }
+
+  if (m_Sharded)
+  {
+    // The optimizer walks the whole lattice; only samples in the shard are kept
+    IndexType latticeIndex;
+    for (unsigned int dim = 0; dim < Dimension; dim++)
     {
-      return;
+      latticeIndex[dim] = static_cast<IndexValueType>(index[dim]);
     }
+    if (m_DataImage->GetLargestPossibleRegion().IsInside(latticeIndex))
+    {
+      const OffsetValueType offset = m_DataImage->ComputeOffset(latticeIndex);
+      SetValueAtOffset(offset, static_cast<InternalDataType>(value));
+      if (m_TimingBuffer != nullptr)
+      {
+        RecordElapsedTime(offset, latticeIndex, elapsedTime);
+      }
+    }
+    return;
+  }
 
-    if (itk::StartEvent().CheckEvent(&event))
+  // The optimizer walks the lattice in data array order, so the expected
+  // position only needs to be confirmed rather than recomputed.
+  for (unsigned int dim = 0; dim < Dimension; dim++)
+  {
+    if (index[dim] != m_NextIndex[dim])
     {
-      // Initialize at start via optimizer parameters
-      Initialize(optimizer);
+      // Nothing is stored before initialization, which the expected order
+      // reaches on the first departure from it
+      if (m_DataImage.IsNull())
+      {
+        return;
+      }
+
+      // Resynchronize when the optimizer leaves the expected order
+      for (unsigned int i = 0; i < Dimension; i++)
+      {
+        m_NextIndex[i] = static_cast<IndexValueType>(index[i]);
+      }
+      m_NextOffset = m_DataImage->ComputeOffset(m_NextIndex);
+      break;
     }
-    else
+  }
+
+  const auto internalValue = static_cast<InternalDataType>(value);
+  if (m_Buffer != nullptr)
+  {
+    m_Buffer[m_NextOffset] = internalValue;
+    MarkSamplesModified();
+  }
+  else if (m_Chunks != nullptr)
+  {
+    SetValue(m_NextIndex, internalValue);
+  }
+  AddSampleToCollaborators(m_NextOffset, &m_NextIndex, internalValue);
+  if (m_TimingBuffer != nullptr)
+  {
+    RecordElapsedTime(m_NextOffset, m_NextIndex, elapsedTime);
+  }
+
+  // Advance to the next position in optimizer order
+  ++m_NextOffset;
+  for (unsigned int dim = 0; dim < Dimension; dim++)
+  {
+    if (static_cast<SizeValueType>(++m_NextIndex[dim]) < m_LatticeSize[dim])
     {
-      // Update iteration value
-      OptimizerType::ParametersType index = optimizer->GetCurrentIndex();
-      OptimizerType::MeasureType    value = optimizer->GetCurrentValue();
-      SetValue(index, value);
+      return;
     }
+    m_NextIndex[dim] = 0;
   }
+  m_NextOffset = 0;
 }
 
 
@@ -83,35 +184,638 @@ template <typename TValue, unsigned int TImageDimension>
 void
 CommandExhaustiveLog<TValue, TImageDimension>::Initialize(const OptimizerType * optimizer)
 {
+  // The optimizer steps by StepLength times the scales
+  ScalesType stepSize = optimizer->GetScales();
+  stepSize *= optimizer->GetStepLength();
+  Initialize(optimizer->GetNumberOfSteps(), stepSize);
+}
+
+template <typename TValue, unsigned int TImageDimension>
+void
+CommandExhaustiveLog<TValue, TImageDimension>::Initialize(const StepsType & numberOfSteps, const ScalesType & scales)
+{
+  if (numberOfSteps.Size() != Dimension || scales.Size() != Dimension)
+  {
+    itkExceptionMacro("Expected " << Dimension << " steps and scales but received " << numberOfSteps.Size()
+                                  << " steps and " << scales.Size() << " scales");
+  }
+
   SizeType    size;
   PointType   origin;
   SpacingType spacing;
 
-  for (int dim = 0; dim < Dimension; dim++)
+  for (unsigned int dim = 0; dim < Dimension; dim++)
   {
     // Compute region size along given dimension
-    size[dim] = optimizer->GetNumberOfSteps()[dim] * 2 + 1;
+    size[dim] = numberOfSteps[dim] * 2 + 1;
 
     // Compute origin position in given dimension
-    origin[dim] = m_Center[dim] - optimizer->GetNumberOfSteps()[dim] * optimizer->GetScales()[dim];
+    origin[dim] = m_Center[dim] - numberOfSteps[dim] * scales[dim];
 
     // Copy spacing to expected type
-    spacing[dim] = optimizer->GetScales()[dim];
+    spacing[dim] = scales[dim];
   }
 
-  m_DataImage = ImageType::New();
-  m_DataImage->SetRegions(size);
+  RegionType region(size);
+  if (m_ShardRegion.GetNumberOfPixels() > 0)
+  {
+    if (!region.IsInside(m_ShardRegion))
+    {
+      itkExceptionMacro("Shard " << m_ShardRegion << " is not inside the lattice of size " << size);
+    }
+    region = m_ShardRegion;
+  }
+
+  // The lattice of the finished level is handed over as it is, so that it is neither
+  // copied nor refilled
+  if (m_RetainingCurrentLevel)
+  {
+    m_LevelImages.push_back((m_Buffer != nullptr || m_Chunks != nullptr) ? GetImage() : nullptr);
+  }
+  m_RetainingCurrentLevel = m_RetainLevels;
+
+  InitializeStorage(region, size, spacing, origin);
+
+  // A resumed stream holds samples that would be lost by recreating it
+  if (m_StreamResumed)
+  {
+    m_StreamWriter->Reopen(this);
+    m_Collaborators.push_back(m_StreamWriter.GetPointer());
+  }
+  else if (m_StreamWriter->Initialize(this))
+  {
+    m_Collaborators.push_back(m_StreamWriter.GetPointer());
+  }
+}
+
+template <typename TValue, unsigned int TImageDimension>
+void
+CommandExhaustiveLog<TValue, TImageDimension>::InitializeStorage(const RegionType &  region,
+                                                                 const SizeType &    latticeSize,
+                                                                 const SpacingType & spacing,
+                                                                 const PointType &   origin)
+{
+  CloseStream();
+  m_Collaborators.clear();
+
+  // A dense image over the same region, whose image and memory are held by no one
+  // else, is refilled rather than allocated again. A supplied container is rebound
+  // instead, which does not allocate either when it is large enough.
+  const SizeType size = region.GetSize();
+  const bool     reuseImage = m_StoreLattice && !m_UseChunkedStorage && m_PixelContainer.IsNull() &&
+                          m_Buffer != nullptr && m_DataImage->GetLargestPossibleRegion() == region &&
+                          m_DataImage->GetReferenceCount() == 1 &&
+                          m_DataImage->GetPixelContainer()->GetReferenceCount() == 1;
+  if (!reuseImage)
+  {
+    m_DataImage = ImageType::New();
+    m_DataImage->SetRegions(region);
+  }
   m_DataImage->SetSpacing(spacing);
   m_DataImage->SetOrigin(origin);
+  {
+    std::lock_guard<std::mutex> lock(m_MaterializeMutex);
+    m_MaterializedImage = nullptr;
+    m_MaterializedImageCurrent = false;
+  }
+  m_StreamCoverage.clear();
+  m_StreamCoverage.shrink_to_fit();
+  m_BSplineCoefficientsCurrent = false;
+  m_LatticeSize = size;
+  m_WholeLatticeSize = latticeSize;
+  m_LatticeStart = region.GetIndex();
+  m_Sharded = (region != RegionType(latticeSize));
+  m_NextIndex.Fill(0);
+  m_NextOffset = 0;
+  m_Buffer = nullptr;
+
+  if (!m_StoreLattice)
+  {
+    InitializeChunks(SizeType());
+  }
+  else if (m_UseChunkedStorage)
+  {
+    InitializeChunks(size);
+  }
+  else
+  {
+    InitializeChunks(SizeType());
+    if (!reuseImage)
+    {
+      AllocateDataImage();
+    }
+    m_DataImage->FillBuffer(m_FillValue);
+    m_Buffer = m_DataImage->GetBufferPointer();
+  }
+
+  // Collaborators are attached only for enabled features, so that the others cost
+  // nothing per sample
+  if (m_Reducer->Initialize(this))
+  {
+    m_Collaborators.push_back(m_Reducer.GetPointer());
+  }
+  if (m_Batcher->Initialize(this))
+  {
+    m_Collaborators.push_back(m_Batcher.GetPointer());
+  }
+  InitializeTiming();
+}
+
+template <typename TValue, unsigned int TImageDimension>
+void
+CommandExhaustiveLog<TValue, TImageDimension>::AllocateDataImage()
+{
+  // A supplied container already holding a retained level cannot take another
+  bool useContainer = m_PixelContainer.IsNotNull();
+  for (const auto & image : m_LevelImages)
+  {
+    useContainer = useContainer && (image.IsNull() || image->GetPixelContainer() != m_PixelContainer);
+  }
 
-  m_DataImage->Allocate();
+  if (useContainer)
+  {
+    m_PixelContainer->Reserve(m_DataImage->GetLargestPossibleRegion().GetNumberOfPixels());
+    m_DataImage->SetPixelContainer(m_PixelContainer);
+  }
+  else
+  {
+    m_DataImage->Allocate();
+  }
+}
+
+template <typename TValue, unsigned int TImageDimension>
+auto
+CommandExhaustiveLog<TValue, TImageDimension>::GetLevelImage(unsigned int level) const -> const ImagePointer
+{
+  if (level >= GetNumberOfLevels())
+  {
+    itkExceptionMacro("Level " << level << " is out of range for " << GetNumberOfLevels() << " retained levels");
+  }
+  if (level < m_LevelImages.size())
+  {
+    return m_LevelImages[level];
+  }
+  return (m_Buffer != nullptr || m_Chunks != nullptr) ? GetImage() : nullptr;
+}
+
+template <typename TValue, unsigned int TImageDimension>
+void
+CommandExhaustiveLog<TValue, TImageDimension>::ClearLevels()
+{
+  m_LevelImages.clear();
+  m_RetainingCurrentLevel = false;
+}
+
+template <typename TValue, unsigned int TImageDimension>
+void
+CommandExhaustiveLog<TValue, TImageDimension>::CloseStream()
+{
+  m_StreamWriter->Close();
+  DetachCollaborator(m_StreamWriter);
+}
+
+template <typename TValue, unsigned int TImageDimension>
+void
+CommandExhaustiveLog<TValue, TImageDimension>::FlushBatch()
+{
+  m_Batcher->Flush();
+}
+
+template <typename TValue, unsigned int TImageDimension>
+void
+CommandExhaustiveLog<TValue, TImageDimension>::DetachCollaborator(const CollaboratorType * collaborator)
+{
+  m_Collaborators.erase(std::remove(m_Collaborators.begin(), m_Collaborators.end(), collaborator),
+                        m_Collaborators.end());
+}
+
+template <typename TValue, unsigned int TImageDimension>
+void
+CommandExhaustiveLog<TValue, TImageDimension>::InitializeTiming()
+{
+  std::lock_guard<std::mutex> lock(m_TimingMutex);
+
+  m_TimingImage = nullptr;
+  m_TimingBuffer = nullptr;
+  m_NumberOfTimedSamples = 0;
+  m_TotalElapsedTime = 0.0;
+  m_SliceElapsedTimes.clear();
+  m_SliceNumberOfTimedSamples.clear();
+  m_SlowestSamplesHeap.clear();
+  m_LastEventTime = std::chrono::steady_clock::now();
+  if (!m_RecordTiming)
+  {
+    return;
+  }
+
+  m_TimingImage = TimingImageType::New();
+  m_TimingImage->SetRegions(m_DataImage->GetLargestPossibleRegion());
+  m_TimingImage->SetSpacing(m_DataImage->GetSpacing());
+  m_TimingImage->SetOrigin(m_DataImage->GetOrigin());
+  m_TimingImage->Allocate();
+  m_TimingImage->FillBuffer(0.0);
+  m_TimingBuffer = m_TimingImage->GetBufferPointer();
+
+  SizeValueType numberOfSlices = 0;
+  for (unsigned int dim = 0; dim < Dimension; dim++)
+  {
+    numberOfSlices += m_LatticeSize[dim];
+  }
+  m_SliceElapsedTimes.assign(numberOfSlices, 0.0);
+  m_SliceNumberOfTimedSamples.assign(numberOfSlices, 0);
+  m_SlowestSamplesHeap.reserve(m_NumberOfSlowestSamples + 1);
+}
+
+template <typename TValue, unsigned int TImageDimension>
+void
+CommandExhaustiveLog<TValue, TImageDimension>::RecordElapsedTime(const OffsetValueType offset,
+                                                                 const IndexType &     index,
+                                                                 double                seconds)
+{
+  std::lock_guard<std::mutex> lock(m_TimingMutex);
+
+  m_TimingBuffer[offset] = seconds;
+  ++m_NumberOfTimedSamples;
+  m_TotalElapsedTime += seconds;
+
+  SizeValueType firstSlice = 0;
+  for (unsigned int dim = 0; dim < Dimension; dim++)
+  {
+    const SizeValueType slice = firstSlice + static_cast<SizeValueType>(index[dim] - m_LatticeStart[dim]);
+    m_SliceElapsedTimes[slice] += seconds;
+    ++m_SliceNumberOfTimedSamples[slice];
+    firstSlice += m_LatticeSize[dim];
+  }
+
+  // Min-heap of the slowest samples, its root the fastest of them
+  if (m_NumberOfSlowestSamples == 0)
+  {
+    return;
+  }
+  if (m_SlowestSamplesHeap.size() < m_NumberOfSlowestSamples)
+  {
+    m_SlowestSamplesHeap.emplace_back(seconds, offset);
+    std::push_heap(m_SlowestSamplesHeap.begin(), m_SlowestSamplesHeap.end(), std::greater<>());
+  }
+  else if (seconds > m_SlowestSamplesHeap.front().first)
+  {
+    std::pop_heap(m_SlowestSamplesHeap.begin(), m_SlowestSamplesHeap.end(), std::greater<>());
+    m_SlowestSamplesHeap.back() = { seconds, offset };
+    std::push_heap(m_SlowestSamplesHeap.begin(), m_SlowestSamplesHeap.end(), std::greater<>());
+  }
+}
+
+template <typename TValue, unsigned int TImageDimension>
+void
+CommandExhaustiveLog<TValue, TImageDimension>::SetElapsedTimeAtOffset(const OffsetValueType offset, double seconds)
+{
+  if (m_TimingBuffer != nullptr)
+  {
+    RecordElapsedTime(offset, m_DataImage->ComputeIndex(offset), seconds);
+  }
+}
+
+template <typename TValue, unsigned int TImageDimension>
+auto
+CommandExhaustiveLog<TValue, TImageDimension>::GetNumberOfTimedSamples() const -> SizeValueType
+{
+  std::lock_guard<std::mutex> lock(m_TimingMutex);
+  return m_NumberOfTimedSamples;
+}
+
+template <typename TValue, unsigned int TImageDimension>
+double
+CommandExhaustiveLog<TValue, TImageDimension>::GetTotalElapsedTime() const
+{
+  std::lock_guard<std::mutex> lock(m_TimingMutex);
+  return m_TotalElapsedTime;
+}
+
+template <typename TValue, unsigned int TImageDimension>
+std::vector<double>
+CommandExhaustiveLog<TValue, TImageDimension>::GetMeanElapsedTimePerSlice(unsigned int dim) const
+{
+  std::lock_guard<std::mutex> lock(m_TimingMutex);
+  if (dim >= Dimension)
+  {
+    itkExceptionMacro("Parameter " << dim << " is out of range for dimension " << Dimension);
+  }
+  if (m_SliceElapsedTimes.empty())
+  {
+    return {};
+  }
+
+  SizeValueType firstSlice = 0;
+  for (unsigned int previous = 0; previous < dim; previous++)
+  {
+    firstSlice += m_LatticeSize[previous];
+  }
+  std::vector<double> means(m_LatticeSize[dim], 0.0);
+  for (SizeValueType slice = 0; slice < m_LatticeSize[dim]; slice++)
+  {
+    const SizeValueType count = m_SliceNumberOfTimedSamples[firstSlice + slice];
+    if (count > 0)
+    {
+      means[slice] = m_SliceElapsedTimes[firstSlice + slice] / static_cast<double>(count);
+    }
+  }
+  return means;
+}
+
+template <typename TValue, unsigned int TImageDimension>
+auto
+CommandExhaustiveLog<TValue, TImageDimension>::GetSlowestSamples() const -> SlowSamplesContainerType
+{
+  std::lock_guard<std::mutex> lock(m_TimingMutex);
+
+  auto sorted = m_SlowestSamplesHeap;
+  std::sort(sorted.begin(), sorted.end(), std::greater<>());
+
+  SlowSamplesContainerType samples;
+  samples.reserve(sorted.size());
+  for (const auto & entry : sorted)
+  {
+    samples.push_back({ entry.first, entry.second, ComputePosition(entry.second) });
+  }
+  return samples;
+}
+
+template <typename TValue, unsigned int TImageDimension>
+auto
+CommandExhaustiveLog<TValue, TImageDimension>::ResumeStream() -> SizeValueType
+{
+  CloseStream();
+  m_StreamResumed = false;
+
+  std::ifstream input(m_StreamFileName, std::ios::in | std::ios::binary);
+  if (!input)
+  {
+    itkExceptionMacro("Cannot open exhaustive log stream " << m_StreamFileName);
+  }
+
+  RegionType  region;
+  SizeType    latticeSize;
+  SpacingType spacing;
+  PointType   origin;
+  StreamSourceType::ReadHeader(input, region, latticeSize, spacing, origin);
+  const std::streamoff headerSize = input.tellg();
+  InitializeStorage(region, latticeSize, spacing, origin);
+  m_ShardRegion = m_Sharded ? region : RegionType();
+  for (unsigned int dim = 0; dim < Dimension; dim++)
+  {
+    m_Center[dim] = origin[dim] + ((latticeSize[dim] - 1) / 2) * spacing[dim];
+  }
+
+  const auto numberOfSamples =
+    static_cast<OffsetValueType>(m_DataImage->GetLargestPossibleRegion().GetNumberOfPixels());
+  // One bit per sample records coverage; missing offsets are listed from it on request
+  m_StreamCoverage.assign(numberOfSamples, false);
+  SizeValueType numberOfRestoredSamples = 0;
+
+  auto restore = [this, &numberOfRestoredSamples, numberOfSamples](OffsetValueType          offset,
+                                                                   const InternalDataType & value) {
+    if (offset >= 0 && offset < numberOfSamples)
+    {
+      StoreValueAtOffset(offset, value);
+      if (!m_StreamCoverage[offset])
+      {
+        m_StreamCoverage[offset] = true;
+        ++numberOfRestoredSamples;
+      }
+    }
+  };
+  const SizeValueType numberOfRecords = StreamSourceType::ReadRecords(input, restore);
+  input.close();
+
+  // Continue appending after the last complete record
+  m_StreamWriter->Resume(this,
+                         headerSize + static_cast<std::streamoff>(numberOfRecords) * StreamSourceType::RecordSize);
+  m_Collaborators.push_back(m_StreamWriter.GetPointer());
+  m_StreamResumed = true;
+
+  return static_cast<SizeValueType>(numberOfSamples) - numberOfRestoredSamples;
+}
+
+template <typename TValue, unsigned int TImageDimension>
+auto
+CommandExhaustiveLog<TValue, TImageDimension>::GetMissingOffsets(OffsetValueType first,
+                                                                 SizeValueType   maximumNumberOfOffsets) const
+  -> std::vector<OffsetValueType>
+{
+  std::vector<OffsetValueType> missingOffsets;
+  const auto                   numberOfSamples = static_cast<OffsetValueType>(m_StreamCoverage.size());
+  for (OffsetValueType offset = std::max(first, OffsetValueType{ 0 });
+       offset < numberOfSamples && missingOffsets.size() < maximumNumberOfOffsets;
+       offset++)
+  {
+    if (!m_StreamCoverage[offset])
+    {
+      missingOffsets.push_back(offset);
+    }
+  }
+  return missingOffsets;
+}
+
+template <typename TValue, unsigned int TImageDimension>
+void
+CommandExhaustiveLog<TValue, TImageDimension>::InitializeChunks(const SizeType & size)
+{
+  m_ChunkBuffers.clear();
+  m_Chunks.reset();
+  m_ChunkLength = 0;
+  m_NumberOfAllocatedChunks = 0;
+
+  if (size[0] == 0)
+  {
+    // Dense storage
+    return;
+  }
+
+  // Automatic extent targets about 2^15 samples per chunk
+  const auto automaticExtent =
+    std::max(SizeValueType{ 2 }, static_cast<SizeValueType>(std::floor(std::pow(32768.0, 1.0 / Dimension))));
+
+  SizeValueType numberOfChunks = 1;
+  m_ChunkLength = 1;
+  for (unsigned int dim = 0; dim < Dimension; dim++)
+  {
+    const SizeValueType extent = (m_ChunkSize[dim] > 0) ? m_ChunkSize[dim] : automaticExtent;
+    m_ChunkExtent[dim] = std::min(extent, size[dim]);
+    m_ChunkGridSize[dim] = (size[dim] + m_ChunkExtent[dim] - 1) / m_ChunkExtent[dim];
+    numberOfChunks *= m_ChunkGridSize[dim];
+    m_ChunkLength *= m_ChunkExtent[dim];
+  }
+
+  m_ChunkBuffers.resize(numberOfChunks);
+  m_Chunks.reset(new std::atomic<InternalDataType *>[numberOfChunks]);
+  for (SizeValueType chunk = 0; chunk < numberOfChunks; chunk++)
+  {
+    m_Chunks[chunk].store(nullptr, std::memory_order_relaxed);
+  }
+}
+
+template <typename TValue, unsigned int TImageDimension>
+void
+CommandExhaustiveLog<TValue, TImageDimension>::ComputeChunkLocation(const IndexType & index,
+                                                                    SizeValueType &   chunk,
+                                                                    SizeValueType &   offsetInChunk) const
+{
+  chunk = 0;
+  offsetInChunk = 0;
+  SizeValueType chunkStride = 1;
+  SizeValueType sampleStride = 1;
+  for (unsigned int dim = 0; dim < Dimension; dim++)
+  {
+    const auto position = static_cast<SizeValueType>(index[dim] - m_LatticeStart[dim]);
+    chunk += (position / m_ChunkExtent[dim]) * chunkStride;
+    offsetInChunk += (position % m_ChunkExtent[dim]) * sampleStride;
+    chunkStride *= m_ChunkGridSize[dim];
+    sampleStride *= m_ChunkExtent[dim];
+  }
+}
+
+template <typename TValue, unsigned int TImageDimension>
+auto
+CommandExhaustiveLog<TValue, TImageDimension>::GetOrAllocateChunk(SizeValueType chunk) -> InternalDataType *
+{
+  InternalDataType * buffer = m_Chunks[chunk].load(std::memory_order_acquire);
+  if (buffer == nullptr)
+  {
+    std::lock_guard<std::mutex> lock(m_ChunkMutex);
+    buffer = m_Chunks[chunk].load(std::memory_order_relaxed);
+    if (buffer == nullptr)
+    {
+      m_ChunkBuffers[chunk].reset(new InternalDataType[m_ChunkLength]);
+      buffer = m_ChunkBuffers[chunk].get();
+      std::fill_n(buffer, m_ChunkLength, m_FillValue);
+      m_Chunks[chunk].store(buffer, std::memory_order_release);
+      ++m_NumberOfAllocatedChunks;
+    }
+  }
+  return buffer;
+}
+
+template <typename TValue, unsigned int TImageDimension>
+auto
+CommandExhaustiveLog<TValue, TImageDimension>::MaterializeImage() const -> ImagePointer
+{
+  ImagePointer image = ImageType::New();
+  image->CopyInformation(m_DataImage);
+  image->SetRegions(m_DataImage->GetLargestPossibleRegion());
+  image->Allocate();
+  image->FillBuffer(m_FillValue);
+
+  const SizeType          size = GetSize();
+  const OffsetValueType * offsetTable = image->GetOffsetTable();
+  InternalDataType *      output = image->GetBufferPointer();
+
+  const SizeValueType numberOfChunks = m_ChunkBuffers.size();
+  for (SizeValueType chunk = 0; chunk < numberOfChunks; chunk++)
+  {
+    const InternalDataType * buffer = m_Chunks[chunk].load(std::memory_order_acquire);
+    if (buffer == nullptr)
+    {
+      continue;
+    }
+
+    // Chunk start and extent clipped to the lattice
+    SizeValueType start[TImageDimension];
+    SizeValueType extent[TImageDimension];
+    SizeValueType remainder = chunk;
+    for (unsigned int dim = 0; dim < Dimension; dim++)
+    {
+      start[dim] = (remainder % m_ChunkGridSize[dim]) * m_ChunkExtent[dim];
+      extent[dim] = std::min(m_ChunkExtent[dim], size[dim] - start[dim]);
+      remainder /= m_ChunkGridSize[dim];
+    }
+
+    // Copy one row along dimension 0 at a time
+    SizeValueType local[TImageDimension] = {};
+    unsigned int  carry = 0;
+    while (carry < Dimension)
+    {
+      OffsetValueType outputOffset = 0;
+      SizeValueType   chunkOffset = 0;
+      SizeValueType   sampleStride = 1;
+      for (unsigned int dim = 0; dim < Dimension; dim++)
+      {
+        outputOffset += static_cast<OffsetValueType>(start[dim] + local[dim]) * offsetTable[dim];
+        chunkOffset += local[dim] * sampleStride;
+        sampleStride *= m_ChunkExtent[dim];
+      }
+      std::copy_n(buffer + chunkOffset, extent[0], output + outputOffset);
+
+      for (carry = 1; carry < Dimension; carry++)
+      {
+        if (++local[carry] < extent[carry])
+        {
+          break;
+        }
+        local[carry] = 0;
+      }
+    }
+  }
+
+  return image;
+}
+
+template <typename TValue, unsigned int TImageDimension>
+auto
+CommandExhaustiveLog<TValue, TImageDimension>::GetImage() const -> const ImagePointer
+{
+  if (m_DataImage.IsNull() || m_Buffer != nullptr)
+  {
+    return m_DataImage;
+  }
+  VerifyLatticeStored();
+
+  // Marked current before the chunks are read, so that a sample written meanwhile
+  // marks the copy outdated again
+  std::lock_guard<std::mutex> lock(m_MaterializeMutex);
+  if (!m_MaterializedImageCurrent.exchange(true) || m_MaterializedImage.IsNull())
+  {
+    m_MaterializedImage = MaterializeImage();
+  }
+  return m_MaterializedImage;
 }
 
 template <typename TValue, unsigned int TImageDimension>
 const TValue
 CommandExhaustiveLog<TValue, TImageDimension>::GetValue(const IndexType & index) const
 {
-  return m_DataImage->GetPixel(index);
+  if (m_Buffer != nullptr)
+  {
+    return m_DataImage->GetPixel(index);
+  }
+  VerifyLatticeStored();
+
+  SizeValueType chunk;
+  SizeValueType offsetInChunk;
+  ComputeChunkLocation(index, chunk, offsetInChunk);
+  const InternalDataType * buffer = m_Chunks[chunk].load(std::memory_order_acquire);
+  return (buffer != nullptr) ? buffer[offsetInChunk] : m_FillValue;
+}
+
+template <typename TValue, unsigned int TImageDimension>
+const TValue
+CommandExhaustiveLog<TValue, TImageDimension>::GetValueAtOffset(const OffsetValueType offset) const
+{
+  if (m_Buffer != nullptr)
+  {
+    return m_Buffer[offset];
+  }
+  VerifyLatticeStored();
+  return GetValue(m_DataImage->ComputeIndex(offset));
+}
+
+template <typename TValue, unsigned int TImageDimension>
+void
+CommandExhaustiveLog<TValue, TImageDimension>::VerifyLatticeStored() const
+{
+  if (m_Buffer == nullptr && m_Chunks == nullptr)
+  {
+    itkExceptionMacro("Lattice samples are not stored; enable StoreLattice before initialization");
+  }
 }
 
 template <typename TValue, unsigned int TImageDimension>
@@ -136,11 +840,212 @@ CommandExhaustiveLog<TValue, TImageDimension>::GetValue(const ParametersType & p
   return GetValue(point);
 }
 
+template <typename TValue, unsigned int TImageDimension>
+void
+CommandExhaustiveLog<TValue, TImageDimension>::GetValues(const double *    parameters,
+                                                         SizeValueType     numberOfPoints,
+                                                         double *          values,
+                                                         InterpolationEnum interpolation) const
+{
+  if (m_DataImage.IsNull())
+  {
+    itkExceptionMacro("Cannot query an exhaustive log that has not been initialized");
+  }
+  VerifyLatticeStored();
+
+  // Held for the whole batch in case samples change and another query replaces it
+  const BSplineInterpolatorPointer bspline =
+    (interpolation == InterpolationEnum::BSpline) ? GetBSplineInterpolator() : nullptr;
+
+  // Parts are large enough that dispatching them costs little next to answering them
+  constexpr SizeValueType minimumPartLength = 4096;
+  const SizeValueType     numberOfParts =
+    std::min<SizeValueType>(m_NumberOfQueryWorkUnits, (numberOfPoints + minimumPartLength - 1) / minimumPartLength);
+  if (numberOfParts <= 1)
+  {
+    EvaluateQueries(parameters, 0, numberOfPoints, values, interpolation, bspline.GetPointer());
+    return;
+  }
+
+  auto threader = MultiThreaderBase::New();
+  threader->SetNumberOfWorkUnits(static_cast<ThreadIdType>(numberOfParts));
+  threader->ParallelizeArray(
+    0,
+    numberOfParts,
+    [&](SizeValueType part) {
+      const SizeValueType begin = numberOfPoints * part / numberOfParts;
+      const SizeValueType end = numberOfPoints * (part + 1) / numberOfParts;
+      EvaluateQueries(parameters, begin, end, values, interpolation, bspline.GetPointer());
+    },
+    nullptr);
+}
+
+template <typename TValue, unsigned int TImageDimension>
+std::vector<double>
+CommandExhaustiveLog<TValue, TImageDimension>::GetValues(const std::vector<double> & parameters,
+                                                         InterpolationEnum           interpolation) const
+{
+  if (parameters.size() % Dimension != 0)
+  {
+    itkExceptionMacro("Expected rows of " << Dimension << " parameters but received " << parameters.size()
+                                          << " values");
+  }
+
+  std::vector<double> values(parameters.size() / Dimension);
+  GetValues(parameters.data(), values.size(), values.data(), interpolation);
+  return values;
+}
+
+template <typename TValue, unsigned int TImageDimension>
+void
+CommandExhaustiveLog<TValue, TImageDimension>::EvaluateQueries(const double *                  parameters,
+                                                               SizeValueType                   begin,
+                                                               SizeValueType                   end,
+                                                               double *                        values,
+                                                               InterpolationEnum               interpolation,
+                                                               const BSplineInterpolatorType * bspline) const
+{
+  // Geometry is hoisted out of the loop so that each position costs only arithmetic
+  const OffsetValueType * offsetTable = m_DataImage->GetOffsetTable();
+  const SpacingType &     spacing = m_DataImage->GetSpacing();
+  const PointType &       origin = m_DataImage->GetOrigin();
+  double                  inverseSpacing[TImageDimension];
+  double                  first[TImageDimension];
+  double                  last[TImageDimension];
+  for (unsigned int dim = 0; dim < Dimension; dim++)
+  {
+    inverseSpacing[dim] = 1.0 / spacing[dim];
+    first[dim] = static_cast<double>(m_LatticeStart[dim]);
+    last[dim] = first[dim] + static_cast<double>(m_LatticeSize[dim] - 1);
+  }
+
+  // Samples are read from the dense buffer, or through the chunks, at a lattice index
+  auto readSample = [this, offsetTable](const IndexType & index) -> double {
+    if (m_Buffer == nullptr)
+    {
+      return static_cast<double>(GetValue(index));
+    }
+    OffsetValueType offset = 0;
+    for (unsigned int dim = 0; dim < Dimension; dim++)
+    {
+      offset += (index[dim] - m_LatticeStart[dim]) * offsetTable[dim];
+    }
+    return static_cast<double>(m_Buffer[offset]);
+  };
+
+  typename BSplineInterpolatorType::ContinuousIndexType continuousIndex;
+  IndexType                                             lower;
+  IndexType                                             corner;
+  double                                                fraction[TImageDimension];
+  IndexValueType                                        upperStep[TImageDimension];
+
+  const double * position = parameters + begin * Dimension;
+  for (SizeValueType point = begin; point < end; point++, position += Dimension)
+  {
+    bool inside = true;
+    for (unsigned int dim = 0; dim < Dimension; dim++)
+    {
+      continuousIndex[dim] = (position[dim] - origin[dim]) * inverseSpacing[dim];
+    }
+
+    if (interpolation == InterpolationEnum::NearestNeighbor)
+    {
+      // Rounded as by Image::TransformPhysicalPointToIndex
+      for (unsigned int dim = 0; dim < Dimension; dim++)
+      {
+        lower[dim] = Math::RoundHalfIntegerUp<IndexValueType>(continuousIndex[dim]);
+        inside = inside && lower[dim] >= m_LatticeStart[dim] &&
+                 lower[dim] < m_LatticeStart[dim] + static_cast<IndexValueType>(m_LatticeSize[dim]);
+      }
+      values[point] = inside ? readSample(lower) : m_OutsideValue;
+      continue;
+    }
+
+    for (unsigned int dim = 0; dim < Dimension; dim++)
+    {
+      inside = inside && continuousIndex[dim] >= first[dim] && continuousIndex[dim] <= last[dim];
+    }
+    if (!inside)
+    {
+      values[point] = m_OutsideValue;
+    }
+    else if (interpolation == InterpolationEnum::BSpline)
+    {
+      values[point] = bspline->EvaluateAtContinuousIndex(continuousIndex);
+    }
+    else
+    {
+      // Multilinear: the 2^Dimension corners of the cell, the upper corner coinciding
+      // with the lower one on the last sample of a dimension
+      for (unsigned int dim = 0; dim < Dimension; dim++)
+      {
+        lower[dim] = static_cast<IndexValueType>(std::floor(continuousIndex[dim]));
+        fraction[dim] = continuousIndex[dim] - static_cast<double>(lower[dim]);
+        upperStep[dim] = (static_cast<double>(lower[dim]) < last[dim]) ? 1 : 0;
+      }
+
+      double value = 0.0;
+      for (unsigned int cornerNumber = 0; cornerNumber < (1u << Dimension); cornerNumber++)
+      {
+        double weight = 1.0;
+        for (unsigned int dim = 0; dim < Dimension; dim++)
+        {
+          const bool upper = (cornerNumber >> dim) & 1u;
+          corner[dim] = lower[dim] + (upper ? upperStep[dim] : 0);
+          weight *= upper ? fraction[dim] : 1.0 - fraction[dim];
+        }
+        if (weight != 0.0)
+        {
+          value += weight * readSample(corner);
+        }
+      }
+      values[point] = value;
+    }
+  }
+}
+
+template <typename TValue, unsigned int TImageDimension>
+auto
+CommandExhaustiveLog<TValue, TImageDimension>::GetBSplineInterpolator() const -> BSplineInterpolatorPointer
+{
+  std::lock_guard<std::mutex> lock(m_QueryMutex);
+  if (m_BSplineInterpolator.IsNull() || !m_BSplineCoefficientsCurrent)
+  {
+    // Marked current before the samples are read, so that a sample written meanwhile
+    // marks the coefficients outdated again. Samples are written without modifying
+    // the image, so a new interpolator is needed for its coefficients to be updated.
+    m_BSplineCoefficientsCurrent = true;
+    auto interpolator = BSplineInterpolatorType::New();
+    interpolator->SetSplineOrder(3);
+    interpolator->SetInputImage(GetImage());
+    m_BSplineInterpolator = interpolator;
+  }
+  return m_BSplineInterpolator;
+}
+
 template <typename TValue, unsigned int TImageDimension>
 void
 CommandExhaustiveLog<TValue, TImageDimension>::SetValue(const IndexType & index, const InternalDataType & value)
 {
-  m_DataImage->SetPixel(index, value);
+  MarkSamplesModified();
+  if (m_Chunks == nullptr)
+  {
+    if (m_Buffer != nullptr)
+    {
+      m_DataImage->SetPixel(index, value);
+    }
+    return;
+  }
+
+  if (m_MaterializedImageCurrent.load(std::memory_order_relaxed))
+  {
+    m_MaterializedImageCurrent.store(false, std::memory_order_relaxed);
+  }
+
+  SizeValueType chunk;
+  SizeValueType offsetInChunk;
+  ComputeChunkLocation(index, chunk, offsetInChunk);
+  GetOrAllocateChunk(chunk)[offsetInChunk] = value;
 }
 
 template <typename TValue, unsigned int TImageDimension>
@@ -157,6 +1062,90 @@ CommandExhaustiveLog<TValue, TImageDimension>::SetValue(const ParametersType &
   SetValue(baseIndex, value);
 }
 
+template <typename TValue, unsigned int TImageDimension>
+void
+CommandExhaustiveLog<TValue, TImageDimension>::SetValueAtOffset(const OffsetValueType    offset,
+                                                                const InternalDataType & value)
+{
+  StoreValueAtOffset(offset, value);
+  AddSampleToCollaborators(offset, nullptr, value);
+}
+
+template <typename TValue, unsigned int TImageDimension>
+void
+CommandExhaustiveLog<TValue, TImageDimension>::BeginConcurrentWrites(ThreadIdType numberOfWorkUnits)
+{
+  for (CollaboratorType * collaborator : m_Collaborators)
+  {
+    collaborator->BeginConcurrentSamples(numberOfWorkUnits);
+  }
+}
+
+template <typename TValue, unsigned int TImageDimension>
+void
+CommandExhaustiveLog<TValue, TImageDimension>::SetValueAtOffset(const OffsetValueType    offset,
+                                                                const InternalDataType & value,
+                                                                ThreadIdType             workUnit)
+{
+  StoreValueAtOffset(offset, value);
+  for (CollaboratorType * collaborator : m_Collaborators)
+  {
+    collaborator->AddConcurrentSample(workUnit, offset, nullptr, value);
+  }
+}
+
+template <typename TValue, unsigned int TImageDimension>
+void
+CommandExhaustiveLog<TValue, TImageDimension>::EndConcurrentWrites()
+{
+  for (CollaboratorType * collaborator : m_Collaborators)
+  {
+    collaborator->EndConcurrentSamples();
+  }
+}
+
+template <typename TValue, unsigned int TImageDimension>
+void
+CommandExhaustiveLog<TValue, TImageDimension>::StoreValueAtOffset(const OffsetValueType    offset,
+                                                                  const InternalDataType & value)
+{
+  if (m_Buffer != nullptr)
+  {
+    m_Buffer[offset] = value;
+    MarkSamplesModified();
+    return;
+  }
+  if (m_Chunks != nullptr)
+  {
+    SetValue(m_DataImage->ComputeIndex(offset), value);
+  }
+}
+
+template <typename TValue, unsigned int TImageDimension>
+auto
+CommandExhaustiveLog<TValue, TImageDimension>::ComputePosition(const OffsetValueType offset) const -> PointType
+{
+  PointType position;
+  m_DataImage->TransformIndexToPhysicalPoint(m_DataImage->ComputeIndex(offset), position);
+  return position;
+}
+
+template <typename TValue, unsigned int TImageDimension>
+auto
+CommandExhaustiveLog<TValue, TImageDimension>::GetMinimumPosition() const -> PointType
+{
+  const OffsetValueType offset = m_Reducer->GetMinimumOffset();
+  return (offset < 0) ? m_Center : ComputePosition(offset);
+}
+
+template <typename TValue, unsigned int TImageDimension>
+auto
+CommandExhaustiveLog<TValue, TImageDimension>::GetMaximumPosition() const -> PointType
+{
+  const OffsetValueType offset = m_Reducer->GetMaximumOffset();
+  return (offset < 0) ? m_Center : ComputePosition(offset);
+}
+
 } // namespace itk
 
 #endif // itkCommandExhaustiveLog_hxx
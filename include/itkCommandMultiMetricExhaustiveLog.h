@@ -0,0 +1,293 @@
+/*=========================================================================
+ *
+ *  Copyright NumFOCUS
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *         https://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *=========================================================================*/
+#ifndef itkCommandMultiMetricExhaustiveLog_h
+#define itkCommandMultiMetricExhaustiveLog_h
+
+#include "itkMacro.h"
+#include "itkCommand.h"
+#include "itkExhaustiveOptimizerv4.h"
+#include "itkImage.h"
+#include "itkVectorImage.h"
+
+#include <vector>
+
+namespace itk
+{
+/**
+ *\class CommandMultiMetricExhaustiveLog
+ *  \brief Monitors ExhaustiveOptimizerv4 and logs several metrics over its lattice.
+ *
+ * Comparing metrics over the same parameter window with one CommandExhaustiveLog
+ * per metric takes one sweep per metric, repeating the transform updates and the
+ * lattice traversal. This observer follows a single ExhaustiveOptimizerv4 sweep and,
+ * on each IterationEvent, records the value reported by the optimizer in channel 0
+ * and evaluates each metric added through AddMetric() at the same position into the
+ * following channels, so that every lattice sample holds one value per metric.
+ *
+ * Added metrics must be fully initialized. A metric whose parameters differ from
+ * the current position is given that position, so independent transforms are
+ * supported; such a metric is given back the parameters it had at initialization
+ * on EndEvent. A metric set up with the moving transform of the optimizer metric
+ * finds it already moved and is neither updated again nor restored, so that the
+ * transform parameters are set once per sample. Each metric still maps its own sample points
+ * through the transform when evaluated; the mapped points are not shared between
+ * metrics.
+ *
+ * Channels are stored interleaved, all values of a sample together, or planar, one
+ * contiguous plane per channel (see ChannelLayout). The layout decides which view
+ * comes without a copy: GetImage() returns the interleaved data as a VectorImage,
+ * and GetChannelImage() the plane of one channel as an Image. The other view is
+ * assembled on request.
+ *
+ * Storage is always dense; chunked storage, streaming, reductions and shards
+ * remain specific to CommandExhaustiveLog.
+ *
+ * Template parameters for class CommandMultiMetricExhaustiveLog:
+ *
+ * - TValue = Element type stored for each channel of a lattice sample.
+ * - TImageDimension = Dimension of image equal to number of transform parameters
+ *
+ * \ingroup ITKOptimizationMonitor
+ */
+template <typename TValue, unsigned int TImageDimension>
+class CommandMultiMetricExhaustiveLog : public itk::Command
+{
+public:
+  ITK_DISALLOW_COPY_AND_MOVE(CommandMultiMetricExhaustiveLog);
+
+  using Self = CommandMultiMetricExhaustiveLog;
+  using Superclass = itk::Command;
+  using Pointer = itk::SmartPointer<Self>;
+  itkNewMacro(Self);
+  itkOverrideGetNameOfClassMacro(CommandMultiMetricExhaustiveLog);
+
+  /** Data type for sample values */
+  using InternalDataType = TValue;
+  /** Image dimension */
+  static constexpr unsigned int Dimension = TImageDimension;
+
+  using OptimizerType = itk::ExhaustiveOptimizerv4<double>;
+  using MetricType = typename OptimizerType::MetricType;
+  using MetricPointer = typename MetricType::Pointer;
+
+  /** Samples of all channels, and of one channel. */
+  using VectorImageType = itk::VectorImage<InternalDataType, Dimension>;
+  using VectorImagePointer = typename VectorImageType::Pointer;
+  using ImageType = itk::Image<InternalDataType, Dimension>;
+  using ImagePointer = typename ImageType::Pointer;
+  /** Values of all channels at one sample. */
+  using PixelType = typename VectorImageType::PixelType;
+
+  using SizeType = typename ImageType::SizeType;
+  using SizeValueType = typename ImageType::SizeValueType;
+  using IndexType = typename ImageType::IndexType;
+  using IndexValueType = typename ImageType::IndexValueType;
+  using RegionType = typename ImageType::RegionType;
+  using SpacingType = typename ImageType::SpacingType;
+  using PointType = typename ImageType::PointType;
+  /** Linear position of a sample in the lattice. */
+  using OffsetValueType = typename ImageType::OffsetValueType;
+
+  /** Default optimizer geometric output type. */
+  using ParametersType = typename OptimizerType::ParametersType;
+  /** Metric value reported by the optimizer. */
+  using MeasureType = typename OptimizerType::MeasureType;
+  /** Number of steps on each side of the center along each dimension. */
+  using StepsType = typename OptimizerType::StepsType;
+  /** Distance between samples along each dimension. */
+  using ScalesType = typename OptimizerType::ScalesType;
+
+  /** Arrangement of channels in memory. */
+  enum class ChannelLayoutEnum : uint8_t
+  {
+    Interleaved,
+    Planar
+  };
+
+  /** Observe an event fired by calling object. */
+  void
+  Execute(itk::Object * caller, const itk::EventObject & event) override;
+
+  /** Observe an event fired by calling object. */
+  void
+  Execute(const itk::Object * caller, const itk::EventObject & event) override;
+
+  /** Add a metric evaluated at every lattice sample, into the next channel. */
+  void
+  AddMetric(MetricType * metric);
+
+  /** Remove all added metrics. */
+  void
+  ClearMetrics();
+
+  /** Number of metrics added, one less than the number of channels. */
+  unsigned int
+  GetNumberOfMetrics() const
+  {
+    return static_cast<unsigned int>(m_Metrics.size());
+  }
+
+  /** Interleaved, the default, or planar storage of channels. Takes effect at the
+   *  next initialization, on StartEvent or Initialize(): until then the storage,
+   *  and so which of GetImage() and GetChannelImage() shares it without a copy,
+   *  keep the layout of the last initialization. */
+  itkSetEnumMacro(ChannelLayout, ChannelLayoutEnum);
+  itkGetEnumMacro(ChannelLayout, ChannelLayoutEnum);
+
+  /** Center of exhaustive region used to compute the origin at initialization. */
+  itkSetMacro(Center, PointType);
+  itkGetConstMacro(Center, PointType);
+
+  /** Value of samples that have not been written. Defaults to zero. */
+  itkSetMacro(FillValue, InternalDataType);
+  itkGetConstMacro(FillValue, InternalDataType);
+
+  /** Allocate one channel for the optimizer metric and one per added metric over a
+   *  lattice of (2 * steps + 1) samples along each dimension spaced by the given
+   *  scales. Called on StartEvent with the optimizer settings. */
+  void
+  Initialize(const StepsType & numberOfSteps, const ScalesType & scales);
+
+  /** Whether the lattice geometry and storage have been set up. */
+  bool
+  IsInitialized() const
+  {
+    return m_NumberOfChannels > 0;
+  }
+
+  /** Number of values per sample, fixed at initialization. */
+  unsigned int
+  GetNumberOfChannels() const
+  {
+    return m_NumberOfChannels;
+  }
+
+  /** Lattice geometry. */
+  const RegionType &
+  GetRegion() const
+  {
+    return m_Region;
+  }
+  SizeValueType
+  GetNumberOfSamples() const
+  {
+    return m_Region.GetNumberOfPixels();
+  }
+  itkGetConstReferenceMacro(Origin, PointType);
+  itkGetConstReferenceMacro(StepSize, SpacingType);
+
+  /** Physical position of the sample at a linear offset, dimension 0 varying fastest. */
+  PointType
+  ComputePosition(const OffsetValueType offset) const;
+
+  /** Set the value of a channel at a linear offset. Concurrent calls are safe for
+   *  distinct samples or channels. */
+  void
+  SetValueAtOffset(const OffsetValueType offset, unsigned int channel, const InternalDataType & value)
+  {
+    m_ChannelBuffers[channel][offset * m_ChannelStride] = value;
+  }
+
+  /** Value of a channel at a linear offset. */
+  const TValue
+  GetValueAtOffset(const OffsetValueType offset, unsigned int channel) const
+  {
+    return m_ChannelBuffers[channel][offset * m_ChannelStride];
+  }
+
+  /** Value of a channel at a lattice index, or at the sample nearest to a position in
+   *  parameter space. Throws if the channel, index or position is out of range. */
+  const TValue
+  GetValue(const IndexType & index, unsigned int channel) const;
+  const TValue
+  GetValue(const PointType & point, unsigned int channel) const;
+  const TValue
+  GetValue(const ParametersType & parameters, unsigned int channel) const;
+
+  /** Values of all channels at a lattice index. */
+  PixelType
+  GetPixel(const IndexType & index) const;
+
+  /** All channels as a vector image, shared with the log for interleaved storage and
+   *  assembled on each call for planar storage. */
+  VectorImagePointer
+  GetImage() const;
+
+  /** One channel as an image, shared with the log for planar storage and extracted on
+   *  each call for interleaved storage. */
+  ImagePointer
+  GetChannelImage(unsigned int channel) const;
+
+protected:
+  CommandMultiMetricExhaustiveLog();
+  ~CommandMultiMetricExhaustiveLog() override = default;
+
+  void
+  PrintSelf(std::ostream & os, Indent indent) const override;
+
+private:
+  /** Record the optimizer value and evaluate the added metrics at its position. */
+  void
+  RecordIteration(const OptimizerType * optimizer);
+
+  /** Give the metrics moved by RecordIteration() back their parameters at initialization. */
+  void
+  RestoreMetrics();
+
+  /** Linear offset of a lattice index. Throws outside the lattice. */
+  OffsetValueType
+  ComputeOffset(const IndexType & index) const;
+
+  /** Throw unless the channel exists. */
+  void
+  VerifyChannel(unsigned int channel) const;
+
+  /** Added metrics, with their parameters at initialization and whether the log
+   *  has moved them since. */
+  std::vector<MetricPointer>  m_Metrics;
+  std::vector<ParametersType> m_MetricInitialParameters;
+  std::vector<bool>           m_MetricsMoved;
+  ChannelLayoutEnum          m_ChannelLayout{ ChannelLayoutEnum::Interleaved };
+  PointType                  m_Center;
+  InternalDataType           m_FillValue{};
+
+  RegionType   m_Region;
+  PointType    m_Origin;
+  SpacingType  m_StepSize;
+  unsigned int m_NumberOfChannels{ 0 };
+
+  /** Storage: the vector image for interleaved channels or one image per channel,
+   *  and the first value of each channel with the distance between samples. */
+  VectorImagePointer              m_VectorImage;
+  std::vector<ImagePointer>       m_ChannelImages;
+  std::vector<InternalDataType *> m_ChannelBuffers;
+  OffsetValueType                 m_ChannelStride{ 1 };
+
+  /** Lattice index and offset expected for the next optimizer sample, and the
+   *  position handed to added metrics. */
+  IndexType       m_NextIndex;
+  OffsetValueType m_NextOffset{ 0 };
+  ParametersType  m_Position;
+};
+} // namespace itk
+
+#ifndef ITK_MANUAL_INSTANTIATION
+#  include "itkCommandMultiMetricExhaustiveLog.hxx"
+#endif
+
+#endif // itkCommandMultiMetricExhaustiveLog_h
@@ -0,0 +1,436 @@
+/*=========================================================================
+ *
+ *  Copyright NumFOCUS
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *         https://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *=========================================================================*/
+
+#ifndef itkCommandMultiMetricExhaustiveLog_hxx
+#define itkCommandMultiMetricExhaustiveLog_hxx
+
+#include "itkCommandMultiMetricExhaustiveLog.h"
+#include "itkMath.h"
+
+#include <algorithm>
+
+namespace itk
+{
+template <typename TValue, unsigned int TImageDimension>
+CommandMultiMetricExhaustiveLog<TValue, TImageDimension>::CommandMultiMetricExhaustiveLog()
+{
+  m_Center.Fill(0.0);
+  m_Origin.Fill(0.0);
+  m_StepSize.Fill(1.0);
+  m_NextIndex.Fill(0);
+}
+
+template <typename TValue, unsigned int TImageDimension>
+void
+CommandMultiMetricExhaustiveLog<TValue, TImageDimension>::Execute(itk::Object * caller, const itk::EventObject & event)
+{
+  Execute((const itk::Object *)caller, event);
+}
+
+template <typename TValue, unsigned int TImageDimension>
+void
+CommandMultiMetricExhaustiveLog<TValue, TImageDimension>::Execute(const itk::Object *     caller,
+                                                                  const itk::EventObject & event)
+{
+  auto optimizer = static_cast<const OptimizerType *>(caller);
+  if (!optimizer)
+  {
+    return;
+  }
+
+  // Iterations vastly outnumber other events so they are recognized first.
+  if (itk::IterationEvent().CheckEvent(&event))
+  {
+    RecordIteration(optimizer);
+  }
+  else if (itk::StartEvent().CheckEvent(&event))
+  {
+    // The optimizer steps by StepLength times the scales
+    ScalesType stepSize = optimizer->GetScales();
+    stepSize *= optimizer->GetStepLength();
+    Initialize(optimizer->GetNumberOfSteps(), stepSize);
+  }
+  else if (itk::EndEvent().CheckEvent(&event))
+  {
+    RestoreMetrics();
+  }
+}
+
+template <typename TValue, unsigned int TImageDimension>
+void
+CommandMultiMetricExhaustiveLog<TValue, TImageDimension>::AddMetric(MetricType * metric)
+{
+  if (metric == nullptr)
+  {
+    itkExceptionMacro("Cannot add a null metric");
+  }
+  m_Metrics.emplace_back(metric);
+  m_MetricInitialParameters.push_back(metric->GetParameters());
+  m_MetricsMoved.push_back(false);
+  this->Modified();
+}
+
+template <typename TValue, unsigned int TImageDimension>
+void
+CommandMultiMetricExhaustiveLog<TValue, TImageDimension>::ClearMetrics()
+{
+  m_Metrics.clear();
+  m_MetricInitialParameters.clear();
+  m_MetricsMoved.clear();
+  this->Modified();
+}
+
+template <typename TValue, unsigned int TImageDimension>
+void
+CommandMultiMetricExhaustiveLog<TValue, TImageDimension>::RecordIteration(const OptimizerType * optimizer)
+{
+  if (!IsInitialized())
+  {
+    return;
+  }
+
+  // The optimizer walks the lattice in buffer order, so the expected position
+  // only needs to be confirmed rather than recomputed.
+  const ParametersType & index = optimizer->GetCurrentIndex();
+  for (unsigned int dim = 0; dim < Dimension; dim++)
+  {
+    if (static_cast<IndexValueType>(index[dim]) != m_NextIndex[dim])
+    {
+      // Resynchronize when the optimizer leaves the expected order
+      for (unsigned int i = 0; i < Dimension; i++)
+      {
+        m_NextIndex[i] = static_cast<IndexValueType>(index[i]);
+      }
+      m_NextOffset = ComputeOffset(m_NextIndex);
+      break;
+    }
+  }
+
+  SetValueAtOffset(m_NextOffset, 0, static_cast<InternalDataType>(optimizer->GetCurrentValue()));
+
+  // Every added metric is moved to the sample of the optimizer metric. The position
+  // is copied into a member since metrics take their parameters by non-const reference.
+  // Metrics sharing a transform already moved by the optimizer are left as they are,
+  // so that the transform is updated once per sample.
+  if (!m_Metrics.empty())
+  {
+    m_Position = optimizer->GetCurrentPosition();
+    for (unsigned int metric = 0; metric < m_Metrics.size(); metric++)
+    {
+      const ParametersType & parameters = m_Metrics[metric]->GetParameters();
+      bool                   moved = true;
+      for (unsigned int dim = 0; dim < Dimension && moved; dim++)
+      {
+        moved = (parameters[dim] == m_Position[dim]);
+      }
+      if (!moved)
+      {
+        m_Metrics[metric]->SetParameters(m_Position);
+        m_MetricsMoved[metric] = true;
+      }
+      SetValueAtOffset(m_NextOffset, metric + 1, static_cast<InternalDataType>(m_Metrics[metric]->GetValue()));
+    }
+  }
+
+  // Advance to the next position in optimizer order
+  ++m_NextOffset;
+  const SizeType & size = m_Region.GetSize();
+  for (unsigned int dim = 0; dim < Dimension; dim++)
+  {
+    if (static_cast<SizeValueType>(++m_NextIndex[dim]) < size[dim])
+    {
+      return;
+    }
+    m_NextIndex[dim] = 0;
+  }
+  m_NextOffset = 0;
+}
+
+template <typename TValue, unsigned int TImageDimension>
+void
+CommandMultiMetricExhaustiveLog<TValue, TImageDimension>::RestoreMetrics()
+{
+  for (unsigned int metric = 0; metric < m_Metrics.size(); metric++)
+  {
+    if (m_MetricsMoved[metric])
+    {
+      m_Metrics[metric]->SetParameters(m_MetricInitialParameters[metric]);
+      m_MetricsMoved[metric] = false;
+    }
+  }
+}
+
+template <typename TValue, unsigned int TImageDimension>
+void
+CommandMultiMetricExhaustiveLog<TValue, TImageDimension>::Initialize(const StepsType &  numberOfSteps,
+                                                                     const ScalesType & scales)
+{
+  if (numberOfSteps.Size() != Dimension || scales.Size() != Dimension)
+  {
+    itkExceptionMacro("Expected " << Dimension << " steps and scales but received " << numberOfSteps.Size()
+                                  << " steps and " << scales.Size() << " scales");
+  }
+  for (const auto & metric : m_Metrics)
+  {
+    if (metric->GetNumberOfParameters() != Dimension)
+    {
+      itkExceptionMacro("Metric " << metric->GetNameOfClass() << " has " << metric->GetNumberOfParameters()
+                                  << " parameters but the lattice has " << Dimension);
+    }
+  }
+
+  SizeType size;
+  for (unsigned int dim = 0; dim < Dimension; dim++)
+  {
+    size[dim] = numberOfSteps[dim] * 2 + 1;
+    m_Origin[dim] = m_Center[dim] - numberOfSteps[dim] * scales[dim];
+    m_StepSize[dim] = scales[dim];
+  }
+  m_Region = RegionType(size);
+
+  const auto          numberOfChannels = static_cast<unsigned int>(m_Metrics.size() + 1);
+  const SizeValueType numberOfSamples = m_Region.GetNumberOfPixels();
+  m_VectorImage = nullptr;
+  m_ChannelImages.clear();
+  m_ChannelBuffers.resize(numberOfChannels);
+
+  if (m_ChannelLayout == ChannelLayoutEnum::Interleaved)
+  {
+    m_VectorImage = VectorImageType::New();
+    m_VectorImage->SetRegions(m_Region);
+    m_VectorImage->SetSpacing(m_StepSize);
+    m_VectorImage->SetOrigin(m_Origin);
+    m_VectorImage->SetNumberOfComponentsPerPixel(numberOfChannels);
+    m_VectorImage->Allocate();
+
+    InternalDataType * buffer = m_VectorImage->GetBufferPointer();
+    std::fill_n(buffer, numberOfSamples * numberOfChannels, m_FillValue);
+    for (unsigned int channel = 0; channel < numberOfChannels; channel++)
+    {
+      m_ChannelBuffers[channel] = buffer + channel;
+    }
+    m_ChannelStride = numberOfChannels;
+  }
+  else
+  {
+    for (unsigned int channel = 0; channel < numberOfChannels; channel++)
+    {
+      auto image = ImageType::New();
+      image->SetRegions(m_Region);
+      image->SetSpacing(m_StepSize);
+      image->SetOrigin(m_Origin);
+      image->Allocate();
+      image->FillBuffer(m_FillValue);
+      m_ChannelBuffers[channel] = image->GetBufferPointer();
+      m_ChannelImages.push_back(image);
+    }
+    m_ChannelStride = 1;
+  }
+
+  m_NumberOfChannels = numberOfChannels;
+  m_NextIndex.Fill(0);
+  m_NextOffset = 0;
+
+  for (unsigned int metric = 0; metric < m_Metrics.size(); metric++)
+  {
+    m_MetricInitialParameters[metric] = m_Metrics[metric]->GetParameters();
+    m_MetricsMoved[metric] = false;
+  }
+}
+
+template <typename TValue, unsigned int TImageDimension>
+auto
+CommandMultiMetricExhaustiveLog<TValue, TImageDimension>::ComputeOffset(const IndexType & index) const
+  -> OffsetValueType
+{
+  if (!m_Region.IsInside(index))
+  {
+    itkExceptionMacro("Index " << index << " is outside the lattice " << m_Region);
+  }
+
+  const SizeType & size = m_Region.GetSize();
+  OffsetValueType  offset = 0;
+  OffsetValueType  stride = 1;
+  for (unsigned int dim = 0; dim < Dimension; dim++)
+  {
+    offset += index[dim] * stride;
+    stride *= static_cast<OffsetValueType>(size[dim]);
+  }
+  return offset;
+}
+
+template <typename TValue, unsigned int TImageDimension>
+auto
+CommandMultiMetricExhaustiveLog<TValue, TImageDimension>::ComputePosition(const OffsetValueType offset) const
+  -> PointType
+{
+  const SizeType & size = m_Region.GetSize();
+  PointType        position;
+  auto             remainder = static_cast<SizeValueType>(offset);
+  for (unsigned int dim = 0; dim < Dimension; dim++)
+  {
+    position[dim] = m_Origin[dim] + static_cast<double>(remainder % size[dim]) * m_StepSize[dim];
+    remainder /= size[dim];
+  }
+  return position;
+}
+
+template <typename TValue, unsigned int TImageDimension>
+void
+CommandMultiMetricExhaustiveLog<TValue, TImageDimension>::VerifyChannel(unsigned int channel) const
+{
+  if (channel >= m_NumberOfChannels)
+  {
+    itkExceptionMacro("Channel " << channel << " is out of range for " << m_NumberOfChannels << " channels");
+  }
+}
+
+template <typename TValue, unsigned int TImageDimension>
+const TValue
+CommandMultiMetricExhaustiveLog<TValue, TImageDimension>::GetValue(const IndexType & index,
+                                                                   unsigned int      channel) const
+{
+  VerifyChannel(channel);
+  return GetValueAtOffset(ComputeOffset(index), channel);
+}
+
+template <typename TValue, unsigned int TImageDimension>
+const TValue
+CommandMultiMetricExhaustiveLog<TValue, TImageDimension>::GetValue(const PointType & point,
+                                                                   unsigned int      channel) const
+{
+  IndexType index;
+  for (unsigned int dim = 0; dim < Dimension; dim++)
+  {
+    index[dim] = Math::Round<IndexValueType>((point[dim] - m_Origin[dim]) / m_StepSize[dim]);
+  }
+  return GetValue(index, channel);
+}
+
+template <typename TValue, unsigned int TImageDimension>
+const TValue
+CommandMultiMetricExhaustiveLog<TValue, TImageDimension>::GetValue(const ParametersType & parameters,
+                                                                   unsigned int           channel) const
+{
+  if (parameters.Size() != Dimension)
+  {
+    itkExceptionMacro("Position " << parameters << " does not have " << Dimension << " parameters");
+  }
+
+  PointType point;
+  for (unsigned int dim = 0; dim < Dimension; dim++)
+  {
+    point[dim] = parameters[dim];
+  }
+  return GetValue(point, channel);
+}
+
+template <typename TValue, unsigned int TImageDimension>
+auto
+CommandMultiMetricExhaustiveLog<TValue, TImageDimension>::GetPixel(const IndexType & index) const -> PixelType
+{
+  const OffsetValueType offset = ComputeOffset(index);
+  PixelType             pixel(m_NumberOfChannels);
+  for (unsigned int channel = 0; channel < m_NumberOfChannels; channel++)
+  {
+    pixel[channel] = GetValueAtOffset(offset, channel);
+  }
+  return pixel;
+}
+
+template <typename TValue, unsigned int TImageDimension>
+auto
+CommandMultiMetricExhaustiveLog<TValue, TImageDimension>::GetImage() const -> VectorImagePointer
+{
+  if (!IsInitialized())
+  {
+    itkExceptionMacro("Cannot provide the samples of a log that has not been initialized");
+  }
+  if (m_VectorImage)
+  {
+    return m_VectorImage;
+  }
+
+  // Planar channels are interleaved into a new image
+  auto image = VectorImageType::New();
+  image->SetRegions(m_Region);
+  image->SetSpacing(m_StepSize);
+  image->SetOrigin(m_Origin);
+  image->SetNumberOfComponentsPerPixel(m_NumberOfChannels);
+  image->Allocate();
+
+  InternalDataType *    buffer = image->GetBufferPointer();
+  const OffsetValueType numberOfSamples = m_Region.GetNumberOfPixels();
+  for (unsigned int channel = 0; channel < m_NumberOfChannels; channel++)
+  {
+    const InternalDataType * plane = m_ChannelBuffers[channel];
+    for (OffsetValueType offset = 0; offset < numberOfSamples; offset++)
+    {
+      buffer[offset * m_NumberOfChannels + channel] = plane[offset];
+    }
+  }
+  return image;
+}
+
+template <typename TValue, unsigned int TImageDimension>
+auto
+CommandMultiMetricExhaustiveLog<TValue, TImageDimension>::GetChannelImage(unsigned int channel) const -> ImagePointer
+{
+  VerifyChannel(channel);
+  if (!m_ChannelImages.empty())
+  {
+    return m_ChannelImages[channel];
+  }
+
+  // One channel is gathered from the interleaved samples into a new image
+  auto image = ImageType::New();
+  image->SetRegions(m_Region);
+  image->SetSpacing(m_StepSize);
+  image->SetOrigin(m_Origin);
+  image->Allocate();
+
+  InternalDataType *    buffer = image->GetBufferPointer();
+  const OffsetValueType numberOfSamples = m_Region.GetNumberOfPixels();
+  for (OffsetValueType offset = 0; offset < numberOfSamples; offset++)
+  {
+    buffer[offset] = GetValueAtOffset(offset, channel);
+  }
+  return image;
+}
+
+template <typename TValue, unsigned int TImageDimension>
+void
+CommandMultiMetricExhaustiveLog<TValue, TImageDimension>::PrintSelf(std::ostream & os, Indent indent) const
+{
+  Superclass::PrintSelf(os, indent);
+
+  os << indent << "NumberOfMetrics: " << m_Metrics.size() << std::endl;
+  os << indent << "NumberOfChannels: " << m_NumberOfChannels << std::endl;
+  os << indent << "ChannelLayout: "
+     << (m_ChannelLayout == ChannelLayoutEnum::Interleaved ? "Interleaved" : "Planar") << std::endl;
+  os << indent << "Region: " << m_Region << std::endl;
+  os << indent << "Origin: " << m_Origin << std::endl;
+  os << indent << "StepSize: " << m_StepSize << std::endl;
+  os << indent << "Center: " << m_Center << std::endl;
+  os << indent << "FillValue: " << static_cast<typename NumericTraits<InternalDataType>::PrintType>(m_FillValue)
+     << std::endl;
+}
+
+} // namespace itk
+
+#endif // itkCommandMultiMetricExhaustiveLog_hxx
@@ -0,0 +1,283 @@
+/*=========================================================================
+ *
+ *  Copyright NumFOCUS
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *         https://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *=========================================================================*/
+#ifndef itkCommandTrajectoryLog_h
+#define itkCommandTrajectoryLog_h
+
+#include "itkMacro.h"
+#include "itkCommand.h"
+#include "itkCommandExhaustiveLog.h"
+#include "itkGradientDescentOptimizerBasev4.h"
+
+#include <typeinfo>
+#include <vector>
+
+namespace itk
+{
+/**
+ *\class CommandTrajectoryLog
+ *  \brief Records the path of an optimizer for comparison with an exhaustive surface.
+ *
+ * CommandTrajectoryLog observes any ITK v4 optimizer, such as
+ * GradientDescentOptimizerv4Template, RegularStepGradientDescentOptimizerv4 or
+ * LBFGSOptimizerv4Template, and records on each IterationEvent the current position,
+ * metric value, learning rate and gradient norm. Positions may then be mapped onto
+ * the lattice of a CommandExhaustiveLog (see ComputeLogIndex) to overlay the path
+ * of the optimizer on the surface it travelled.
+ *
+ * Records are kept in a ring buffer of Capacity entries stored as one array per
+ * field, allocated on StartEvent, so that recording an iteration copies a few values
+ * without allocating or locking. Once the buffer is full each iteration overwrites
+ * the oldest record. Each array may be read in place, the oldest record being at
+ * GetFirstSlot() and later records following it modulo Capacity.
+ *
+ * Each record pairs a position with the metric value and gradient evaluated there.
+ * Gradient descent optimizers invoke IterationEvent after stepping away from the
+ * position they evaluated, so their records hold the position the iteration started
+ * from, and the position reached by the last step is the final position of the
+ * optimizer rather than a record.
+ *
+ * The learning rate is that reported by optimizers providing GetLearningRate(). The
+ * gradient norm is that of the metric gradient at the recorded position.
+ * Vnl-based optimizers report it through GetCachedDerivative(). By the time
+ * GradientDescentOptimizerv4Template invokes IterationEvent, its GetGradient() has
+ * been divided by the scales, multiplied by the weights and multiplied by the learning
+ * rate. Those factors are undone, so the norm is not that of the step taken. Other
+ * gradient-based optimizers, such as RegularStepGradientDescentOptimizerv4, normalize
+ * or combine their gradients so that the metric gradient cannot be recovered. Fields an
+ * optimizer does not provide, including the gradient norm of those optimizers, are
+ * recorded as NaN. The step length may be computed from consecutive positions.
+ *
+ * Template parameters for class CommandTrajectoryLog:
+ *
+ * - TOptimizer = Type of the observed optimizer, derived from
+ *   ObjectToObjectOptimizerBaseTemplate.
+ *
+ * \ingroup ITKOptimizationMonitor
+ */
+template <typename TOptimizer>
+class CommandTrajectoryLog : public itk::Command
+{
+public:
+  ITK_DISALLOW_COPY_AND_MOVE(CommandTrajectoryLog);
+
+  using Self = CommandTrajectoryLog;
+  using Superclass = itk::Command;
+  using Pointer = itk::SmartPointer<Self>;
+  itkNewMacro(Self);
+  itkOverrideGetNameOfClassMacro(CommandTrajectoryLog);
+
+  using OptimizerType = TOptimizer;
+  using ParametersType = typename OptimizerType::ParametersType;
+  using MeasureType = typename OptimizerType::MeasureType;
+
+  /** Type of positions, learning rates and gradient norms. */
+  using InternalComputationValueType = typename ParametersType::ValueType;
+
+  using SizeValueType = itk::SizeValueType;
+
+  /** Observe an event fired by calling object. */
+  void
+  Execute(itk::Object * caller, const itk::EventObject & event) override;
+
+  /** Observe an event fired by calling object. */
+  void
+  Execute(const itk::Object * caller, const itk::EventObject & event) override;
+
+  /** Maximum number of records held, the oldest being overwritten first. Takes effect
+   *  at the next allocation. Defaults to 1024. */
+  itkSetMacro(Capacity, SizeValueType);
+  itkGetConstMacro(Capacity, SizeValueType);
+
+  /** Allocate the buffers for a number of parameters and clear all records. Called on
+   *  StartEvent, where buffers of the right size are reused as they are. */
+  void
+  Allocate(unsigned int numberOfParameters);
+
+  /** Number of parameters of each recorded position. */
+  unsigned int
+  GetNumberOfParameters() const
+  {
+    return m_NumberOfParameters;
+  }
+
+  /** Number of records held, at most Capacity. */
+  SizeValueType
+  GetNumberOfRecords() const
+  {
+    return (m_NumberOfIterations < m_BufferCapacity) ? m_NumberOfIterations : m_BufferCapacity;
+  }
+
+  /** Number of iterations observed since the last allocation, including those whose
+   *  records have been overwritten. */
+  itkGetConstMacro(NumberOfIterations, SizeValueType);
+
+  /** Slot of the buffers holding the oldest record. */
+  SizeValueType
+  GetFirstSlot() const
+  {
+    return (m_NumberOfIterations < m_BufferCapacity) ? 0 : m_NextSlot;
+  }
+
+  /** Slot of the buffers holding a record, 0 being the oldest held. */
+  SizeValueType
+  GetSlot(SizeValueType record) const
+  {
+    const SizeValueType slot = GetFirstSlot() + record;
+    return (slot < m_BufferCapacity) ? slot : slot - m_BufferCapacity;
+  }
+
+  /** Buffers of Capacity entries indexed by slot, valid until the next allocation. */
+  const MeasureType *
+  GetValueBuffer() const
+  {
+    return m_Values.data();
+  }
+  const InternalComputationValueType *
+  GetLearningRateBuffer() const
+  {
+    return m_LearningRates.data();
+  }
+  const InternalComputationValueType *
+  GetGradientNormBuffer() const
+  {
+    return m_GradientNorms.data();
+  }
+
+  /** Buffer of one parameter of the recorded positions, indexed by slot. */
+  const InternalComputationValueType *
+  GetParameterBuffer(unsigned int parameter) const;
+
+  /** Fields of a record, 0 being the oldest held. */
+  MeasureType
+  GetValue(SizeValueType record) const
+  {
+    return m_Values[GetSlot(record)];
+  }
+  InternalComputationValueType
+  GetLearningRate(SizeValueType record) const
+  {
+    return m_LearningRates[GetSlot(record)];
+  }
+  InternalComputationValueType
+  GetGradientNorm(SizeValueType record) const
+  {
+    return m_GradientNorms[GetSlot(record)];
+  }
+  ParametersType
+  GetPosition(SizeValueType record) const;
+
+  /** Index of the lattice sample of an exhaustive log nearest to the position of a
+   *  record. Returns false if that sample lies outside the region stored by the log.
+   *  Throws if the log is not initialized or does not have one dimension per
+   *  parameter. */
+  template <typename TValue, unsigned int VDimension>
+  bool
+  ComputeLogIndex(SizeValueType                                                  record,
+                  const CommandExhaustiveLog<TValue, VDimension> *               log,
+                  typename CommandExhaustiveLog<TValue, VDimension>::IndexType & index) const;
+
+protected:
+  CommandTrajectoryLog() = default;
+  ~CommandTrajectoryLog() override = default;
+
+  void
+  PrintSelf(std::ostream & os, Indent indent) const override;
+
+private:
+  /** Check the type of a caller of a dynamic type not seen last. Returns nullptr for
+   *  callers that are not of OptimizerType. */
+  const OptimizerType *
+  AttachCaller(const itk::Object * caller);
+
+  void
+  RecordIteration(const OptimizerType * optimizer);
+
+  /** Fields reported by some optimizers only, NaN for the others. The first viable
+   *  overload is chosen by the int argument. */
+  template <typename T>
+  static auto
+  ReadLearningRate(const T * optimizer, int)
+    -> decltype(static_cast<InternalComputationValueType>(optimizer->GetLearningRate()))
+  {
+    return static_cast<InternalComputationValueType>(optimizer->GetLearningRate());
+  }
+  template <typename T>
+  static InternalComputationValueType
+  ReadLearningRate(const T *, long)
+  {
+    return NumericTraits<InternalComputationValueType>::quiet_NaN();
+  }
+
+  template <typename T>
+  static auto
+  ReadGradientNorm(const T * optimizer, int)
+    -> decltype(static_cast<InternalComputationValueType>(optimizer->GetGradient()[0] * optimizer->GetScales()[0] /
+                                                          optimizer->GetLearningRate()))
+  {
+    return UnscaleGradientNorm(optimizer);
+  }
+  template <typename T>
+  static auto
+  ReadGradientNorm(const T * optimizer, long)
+    -> decltype(static_cast<InternalComputationValueType>(optimizer->GetCachedDerivative().two_norm()))
+  {
+    return static_cast<InternalComputationValueType>(optimizer->GetCachedDerivative().two_norm());
+  }
+  template <typename T>
+  static InternalComputationValueType
+  ReadGradientNorm(const T *, ...)
+  {
+    return NumericTraits<InternalComputationValueType>::quiet_NaN();
+  }
+
+  /** Norm of the metric gradient from which a gradient descent optimizer computed its
+   *  step, undoing the scales, weights and learning rate applied to GetGradient(). NaN
+   *  for optimizers that modify the gradient otherwise. */
+  template <typename T>
+  static InternalComputationValueType
+  UnscaleGradientNorm(const T * optimizer);
+
+  SizeValueType m_Capacity{ 1024 };
+
+  /** Dynamic type of the callers last checked to be of OptimizerType. */
+  const std::type_info * m_CallerType{ nullptr };
+
+  /** Whether the caller steps before invoking IterationEvent, and the position it
+   *  evaluated for the next iteration if it does. */
+  bool           m_StepsBeforeIteration{ false };
+  ParametersType m_EvaluatedPosition;
+
+  unsigned int  m_NumberOfParameters{ 0 };
+  SizeValueType m_BufferCapacity{ 0 };
+  SizeValueType m_NumberOfIterations{ 0 };
+  SizeValueType m_NextSlot{ 0 };
+
+  std::vector<MeasureType>                  m_Values;
+  std::vector<InternalComputationValueType> m_LearningRates;
+  std::vector<InternalComputationValueType> m_GradientNorms;
+
+  /** Positions, one parameter after the other, each over Capacity slots. */
+  std::vector<InternalComputationValueType> m_Parameters;
+};
+} // namespace itk
+
+#ifndef ITK_MANUAL_INSTANTIATION
+#  include "itkCommandTrajectoryLog.hxx"
+#endif
+
+#endif // itkCommandTrajectoryLog_h
@@ -0,0 +1,266 @@
+/*=========================================================================
+ *
+ *  Copyright NumFOCUS
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *         https://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *=========================================================================*/
+
+#ifndef itkCommandTrajectoryLog_hxx
+#define itkCommandTrajectoryLog_hxx
+
+#include "itkCommandTrajectoryLog.h"
+#include "itkConjugateGradientLineSearchOptimizerv4.h"
+#include "itkMath.h"
+#include "itkMultiGradientOptimizerv4.h"
+#include "itkQuasiNewtonOptimizerv4.h"
+#include "itkRegularStepGradientDescentOptimizerv4.h"
+
+#include <cmath>
+
+namespace itk
+{
+template <typename TOptimizer>
+void
+CommandTrajectoryLog<TOptimizer>::Execute(itk::Object * caller, const itk::EventObject & event)
+{
+  Execute((const itk::Object *)caller, event);
+}
+
+template <typename TOptimizer>
+void
+CommandTrajectoryLog<TOptimizer>::Execute(const itk::Object * caller, const itk::EventObject & event)
+{
+  if (caller == nullptr)
+  {
+    return;
+  }
+
+  // Any caller of a dynamic type already checked may be cast without checking the
+  // type hierarchy again, whichever object it is
+  const OptimizerType * optimizer = (m_CallerType != nullptr && typeid(*caller) == *m_CallerType)
+                                      ? static_cast<const OptimizerType *>(caller)
+                                      : AttachCaller(caller);
+  if (optimizer == nullptr)
+  {
+    return;
+  }
+
+  if (itk::IterationEvent().CheckEvent(&event))
+  {
+    RecordIteration(optimizer);
+  }
+  else if (itk::StartEvent().CheckEvent(&event))
+  {
+    Allocate(static_cast<unsigned int>(optimizer->GetCurrentPosition().Size()));
+    m_EvaluatedPosition = optimizer->GetCurrentPosition();
+  }
+}
+
+template <typename TOptimizer>
+auto
+CommandTrajectoryLog<TOptimizer>::AttachCaller(const itk::Object * caller) -> const OptimizerType *
+{
+  const auto * optimizer = dynamic_cast<const OptimizerType *>(caller);
+  if (optimizer != nullptr)
+  {
+    m_CallerType = &typeid(*caller);
+    m_StepsBeforeIteration =
+      dynamic_cast<const GradientDescentOptimizerBasev4Template<InternalComputationValueType> *>(caller) != nullptr;
+  }
+  return optimizer;
+}
+
+template <typename TOptimizer>
+void
+CommandTrajectoryLog<TOptimizer>::Allocate(unsigned int numberOfParameters)
+{
+  if (m_Capacity == 0)
+  {
+    itkExceptionMacro("Capacity must be at least one record");
+  }
+
+  if (m_BufferCapacity != m_Capacity || m_NumberOfParameters != numberOfParameters)
+  {
+    m_BufferCapacity = m_Capacity;
+    m_NumberOfParameters = numberOfParameters;
+    m_Values.assign(m_BufferCapacity, MeasureType{});
+    m_LearningRates.assign(m_BufferCapacity, InternalComputationValueType{});
+    m_GradientNorms.assign(m_BufferCapacity, InternalComputationValueType{});
+    m_Parameters.assign(m_BufferCapacity * m_NumberOfParameters, InternalComputationValueType{});
+  }
+  m_NumberOfIterations = 0;
+  m_NextSlot = 0;
+}
+
+template <typename TOptimizer>
+void
+CommandTrajectoryLog<TOptimizer>::RecordIteration(const OptimizerType * optimizer)
+{
+  const ParametersType & currentPosition = optimizer->GetCurrentPosition();
+  if (currentPosition.Size() != m_NumberOfParameters || m_BufferCapacity == 0 ||
+      m_EvaluatedPosition.Size() != m_NumberOfParameters)
+  {
+    // Only reached by optimizers that iterate without a StartEvent, whose first
+    // evaluated position is unknown
+    Allocate(static_cast<unsigned int>(currentPosition.Size()));
+    m_EvaluatedPosition = currentPosition;
+  }
+
+  // Gradient descent optimizers report the value and gradient of the position the
+  // iteration started from, after having stepped away from it
+  const ParametersType & position = m_StepsBeforeIteration ? m_EvaluatedPosition : currentPosition;
+
+  const SizeValueType slot = m_NextSlot;
+  m_Values[slot] = optimizer->GetValue();
+  m_LearningRates[slot] = ReadLearningRate(optimizer, 0);
+  m_GradientNorms[slot] = ReadGradientNorm(optimizer, 0);
+  InternalComputationValueType * parameters = m_Parameters.data() + slot;
+  for (unsigned int parameter = 0; parameter < m_NumberOfParameters; parameter++)
+  {
+    parameters[parameter * m_BufferCapacity] = position[parameter];
+  }
+
+  m_NextSlot = (slot + 1 < m_BufferCapacity) ? slot + 1 : 0;
+  ++m_NumberOfIterations;
+
+  if (m_StepsBeforeIteration)
+  {
+    m_EvaluatedPosition = currentPosition;
+  }
+}
+
+template <typename TOptimizer>
+template <typename T>
+auto
+CommandTrajectoryLog<TOptimizer>::UnscaleGradientNorm(const T * optimizer) -> InternalComputationValueType
+{
+  using ValueType = InternalComputationValueType;
+
+  // The step of gradient descent is the scaled gradient times the learning rate,
+  // except for the subclasses that normalize the gradient or combine it with others
+  const auto * gradientDescent = dynamic_cast<const GradientDescentOptimizerv4Template<ValueType> *>(optimizer);
+  if (gradientDescent == nullptr ||
+      dynamic_cast<const RegularStepGradientDescentOptimizerv4<ValueType> *>(optimizer) != nullptr ||
+      dynamic_cast<const ConjugateGradientLineSearchOptimizerv4Template<ValueType> *>(optimizer) != nullptr ||
+      dynamic_cast<const QuasiNewtonOptimizerv4Template<ValueType> *>(optimizer) != nullptr ||
+      dynamic_cast<const MultiGradientOptimizerv4Template<ValueType> *>(optimizer) != nullptr)
+  {
+    return NumericTraits<ValueType>::quiet_NaN();
+  }
+  const auto learningRate = static_cast<ValueType>(gradientDescent->GetLearningRate());
+  if (!(learningRate > 0))
+  {
+    return NumericTraits<ValueType>::quiet_NaN();
+  }
+
+  // Gradients of transforms with local support repeat the scales for each point
+  const auto & gradient = gradientDescent->GetGradient();
+  const auto & scales = gradientDescent->GetScales();
+  const auto & weights = gradientDescent->GetWeights();
+  const bool   unscale = !gradientDescent->GetScalesAreIdentity() && scales.Size() > 0;
+  const bool   unweight = !gradientDescent->GetWeightsAreIdentity() && weights.Size() > 0;
+
+  ValueType sumOfSquares = 0;
+  for (SizeValueType i = 0; i < gradient.Size(); i++)
+  {
+    ValueType component = gradient[i];
+    if (unscale)
+    {
+      component *= scales[i % scales.Size()];
+    }
+    if (unweight)
+    {
+      component /= weights[i % weights.Size()];
+    }
+    sumOfSquares += component * component;
+  }
+  return std::sqrt(sumOfSquares) / learningRate;
+}
+
+template <typename TOptimizer>
+auto
+CommandTrajectoryLog<TOptimizer>::GetParameterBuffer(unsigned int parameter) const
+  -> const InternalComputationValueType *
+{
+  if (parameter >= m_NumberOfParameters)
+  {
+    itkExceptionMacro("Parameter " << parameter << " is out of range for " << m_NumberOfParameters
+                                   << " recorded parameters");
+  }
+  return m_Parameters.data() + parameter * m_BufferCapacity;
+}
+
+template <typename TOptimizer>
+auto
+CommandTrajectoryLog<TOptimizer>::GetPosition(SizeValueType record) const -> ParametersType
+{
+  const SizeValueType slot = GetSlot(record);
+  ParametersType      position(m_NumberOfParameters);
+  for (unsigned int parameter = 0; parameter < m_NumberOfParameters; parameter++)
+  {
+    position[parameter] = m_Parameters[parameter * m_BufferCapacity + slot];
+  }
+  return position;
+}
+
+template <typename TOptimizer>
+template <typename TValue, unsigned int VDimension>
+bool
+CommandTrajectoryLog<TOptimizer>::ComputeLogIndex(
+  SizeValueType                                                  record,
+  const CommandExhaustiveLog<TValue, VDimension> *               log,
+  typename CommandExhaustiveLog<TValue, VDimension>::IndexType & index) const
+{
+  using LogType = CommandExhaustiveLog<TValue, VDimension>;
+
+  if (log == nullptr || !log->IsInitialized())
+  {
+    itkExceptionMacro("Cannot map onto an exhaustive log that has not been initialized");
+  }
+  if (m_NumberOfParameters != VDimension)
+  {
+    itkExceptionMacro("Cannot map " << m_NumberOfParameters << " parameters onto an exhaustive log of dimension "
+                                    << VDimension);
+  }
+  if (record >= GetNumberOfRecords())
+  {
+    itkExceptionMacro("Record " << record << " is out of range for " << GetNumberOfRecords() << " records");
+  }
+
+  const SizeValueType                 slot = GetSlot(record);
+  const typename LogType::PointType   origin = log->GetOrigin();
+  const typename LogType::SpacingType spacing = log->GetStepSize();
+  for (unsigned int dim = 0; dim < VDimension; dim++)
+  {
+    const double steps = (m_Parameters[dim * m_BufferCapacity + slot] - origin[dim]) / spacing[dim];
+    index[dim] = Math::Round<typename LogType::IndexValueType>(steps);
+  }
+  return log->GetRegion().IsInside(index);
+}
+
+template <typename TOptimizer>
+void
+CommandTrajectoryLog<TOptimizer>::PrintSelf(std::ostream & os, Indent indent) const
+{
+  Superclass::PrintSelf(os, indent);
+
+  os << indent << "Capacity: " << m_Capacity << std::endl;
+  os << indent << "NumberOfParameters: " << m_NumberOfParameters << std::endl;
+  os << indent << "NumberOfIterations: " << m_NumberOfIterations << std::endl;
+  os << indent << "NumberOfRecords: " << GetNumberOfRecords() << std::endl;
+}
+
+} // namespace itk
+
+#endif // itkCommandTrajectoryLog_hxx
@@ -0,0 +1,230 @@
+/*=========================================================================
+ *
+ *  Copyright NumFOCUS
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *         https://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *=========================================================================*/
+#ifndef itkCommandVariableDimensionExhaustiveLog_h
+#define itkCommandVariableDimensionExhaustiveLog_h
+
+#include "itkMacro.h"
+#include "itkCommand.h"
+#include "itkExhaustiveOptimizerv4.h"
+
+#include <vector>
+
+namespace itk
+{
+/**
+ *\class CommandVariableDimensionExhaustiveLog
+ *  \brief Monitors ExhaustiveOptimizerv4 over any number of parameters chosen at run time.
+ *
+ * CommandExhaustiveLog fixes the number of transform parameters at compile time,
+ * so that logging a 6-parameter Euler3DTransform or a 12-parameter
+ * AffineTransform sweep requires an instantiation, and a wrapping, for that
+ * dimension. This class follows the same Execute(), Initialize() and GetValue()
+ * contract, but takes its dimension from the number of steps of the optimizer on
+ * StartEvent, and is wrapped once per value type.
+ *
+ * The lattice of (2 * steps + 1) samples along each dimension is stored in one
+ * contiguous buffer in optimizer order, dimension 0 varying fastest, addressed
+ * through strides computed at initialization. Samples are recorded on
+ * IterationEvent at linear offsets tracked incrementally, as in
+ * CommandExhaustiveLog, and the buffer may be read in place through
+ * GetBufferPointer(), or from Python as a NumPy array through GetArrayView().
+ * Iterations observed before initialization are ignored.
+ *
+ * Storage is always dense; chunked storage, streaming, reductions and shards
+ * remain specific to CommandExhaustiveLog.
+ *
+ * Template parameters for class CommandVariableDimensionExhaustiveLog:
+ *
+ * - TValue = Element type stored at each lattice sample.
+ *
+ * \ingroup ITKOptimizationMonitor
+ */
+template <typename TValue>
+class CommandVariableDimensionExhaustiveLog : public itk::Command
+{
+public:
+  ITK_DISALLOW_COPY_AND_MOVE(CommandVariableDimensionExhaustiveLog);
+
+  using Self = CommandVariableDimensionExhaustiveLog;
+  using Superclass = itk::Command;
+  using Pointer = itk::SmartPointer<Self>;
+  itkNewMacro(Self);
+  itkOverrideGetNameOfClassMacro(CommandVariableDimensionExhaustiveLog);
+
+  /** Data type for sample values */
+  using InternalDataType = TValue;
+
+  using OptimizerType = itk::ExhaustiveOptimizerv4<double>;
+  /** Default optimizer geometric output type. */
+  using ParametersType = typename OptimizerType::ParametersType;
+  /** Metric value reported by the optimizer. */
+  using MeasureType = typename OptimizerType::MeasureType;
+  /** Number of steps on each side of the center along each dimension. */
+  using StepsType = typename OptimizerType::StepsType;
+  /** Distance between samples along each dimension. */
+  using ScalesType = typename OptimizerType::ScalesType;
+
+  /** Lattice index, one nonnegative entry per parameter. */
+  using IndexType = StepsType;
+  using SizeValueType = itk::SizeValueType;
+  /** Linear position of a sample in the data buffer. */
+  using OffsetValueType = itk::OffsetValueType;
+
+  /** Observe an event fired by calling object. */
+  void
+  Execute(itk::Object * caller, const itk::EventObject & event) override;
+
+  /** Observe an event fired by calling object. */
+  void
+  Execute(const itk::Object * caller, const itk::EventObject & event) override;
+
+  /** Allocate the data buffer for a lattice of (2 * steps + 1) samples along each
+   *  dimension spaced by the given scales, the dimension being the number of steps.
+   *  Called on StartEvent with the optimizer settings. */
+  void
+  Initialize(const StepsType & numberOfSteps, const ScalesType & scales);
+
+  /** Whether the lattice geometry and storage have been set up. */
+  bool
+  IsInitialized() const
+  {
+    return m_Dimension > 0;
+  }
+
+  /** Number of parameters, zero before initialization. */
+  unsigned int
+  GetDimension() const
+  {
+    return m_Dimension;
+  }
+
+  /** Total number of lattice samples. */
+  SizeValueType
+  GetNumberOfSamples() const
+  {
+    return m_Buffer.size();
+  }
+
+  /** Number of samples, steps away from the center, and distance in the linear
+   *  buffer between consecutive samples along a dimension. */
+  SizeValueType
+  GetSize(unsigned int dim) const
+  {
+    return (dim < m_Dimension) ? m_Size[dim] : 0;
+  }
+  SizeValueType
+  GetNumberOfSteps(unsigned int dim) const
+  {
+    return (dim < m_Dimension) ? (m_Size[dim] - 1) / 2 : 0;
+  }
+  OffsetValueType
+  GetStride(unsigned int dim) const
+  {
+    return (dim < m_Dimension) ? m_Strides[dim] : 0;
+  }
+
+  /** Position of the first sample and distance between samples along each
+   *  dimension. */
+  itkGetConstReferenceMacro(Origin, ParametersType);
+  itkGetConstReferenceMacro(StepSize, ParametersType);
+
+  /** Center of exhaustive region used to compute the origin at initialization.
+   *  Empty, the default, centers the lattice at zero. */
+  itkSetMacro(Center, ParametersType);
+  itkGetConstReferenceMacro(Center, ParametersType);
+
+  /** Value of samples that have not been written. Defaults to zero. */
+  itkSetMacro(FillValue, InternalDataType);
+  itkGetConstMacro(FillValue, InternalDataType);
+
+  /** Set data at a linear offset into the data buffer, where dimension 0 varies
+   *  fastest as in the optimizer iteration order. Concurrent calls are safe for
+   *  distinct offsets. */
+  void
+  SetValueAtOffset(const OffsetValueType offset, const InternalDataType & value)
+  {
+    m_Buffer[offset] = value;
+  }
+
+  /** Retrieve data at a linear offset into the data buffer. */
+  const TValue
+  GetValueAtOffset(const OffsetValueType offset) const
+  {
+    return m_Buffer[offset];
+  }
+
+  /** Retrieve the sample at a lattice index, or nearest to a position in parameter
+   *  space. Throws if the index or position lies outside the lattice. */
+  const TValue
+  GetValue(const IndexType & index) const;
+  const TValue
+  GetValue(const ParametersType & parameters) const;
+
+  /** Conversions between lattice indices, linear offsets and positions. */
+  OffsetValueType
+  ComputeOffset(const IndexType & index) const;
+  IndexType
+  ComputeIndex(OffsetValueType offset) const;
+  ParametersType
+  ComputePosition(OffsetValueType offset) const;
+
+  /** Data buffer of GetNumberOfSamples() samples in optimizer order, valid until the
+   *  next initialization. */
+  const InternalDataType *
+  GetBufferPointer() const
+  {
+    return m_Buffer.data();
+  }
+
+protected:
+  CommandVariableDimensionExhaustiveLog() = default;
+  ~CommandVariableDimensionExhaustiveLog() override = default;
+
+  void
+  PrintSelf(std::ostream & os, Indent indent) const override;
+
+private:
+  /** Record an optimizer sample at its index in the data buffer. */
+  void
+  RecordIteration(const ParametersType & index, const MeasureType value);
+
+  /** Offset of the sample nearest to a position. Returns false outside the lattice. */
+  bool
+  ComputeNearestOffset(const ParametersType & parameters, OffsetValueType & offset) const;
+
+  unsigned int                 m_Dimension{ 0 };
+  std::vector<SizeValueType>   m_Size;
+  std::vector<OffsetValueType> m_Strides;
+  ParametersType               m_Origin;
+  ParametersType               m_StepSize;
+  ParametersType               m_Center;
+  InternalDataType             m_FillValue{};
+
+  std::vector<InternalDataType> m_Buffer;
+
+  /** Lattice index and offset expected for the next optimizer sample. */
+  std::vector<SizeValueType> m_NextIndex;
+  OffsetValueType            m_NextOffset{ 0 };
+};
+} // namespace itk
+
+#ifndef ITK_MANUAL_INSTANTIATION
+#  include "itkCommandVariableDimensionExhaustiveLog.hxx"
+#endif
+
+#endif // itkCommandVariableDimensionExhaustiveLog_h
@@ -0,0 +1,259 @@
+/*=========================================================================
+ *
+ *  Copyright NumFOCUS
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *         https://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *=========================================================================*/
+
+#ifndef itkCommandVariableDimensionExhaustiveLog_hxx
+#define itkCommandVariableDimensionExhaustiveLog_hxx
+
+#include "itkCommandVariableDimensionExhaustiveLog.h"
+#include "itkMath.h"
+
+#include <limits>
+
+namespace itk
+{
+template <typename TValue>
+void
+CommandVariableDimensionExhaustiveLog<TValue>::Execute(itk::Object * caller, const itk::EventObject & event)
+{
+  Execute((const itk::Object *)caller, event);
+}
+
+template <typename TValue>
+void
+CommandVariableDimensionExhaustiveLog<TValue>::Execute(const itk::Object * caller, const itk::EventObject & event)
+{
+  auto optimizer = static_cast<const OptimizerType *>(caller);
+  if (!optimizer)
+  {
+    return;
+  }
+
+  // Iterations vastly outnumber other events so they are recognized first.
+  if (itk::IterationEvent().CheckEvent(&event))
+  {
+    RecordIteration(optimizer->GetCurrentIndex(), optimizer->GetCurrentValue());
+  }
+  else if (itk::StartEvent().CheckEvent(&event))
+  {
+    // The optimizer steps by StepLength times the scales
+    ScalesType stepSize = optimizer->GetScales();
+    stepSize *= optimizer->GetStepLength();
+    Initialize(optimizer->GetNumberOfSteps(), stepSize);
+  }
+}
+
+template <typename TValue>
+void
+CommandVariableDimensionExhaustiveLog<TValue>::RecordIteration(const ParametersType & index, const MeasureType value)
+{
+  // Iterations observed without a lattice, before StartEvent, are not recorded
+  if (!IsInitialized())
+  {
+    return;
+  }
+
+  // The optimizer walks the lattice in buffer order, so the expected position
+  // only needs to be confirmed rather than recomputed.
+  for (unsigned int dim = 0; dim < m_Dimension; dim++)
+  {
+    if (static_cast<SizeValueType>(index[dim]) != m_NextIndex[dim])
+    {
+      // Resynchronize when the optimizer leaves the expected order
+      m_NextOffset = 0;
+      for (unsigned int i = 0; i < m_Dimension; i++)
+      {
+        m_NextIndex[i] = static_cast<SizeValueType>(index[i]);
+        m_NextOffset += static_cast<OffsetValueType>(m_NextIndex[i]) * m_Strides[i];
+      }
+      break;
+    }
+  }
+
+  m_Buffer[m_NextOffset] = static_cast<InternalDataType>(value);
+
+  // Advance to the next position in optimizer order
+  ++m_NextOffset;
+  for (unsigned int dim = 0; dim < m_Dimension; dim++)
+  {
+    if (++m_NextIndex[dim] < m_Size[dim])
+    {
+      return;
+    }
+    m_NextIndex[dim] = 0;
+  }
+  m_NextOffset = 0;
+}
+
+template <typename TValue>
+void
+CommandVariableDimensionExhaustiveLog<TValue>::Initialize(const StepsType & numberOfSteps, const ScalesType & scales)
+{
+  const auto dimension = static_cast<unsigned int>(numberOfSteps.Size());
+  if (dimension == 0 || scales.Size() != dimension)
+  {
+    itkExceptionMacro("Expected one scale per step but received " << numberOfSteps.Size() << " steps and "
+                                                                   << scales.Size() << " scales");
+  }
+  if (m_Center.Size() != 0 && m_Center.Size() != dimension)
+  {
+    itkExceptionMacro("Center has " << m_Center.Size() << " parameters but the lattice has " << dimension);
+  }
+
+  m_Size.resize(dimension);
+  m_Strides.resize(dimension);
+  m_Origin.SetSize(dimension);
+  m_StepSize.SetSize(dimension);
+
+  SizeValueType numberOfSamples = 1;
+  for (unsigned int dim = 0; dim < dimension; dim++)
+  {
+    m_Size[dim] = numberOfSteps[dim] * 2 + 1;
+    if (numberOfSamples > std::numeric_limits<SizeValueType>::max() / m_Size[dim])
+    {
+      itkExceptionMacro("Lattice of " << dimension << " dimensions with steps " << numberOfSteps
+                                      << " has too many samples to store");
+    }
+    m_Strides[dim] = static_cast<OffsetValueType>(numberOfSamples);
+    numberOfSamples *= m_Size[dim];
+
+    const double center = (m_Center.Size() == dimension) ? m_Center[dim] : 0.0;
+    m_Origin[dim] = center - numberOfSteps[dim] * scales[dim];
+    m_StepSize[dim] = scales[dim];
+  }
+
+  m_Buffer.assign(numberOfSamples, m_FillValue);
+  m_Dimension = dimension;
+  m_NextIndex.assign(dimension, 0);
+  m_NextOffset = 0;
+}
+
+template <typename TValue>
+auto
+CommandVariableDimensionExhaustiveLog<TValue>::ComputeOffset(const IndexType & index) const -> OffsetValueType
+{
+  if (index.Size() != m_Dimension)
+  {
+    itkExceptionMacro("Index " << index << " does not have " << m_Dimension << " entries");
+  }
+
+  OffsetValueType offset = 0;
+  for (unsigned int dim = 0; dim < m_Dimension; dim++)
+  {
+    if (index[dim] >= m_Size[dim])
+    {
+      itkExceptionMacro("Index " << index << " is outside the lattice");
+    }
+    offset += static_cast<OffsetValueType>(index[dim]) * m_Strides[dim];
+  }
+  return offset;
+}
+
+template <typename TValue>
+auto
+CommandVariableDimensionExhaustiveLog<TValue>::ComputeIndex(OffsetValueType offset) const -> IndexType
+{
+  IndexType index(m_Dimension);
+  auto      remainder = static_cast<SizeValueType>(offset);
+  for (unsigned int dim = 0; dim < m_Dimension; dim++)
+  {
+    index[dim] = remainder % m_Size[dim];
+    remainder /= m_Size[dim];
+  }
+  return index;
+}
+
+template <typename TValue>
+auto
+CommandVariableDimensionExhaustiveLog<TValue>::ComputePosition(OffsetValueType offset) const -> ParametersType
+{
+  ParametersType position(m_Dimension);
+  auto           remainder = static_cast<SizeValueType>(offset);
+  for (unsigned int dim = 0; dim < m_Dimension; dim++)
+  {
+    position[dim] = m_Origin[dim] + static_cast<double>(remainder % m_Size[dim]) * m_StepSize[dim];
+    remainder /= m_Size[dim];
+  }
+  return position;
+}
+
+template <typename TValue>
+bool
+CommandVariableDimensionExhaustiveLog<TValue>::ComputeNearestOffset(const ParametersType & parameters,
+                                                                    OffsetValueType &      offset) const
+{
+  offset = 0;
+  for (unsigned int dim = 0; dim < m_Dimension; dim++)
+  {
+    const auto index = Math::Round<OffsetValueType>((parameters[dim] - m_Origin[dim]) / m_StepSize[dim]);
+    if (index < 0 || static_cast<SizeValueType>(index) >= m_Size[dim])
+    {
+      return false;
+    }
+    offset += index * m_Strides[dim];
+  }
+  return true;
+}
+
+template <typename TValue>
+const TValue
+CommandVariableDimensionExhaustiveLog<TValue>::GetValue(const IndexType & index) const
+{
+  return m_Buffer[ComputeOffset(index)];
+}
+
+template <typename TValue>
+const TValue
+CommandVariableDimensionExhaustiveLog<TValue>::GetValue(const ParametersType & parameters) const
+{
+  if (parameters.Size() != m_Dimension)
+  {
+    itkExceptionMacro("Position " << parameters << " does not have " << m_Dimension << " parameters");
+  }
+
+  OffsetValueType offset;
+  if (!ComputeNearestOffset(parameters, offset))
+  {
+    itkExceptionMacro("Position " << parameters << " is outside the lattice");
+  }
+  return m_Buffer[offset];
+}
+
+template <typename TValue>
+void
+CommandVariableDimensionExhaustiveLog<TValue>::PrintSelf(std::ostream & os, Indent indent) const
+{
+  Superclass::PrintSelf(os, indent);
+
+  os << indent << "Dimension: " << m_Dimension << std::endl;
+  os << indent << "Size:";
+  for (const auto size : m_Size)
+  {
+    os << ' ' << size;
+  }
+  os << std::endl;
+  os << indent << "Origin: " << m_Origin << std::endl;
+  os << indent << "StepSize: " << m_StepSize << std::endl;
+  os << indent << "Center: " << m_Center << std::endl;
+  os << indent << "FillValue: " << static_cast<typename NumericTraits<InternalDataType>::PrintType>(m_FillValue)
+     << std::endl;
+  os << indent << "NumberOfSamples: " << GetNumberOfSamples() << std::endl;
+}
+
+} // namespace itk
+
+#endif // itkCommandVariableDimensionExhaustiveLog_hxx
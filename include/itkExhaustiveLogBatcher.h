@@ -0,0 +1,168 @@
+/*=========================================================================
+ *
+ *  Copyright NumFOCUS
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *         https://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *=========================================================================*/
+#ifndef itkExhaustiveLogBatcher_h
+#define itkExhaustiveLogBatcher_h
+
+#include "itkExhaustiveLogCollaborator.h"
+
+#include <chrono>
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace itk
+{
+/**
+ *\class ExhaustiveLogBatcher
+ *  \brief Delivers the samples recorded by a CommandExhaustiveLog in batches.
+ *
+ * Collaborator of CommandExhaustiveLog gathering recorded samples until
+ * CommandExhaustiveLog::SetBatchSize of them wait or
+ * CommandExhaustiveLog::SetBatchInterval has passed, then invoking IterationEvent
+ * on the log with the batch in contiguous buffers.
+ *
+ * A completed batch is moved out of the way under the lock guarding the pending
+ * samples and delivered after releasing it, one batch at a time, so that threads
+ * recording samples do not wait for batch observers. While samples are added
+ * concurrently, batches are delivered only on the thread that called
+ * BeginConcurrentSamples(), the one running ParallelExhaustiveSweep::StartSweep,
+ * so that observers which must run on that thread, such as Python callbacks
+ * needing the interpreter lock it holds, do not block the other workers; batches
+ * completed by other threads wait for it or for EndConcurrentSamples().
+ *
+ * Template parameters for class ExhaustiveLogBatcher:
+ *
+ * - TValue = Element type stored at each location in the data image.
+ * - TImageDimension = Dimension of image equal to number of transform parameters
+ *
+ * \ingroup ITKOptimizationMonitor
+ */
+template <typename TValue, unsigned int TImageDimension>
+class ExhaustiveLogBatcher : public ExhaustiveLogCollaborator<TValue, TImageDimension>
+{
+public:
+  ITK_DISALLOW_COPY_AND_MOVE(ExhaustiveLogBatcher);
+
+  using Self = ExhaustiveLogBatcher;
+  using Superclass = ExhaustiveLogCollaborator<TValue, TImageDimension>;
+  using Pointer = SmartPointer<Self>;
+  using ConstPointer = SmartPointer<const Self>;
+  itkNewMacro(Self);
+  itkOverrideGetNameOfClassMacro(ExhaustiveLogBatcher);
+
+  /** Image dimension */
+  static constexpr unsigned int Dimension = TImageDimension;
+
+  using typename Superclass::LogType;
+  using typename Superclass::InternalDataType;
+  using typename Superclass::IndexType;
+  using typename Superclass::IndexValueType;
+  using typename Superclass::SizeValueType;
+  using typename Superclass::OffsetValueType;
+
+  /** Size the batch buffers from the batch settings of the log. Returns whether
+   *  batches are delivered. */
+  bool
+  Initialize(LogType * log) override;
+
+  /** Add a sample to the pending batch, delivering it when full or overdue. */
+  void
+  AddSample(OffsetValueType offset, const IndexType * index, const InternalDataType & value) override;
+
+  /** Deliver batches completed concurrently only on the calling thread until
+   *  EndConcurrentSamples(). */
+  void
+  BeginConcurrentSamples(ThreadIdType numberOfWorkUnits) override;
+
+  /** Deliver the batches completed concurrently that are still waiting. */
+  void
+  EndConcurrentSamples() override;
+
+  /** Deliver the pending samples, if any, and completed batches still waiting. */
+  void
+  Flush() override;
+
+  /** Samples of the batch being delivered. */
+  SizeValueType
+  GetNumberOfSamples() const
+  {
+    return m_Delivered.Offsets.size();
+  }
+  const OffsetValueType *
+  GetOffsetBuffer() const
+  {
+    return m_Delivered.Offsets.data();
+  }
+  const IndexValueType *
+  GetIndexBuffer() const
+  {
+    return m_DeliveredIndices.data();
+  }
+  const InternalDataType *
+  GetValueBuffer() const
+  {
+    return m_Delivered.Values.data();
+  }
+
+protected:
+  ExhaustiveLogBatcher() = default;
+  ~ExhaustiveLogBatcher() override = default;
+
+private:
+  /** Offsets and values of the samples of a batch. */
+  struct BatchType
+  {
+    std::vector<OffsetValueType>  Offsets;
+    std::vector<InternalDataType> Values;
+  };
+
+  /** Queue the pending samples as a completed batch. Called with m_BatchMutex held. */
+  void
+  CompletePendingBatch();
+
+  /** Invoke IterationEvent on the log for each completed batch in turn. Called
+   *  without m_BatchMutex held. */
+  void
+  DeliverCompletedBatches();
+
+  /** Batch settings, then the pending samples and completed batches, guarded by
+   *  m_BatchMutex, with emptied batches kept for reuse. */
+  LogType *                             m_Log{ nullptr };
+  double                                m_Interval{ 0.0 };
+  SizeValueType                         m_Capacity{ 0 };
+  BatchType                             m_Pending;
+  std::deque<BatchType>                 m_CompletedBatches;
+  std::vector<BatchType>                m_SpareBatches;
+  std::chrono::steady_clock::time_point m_LastBatchTime;
+  bool                                  m_DeliveringOnOneThread{ false };
+  std::thread::id                       m_DeliveryThread;
+  std::mutex                            m_BatchMutex;
+
+  /** Batch being delivered and its lattice indices, guarded by m_DeliveryMutex. */
+  BatchType                   m_Delivered;
+  std::vector<IndexValueType> m_DeliveredIndices;
+  std::mutex                  m_DeliveryMutex;
+};
+} // namespace itk
+
+#ifndef ITK_MANUAL_INSTANTIATION
+#  include "itkExhaustiveLogBatcher.hxx"
+#endif
+
+#endif // itkExhaustiveLogBatcher_h
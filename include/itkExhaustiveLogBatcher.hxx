@@ -0,0 +1,179 @@
+/*=========================================================================
+ *
+ *  Copyright NumFOCUS
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *         https://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *=========================================================================*/
+
+#ifndef itkExhaustiveLogBatcher_hxx
+#define itkExhaustiveLogBatcher_hxx
+
+#include "itkExhaustiveLogBatcher.h"
+#include "itkCommandExhaustiveLog.h"
+
+#include <algorithm>
+#include <utility>
+
+namespace itk
+{
+template <typename TValue, unsigned int TImageDimension>
+bool
+ExhaustiveLogBatcher<TValue, TImageDimension>::Initialize(LogType * log)
+{
+  std::lock_guard<std::mutex> deliveryLock(m_DeliveryMutex);
+  std::lock_guard<std::mutex> lock(m_BatchMutex);
+
+  // With a time limit alone, batches are also delivered whenever this many samples wait
+  constexpr SizeValueType defaultBatchCapacity = 4096;
+
+  m_Log = log;
+  m_Interval = log->GetBatchInterval();
+  const bool batching = log->GetBatchSize() > 0 || m_Interval > 0.0;
+  m_Capacity = !batching ? 0 : (log->GetBatchSize() > 0) ? log->GetBatchSize() : defaultBatchCapacity;
+  m_Pending.Offsets.clear();
+  m_Pending.Values.clear();
+  m_Pending.Offsets.reserve(m_Capacity);
+  m_Pending.Values.reserve(m_Capacity);
+  m_CompletedBatches.clear();
+  m_SpareBatches.clear();
+  m_Delivered.Offsets.clear();
+  m_Delivered.Values.clear();
+  m_DeliveredIndices.clear();
+  m_DeliveringOnOneThread = false;
+  m_LastBatchTime = std::chrono::steady_clock::now();
+  return batching;
+}
+
+template <typename TValue, unsigned int TImageDimension>
+void
+ExhaustiveLogBatcher<TValue, TImageDimension>::AddSample(OffsetValueType offset,
+                                                         const IndexType *,
+                                                         const InternalDataType & value)
+{
+  bool deliver = false;
+  {
+    std::lock_guard<std::mutex> lock(m_BatchMutex);
+    m_Pending.Offsets.push_back(offset);
+    m_Pending.Values.push_back(value);
+
+    if (m_Pending.Offsets.size() >= m_Capacity)
+    {
+      CompletePendingBatch();
+    }
+    else if (m_Interval > 0.0)
+    {
+      const std::chrono::duration<double, std::milli> elapsed = std::chrono::steady_clock::now() - m_LastBatchTime;
+      if (elapsed.count() >= m_Interval)
+      {
+        CompletePendingBatch();
+      }
+    }
+    deliver = !m_CompletedBatches.empty() &&
+              (!m_DeliveringOnOneThread || std::this_thread::get_id() == m_DeliveryThread);
+  }
+
+  if (deliver)
+  {
+    DeliverCompletedBatches();
+  }
+}
+
+template <typename TValue, unsigned int TImageDimension>
+void
+ExhaustiveLogBatcher<TValue, TImageDimension>::BeginConcurrentSamples(ThreadIdType)
+{
+  std::lock_guard<std::mutex> lock(m_BatchMutex);
+  m_DeliveringOnOneThread = true;
+  m_DeliveryThread = std::this_thread::get_id();
+}
+
+template <typename TValue, unsigned int TImageDimension>
+void
+ExhaustiveLogBatcher<TValue, TImageDimension>::EndConcurrentSamples()
+{
+  {
+    std::lock_guard<std::mutex> lock(m_BatchMutex);
+    m_DeliveringOnOneThread = false;
+  }
+  DeliverCompletedBatches();
+}
+
+template <typename TValue, unsigned int TImageDimension>
+void
+ExhaustiveLogBatcher<TValue, TImageDimension>::CompletePendingBatch()
+{
+  BatchType batch;
+  if (!m_SpareBatches.empty())
+  {
+    batch = std::move(m_SpareBatches.back());
+    m_SpareBatches.pop_back();
+  }
+  batch.Offsets.clear();
+  batch.Values.clear();
+  batch.Offsets.reserve(m_Capacity);
+  batch.Values.reserve(m_Capacity);
+
+  std::swap(batch, m_Pending);
+  m_CompletedBatches.push_back(std::move(batch));
+  m_LastBatchTime = std::chrono::steady_clock::now();
+}
+
+template <typename TValue, unsigned int TImageDimension>
+void
+ExhaustiveLogBatcher<TValue, TImageDimension>::DeliverCompletedBatches()
+{
+  std::lock_guard<std::mutex> deliveryLock(m_DeliveryMutex);
+  while (true)
+  {
+    {
+      std::lock_guard<std::mutex> lock(m_BatchMutex);
+      if (m_CompletedBatches.empty())
+      {
+        return;
+      }
+      m_SpareBatches.push_back(std::move(m_Delivered));
+      m_Delivered = std::move(m_CompletedBatches.front());
+      m_CompletedBatches.pop_front();
+    }
+
+    // Indices are only needed once per batch, so they are not tracked per sample
+    const SizeValueType numberOfSamples = m_Delivered.Offsets.size();
+    m_DeliveredIndices.resize(numberOfSamples * Dimension);
+    IndexValueType * indices = m_DeliveredIndices.data();
+    for (SizeValueType sample = 0; sample < numberOfSamples; sample++, indices += Dimension)
+    {
+      const IndexType index = m_Log->ComputeIndex(m_Delivered.Offsets[sample]);
+      std::copy_n(index.begin(), Dimension, indices);
+    }
+
+    m_Log->InvokeEvent(IterationEvent());
+  }
+}
+
+template <typename TValue, unsigned int TImageDimension>
+void
+ExhaustiveLogBatcher<TValue, TImageDimension>::Flush()
+{
+  {
+    std::lock_guard<std::mutex> lock(m_BatchMutex);
+    if (!m_Pending.Offsets.empty())
+    {
+      CompletePendingBatch();
+    }
+  }
+  DeliverCompletedBatches();
+}
+} // namespace itk
+
+#endif // itkExhaustiveLogBatcher_hxx
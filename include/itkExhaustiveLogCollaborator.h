@@ -0,0 +1,123 @@
+/*=========================================================================
+ *
+ *  Copyright NumFOCUS
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *         https://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *=========================================================================*/
+#ifndef itkExhaustiveLogCollaborator_h
+#define itkExhaustiveLogCollaborator_h
+
+#include "itkMacro.h"
+#include "itkIntTypes.h"
+#include "itkObject.h"
+#include "itkObjectFactory.h"
+#include "itkImageRegion.h"
+#include "itkPoint.h"
+
+namespace itk
+{
+template <typename TValue, unsigned int TImageDimension>
+class CommandExhaustiveLog;
+
+/**
+ *\class ExhaustiveLogCollaborator
+ *  \brief Receives the samples recorded by a CommandExhaustiveLog for an optional feature.
+ *
+ * Features of CommandExhaustiveLog beyond storing the lattice, such as the stream
+ * file, batch delivery and online reductions, are each implemented by a
+ * collaborator. At initialization the log sets up every collaborator from its own
+ * settings and attaches those whose feature is enabled; each recorded sample is
+ * then handed to the attached collaborators in turn, so that a disabled feature
+ * costs nothing per sample.
+ *
+ * Template parameters for class ExhaustiveLogCollaborator:
+ *
+ * - TValue = Element type stored at each location in the data image.
+ * - TImageDimension = Dimension of image equal to number of transform parameters
+ *
+ * \ingroup ITKOptimizationMonitor
+ */
+template <typename TValue, unsigned int TImageDimension>
+class ExhaustiveLogCollaborator : public Object
+{
+public:
+  ITK_DISALLOW_COPY_AND_MOVE(ExhaustiveLogCollaborator);
+
+  using Self = ExhaustiveLogCollaborator;
+  using Superclass = Object;
+  using Pointer = SmartPointer<Self>;
+  using ConstPointer = SmartPointer<const Self>;
+  itkOverrideGetNameOfClassMacro(ExhaustiveLogCollaborator);
+
+  /** Image dimension */
+  static constexpr unsigned int Dimension = TImageDimension;
+
+  using LogType = CommandExhaustiveLog<TValue, TImageDimension>;
+  using InternalDataType = TValue;
+  using IndexType = Index<TImageDimension>;
+  using IndexValueType = itk::IndexValueType;
+  using SizeType = Size<TImageDimension>;
+  using SizeValueType = itk::SizeValueType;
+  using OffsetValueType = itk::OffsetValueType;
+  using RegionType = ImageRegion<TImageDimension>;
+  using PointType = Point<double, TImageDimension>;
+
+  /** Set up for the lattice of the log being initialized, from the settings of the
+   *  log. Returns whether the feature is enabled, that is whether the log should
+   *  attach this collaborator. */
+  virtual bool
+  Initialize(LogType * log) = 0;
+
+  /** Take a sample written at a linear offset into the data array of the log. The
+   *  lattice index of the sample is given when the log knows it, and is null
+   *  otherwise. Concurrent calls are made for distinct offsets. */
+  virtual void
+  AddSample(OffsetValueType offset, const IndexType * index, const InternalDataType & value) = 0;
+
+  /** Prepare for samples added concurrently by numberOfWorkUnits work units through
+   *  AddConcurrentSample() until EndConcurrentSamples(). Does nothing by default. */
+  virtual void
+  BeginConcurrentSamples(ThreadIdType itkNotUsed(numberOfWorkUnits))
+  {}
+
+  /** Take a sample added by one of the work units announced to
+   *  BeginConcurrentSamples(). No two calls share a work unit at the same time, so
+   *  that state kept per work unit needs no lock. Calls AddSample() by default. */
+  virtual void
+  AddConcurrentSample(ThreadIdType             itkNotUsed(workUnit),
+                      OffsetValueType          offset,
+                      const IndexType *        index,
+                      const InternalDataType & value)
+  {
+    this->AddSample(offset, index, value);
+  }
+
+  /** Combine the samples added concurrently since BeginConcurrentSamples(). Does
+   *  nothing by default. */
+  virtual void
+  EndConcurrentSamples()
+  {}
+
+  /** Complete work left pending by the samples taken so far. Called on EndEvent. */
+  virtual void
+  Flush()
+  {}
+
+protected:
+  ExhaustiveLogCollaborator() = default;
+  ~ExhaustiveLogCollaborator() override = default;
+};
+} // namespace itk
+
+#endif // itkExhaustiveLogCollaborator_h
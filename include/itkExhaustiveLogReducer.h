@@ -0,0 +1,289 @@
+/*=========================================================================
+ *
+ *  Copyright NumFOCUS
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *         https://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *=========================================================================*/
+#ifndef itkExhaustiveLogReducer_h
+#define itkExhaustiveLogReducer_h
+
+#include "itkExhaustiveLogCollaborator.h"
+#include "itkImage.h"
+
+#include <mutex>
+#include <utility>
+#include <vector>
+
+namespace itk
+{
+/**
+ *\class ExhaustiveLogReducer
+ *  \brief Maintains online reductions of the samples recorded by a CommandExhaustiveLog.
+ *
+ * Collaborator of CommandExhaustiveLog updating, as samples arrive, the summaries
+ * enabled on the log: running statistics (see
+ * CommandExhaustiveLog::SetComputeStatistics), a histogram (see
+ * CommandExhaustiveLog::SetNumberOfHistogramBins), the deepest local minima (see
+ * CommandExhaustiveLog::SetNumberOfLocalMinima) and the pairwise minimum
+ * projections (see CommandExhaustiveLog::SetComputeProjections). The log forwards
+ * its getters of the summaries here.
+ *
+ * Samples added concurrently, for example by the work units of
+ * ParallelExhaustiveSweep, are reduced by each work unit on its own and the partial
+ * reductions merged at EndConcurrentSamples(), so that work units do not contend
+ * for a lock on every sample. Local minima are searched for online only while
+ * samples arrive in lattice order; after any sample out of that order, they are
+ * searched again over the stored lattice when next requested.
+ *
+ * Template parameters for class ExhaustiveLogReducer:
+ *
+ * - TValue = Element type stored at each location in the data image.
+ * - TImageDimension = Dimension of image equal to number of transform parameters
+ *
+ * \ingroup ITKOptimizationMonitor
+ */
+template <typename TValue, unsigned int TImageDimension>
+class ExhaustiveLogReducer : public ExhaustiveLogCollaborator<TValue, TImageDimension>
+{
+public:
+  ITK_DISALLOW_COPY_AND_MOVE(ExhaustiveLogReducer);
+
+  using Self = ExhaustiveLogReducer;
+  using Superclass = ExhaustiveLogCollaborator<TValue, TImageDimension>;
+  using Pointer = SmartPointer<Self>;
+  using ConstPointer = SmartPointer<const Self>;
+  itkNewMacro(Self);
+  itkOverrideGetNameOfClassMacro(ExhaustiveLogReducer);
+
+  /** Image dimension */
+  static constexpr unsigned int Dimension = TImageDimension;
+
+  using typename Superclass::LogType;
+  using typename Superclass::InternalDataType;
+  using typename Superclass::IndexType;
+  using typename Superclass::IndexValueType;
+  using typename Superclass::SizeType;
+  using typename Superclass::SizeValueType;
+  using typename Superclass::OffsetValueType;
+  using typename Superclass::PointType;
+
+  /** Local minimum of the logged surface. */
+  struct LocalMinimumType
+  {
+    InternalDataType Value;
+    OffsetValueType  Offset;
+    PointType        Position;
+  };
+  using LocalMinimaContainerType = std::vector<LocalMinimumType>;
+
+  /** Sample counts of equal-width bins. */
+  using HistogramType = std::vector<SizeValueType>;
+
+  /** Minimum of the lattice over all parameters but two, and the linear offset of
+   *  the sample attaining it. */
+  using ProjectionImageType = Image<InternalDataType, 2>;
+  using ProjectionImagePointer = typename ProjectionImageType::Pointer;
+  using ProjectionArgminImageType = Image<OffsetValueType, 2>;
+  using ProjectionArgminImagePointer = typename ProjectionArgminImageType::Pointer;
+
+  /** Reset the reductions enabled on the log for its lattice. Returns whether any
+   *  is enabled. Throws if the histogram range is empty. */
+  bool
+  Initialize(LogType * log) override;
+
+  /** Add a sample to the reductions. */
+  void
+  AddSample(OffsetValueType offset, const IndexType * index, const InternalDataType & value) override;
+
+  /** Reduce samples of each work unit separately until EndConcurrentSamples(). */
+  void
+  BeginConcurrentSamples(ThreadIdType numberOfWorkUnits) override;
+  void
+  AddConcurrentSample(ThreadIdType             workUnit,
+                      OffsetValueType          offset,
+                      const IndexType *        index,
+                      const InternalDataType & value) override;
+
+  /** Merge the reductions of the work units. Of equal samples added concurrently,
+   *  the extremes and projections keep the one at the lowest offset. */
+  void
+  EndConcurrentSamples() override;
+
+  /** Summaries of the samples added since initialization, as documented by the
+   *  getters of CommandExhaustiveLog. Extreme samples are given by their linear
+   *  offset, negative before any sample is added. */
+  SizeValueType
+  GetNumberOfRecordedSamples() const;
+  InternalDataType
+  GetMinimumValue() const;
+  OffsetValueType
+  GetMinimumOffset() const;
+  InternalDataType
+  GetMaximumValue() const;
+  OffsetValueType
+  GetMaximumOffset() const;
+  double
+  GetMean() const;
+  double
+  GetVariance() const;
+  HistogramType
+  GetHistogram() const;
+
+  /** Deepest local minima, lowest first. Searched again over the stored lattice,
+   *  where unwritten samples read as FillValue, if samples have been added out of
+   *  lattice order since the last search; throws if the lattice is not stored then. */
+  LocalMinimaContainerType
+  GetLocalMinima() const;
+
+  /** Number of projection images, D*(D-1)/2 when projections are computed. */
+  unsigned int
+  GetNumberOfProjections() const
+  {
+    return static_cast<unsigned int>(m_ProjectionImages.size());
+  }
+  ProjectionImageType *
+  GetProjectionImage(unsigned int first, unsigned int second) const;
+  ProjectionArgminImageType *
+  GetProjectionArgminImage(unsigned int first, unsigned int second) const;
+
+protected:
+  ExhaustiveLogReducer();
+  ~ExhaustiveLogReducer() override = default;
+
+private:
+  /** Running statistics and histogram of a set of samples. */
+  struct AccumulatorType
+  {
+    SizeValueType    NumberOfSamples;
+    InternalDataType MinimumValue;
+    InternalDataType MaximumValue;
+    OffsetValueType  MinimumOffset;
+    OffsetValueType  MaximumOffset;
+    double           Mean;
+    double           SumOfSquaredDeviations;
+    HistogramType    Histogram;
+  };
+
+  /** Reductions of the samples of one work unit between BeginConcurrentSamples()
+   *  and EndConcurrentSamples(), projections in the order of m_ProjectionBuffers. */
+  struct PartialReductionsType
+  {
+    AccumulatorType                 Accumulator;
+    std::vector<InternalDataType>   ProjectionValues;
+    std::vector<OffsetValueType>    ProjectionArgmins;
+    std::vector<InternalDataType *> ProjectionBuffers;
+    std::vector<OffsetValueType *>  ProjectionArgminBuffers;
+  };
+
+  /** State of the local minima search over samples arriving in lattice order:
+   *  recent samples in a ring spanning the neighborhood reach on both sides of the
+   *  candidate, the candidate awaiting its last neighbor, and a max-heap of the
+   *  deepest minima. */
+  struct LocalMinimaSearchType
+  {
+    std::vector<InternalDataType>                             Window;
+    OffsetValueType                                           NextOffset;
+    OffsetValueType                                           CandidateOffset;
+    IndexType                                                 CandidateIndex;
+    std::vector<std::pair<InternalDataType, OffsetValueType>> Heap;
+  };
+
+  /** Empty the statistics and histogram. */
+  void
+  ResetAccumulator(AccumulatorType & accumulator) const;
+
+  /** Add a sample to running statistics and a histogram. Of equal extremes the first
+   *  added is kept, or with lowestOffsetFirst the one at the lowest offset. */
+  void
+  AccumulateSample(AccumulatorType &        accumulator,
+                   const OffsetValueType    offset,
+                   const InternalDataType & value,
+                   bool                     lowestOffsetFirst) const;
+
+  /** Merge the statistics and histogram of another set of samples. */
+  void
+  MergeAccumulator(AccumulatorType & accumulator, const AccumulatorType & other) const;
+
+  /** Lower the projections held in the given buffers with a sample. Of equal samples
+   *  the first added is kept, or with lowestOffsetFirst the one at the lowest offset. */
+  void
+  UpdateProjections(const std::vector<InternalDataType *> & projectionBuffers,
+                    const std::vector<OffsetValueType *> &  argminBuffers,
+                    const OffsetValueType                   offset,
+                    const IndexType &                       index,
+                    const InternalDataType &                value,
+                    bool                                    lowestOffsetFirst) const;
+
+  /** Restart the local minima search at the first sample of the lattice. */
+  void
+  ResetLocalMinimaSearch() const;
+
+  /** Add the next sample in lattice order to the local minima search, deciding the
+   *  samples whose neighborhoods it completes. */
+  void
+  TrackLocalMinima(const OffsetValueType offset, const InternalDataType & value) const;
+
+  /** Decide whether the current local minimum candidate is one. */
+  void
+  TestLocalMinimumCandidate() const;
+
+  /** Search the stored lattice for local minima in lattice order. Requires m_ReductionMutex. */
+  void
+  RescanLocalMinima() const;
+
+  /** Position of the projection onto two parameters in the projection containers. */
+  unsigned int
+  GetProjectionNumber(unsigned int first, unsigned int second) const;
+
+  /** Log whose lattice is reduced, and the region of it that is stored. */
+  LogType * m_Log{ nullptr };
+  IndexType m_LatticeStart;
+  SizeType  m_LatticeSize;
+  bool      m_LatticeStored{ false };
+
+  /** Reductions enabled at initialization, then state guarded by m_ReductionMutex. */
+  bool               m_Accumulating{ false };
+  bool               m_AccumulatingStatistics{ false };
+  SizeValueType      m_NumberOfHistogramBins{ 0 };
+  double             m_HistogramMinimum{ 0.0 };
+  double             m_HistogramBinsPerValue{ 0.0 };
+  mutable std::mutex m_ReductionMutex;
+  AccumulatorType    m_Accumulator;
+
+  /** Partial reductions of each work unit while samples are added concurrently. */
+  std::vector<PartialReductionsType> m_PartialReductions;
+
+  /** Local minima settings and neighbor displacements as offsets and indices, then
+   *  the search, which is redone over the lattice on request once outdated. */
+  SizeValueType                 m_NumberOfLocalMinima{ 0 };
+  OffsetValueType               m_MinimaReach{ 0 };
+  OffsetValueType               m_MinimaLastOffset{ 0 };
+  std::vector<OffsetValueType>  m_NeighborOffsets;
+  std::vector<IndexValueType>   m_NeighborDisplacements;
+  mutable LocalMinimaSearchType m_MinimaSearch;
+  mutable bool                  m_LocalMinimaOutdated{ false };
+
+  /** Pairwise projections in (0,1), (0,2), ..., (1,2), ... order, with their buffers. */
+  std::vector<ProjectionImagePointer>       m_ProjectionImages;
+  std::vector<ProjectionArgminImagePointer> m_ProjectionArgminImages;
+  std::vector<InternalDataType *>           m_ProjectionBuffers;
+  std::vector<OffsetValueType *>            m_ProjectionArgminBuffers;
+};
+} // namespace itk
+
+#ifndef ITK_MANUAL_INSTANTIATION
+#  include "itkExhaustiveLogReducer.hxx"
+#endif
+
+#endif // itkExhaustiveLogReducer_h
@@ -0,0 +1,666 @@
+/*=========================================================================
+ *
+ *  Copyright NumFOCUS
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *         https://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *=========================================================================*/
+
+#ifndef itkExhaustiveLogReducer_hxx
+#define itkExhaustiveLogReducer_hxx
+
+#include "itkExhaustiveLogReducer.h"
+#include "itkCommandExhaustiveLog.h"
+#include "itkNumericTraits.h"
+
+#include <algorithm>
+
+namespace itk
+{
+template <typename TValue, unsigned int TImageDimension>
+ExhaustiveLogReducer<TValue, TImageDimension>::ExhaustiveLogReducer()
+{
+  m_LatticeStart.Fill(0);
+  m_LatticeSize.Fill(0);
+  ResetAccumulator(m_Accumulator);
+  ResetLocalMinimaSearch();
+}
+
+template <typename TValue, unsigned int TImageDimension>
+bool
+ExhaustiveLogReducer<TValue, TImageDimension>::Initialize(LogType * log)
+{
+  std::lock_guard<std::mutex> lock(m_ReductionMutex);
+
+  m_Log = log;
+  const auto region = log->GetRegion();
+  m_LatticeStart = region.GetIndex();
+  m_LatticeSize = region.GetSize();
+  m_LatticeStored = log->GetStoreLattice();
+  const bool sharded = (region != typename Superclass::RegionType(log->GetLatticeSize()));
+
+  m_NumberOfHistogramBins = log->GetNumberOfHistogramBins();
+  m_AccumulatingStatistics = log->GetComputeStatistics();
+  m_Accumulating = m_AccumulatingStatistics || m_NumberOfHistogramBins > 0;
+  m_HistogramMinimum = log->GetHistogramMinimum();
+  if (m_NumberOfHistogramBins > 0)
+  {
+    const double histogramMaximum = log->GetHistogramMaximum();
+    if (!(histogramMaximum > m_HistogramMinimum))
+    {
+      itkExceptionMacro("Histogram range [" << m_HistogramMinimum << ", " << histogramMaximum << ") is empty");
+    }
+    m_HistogramBinsPerValue = static_cast<double>(m_NumberOfHistogramBins) / (histogramMaximum - m_HistogramMinimum);
+  }
+  ResetAccumulator(m_Accumulator);
+  m_PartialReductions.clear();
+
+  m_ProjectionImages.clear();
+  m_ProjectionArgminImages.clear();
+  m_ProjectionBuffers.clear();
+  m_ProjectionArgminBuffers.clear();
+  if (log->GetComputeProjections())
+  {
+    const auto spacing = log->GetStepSize();
+    const auto origin = log->GetOrigin();
+    for (unsigned int first = 0; first < Dimension; first++)
+    {
+      for (unsigned int second = first + 1; second < Dimension; second++)
+      {
+        typename ProjectionImageType::RegionType  projectionRegion;
+        typename ProjectionImageType::SpacingType projectionSpacing;
+        typename ProjectionImageType::PointType   projectionOrigin;
+        projectionSpacing[0] = spacing[first];
+        projectionSpacing[1] = spacing[second];
+        projectionOrigin[0] = origin[first];
+        projectionOrigin[1] = origin[second];
+        projectionRegion.SetIndex(0, m_LatticeStart[first]);
+        projectionRegion.SetIndex(1, m_LatticeStart[second]);
+        projectionRegion.SetSize(0, m_LatticeSize[first]);
+        projectionRegion.SetSize(1, m_LatticeSize[second]);
+
+        ProjectionImagePointer projection = ProjectionImageType::New();
+        projection->SetRegions(projectionRegion);
+        projection->SetSpacing(projectionSpacing);
+        projection->SetOrigin(projectionOrigin);
+        projection->Allocate();
+        projection->FillBuffer(NumericTraits<InternalDataType>::max());
+
+        ProjectionArgminImagePointer argmin = ProjectionArgminImageType::New();
+        argmin->SetRegions(projectionRegion);
+        argmin->SetSpacing(projectionSpacing);
+        argmin->SetOrigin(projectionOrigin);
+        argmin->Allocate();
+        argmin->FillBuffer(-1);
+
+        m_ProjectionBuffers.push_back(projection->GetBufferPointer());
+        m_ProjectionArgminBuffers.push_back(argmin->GetBufferPointer());
+        m_ProjectionImages.push_back(projection);
+        m_ProjectionArgminImages.push_back(argmin);
+      }
+    }
+  }
+
+  m_NumberOfLocalMinima = sharded ? 0 : log->GetNumberOfLocalMinima();
+  m_NeighborOffsets.clear();
+  m_NeighborDisplacements.clear();
+  m_MinimaSearch.Window.clear();
+  m_MinimaReach = 0;
+  m_LocalMinimaOutdated = false;
+  ResetLocalMinimaSearch();
+  const bool reducing = m_Accumulating || m_NumberOfLocalMinima > 0 || !m_ProjectionBuffers.empty();
+  if (m_NumberOfLocalMinima == 0)
+  {
+    return reducing;
+  }
+
+  // Neighborhood radius clipped to the lattice, and the farthest neighbor in lattice order
+  OffsetValueType offsetTable[TImageDimension + 1];
+  IndexValueType  radius[TImageDimension];
+  IndexValueType  displacement[TImageDimension];
+  offsetTable[0] = 1;
+  for (unsigned int dim = 0; dim < Dimension; dim++)
+  {
+    offsetTable[dim + 1] = offsetTable[dim] * static_cast<OffsetValueType>(m_LatticeSize[dim]);
+    radius[dim] = static_cast<IndexValueType>(std::min(log->GetLocalMinimaRadius(), m_LatticeSize[dim] - 1));
+    displacement[dim] = -radius[dim];
+    m_MinimaReach += radius[dim] * offsetTable[dim];
+  }
+  m_MinimaLastOffset = offsetTable[Dimension] - 1;
+
+  // Every displacement within the radius except none
+  unsigned int carry = 0;
+  while (carry < Dimension)
+  {
+    OffsetValueType neighborOffset = 0;
+    for (unsigned int dim = 0; dim < Dimension; dim++)
+    {
+      neighborOffset += displacement[dim] * offsetTable[dim];
+    }
+    if (neighborOffset != 0)
+    {
+      m_NeighborOffsets.push_back(neighborOffset);
+      m_NeighborDisplacements.insert(m_NeighborDisplacements.end(), displacement, displacement + Dimension);
+    }
+
+    for (carry = 0; carry < Dimension; carry++)
+    {
+      if (++displacement[carry] <= radius[carry])
+      {
+        break;
+      }
+      displacement[carry] = -radius[carry];
+    }
+  }
+
+  // A candidate is decided when its farthest neighbor arrives, at which point its
+  // nearest neighbor in lattice order is as far behind
+  m_MinimaSearch.Window.resize(static_cast<size_t>(2 * m_MinimaReach + 1));
+  m_MinimaSearch.Heap.reserve(m_NumberOfLocalMinima + 1);
+  return reducing;
+}
+
+template <typename TValue, unsigned int TImageDimension>
+void
+ExhaustiveLogReducer<TValue, TImageDimension>::AddSample(OffsetValueType          offset,
+                                                         const IndexType *        index,
+                                                         const InternalDataType & value)
+{
+  std::lock_guard<std::mutex> lock(m_ReductionMutex);
+  if (m_Accumulating)
+  {
+    AccumulateSample(m_Accumulator, offset, value, false);
+  }
+  if (!m_MinimaSearch.Window.empty() && !m_LocalMinimaOutdated)
+  {
+    // A stored lattice is searched again on request for samples out of lattice
+    // order; otherwise the online search resynchronizes past them
+    if (offset == m_MinimaSearch.NextOffset || !m_LatticeStored)
+    {
+      TrackLocalMinima(offset, value);
+    }
+    else
+    {
+      m_LocalMinimaOutdated = true;
+    }
+  }
+  if (!m_ProjectionBuffers.empty())
+  {
+    UpdateProjections(m_ProjectionBuffers,
+                      m_ProjectionArgminBuffers,
+                      offset,
+                      (index != nullptr) ? *index : m_Log->ComputeIndex(offset),
+                      value,
+                      false);
+  }
+}
+
+template <typename TValue, unsigned int TImageDimension>
+void
+ExhaustiveLogReducer<TValue, TImageDimension>::BeginConcurrentSamples(ThreadIdType numberOfWorkUnits)
+{
+  std::lock_guard<std::mutex> lock(m_ReductionMutex);
+
+  // Concurrent samples arrive out of lattice order
+  if (!m_MinimaSearch.Window.empty())
+  {
+    m_LocalMinimaOutdated = true;
+  }
+
+  m_PartialReductions.resize(numberOfWorkUnits);
+  for (auto & partial : m_PartialReductions)
+  {
+    ResetAccumulator(partial.Accumulator);
+    partial.ProjectionBuffers.clear();
+    partial.ProjectionArgminBuffers.clear();
+
+    SizeValueType projectionLength = 0;
+    for (const auto & projection : m_ProjectionImages)
+    {
+      projectionLength += projection->GetBufferedRegion().GetNumberOfPixels();
+    }
+    partial.ProjectionValues.assign(projectionLength, NumericTraits<InternalDataType>::max());
+    partial.ProjectionArgmins.assign(projectionLength, -1);
+
+    SizeValueType projectionStart = 0;
+    for (const auto & projection : m_ProjectionImages)
+    {
+      partial.ProjectionBuffers.push_back(partial.ProjectionValues.data() + projectionStart);
+      partial.ProjectionArgminBuffers.push_back(partial.ProjectionArgmins.data() + projectionStart);
+      projectionStart += projection->GetBufferedRegion().GetNumberOfPixels();
+    }
+  }
+}
+
+template <typename TValue, unsigned int TImageDimension>
+void
+ExhaustiveLogReducer<TValue, TImageDimension>::AddConcurrentSample(ThreadIdType             workUnit,
+                                                                   OffsetValueType          offset,
+                                                                   const IndexType *        index,
+                                                                   const InternalDataType & value)
+{
+  PartialReductionsType & partial = m_PartialReductions[workUnit];
+  if (m_Accumulating)
+  {
+    AccumulateSample(partial.Accumulator, offset, value, true);
+  }
+  if (!partial.ProjectionBuffers.empty())
+  {
+    UpdateProjections(partial.ProjectionBuffers,
+                      partial.ProjectionArgminBuffers,
+                      offset,
+                      (index != nullptr) ? *index : m_Log->ComputeIndex(offset),
+                      value,
+                      true);
+  }
+}
+
+template <typename TValue, unsigned int TImageDimension>
+void
+ExhaustiveLogReducer<TValue, TImageDimension>::EndConcurrentSamples()
+{
+  std::lock_guard<std::mutex> lock(m_ReductionMutex);
+  for (const auto & partial : m_PartialReductions)
+  {
+    MergeAccumulator(m_Accumulator, partial.Accumulator);
+
+    const SizeValueType numberOfProjections = partial.ProjectionBuffers.size();
+    for (SizeValueType projection = 0; projection < numberOfProjections; projection++)
+    {
+      const SizeValueType numberOfPixels = m_ProjectionImages[projection]->GetBufferedRegion().GetNumberOfPixels();
+
+      const InternalDataType * partialMinimum = partial.ProjectionBuffers[projection];
+      const OffsetValueType *  partialArgmin = partial.ProjectionArgminBuffers[projection];
+      InternalDataType *       minimum = m_ProjectionBuffers[projection];
+      OffsetValueType *        argmin = m_ProjectionArgminBuffers[projection];
+      for (SizeValueType pixel = 0; pixel < numberOfPixels; pixel++)
+      {
+        if (partialArgmin[pixel] >= 0 &&
+            (argmin[pixel] < 0 || partialMinimum[pixel] < minimum[pixel] ||
+             (!(minimum[pixel] < partialMinimum[pixel]) && partialArgmin[pixel] < argmin[pixel])))
+        {
+          minimum[pixel] = partialMinimum[pixel];
+          argmin[pixel] = partialArgmin[pixel];
+        }
+      }
+    }
+  }
+  m_PartialReductions.clear();
+}
+
+template <typename TValue, unsigned int TImageDimension>
+void
+ExhaustiveLogReducer<TValue, TImageDimension>::ResetAccumulator(AccumulatorType & accumulator) const
+{
+  accumulator.NumberOfSamples = 0;
+  accumulator.MinimumValue = NumericTraits<InternalDataType>::max();
+  accumulator.MaximumValue = NumericTraits<InternalDataType>::NonpositiveMin();
+  accumulator.MinimumOffset = -1;
+  accumulator.MaximumOffset = -1;
+  accumulator.Mean = 0.0;
+  accumulator.SumOfSquaredDeviations = 0.0;
+  accumulator.Histogram.assign(m_NumberOfHistogramBins, 0);
+}
+
+template <typename TValue, unsigned int TImageDimension>
+void
+ExhaustiveLogReducer<TValue, TImageDimension>::AccumulateSample(AccumulatorType &        accumulator,
+                                                                const OffsetValueType    offset,
+                                                                const InternalDataType & value,
+                                                                bool                     lowestOffsetFirst) const
+{
+  ++accumulator.NumberOfSamples;
+
+  if (m_AccumulatingStatistics)
+  {
+    if (accumulator.MinimumOffset < 0 || value < accumulator.MinimumValue ||
+        (lowestOffsetFirst && !(accumulator.MinimumValue < value) && offset < accumulator.MinimumOffset))
+    {
+      accumulator.MinimumValue = value;
+      accumulator.MinimumOffset = offset;
+    }
+    if (accumulator.MaximumOffset < 0 || value > accumulator.MaximumValue ||
+        (lowestOffsetFirst && !(accumulator.MaximumValue > value) && offset < accumulator.MaximumOffset))
+    {
+      accumulator.MaximumValue = value;
+      accumulator.MaximumOffset = offset;
+    }
+
+    // Welford's update of the mean and sum of squared deviations
+    const auto   sample = static_cast<double>(value);
+    const double deviation = sample - accumulator.Mean;
+    accumulator.Mean += deviation / static_cast<double>(accumulator.NumberOfSamples);
+    accumulator.SumOfSquaredDeviations += deviation * (sample - accumulator.Mean);
+  }
+
+  if (!accumulator.Histogram.empty())
+  {
+    const double  position = (static_cast<double>(value) - m_HistogramMinimum) * m_HistogramBinsPerValue;
+    const auto    lastBin = static_cast<SizeValueType>(accumulator.Histogram.size() - 1);
+    SizeValueType bin = 0;
+    if (position >= static_cast<double>(lastBin))
+    {
+      bin = lastBin;
+    }
+    else if (position > 0.0)
+    {
+      bin = static_cast<SizeValueType>(position);
+    }
+    ++accumulator.Histogram[bin];
+  }
+}
+
+template <typename TValue, unsigned int TImageDimension>
+void
+ExhaustiveLogReducer<TValue, TImageDimension>::MergeAccumulator(AccumulatorType &       accumulator,
+                                                                const AccumulatorType & other) const
+{
+  if (other.NumberOfSamples == 0)
+  {
+    return;
+  }
+
+  if (m_AccumulatingStatistics)
+  {
+    if (accumulator.MinimumOffset < 0 || other.MinimumValue < accumulator.MinimumValue ||
+        (!(accumulator.MinimumValue < other.MinimumValue) && other.MinimumOffset < accumulator.MinimumOffset))
+    {
+      accumulator.MinimumValue = other.MinimumValue;
+      accumulator.MinimumOffset = other.MinimumOffset;
+    }
+    if (accumulator.MaximumOffset < 0 || other.MaximumValue > accumulator.MaximumValue ||
+        (!(accumulator.MaximumValue > other.MaximumValue) && other.MaximumOffset < accumulator.MaximumOffset))
+    {
+      accumulator.MaximumValue = other.MaximumValue;
+      accumulator.MaximumOffset = other.MaximumOffset;
+    }
+
+    // Chan et al.'s pairwise combination of the means and sums of squared deviations
+    const auto   count = static_cast<double>(accumulator.NumberOfSamples);
+    const auto   otherCount = static_cast<double>(other.NumberOfSamples);
+    const double total = count + otherCount;
+    const double deviation = other.Mean - accumulator.Mean;
+    accumulator.Mean += deviation * otherCount / total;
+    accumulator.SumOfSquaredDeviations +=
+      other.SumOfSquaredDeviations + deviation * deviation * count * otherCount / total;
+  }
+
+  accumulator.NumberOfSamples += other.NumberOfSamples;
+  for (SizeValueType bin = 0; bin < accumulator.Histogram.size(); bin++)
+  {
+    accumulator.Histogram[bin] += other.Histogram[bin];
+  }
+}
+
+template <typename TValue, unsigned int TImageDimension>
+void
+ExhaustiveLogReducer<TValue, TImageDimension>::ResetLocalMinimaSearch() const
+{
+  m_MinimaSearch.NextOffset = 0;
+  m_MinimaSearch.CandidateOffset = 0;
+  m_MinimaSearch.CandidateIndex = m_LatticeStart;
+  m_MinimaSearch.Heap.clear();
+}
+
+template <typename TValue, unsigned int TImageDimension>
+void
+ExhaustiveLogReducer<TValue, TImageDimension>::TrackLocalMinima(const OffsetValueType    offset,
+                                                                const InternalDataType & value) const
+{
+  LocalMinimaSearchType & search = m_MinimaSearch;
+  if (offset != search.NextOffset)
+  {
+    // Out of lattice order: pending candidates are dropped and the search resumes
+    // once a full reach of predecessors has been seen again
+    search.CandidateOffset = (offset == 0) ? 0 : offset + m_MinimaReach;
+    if (search.CandidateOffset <= m_MinimaLastOffset)
+    {
+      search.CandidateIndex = m_Log->ComputeIndex(search.CandidateOffset);
+    }
+  }
+
+  const auto windowLength = static_cast<OffsetValueType>(search.Window.size());
+  search.Window[offset % windowLength] = value;
+  search.NextOffset = offset + 1;
+
+  // The last sample completes every remaining neighborhood
+  const OffsetValueType lastDecided = (offset == m_MinimaLastOffset) ? offset : offset - m_MinimaReach;
+  while (search.CandidateOffset <= lastDecided)
+  {
+    TestLocalMinimumCandidate();
+
+    ++search.CandidateOffset;
+    for (unsigned int dim = 0; dim < Dimension; dim++)
+    {
+      if (static_cast<SizeValueType>(++search.CandidateIndex[dim] - m_LatticeStart[dim]) < m_LatticeSize[dim])
+      {
+        break;
+      }
+      search.CandidateIndex[dim] = m_LatticeStart[dim];
+    }
+  }
+}
+
+template <typename TValue, unsigned int TImageDimension>
+void
+ExhaustiveLogReducer<TValue, TImageDimension>::TestLocalMinimumCandidate() const
+{
+  LocalMinimaSearchType & search = m_MinimaSearch;
+  const auto              windowLength = static_cast<OffsetValueType>(search.Window.size());
+  const InternalDataType  value = search.Window[search.CandidateOffset % windowLength];
+
+  // Once the heap is full most samples are rejected without visiting neighbors
+  if (search.Heap.size() >= m_NumberOfLocalMinima && !(value < search.Heap.front().first))
+  {
+    return;
+  }
+
+  const SizeValueType numberOfNeighbors = m_NeighborOffsets.size();
+  for (SizeValueType neighbor = 0; neighbor < numberOfNeighbors; neighbor++)
+  {
+    const IndexValueType * displacement = &m_NeighborDisplacements[neighbor * Dimension];
+    bool                   inside = true;
+    for (unsigned int dim = 0; dim < Dimension && inside; dim++)
+    {
+      const IndexValueType position = search.CandidateIndex[dim] - m_LatticeStart[dim] + displacement[dim];
+      inside = position >= 0 && static_cast<SizeValueType>(position) < m_LatticeSize[dim];
+    }
+    if (!inside)
+    {
+      continue;
+    }
+
+    // Of equal samples only the first in lattice order is a minimum
+    const OffsetValueType  neighborOffset = m_NeighborOffsets[neighbor];
+    const InternalDataType neighborValue = search.Window[(search.CandidateOffset + neighborOffset) % windowLength];
+    if (neighborValue < value || (neighborOffset < 0 && !(value < neighborValue)))
+    {
+      return;
+    }
+  }
+
+  // Max-heap on value so that the shallowest kept minimum is replaced first
+  auto shallower = [](const std::pair<InternalDataType, OffsetValueType> & a,
+                      const std::pair<InternalDataType, OffsetValueType> & b) { return a.first < b.first; };
+  search.Heap.emplace_back(value, search.CandidateOffset);
+  std::push_heap(search.Heap.begin(), search.Heap.end(), shallower);
+  if (search.Heap.size() > m_NumberOfLocalMinima)
+  {
+    std::pop_heap(search.Heap.begin(), search.Heap.end(), shallower);
+    search.Heap.pop_back();
+  }
+}
+
+template <typename TValue, unsigned int TImageDimension>
+void
+ExhaustiveLogReducer<TValue, TImageDimension>::RescanLocalMinima() const
+{
+  ResetLocalMinimaSearch();
+  for (OffsetValueType offset = 0; offset <= m_MinimaLastOffset; offset++)
+  {
+    TrackLocalMinima(offset, m_Log->GetValueAtOffset(offset));
+  }
+  m_LocalMinimaOutdated = false;
+}
+
+template <typename TValue, unsigned int TImageDimension>
+void
+ExhaustiveLogReducer<TValue, TImageDimension>::UpdateProjections(
+  const std::vector<InternalDataType *> & projectionBuffers,
+  const std::vector<OffsetValueType *> &  argminBuffers,
+  const OffsetValueType                   offset,
+  const IndexType &                       index,
+  const InternalDataType &                value,
+  bool                                    lowestOffsetFirst) const
+{
+  unsigned int projection = 0;
+  for (unsigned int first = 0; first < Dimension; first++)
+  {
+    for (unsigned int second = first + 1; second < Dimension; second++, projection++)
+    {
+      const OffsetValueType pixel = (index[first] - m_LatticeStart[first]) +
+                                    (index[second] - m_LatticeStart[second]) *
+                                      static_cast<OffsetValueType>(m_LatticeSize[first]);
+      OffsetValueType &     argmin = argminBuffers[projection][pixel];
+      InternalDataType &    minimum = projectionBuffers[projection][pixel];
+      if (argmin < 0 || value < minimum || (lowestOffsetFirst && !(minimum < value) && offset < argmin))
+      {
+        minimum = value;
+        argmin = offset;
+      }
+    }
+  }
+}
+
+template <typename TValue, unsigned int TImageDimension>
+unsigned int
+ExhaustiveLogReducer<TValue, TImageDimension>::GetProjectionNumber(unsigned int first, unsigned int second) const
+{
+  if (first > second)
+  {
+    std::swap(first, second);
+  }
+  if (first == second || second >= Dimension || m_ProjectionImages.empty())
+  {
+    itkExceptionMacro("No projection onto parameters " << first << " and " << second);
+  }
+  // Pairs starting with a lower parameter come first
+  return first * (2 * Dimension - first - 1) / 2 + (second - first - 1);
+}
+
+template <typename TValue, unsigned int TImageDimension>
+auto
+ExhaustiveLogReducer<TValue, TImageDimension>::GetProjectionImage(unsigned int first, unsigned int second) const
+  -> ProjectionImageType *
+{
+  return m_ProjectionImages[GetProjectionNumber(first, second)];
+}
+
+template <typename TValue, unsigned int TImageDimension>
+auto
+ExhaustiveLogReducer<TValue, TImageDimension>::GetProjectionArgminImage(unsigned int first, unsigned int second) const
+  -> ProjectionArgminImageType *
+{
+  return m_ProjectionArgminImages[GetProjectionNumber(first, second)];
+}
+
+template <typename TValue, unsigned int TImageDimension>
+auto
+ExhaustiveLogReducer<TValue, TImageDimension>::GetNumberOfRecordedSamples() const -> SizeValueType
+{
+  std::lock_guard<std::mutex> lock(m_ReductionMutex);
+  return m_Accumulator.NumberOfSamples;
+}
+
+template <typename TValue, unsigned int TImageDimension>
+auto
+ExhaustiveLogReducer<TValue, TImageDimension>::GetMinimumValue() const -> InternalDataType
+{
+  std::lock_guard<std::mutex> lock(m_ReductionMutex);
+  return m_Accumulator.MinimumValue;
+}
+
+template <typename TValue, unsigned int TImageDimension>
+auto
+ExhaustiveLogReducer<TValue, TImageDimension>::GetMinimumOffset() const -> OffsetValueType
+{
+  std::lock_guard<std::mutex> lock(m_ReductionMutex);
+  return m_Accumulator.MinimumOffset;
+}
+
+template <typename TValue, unsigned int TImageDimension>
+auto
+ExhaustiveLogReducer<TValue, TImageDimension>::GetMaximumValue() const -> InternalDataType
+{
+  std::lock_guard<std::mutex> lock(m_ReductionMutex);
+  return m_Accumulator.MaximumValue;
+}
+
+template <typename TValue, unsigned int TImageDimension>
+auto
+ExhaustiveLogReducer<TValue, TImageDimension>::GetMaximumOffset() const -> OffsetValueType
+{
+  std::lock_guard<std::mutex> lock(m_ReductionMutex);
+  return m_Accumulator.MaximumOffset;
+}
+
+template <typename TValue, unsigned int TImageDimension>
+double
+ExhaustiveLogReducer<TValue, TImageDimension>::GetMean() const
+{
+  std::lock_guard<std::mutex> lock(m_ReductionMutex);
+  return m_Accumulator.Mean;
+}
+
+template <typename TValue, unsigned int TImageDimension>
+double
+ExhaustiveLogReducer<TValue, TImageDimension>::GetVariance() const
+{
+  std::lock_guard<std::mutex> lock(m_ReductionMutex);
+  return (m_Accumulator.NumberOfSamples > 0)
+           ? m_Accumulator.SumOfSquaredDeviations / static_cast<double>(m_Accumulator.NumberOfSamples)
+           : 0.0;
+}
+
+template <typename TValue, unsigned int TImageDimension>
+auto
+ExhaustiveLogReducer<TValue, TImageDimension>::GetLocalMinima() const -> LocalMinimaContainerType
+{
+  std::lock_guard<std::mutex> lock(m_ReductionMutex);
+  if (m_LocalMinimaOutdated)
+  {
+    RescanLocalMinima();
+  }
+
+  auto sorted = m_MinimaSearch.Heap;
+  std::sort(sorted.begin(), sorted.end());
+
+  LocalMinimaContainerType minima;
+  minima.reserve(sorted.size());
+  for (const auto & entry : sorted)
+  {
+    minima.push_back({ entry.first, entry.second, m_Log->ComputePosition(entry.second) });
+  }
+  return minima;
+}
+
+template <typename TValue, unsigned int TImageDimension>
+auto
+ExhaustiveLogReducer<TValue, TImageDimension>::GetHistogram() const -> HistogramType
+{
+  std::lock_guard<std::mutex> lock(m_ReductionMutex);
+  return m_Accumulator.Histogram;
+}
+} // namespace itk
+
+#endif // itkExhaustiveLogReducer_hxx
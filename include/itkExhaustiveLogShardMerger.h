@@ -0,0 +1,129 @@
+/*=========================================================================
+ *
+ *  Copyright NumFOCUS
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *         https://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *=========================================================================*/
+#ifndef itkExhaustiveLogShardMerger_h
+#define itkExhaustiveLogShardMerger_h
+
+#include "itkMacro.h"
+#include "itkImageSource.h"
+#include "itkImage.h"
+#include "itkExhaustiveLogStreamImageSource.h"
+
+#include <string>
+#include <vector>
+
+namespace itk
+{
+/**
+ *\class ExhaustiveLogShardMerger
+ *  \brief Combines the stream files of the shards of one sweep into an image of the whole lattice.
+ *
+ * A sweep may be split across processes or nodes by giving each a CommandExhaustiveLog
+ * restricted to one shard of the lattice (see CommandExhaustiveLog::SetShardRegion)
+ * that streams its samples to a file (see CommandExhaustiveLog::SetStreamFileName).
+ * Splitting the lattice region with ImageRegionSplitterSlowDimension, for example,
+ * yields shards that tile it. This source reads those files into one image.
+ *
+ * All headers are read and checked before any sample is: the files must describe the
+ * same lattice, and their shards must cover it without overlapping. Samples are then
+ * read one file at a time, in small batches, directly into the output buffer, so
+ * that memory holds the output image once however many shards there are. Every
+ * sample of every shard must have been recorded. Any violation throws an exception
+ * naming the offending files.
+ *
+ * The ExhaustiveLogMergeShards example program wraps this source for use from the
+ * command line.
+ *
+ * Template parameters for class ExhaustiveLogShardMerger:
+ *
+ * - TValue = Element type stored at each location in the data image.
+ * - TImageDimension = Dimension of image equal to number of transform parameters
+ *
+ * \ingroup ITKOptimizationMonitor
+ */
+template <typename TValue, unsigned int TImageDimension>
+class ExhaustiveLogShardMerger : public ImageSource<Image<TValue, TImageDimension>>
+{
+public:
+  ITK_DISALLOW_COPY_AND_MOVE(ExhaustiveLogShardMerger);
+
+  using OutputImageType = Image<TValue, TImageDimension>;
+
+  using Self = ExhaustiveLogShardMerger;
+  using Superclass = ImageSource<OutputImageType>;
+  using Pointer = SmartPointer<Self>;
+  using ConstPointer = SmartPointer<const Self>;
+  itkNewMacro(Self);
+  itkOverrideGetNameOfClassMacro(ExhaustiveLogShardMerger);
+
+  /** Image dimension */
+  static constexpr unsigned int Dimension = TImageDimension;
+
+  using SizeType = typename OutputImageType::SizeType;
+  using SizeValueType = typename OutputImageType::SizeValueType;
+  using RegionType = typename OutputImageType::RegionType;
+  using SpacingType = typename OutputImageType::SpacingType;
+  using PointType = typename OutputImageType::PointType;
+  using OffsetValueType = typename OutputImageType::OffsetValueType;
+
+  using StreamSourceType = ExhaustiveLogStreamImageSource<TValue, TImageDimension>;
+
+  /** Add the stream file of one shard. */
+  void
+  AddFileName(const std::string & fileName);
+
+  /** Stream files of all shards. */
+  void
+  SetFileNames(const std::vector<std::string> & fileNames);
+  const std::vector<std::string> &
+  GetFileNames() const
+  {
+    return m_FileNames;
+  }
+
+  /** Number of complete records read by the last update, over all files. */
+  itkGetConstMacro(NumberOfRecords, SizeValueType);
+
+protected:
+  ExhaustiveLogShardMerger() = default;
+  ~ExhaustiveLogShardMerger() override = default;
+
+  void
+  PrintSelf(std::ostream & os, Indent indent) const override;
+
+  /** Read and check the headers of all files. */
+  void
+  GenerateOutputInformation() override;
+
+  /** The whole image is always produced. */
+  void
+  EnlargeOutputRequestedRegion(DataObject * output) override;
+
+  void
+  GenerateData() override;
+
+private:
+  std::vector<std::string> m_FileNames;
+  SizeValueType            m_NumberOfRecords{ 0 };
+};
+} // namespace itk
+
+#ifndef ITK_MANUAL_INSTANTIATION
+#  include "itkExhaustiveLogShardMerger.hxx"
+#endif
+
+#endif // itkExhaustiveLogShardMerger_h
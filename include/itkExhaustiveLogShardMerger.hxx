@@ -0,0 +1,205 @@
+/*=========================================================================
+ *
+ *  Copyright NumFOCUS
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *         https://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *=========================================================================*/
+
+#ifndef itkExhaustiveLogShardMerger_hxx
+#define itkExhaustiveLogShardMerger_hxx
+
+#include "itkExhaustiveLogShardMerger.h"
+#include "itkMath.h"
+
+#include <fstream>
+
+namespace itk
+{
+template <typename TValue, unsigned int TImageDimension>
+void
+ExhaustiveLogShardMerger<TValue, TImageDimension>::AddFileName(const std::string & fileName)
+{
+  m_FileNames.push_back(fileName);
+  this->Modified();
+}
+
+template <typename TValue, unsigned int TImageDimension>
+void
+ExhaustiveLogShardMerger<TValue, TImageDimension>::SetFileNames(const std::vector<std::string> & fileNames)
+{
+  m_FileNames = fileNames;
+  this->Modified();
+}
+
+template <typename TValue, unsigned int TImageDimension>
+void
+ExhaustiveLogShardMerger<TValue, TImageDimension>::GenerateOutputInformation()
+{
+  if (m_FileNames.empty())
+  {
+    itkExceptionMacro("No shard files to merge");
+  }
+
+  SizeType                latticeSize;
+  SpacingType             spacing;
+  PointType               origin;
+  std::vector<RegionType> shardRegions;
+  for (const auto & fileName : m_FileNames)
+  {
+    std::ifstream stream(fileName, std::ios::in | std::ios::binary);
+    if (!stream)
+    {
+      itkExceptionMacro("Cannot open exhaustive log stream " << fileName);
+    }
+
+    RegionType  shardRegion;
+    SizeType    shardLatticeSize;
+    SpacingType shardSpacing;
+    PointType   shardOrigin;
+    StreamSourceType::ReadHeader(stream, shardRegion, shardLatticeSize, shardSpacing, shardOrigin);
+
+    if (shardRegions.empty())
+    {
+      latticeSize = shardLatticeSize;
+      spacing = shardSpacing;
+      origin = shardOrigin;
+    }
+    for (unsigned int dim = 0; dim < Dimension; dim++)
+    {
+      if (shardLatticeSize[dim] != latticeSize[dim] || !Math::FloatAlmostEqual(shardSpacing[dim], spacing[dim]) ||
+          !Math::FloatAlmostEqual(shardOrigin[dim], origin[dim]))
+      {
+        itkExceptionMacro("Shard " << fileName << " was logged on a different lattice than " << m_FileNames[0]);
+      }
+    }
+
+    // Shards are disjoint unless two of them crop each other
+    for (SizeValueType other = 0; other < shardRegions.size(); other++)
+    {
+      RegionType overlap = shardRegion;
+      if (overlap.Crop(shardRegions[other]))
+      {
+        itkExceptionMacro("Shards " << m_FileNames[other] << " and " << fileName << " overlap in " << overlap);
+      }
+    }
+    shardRegions.push_back(shardRegion);
+  }
+
+  // Disjoint shards inside the lattice cover it if their sizes add up
+  const RegionType latticeRegion(latticeSize);
+  SizeValueType    numberOfShardSamples = 0;
+  for (const auto & shardRegion : shardRegions)
+  {
+    numberOfShardSamples += shardRegion.GetNumberOfPixels();
+  }
+  if (numberOfShardSamples != latticeRegion.GetNumberOfPixels())
+  {
+    itkExceptionMacro("Shards cover " << numberOfShardSamples << " of the " << latticeRegion.GetNumberOfPixels()
+                                      << " lattice samples");
+  }
+
+  OutputImageType * output = this->GetOutput();
+  output->SetLargestPossibleRegion(latticeRegion);
+  output->SetSpacing(spacing);
+  output->SetOrigin(origin);
+}
+
+template <typename TValue, unsigned int TImageDimension>
+void
+ExhaustiveLogShardMerger<TValue, TImageDimension>::EnlargeOutputRequestedRegion(DataObject * output)
+{
+  output->SetRequestedRegionToLargestPossibleRegion();
+}
+
+template <typename TValue, unsigned int TImageDimension>
+void
+ExhaustiveLogShardMerger<TValue, TImageDimension>::GenerateData()
+{
+  OutputImageType * output = this->GetOutput();
+  output->SetBufferedRegion(output->GetLargestPossibleRegion());
+  output->Allocate();
+
+  TValue *                buffer = output->GetBufferPointer();
+  const OffsetValueType * offsetTable = output->GetOffsetTable();
+
+  m_NumberOfRecords = 0;
+  for (SizeValueType shard = 0; shard < m_FileNames.size(); shard++)
+  {
+    std::ifstream stream(m_FileNames[shard], std::ios::in | std::ios::binary);
+    if (!stream)
+    {
+      itkExceptionMacro("Cannot read exhaustive log stream " << m_FileNames[shard]);
+    }
+    RegionType  region;
+    SizeType    latticeSize;
+    SpacingType spacing;
+    PointType   origin;
+    StreamSourceType::ReadHeader(stream, region, latticeSize, spacing, origin);
+
+    const SizeType      size = region.GetSize();
+    const SizeValueType numberOfSamples = region.GetNumberOfPixels();
+    OffsetValueType     shardStart = 0;
+    std::vector<bool>   recorded(numberOfSamples, false);
+    SizeValueType       numberRecorded = 0;
+    for (unsigned int dim = 0; dim < Dimension; dim++)
+    {
+      shardStart += region.GetIndex(dim) * offsetTable[dim];
+    }
+
+    // Offsets count samples of the shard, so each is placed through its index
+    m_NumberOfRecords += StreamSourceType::ReadRecords(stream, [&](OffsetValueType offset, const TValue & value) {
+      if (offset < 0 || static_cast<SizeValueType>(offset) >= numberOfSamples)
+      {
+        return;
+      }
+      OffsetValueType outputOffset = shardStart;
+      auto            remainder = static_cast<SizeValueType>(offset);
+      for (unsigned int dim = 0; dim < Dimension; dim++)
+      {
+        outputOffset += static_cast<OffsetValueType>(remainder % size[dim]) * offsetTable[dim];
+        remainder /= size[dim];
+      }
+      buffer[outputOffset] = value;
+      if (!recorded[offset])
+      {
+        recorded[offset] = true;
+        ++numberRecorded;
+      }
+    });
+
+    if (numberRecorded != numberOfSamples)
+    {
+      itkExceptionMacro("Shard " << m_FileNames[shard] << " is missing " << numberOfSamples - numberRecorded
+                                 << " of its " << numberOfSamples << " samples");
+    }
+  }
+}
+
+template <typename TValue, unsigned int TImageDimension>
+void
+ExhaustiveLogShardMerger<TValue, TImageDimension>::PrintSelf(std::ostream & os, Indent indent) const
+{
+  Superclass::PrintSelf(os, indent);
+
+  os << indent << "NumberOfFileNames: " << m_FileNames.size() << std::endl;
+  for (const auto & fileName : m_FileNames)
+  {
+    os << indent.GetNextIndent() << fileName << std::endl;
+  }
+  os << indent << "NumberOfRecords: " << m_NumberOfRecords << std::endl;
+}
+
+} // namespace itk
+
+#endif // itkExhaustiveLogShardMerger_hxx
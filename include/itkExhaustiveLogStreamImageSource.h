@@ -0,0 +1,182 @@
+/*=========================================================================
+ *
+ *  Copyright NumFOCUS
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *         https://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *=========================================================================*/
+#ifndef itkExhaustiveLogStreamImageSource_h
+#define itkExhaustiveLogStreamImageSource_h
+
+#include "itkMacro.h"
+#include "itkImageSource.h"
+#include "itkImage.h"
+
+#include <cstdint>
+#include <iostream>
+#include <string>
+
+namespace itk
+{
+/**
+ *\class ExhaustiveLogStreamImageSource
+ *  \brief Reads an exhaustive log stream file written by CommandExhaustiveLog into an image.
+ *
+ * CommandExhaustiveLog can append every sample to a stream file as it is recorded
+ * (see CommandExhaustiveLog::SetStreamFileName) so that a long sweep survives a crash.
+ * The file starts with a header describing the lattice geometry and the region of it
+ * that was logged, followed by fixed-size records of (linear offset into the region,
+ * value) in arrival order. Samples missing from the stream are set to FillValue;
+ * samples recorded more than once keep their last value. The output image covers
+ * the logged region, which for a shard of the lattice starts at the shard index.
+ *
+ * Connecting this source to an ImageFileWriter converts a stream to any ITK image
+ * format while holding the image only once, since records are read in small batches
+ * directly into the output buffer.
+ *
+ * Stream files are written in native byte order. The static methods give access to
+ * the file layout for other readers and writers of the format.
+ *
+ * Template parameters for class ExhaustiveLogStreamImageSource:
+ *
+ * - TValue = Element type stored at each location in the data image.
+ * - TImageDimension = Dimension of image equal to number of transform parameters
+ *
+ * \ingroup ITKOptimizationMonitor
+ */
+template <typename TValue, unsigned int TImageDimension>
+class ExhaustiveLogStreamImageSource : public ImageSource<Image<TValue, TImageDimension>>
+{
+public:
+  ITK_DISALLOW_COPY_AND_MOVE(ExhaustiveLogStreamImageSource);
+
+  using OutputImageType = Image<TValue, TImageDimension>;
+
+  using Self = ExhaustiveLogStreamImageSource;
+  using Superclass = ImageSource<OutputImageType>;
+  using Pointer = SmartPointer<Self>;
+  using ConstPointer = SmartPointer<const Self>;
+  itkNewMacro(Self);
+  itkOverrideGetNameOfClassMacro(ExhaustiveLogStreamImageSource);
+
+  /** Image dimension */
+  static constexpr unsigned int Dimension = TImageDimension;
+
+  using SizeType = typename OutputImageType::SizeType;
+  using SizeValueType = typename OutputImageType::SizeValueType;
+  using RegionType = typename OutputImageType::RegionType;
+  using SpacingType = typename OutputImageType::SpacingType;
+  using PointType = typename OutputImageType::PointType;
+  using OffsetValueType = typename OutputImageType::OffsetValueType;
+
+  /** Size in bytes of one (offset, value) record. */
+  static constexpr std::streamoff RecordSize = sizeof(std::uint64_t) + sizeof(TValue);
+
+  /** Stream file to read. */
+  itkSetStringMacro(FileName);
+  itkGetStringMacro(FileName);
+
+  /** Value of samples absent from the stream. Defaults to zero. */
+  itkSetMacro(FillValue, TValue);
+  itkGetConstMacro(FillValue, TValue);
+
+  /** Number of complete records read by the last update. */
+  itkGetConstMacro(NumberOfRecords, SizeValueType);
+
+  /** Write the stream header for a region of a lattice with the given geometry,
+   *  the origin being that of the whole lattice. */
+  static void
+  WriteHeader(std::ostream &      stream,
+              const RegionType &  region,
+              const SizeType &    latticeSize,
+              const SpacingType & spacing,
+              const PointType &   origin);
+
+  /** Read and validate the stream header, leaving the stream at the first record.
+   *  Throws if the file was written for a different dimension or value type. Streams
+   *  of the first version of the format cover their whole lattice. */
+  static void
+  ReadHeader(std::istream &  stream,
+             RegionType &    region,
+             SizeType &      latticeSize,
+             SpacingType &   spacing,
+             PointType &     origin);
+
+  /** Read the dimension and value type a stream was written for, leaving the stream
+   *  past them. Does not depend on the template arguments, so that readers may use it
+   *  to choose them. */
+  static void
+  ReadSampleDescription(std::istream & stream, unsigned int & dimension, unsigned int & valueSize, bool & isInteger);
+
+  /** Size in bytes of the stream header written by WriteHeader(). */
+  static std::streamoff
+  GetHeaderSize();
+
+  /** Append one record. */
+  static void
+  WriteRecord(std::ostream & stream, OffsetValueType offset, const TValue & value);
+
+  /** Read records from the current position to the end of the stream in batches,
+   *  calling function(offset, value) for each complete record. An incomplete trailing
+   *  record, as left by an interrupted write, is ignored. Returns the number of
+   *  complete records read. */
+  template <typename TFunction>
+  static SizeValueType
+  ReadRecords(std::istream & stream, TFunction && function);
+
+protected:
+  ExhaustiveLogStreamImageSource();
+  ~ExhaustiveLogStreamImageSource() override = default;
+
+  void
+  PrintSelf(std::ostream & os, Indent indent) const override;
+
+  void
+  GenerateOutputInformation() override;
+
+  /** The whole image is always produced. */
+  void
+  EnlargeOutputRequestedRegion(DataObject * output) override;
+
+  void
+  GenerateData() override;
+
+private:
+  /** Identifies exhaustive log stream files. Version 2 adds the logged region. */
+  static constexpr std::streamoff MagicSize = 8;
+  static const char *
+  GetMagic()
+  {
+    return "ITKEXLG2";
+  }
+  static const char *
+  GetVersion1Magic()
+  {
+    return "ITKEXLG1";
+  }
+
+  /** Read the magic and sample description, returning the format version. */
+  static unsigned int
+  ReadPreamble(std::istream & stream, unsigned int & dimension, unsigned int & valueSize, bool & isInteger);
+
+  std::string   m_FileName;
+  TValue        m_FillValue;
+  SizeValueType m_NumberOfRecords{ 0 };
+};
+} // namespace itk
+
+#ifndef ITK_MANUAL_INSTANTIATION
+#  include "itkExhaustiveLogStreamImageSource.hxx"
+#endif
+
+#endif // itkExhaustiveLogStreamImageSource_h
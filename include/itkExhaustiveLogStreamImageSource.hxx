@@ -0,0 +1,294 @@
+/*=========================================================================
+ *
+ *  Copyright NumFOCUS
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *         https://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *=========================================================================*/
+
+#ifndef itkExhaustiveLogStreamImageSource_hxx
+#define itkExhaustiveLogStreamImageSource_hxx
+
+#include "itkExhaustiveLogStreamImageSource.h"
+#include "itkNumericTraits.h"
+
+#include <cstring>
+#include <fstream>
+#include <limits>
+#include <vector>
+
+namespace itk
+{
+template <typename TValue, unsigned int TImageDimension>
+ExhaustiveLogStreamImageSource<TValue, TImageDimension>::ExhaustiveLogStreamImageSource()
+{
+  m_FillValue = NumericTraits<TValue>::ZeroValue();
+}
+
+template <typename TValue, unsigned int TImageDimension>
+void
+ExhaustiveLogStreamImageSource<TValue, TImageDimension>::WriteHeader(std::ostream &      stream,
+                                                                     const RegionType &  region,
+                                                                     const SizeType &    latticeSize,
+                                                                     const SpacingType & spacing,
+                                                                     const PointType &   origin)
+{
+  const std::uint32_t dimension = Dimension;
+  const std::uint32_t valueSize = sizeof(TValue);
+  const std::uint32_t isInteger = std::numeric_limits<TValue>::is_integer ? 1 : 0;
+
+  stream.write(GetMagic(), MagicSize);
+  stream.write(reinterpret_cast<const char *>(&dimension), sizeof(dimension));
+  stream.write(reinterpret_cast<const char *>(&valueSize), sizeof(valueSize));
+  stream.write(reinterpret_cast<const char *>(&isInteger), sizeof(isInteger));
+  for (unsigned int dim = 0; dim < Dimension; dim++)
+  {
+    const std::uint64_t length = latticeSize[dim];
+    const double        step = spacing[dim];
+    const double        start = origin[dim];
+    stream.write(reinterpret_cast<const char *>(&length), sizeof(length));
+    stream.write(reinterpret_cast<const char *>(&step), sizeof(step));
+    stream.write(reinterpret_cast<const char *>(&start), sizeof(start));
+  }
+
+  // Version 2: the logged region follows the version 1 lattice description
+  for (unsigned int dim = 0; dim < Dimension; dim++)
+  {
+    const std::int64_t  regionStart = region.GetIndex(dim);
+    const std::uint64_t regionLength = region.GetSize(dim);
+    stream.write(reinterpret_cast<const char *>(&regionStart), sizeof(regionStart));
+    stream.write(reinterpret_cast<const char *>(&regionLength), sizeof(regionLength));
+  }
+}
+
+template <typename TValue, unsigned int TImageDimension>
+unsigned int
+ExhaustiveLogStreamImageSource<TValue, TImageDimension>::ReadPreamble(std::istream & stream,
+                                                                      unsigned int & dimension,
+                                                                      unsigned int & valueSize,
+                                                                      bool &         isInteger)
+{
+  char          magic[MagicSize];
+  std::uint32_t fields[3] = {};
+
+  stream.read(magic, sizeof(magic));
+  stream.read(reinterpret_cast<char *>(fields), sizeof(fields));
+  unsigned int version = 0;
+  if (stream && std::memcmp(magic, GetMagic(), MagicSize) == 0)
+  {
+    version = 2;
+  }
+  else if (stream && std::memcmp(magic, GetVersion1Magic(), MagicSize) == 0)
+  {
+    version = 1;
+  }
+  else
+  {
+    itkGenericExceptionMacro("Not an exhaustive log stream");
+  }
+
+  dimension = fields[0];
+  valueSize = fields[1];
+  isInteger = fields[2] != 0;
+  return version;
+}
+
+template <typename TValue, unsigned int TImageDimension>
+void
+ExhaustiveLogStreamImageSource<TValue, TImageDimension>::ReadSampleDescription(std::istream & stream,
+                                                                               unsigned int & dimension,
+                                                                               unsigned int & valueSize,
+                                                                               bool &         isInteger)
+{
+  ReadPreamble(stream, dimension, valueSize, isInteger);
+}
+
+template <typename TValue, unsigned int TImageDimension>
+void
+ExhaustiveLogStreamImageSource<TValue, TImageDimension>::ReadHeader(std::istream & stream,
+                                                                    RegionType &   region,
+                                                                    SizeType &     latticeSize,
+                                                                    SpacingType &  spacing,
+                                                                    PointType &    origin)
+{
+  unsigned int       dimension = 0;
+  unsigned int       valueSize = 0;
+  bool               isInteger = false;
+  const unsigned int version = ReadPreamble(stream, dimension, valueSize, isInteger);
+  if (dimension != Dimension || valueSize != sizeof(TValue) || isInteger != std::numeric_limits<TValue>::is_integer)
+  {
+    itkGenericExceptionMacro("Exhaustive log stream holds " << dimension << "-D samples of " << valueSize
+                                                            << " bytes but " << Dimension << "-D samples of "
+                                                            << sizeof(TValue) << " bytes were expected");
+  }
+
+  for (unsigned int dim = 0; dim < Dimension; dim++)
+  {
+    std::uint64_t length = 0;
+    double        step = 0.0;
+    double        start = 0.0;
+    stream.read(reinterpret_cast<char *>(&length), sizeof(length));
+    stream.read(reinterpret_cast<char *>(&step), sizeof(step));
+    stream.read(reinterpret_cast<char *>(&start), sizeof(start));
+    latticeSize[dim] = static_cast<SizeValueType>(length);
+    spacing[dim] = step;
+    origin[dim] = start;
+  }
+
+  region = RegionType(latticeSize);
+  if (version >= 2)
+  {
+    for (unsigned int dim = 0; dim < Dimension; dim++)
+    {
+      std::int64_t  regionStart = 0;
+      std::uint64_t regionLength = 0;
+      stream.read(reinterpret_cast<char *>(&regionStart), sizeof(regionStart));
+      stream.read(reinterpret_cast<char *>(&regionLength), sizeof(regionLength));
+      region.SetIndex(dim, static_cast<typename RegionType::IndexValueType>(regionStart));
+      region.SetSize(dim, static_cast<SizeValueType>(regionLength));
+    }
+  }
+  if (!stream)
+  {
+    itkGenericExceptionMacro("Exhaustive log stream header is truncated");
+  }
+  if (!RegionType(latticeSize).IsInside(region))
+  {
+    itkGenericExceptionMacro("Exhaustive log stream region " << region << " is not inside its lattice of size "
+                                                             << latticeSize);
+  }
+}
+
+template <typename TValue, unsigned int TImageDimension>
+std::streamoff
+ExhaustiveLogStreamImageSource<TValue, TImageDimension>::GetHeaderSize()
+{
+  return MagicSize + 3 * sizeof(std::uint32_t) +
+         Dimension * (2 * sizeof(std::uint64_t) + sizeof(std::int64_t) + 2 * sizeof(double));
+}
+
+template <typename TValue, unsigned int TImageDimension>
+void
+ExhaustiveLogStreamImageSource<TValue, TImageDimension>::WriteRecord(std::ostream &        stream,
+                                                                     const OffsetValueType offset,
+                                                                     const TValue &        value)
+{
+  char                record[RecordSize];
+  const std::uint64_t position = offset;
+  std::memcpy(record, &position, sizeof(position));
+  std::memcpy(record + sizeof(position), &value, sizeof(TValue));
+  stream.write(record, RecordSize);
+}
+
+template <typename TValue, unsigned int TImageDimension>
+template <typename TFunction>
+auto
+ExhaustiveLogStreamImageSource<TValue, TImageDimension>::ReadRecords(std::istream & stream, TFunction && function)
+  -> SizeValueType
+{
+  constexpr SizeValueType recordsPerBatch = 65536;
+  std::vector<char>       batch(recordsPerBatch * RecordSize);
+
+  SizeValueType numberOfRecords = 0;
+  while (stream)
+  {
+    stream.read(batch.data(), static_cast<std::streamsize>(batch.size()));
+    const auto numberInBatch = static_cast<SizeValueType>(stream.gcount() / RecordSize);
+    for (SizeValueType record = 0; record < numberInBatch; record++)
+    {
+      const char *  data = batch.data() + record * RecordSize;
+      std::uint64_t offset;
+      TValue        value;
+      std::memcpy(&offset, data, sizeof(offset));
+      std::memcpy(&value, data + sizeof(offset), sizeof(TValue));
+      function(static_cast<OffsetValueType>(offset), value);
+    }
+    numberOfRecords += numberInBatch;
+  }
+  return numberOfRecords;
+}
+
+template <typename TValue, unsigned int TImageDimension>
+void
+ExhaustiveLogStreamImageSource<TValue, TImageDimension>::GenerateOutputInformation()
+{
+  std::ifstream stream(m_FileName, std::ios::in | std::ios::binary);
+  if (!stream)
+  {
+    itkExceptionMacro("Cannot open exhaustive log stream " << m_FileName);
+  }
+
+  RegionType  region;
+  SizeType    latticeSize;
+  SpacingType spacing;
+  PointType   origin;
+  ReadHeader(stream, region, latticeSize, spacing, origin);
+
+  OutputImageType * output = this->GetOutput();
+  output->SetLargestPossibleRegion(region);
+  output->SetSpacing(spacing);
+  output->SetOrigin(origin);
+}
+
+template <typename TValue, unsigned int TImageDimension>
+void
+ExhaustiveLogStreamImageSource<TValue, TImageDimension>::EnlargeOutputRequestedRegion(DataObject * output)
+{
+  output->SetRequestedRegionToLargestPossibleRegion();
+}
+
+template <typename TValue, unsigned int TImageDimension>
+void
+ExhaustiveLogStreamImageSource<TValue, TImageDimension>::GenerateData()
+{
+  OutputImageType * output = this->GetOutput();
+  output->SetBufferedRegion(output->GetLargestPossibleRegion());
+  output->Allocate();
+  output->FillBuffer(m_FillValue);
+
+  std::ifstream stream(m_FileName, std::ios::in | std::ios::binary);
+  if (!stream)
+  {
+    itkExceptionMacro("Cannot read exhaustive log stream " << m_FileName);
+  }
+  RegionType  region;
+  SizeType    latticeSize;
+  SpacingType spacing;
+  PointType   origin;
+  ReadHeader(stream, region, latticeSize, spacing, origin);
+
+  TValue * buffer = output->GetBufferPointer();
+  const auto numberOfSamples = static_cast<OffsetValueType>(output->GetLargestPossibleRegion().GetNumberOfPixels());
+  m_NumberOfRecords = ReadRecords(stream, [buffer, numberOfSamples](OffsetValueType offset, const TValue & value) {
+    // Corrupt records may hold any offset, including ones beyond the signed range
+    if (offset >= 0 && offset < numberOfSamples)
+    {
+      buffer[offset] = value;
+    }
+  });
+}
+
+template <typename TValue, unsigned int TImageDimension>
+void
+ExhaustiveLogStreamImageSource<TValue, TImageDimension>::PrintSelf(std::ostream & os, Indent indent) const
+{
+  Superclass::PrintSelf(os, indent);
+
+  os << indent << "FileName: " << m_FileName << std::endl;
+  os << indent << "FillValue: " << static_cast<typename NumericTraits<TValue>::PrintType>(m_FillValue) << std::endl;
+  os << indent << "NumberOfRecords: " << m_NumberOfRecords << std::endl;
+}
+
+} // namespace itk
+
+#endif // itkExhaustiveLogStreamImageSource_hxx
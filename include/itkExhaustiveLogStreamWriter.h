@@ -0,0 +1,121 @@
+/*=========================================================================
+ *
+ *  Copyright NumFOCUS
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *         https://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *=========================================================================*/
+#ifndef itkExhaustiveLogStreamWriter_h
+#define itkExhaustiveLogStreamWriter_h
+
+#include "itkExhaustiveLogCollaborator.h"
+#include "itkExhaustiveLogStreamImageSource.h"
+
+#include <fstream>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace itk
+{
+/**
+ *\class ExhaustiveLogStreamWriter
+ *  \brief Appends the samples recorded by a CommandExhaustiveLog to its stream file.
+ *
+ * Collaborator of CommandExhaustiveLog writing the stream file named by
+ * CommandExhaustiveLog::SetStreamFileName in the format read by
+ * ExhaustiveLogStreamImageSource: a header describing the lattice, then one
+ * record per sample in arrival order, flushed every StreamFlushInterval records.
+ *
+ * Template parameters for class ExhaustiveLogStreamWriter:
+ *
+ * - TValue = Element type stored at each location in the data image.
+ * - TImageDimension = Dimension of image equal to number of transform parameters
+ *
+ * \ingroup ITKOptimizationMonitor
+ */
+template <typename TValue, unsigned int TImageDimension>
+class ExhaustiveLogStreamWriter : public ExhaustiveLogCollaborator<TValue, TImageDimension>
+{
+public:
+  ITK_DISALLOW_COPY_AND_MOVE(ExhaustiveLogStreamWriter);
+
+  using Self = ExhaustiveLogStreamWriter;
+  using Superclass = ExhaustiveLogCollaborator<TValue, TImageDimension>;
+  using Pointer = SmartPointer<Self>;
+  using ConstPointer = SmartPointer<const Self>;
+  itkNewMacro(Self);
+  itkOverrideGetNameOfClassMacro(ExhaustiveLogStreamWriter);
+
+  using typename Superclass::LogType;
+  using typename Superclass::InternalDataType;
+  using typename Superclass::IndexType;
+  using typename Superclass::SizeValueType;
+  using typename Superclass::OffsetValueType;
+
+  using StreamSourceType = ExhaustiveLogStreamImageSource<TValue, TImageDimension>;
+
+  /** Recreate the stream file of the log with a header for its lattice. Returns
+   *  false, leaving the file closed, when the log has no stream file. */
+  bool
+  Initialize(LogType * log) override;
+
+  /** Open the stream file of the log for appending at the given byte position,
+   *  overwriting anything after it. */
+  void
+  Resume(LogType * log, std::streamoff appendPosition);
+
+  /** Open the stream file of the log for appending after its last complete record.
+   *  Throws if the file was written for another lattice than that of the log. */
+  void
+  Reopen(LogType * log);
+
+  /** Append one record. */
+  void
+  AddSample(OffsetValueType offset, const IndexType * index, const InternalDataType & value) override;
+
+  /** Write buffered records to the file. */
+  void
+  Flush() override;
+
+  /** Flush and close the file. */
+  void
+  Close();
+
+  /** Whether a stream file is open. */
+  bool
+  IsOpen() const;
+
+protected:
+  ExhaustiveLogStreamWriter() = default;
+  ~ExhaustiveLogStreamWriter() override = default;
+
+private:
+  /** Open the stream file of the log with the given mode, throwing on failure. */
+  void
+  Open(const LogType * log, std::ios::openmode mode);
+
+  std::string        m_FileName;
+  SizeValueType      m_FlushInterval{ 4096 };
+  std::fstream       m_Stream;
+  std::vector<char>  m_StreamBuffer;
+  SizeValueType      m_RecordsSinceFlush{ 0 };
+  mutable std::mutex m_StreamMutex;
+};
+} // namespace itk
+
+#ifndef ITK_MANUAL_INSTANTIATION
+#  include "itkExhaustiveLogStreamWriter.hxx"
+#endif
+
+#endif // itkExhaustiveLogStreamWriter_h
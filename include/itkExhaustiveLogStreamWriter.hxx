@@ -0,0 +1,177 @@
+/*=========================================================================
+ *
+ *  Copyright NumFOCUS
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *         https://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *=========================================================================*/
+
+#ifndef itkExhaustiveLogStreamWriter_hxx
+#define itkExhaustiveLogStreamWriter_hxx
+
+#include "itkExhaustiveLogStreamWriter.h"
+#include "itkCommandExhaustiveLog.h"
+
+#include <cmath>
+
+namespace itk
+{
+template <typename TValue, unsigned int TImageDimension>
+bool
+ExhaustiveLogStreamWriter<TValue, TImageDimension>::Initialize(LogType * log)
+{
+  Close();
+
+  const char * fileName = log->GetStreamFileName();
+  if (fileName == nullptr || *fileName == '\0')
+  {
+    return false;
+  }
+
+  Open(log, std::ios::out | std::ios::binary | std::ios::trunc);
+  StreamSourceType::WriteHeader(
+    m_Stream, log->GetRegion(), log->GetLatticeSize(), log->GetStepSize(), log->GetOrigin());
+  m_Stream.flush();
+  return true;
+}
+
+template <typename TValue, unsigned int TImageDimension>
+void
+ExhaustiveLogStreamWriter<TValue, TImageDimension>::Resume(LogType * log, std::streamoff appendPosition)
+{
+  Close();
+
+  // Records are written over any incomplete record left by an interrupted write
+  Open(log, std::ios::in | std::ios::out | std::ios::binary);
+  m_Stream.seekp(appendPosition);
+  if (!m_Stream)
+  {
+    m_Stream.close();
+    itkExceptionMacro("Cannot append to exhaustive log stream " << m_FileName);
+  }
+}
+
+template <typename TValue, unsigned int TImageDimension>
+void
+ExhaustiveLogStreamWriter<TValue, TImageDimension>::Reopen(LogType * log)
+{
+  Close();
+
+  const std::string fileName = log->GetStreamFileName();
+  std::ifstream     input(fileName, std::ios::in | std::ios::binary);
+  if (!input)
+  {
+    itkExceptionMacro("Cannot open exhaustive log stream " << fileName);
+  }
+
+  typename StreamSourceType::RegionType  region;
+  typename StreamSourceType::SizeType    latticeSize;
+  typename StreamSourceType::SpacingType spacing;
+  typename StreamSourceType::PointType   origin;
+  StreamSourceType::ReadHeader(input, region, latticeSize, spacing, origin);
+  const std::streamoff headerSize = input.tellg();
+  input.seekg(0, std::ios::end);
+  const std::streamoff numberOfRecords = (static_cast<std::streamoff>(input.tellg()) - headerSize) /
+                                         StreamSourceType::RecordSize;
+  input.close();
+
+  // The origin of a log initialized about the center of a resumed stream may differ
+  // from that of the stream by rounding
+  const auto logSpacing = log->GetStepSize();
+  const auto logOrigin = log->GetOrigin();
+  bool       sameLattice = region == log->GetRegion() && latticeSize == log->GetLatticeSize();
+  for (unsigned int dim = 0; dim < TImageDimension && sameLattice; dim++)
+  {
+    const double tolerance = 1e-9 * std::abs(spacing[dim]);
+    sameLattice = std::abs(spacing[dim] - logSpacing[dim]) <= tolerance &&
+                  std::abs(origin[dim] - logOrigin[dim]) <= tolerance;
+  }
+  if (!sameLattice)
+  {
+    itkExceptionMacro("Exhaustive log stream " << fileName << " was written for a lattice of size " << latticeSize
+                                               << " at " << origin << " spaced by " << spacing
+                                               << ", not the one being initialized");
+  }
+
+  Resume(log, headerSize + numberOfRecords * StreamSourceType::RecordSize);
+}
+
+template <typename TValue, unsigned int TImageDimension>
+void
+ExhaustiveLogStreamWriter<TValue, TImageDimension>::Open(const LogType * log, std::ios::openmode mode)
+{
+  std::lock_guard<std::mutex> lock(m_StreamMutex);
+  m_FileName = log->GetStreamFileName();
+  m_FlushInterval = log->GetStreamFlushInterval();
+
+  // Larger buffer than the default so that records reach the file in big writes
+  m_StreamBuffer.resize(1 << 20);
+  m_Stream.rdbuf()->pubsetbuf(m_StreamBuffer.data(), static_cast<std::streamsize>(m_StreamBuffer.size()));
+
+  m_Stream.open(m_FileName, mode);
+  if (!m_Stream)
+  {
+    m_Stream.close();
+    itkExceptionMacro("Cannot write exhaustive log stream " << m_FileName);
+  }
+  m_RecordsSinceFlush = 0;
+}
+
+template <typename TValue, unsigned int TImageDimension>
+void
+ExhaustiveLogStreamWriter<TValue, TImageDimension>::AddSample(OffsetValueType offset,
+                                                              const IndexType *,
+                                                              const InternalDataType & value)
+{
+  std::lock_guard<std::mutex> lock(m_StreamMutex);
+  StreamSourceType::WriteRecord(m_Stream, offset, value);
+  if (++m_RecordsSinceFlush >= m_FlushInterval)
+  {
+    m_Stream.flush();
+    m_RecordsSinceFlush = 0;
+  }
+}
+
+template <typename TValue, unsigned int TImageDimension>
+void
+ExhaustiveLogStreamWriter<TValue, TImageDimension>::Flush()
+{
+  std::lock_guard<std::mutex> lock(m_StreamMutex);
+  if (m_Stream.is_open())
+  {
+    m_Stream.flush();
+    m_RecordsSinceFlush = 0;
+  }
+}
+
+template <typename TValue, unsigned int TImageDimension>
+void
+ExhaustiveLogStreamWriter<TValue, TImageDimension>::Close()
+{
+  std::lock_guard<std::mutex> lock(m_StreamMutex);
+  if (m_Stream.is_open())
+  {
+    m_Stream.close();
+  }
+}
+
+template <typename TValue, unsigned int TImageDimension>
+bool
+ExhaustiveLogStreamWriter<TValue, TImageDimension>::IsOpen() const
+{
+  std::lock_guard<std::mutex> lock(m_StreamMutex);
+  return m_Stream.is_open();
+}
+} // namespace itk
+
+#endif // itkExhaustiveLogStreamWriter_hxx
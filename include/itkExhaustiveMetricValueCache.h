@@ -0,0 +1,222 @@
+/*=========================================================================
+ *
+ *  Copyright NumFOCUS
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *         https://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *=========================================================================*/
+#ifndef itkExhaustiveMetricValueCache_h
+#define itkExhaustiveMetricValueCache_h
+
+#include "itkMacro.h"
+#include "itkObject.h"
+#include "itkFixedArray.h"
+#include "itkCommandExhaustiveLog.h"
+
+#include <array>
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+
+namespace itk
+{
+/**
+ *\class ExhaustiveMetricValueCache
+ *  \brief Remembers metric values by parameter position so that overlapping sweeps reuse earlier work.
+ *
+ * Exhaustive sweeps are often repeated with the same steps and scales around a shifted
+ * center or with more steps around the same center. Most of the new lattice then
+ * coincides with samples computed before. This cache stores metric values keyed by
+ * physical parameter position, quantized to Quantum (normally the lattice step size
+ * StepLength * Scales) about QuantizationOrigin (normally the center of the first
+ * sweep), together with a Fingerprint identifying the metric and images that produced
+ * them. Positions closer than half a quantum along every parameter share an entry,
+ * which absorbs the rounding differences of lattices anchored at different centers.
+ *
+ * ParallelExhaustiveSweep consults the cache through SetValueCache(): cached samples
+ * are written straight into the observer and only the remaining samples are evaluated,
+ * after which they are added to the cache. Values from a finished CommandExhaustiveLog
+ * may be added with InsertLog(). The cache persists across processes with Write() and
+ * Read().
+ *
+ * The fingerprint is chosen by the caller, who is responsible for changing it whenever
+ * the metric, its configuration or its images change. ComputeFingerprint() and
+ * ComputeImageFingerprint() help build one. Entries of every fingerprint are kept, and
+ * lookups and insertions use the current one.
+ *
+ * The cache is not safe for concurrent modification.
+ *
+ * Template parameters for class ExhaustiveMetricValueCache:
+ *
+ * - TValue = Element type of the cached metric values.
+ * - TImageDimension = Dimension of image equal to number of transform parameters
+ *
+ * \ingroup ITKOptimizationMonitor
+ */
+template <typename TValue, unsigned int TImageDimension>
+class ExhaustiveMetricValueCache : public Object
+{
+public:
+  ITK_DISALLOW_COPY_AND_MOVE(ExhaustiveMetricValueCache);
+
+  using Self = ExhaustiveMetricValueCache;
+  using Superclass = Object;
+  using Pointer = SmartPointer<Self>;
+  using ConstPointer = SmartPointer<const Self>;
+  itkNewMacro(Self);
+  itkOverrideGetNameOfClassMacro(ExhaustiveMetricValueCache);
+
+  /** Image dimension */
+  static constexpr unsigned int Dimension = TImageDimension;
+
+  using LogType = CommandExhaustiveLog<TValue, TImageDimension>;
+  using ParametersType = typename LogType::ParametersType;
+  using SizeValueType = typename LogType::SizeValueType;
+
+  using QuantumType = FixedArray<double, TImageDimension>;
+  using FingerprintType = std::uint64_t;
+
+  /** Starting value for chaining ComputeFingerprint() calls. */
+  static constexpr FingerprintType InitialFingerprint = 14695981039346656037ull;
+
+  /** Spacing of the position quantization along each parameter. Must be set, to
+   *  positive values, before the cache is used; ParallelExhaustiveSweep sets it to
+   *  the lattice step size if it is not. */
+  itkSetMacro(Quantum, QuantumType);
+  itkGetConstReferenceMacro(Quantum, QuantumType);
+
+  /** Position quantized to zero. Lattice points of sweeps whose centers differ by
+   *  whole steps from it lie on quantization points rather than between them.
+   *  Defaults to zero; ParallelExhaustiveSweep sets it to the sweep center together
+   *  with the quantum. */
+  itkSetMacro(QuantizationOrigin, QuantumType);
+  itkGetConstReferenceMacro(QuantizationOrigin, QuantumType);
+
+  /** Whether all quantum elements are positive. */
+  bool
+  IsQuantumSet() const;
+
+  /** Whether a lattice with the given origin and step size steps by whole quanta
+   *  from a quantization point, so that each of its points has a key of its own
+   *  that a sweep over the same lattice looks up. */
+  bool
+  IsOnQuantization(const QuantumType & origin, const QuantumType & stepSize) const;
+
+  /** Identifies the metric and images of the values looked up and inserted. */
+  itkSetMacro(Fingerprint, FingerprintType);
+  itkGetConstMacro(Fingerprint, FingerprintType);
+
+  /** Retrieve the value cached for the position under the current fingerprint.
+   *  Returns false, leaving value unchanged, if there is none. */
+  bool
+  Lookup(const ParametersType & position, TValue & value) const;
+
+  /** Cache a value for the position under the current fingerprint, replacing any
+   *  previous value. */
+  void
+  Insert(const ParametersType & position, const TValue & value);
+
+  /** Cache every sample of a log under the current fingerprint, at the physical
+   *  positions of the log lattice. Only complete logs should be inserted since
+   *  samples never recorded hold the log fill value. If the quantum is not set, the
+   *  cache is quantized to the log step size about the log center. Throws if the
+   *  lattice does not step by whole quanta from a quantization point. */
+  void
+  InsertLog(const LogType * log);
+
+  /** Number of values cached, over all fingerprints. */
+  SizeValueType
+  GetNumberOfEntries() const
+  {
+    return static_cast<SizeValueType>(m_Values.size());
+  }
+
+  /** Remove all values. */
+  void
+  Clear();
+
+  /** Save all values to a file in native byte order. */
+  void
+  Write(const std::string & fileName) const;
+
+  /** Add the values saved in a file, replacing cached values at the same keys. The
+   *  quantum and quantization origin are taken from the file if the quantum is not
+   *  set, and must match the file otherwise. */
+  void
+  Read(const std::string & fileName);
+
+  /** Hash bytes into a fingerprint, continuing from seed. */
+  static FingerprintType
+  ComputeFingerprint(const void * data, std::size_t numberOfBytes, FingerprintType seed = InitialFingerprint);
+
+  /** Hash a string into a fingerprint, continuing from seed. */
+  static FingerprintType
+  ComputeFingerprint(const std::string & text, FingerprintType seed = InitialFingerprint);
+
+  /** Hash the geometry and buffered pixels of an itk::Image into a fingerprint,
+   *  continuing from seed. */
+  template <typename TImage>
+  static FingerprintType
+  ComputeImageFingerprint(const TImage * image, FingerprintType seed = InitialFingerprint);
+
+protected:
+  ExhaustiveMetricValueCache();
+  ~ExhaustiveMetricValueCache() override = default;
+
+  void
+  PrintSelf(std::ostream & os, Indent indent) const override;
+
+private:
+  /** Fingerprint and quantized position of a cached value. */
+  struct KeyType
+  {
+    FingerprintType                           Fingerprint;
+    std::array<std::int64_t, TImageDimension> Position;
+
+    bool
+    operator==(const KeyType & other) const
+    {
+      return Fingerprint == other.Fingerprint && Position == other.Position;
+    }
+  };
+
+  struct KeyHash
+  {
+    std::size_t
+    operator()(const KeyType & key) const;
+  };
+
+  KeyType
+  MakeKey(const ParametersType & position) const;
+
+  /** Identifies exhaustive metric value cache files, version 1. */
+  static constexpr std::streamoff MagicSize = 8;
+  static const char *
+  GetMagic()
+  {
+    return "ITKEXVC1";
+  }
+
+  QuantumType     m_Quantum;
+  QuantumType     m_QuantizationOrigin;
+  FingerprintType m_Fingerprint{ InitialFingerprint };
+
+  std::unordered_map<KeyType, TValue, KeyHash> m_Values;
+};
+} // namespace itk
+
+#ifndef ITK_MANUAL_INSTANTIATION
+#  include "itkExhaustiveMetricValueCache.hxx"
+#endif
+
+#endif // itkExhaustiveMetricValueCache_h
@@ -0,0 +1,394 @@
+/*=========================================================================
+ *
+ *  Copyright NumFOCUS
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *         https://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *=========================================================================*/
+
+#ifndef itkExhaustiveMetricValueCache_hxx
+#define itkExhaustiveMetricValueCache_hxx
+
+#include "itkExhaustiveMetricValueCache.h"
+
+#include <cmath>
+#include <cstring>
+#include <fstream>
+#include <limits>
+
+namespace itk
+{
+template <typename TValue, unsigned int TImageDimension>
+ExhaustiveMetricValueCache<TValue, TImageDimension>::ExhaustiveMetricValueCache()
+{
+  m_Quantum.Fill(0.0);
+  m_QuantizationOrigin.Fill(0.0);
+}
+
+template <typename TValue, unsigned int TImageDimension>
+bool
+ExhaustiveMetricValueCache<TValue, TImageDimension>::IsQuantumSet() const
+{
+  for (unsigned int dim = 0; dim < Dimension; dim++)
+  {
+    if (!(m_Quantum[dim] > 0.0))
+    {
+      return false;
+    }
+  }
+  return true;
+}
+
+template <typename TValue, unsigned int TImageDimension>
+bool
+ExhaustiveMetricValueCache<TValue, TImageDimension>::IsOnQuantization(const QuantumType & origin,
+                                                                      const QuantumType & stepSize) const
+{
+  if (!this->IsQuantumSet())
+  {
+    return false;
+  }
+  for (unsigned int dim = 0; dim < Dimension; dim++)
+  {
+    const double quantaPerStep = stepSize[dim] / m_Quantum[dim];
+    const double quantaToOrigin = (origin[dim] - m_QuantizationOrigin[dim]) / m_Quantum[dim];
+    if (std::llround(quantaPerStep) < 1 || std::abs(quantaPerStep - std::round(quantaPerStep)) > 1e-6 ||
+        std::abs(quantaToOrigin - std::round(quantaToOrigin)) > 1e-6)
+    {
+      return false;
+    }
+  }
+  return true;
+}
+
+template <typename TValue, unsigned int TImageDimension>
+auto
+ExhaustiveMetricValueCache<TValue, TImageDimension>::MakeKey(const ParametersType & position) const -> KeyType
+{
+  if (position.Size() != Dimension)
+  {
+    itkExceptionMacro("Position has " << position.Size() << " parameters but the cache expects " << Dimension);
+  }
+  if (!this->IsQuantumSet())
+  {
+    itkExceptionMacro("Quantum must be positive but is " << m_Quantum);
+  }
+
+  KeyType key;
+  key.Fingerprint = m_Fingerprint;
+  for (unsigned int dim = 0; dim < Dimension; dim++)
+  {
+    key.Position[dim] =
+      static_cast<std::int64_t>(std::llround((position[dim] - m_QuantizationOrigin[dim]) / m_Quantum[dim]));
+  }
+  return key;
+}
+
+template <typename TValue, unsigned int TImageDimension>
+std::size_t
+ExhaustiveMetricValueCache<TValue, TImageDimension>::KeyHash::operator()(const KeyType & key) const
+{
+  std::uint64_t hash = key.Fingerprint;
+  for (const auto coordinate : key.Position)
+  {
+    // splitmix64 finalizer on each combined word
+    hash += static_cast<std::uint64_t>(coordinate) + 0x9e3779b97f4a7c15ull;
+    hash = (hash ^ (hash >> 30)) * 0xbf58476d1ce4e5b9ull;
+    hash = (hash ^ (hash >> 27)) * 0x94d049bb133111ebull;
+    hash ^= hash >> 31;
+  }
+  return static_cast<std::size_t>(hash);
+}
+
+template <typename TValue, unsigned int TImageDimension>
+bool
+ExhaustiveMetricValueCache<TValue, TImageDimension>::Lookup(const ParametersType & position, TValue & value) const
+{
+  const auto found = m_Values.find(MakeKey(position));
+  if (found == m_Values.end())
+  {
+    return false;
+  }
+  value = found->second;
+  return true;
+}
+
+template <typename TValue, unsigned int TImageDimension>
+void
+ExhaustiveMetricValueCache<TValue, TImageDimension>::Insert(const ParametersType & position, const TValue & value)
+{
+  m_Values[MakeKey(position)] = value;
+}
+
+template <typename TValue, unsigned int TImageDimension>
+void
+ExhaustiveMetricValueCache<TValue, TImageDimension>::InsertLog(const LogType * log)
+{
+  if (log == nullptr || !log->IsInitialized())
+  {
+    itkExceptionMacro("Cannot insert a log that has not been initialized");
+  }
+
+  const auto   region = log->GetRegion();
+  const auto & size = region.GetSize();
+  const auto & spacing = log->GetStepSize();
+  const auto & origin = log->GetOrigin();
+
+  // An unset quantization follows the log lattice about its center, as a sweep does
+  if (!this->IsQuantumSet())
+  {
+    for (unsigned int dim = 0; dim < Dimension; dim++)
+    {
+      m_Quantum[dim] = spacing[dim];
+      m_QuantizationOrigin[dim] = origin[dim] + log->GetNumberOfSteps(dim) * spacing[dim];
+    }
+  }
+
+  // Lattice points between quantization points would be keyed where no sweep looks
+  // them up, so the lattice must step by whole quanta from a quantization point
+  QuantumType logOrigin;
+  QuantumType logStepSize;
+  for (unsigned int dim = 0; dim < Dimension; dim++)
+  {
+    logOrigin[dim] = origin[dim];
+    logStepSize[dim] = spacing[dim];
+  }
+  if (!this->IsOnQuantization(logOrigin, logStepSize))
+  {
+    itkExceptionMacro("Log lattice with origin " << origin << " and step size " << spacing
+                                                 << " does not lie on the cache quantization of " << m_Quantum
+                                                 << " about " << m_QuantizationOrigin);
+  }
+
+  SizeValueType numberOfSamples = 1;
+  for (unsigned int dim = 0; dim < Dimension; dim++)
+  {
+    numberOfSamples *= size[dim];
+  }
+  m_Values.reserve(m_Values.size() + numberOfSamples);
+
+  SizeValueType  index[TImageDimension] = {};
+  ParametersType position(Dimension);
+  for (SizeValueType offset = 0; offset < numberOfSamples; offset++)
+  {
+    for (unsigned int dim = 0; dim < Dimension; dim++)
+    {
+      const double latticeIndex = static_cast<double>(region.GetIndex(dim)) + static_cast<double>(index[dim]);
+      position[dim] = origin[dim] + latticeIndex * spacing[dim];
+    }
+    Insert(position, log->GetValueAtOffset(static_cast<typename LogType::OffsetValueType>(offset)));
+
+    for (unsigned int dim = 0; dim < Dimension; dim++)
+    {
+      if (++index[dim] < size[dim])
+      {
+        break;
+      }
+      index[dim] = 0;
+    }
+  }
+  this->Modified();
+}
+
+template <typename TValue, unsigned int TImageDimension>
+void
+ExhaustiveMetricValueCache<TValue, TImageDimension>::Clear()
+{
+  m_Values.clear();
+  this->Modified();
+}
+
+template <typename TValue, unsigned int TImageDimension>
+void
+ExhaustiveMetricValueCache<TValue, TImageDimension>::Write(const std::string & fileName) const
+{
+  std::ofstream stream(fileName, std::ios::out | std::ios::binary | std::ios::trunc);
+  if (!stream)
+  {
+    itkExceptionMacro("Cannot open metric value cache " << fileName << " for writing");
+  }
+
+  const std::uint32_t dimension = Dimension;
+  const std::uint32_t valueSize = sizeof(TValue);
+  const std::uint32_t isInteger = std::numeric_limits<TValue>::is_integer ? 1 : 0;
+  const std::uint64_t numberOfEntries = m_Values.size();
+
+  stream.write(GetMagic(), MagicSize);
+  stream.write(reinterpret_cast<const char *>(&dimension), sizeof(dimension));
+  stream.write(reinterpret_cast<const char *>(&valueSize), sizeof(valueSize));
+  stream.write(reinterpret_cast<const char *>(&isInteger), sizeof(isInteger));
+  for (unsigned int dim = 0; dim < Dimension; dim++)
+  {
+    const double quantum = m_Quantum[dim];
+    const double origin = m_QuantizationOrigin[dim];
+    stream.write(reinterpret_cast<const char *>(&quantum), sizeof(quantum));
+    stream.write(reinterpret_cast<const char *>(&origin), sizeof(origin));
+  }
+  stream.write(reinterpret_cast<const char *>(&numberOfEntries), sizeof(numberOfEntries));
+
+  for (const auto & entry : m_Values)
+  {
+    stream.write(reinterpret_cast<const char *>(&entry.first.Fingerprint), sizeof(FingerprintType));
+    stream.write(reinterpret_cast<const char *>(entry.first.Position.data()), sizeof(std::int64_t) * Dimension);
+    stream.write(reinterpret_cast<const char *>(&entry.second), sizeof(TValue));
+  }
+  if (!stream)
+  {
+    itkExceptionMacro("Failed writing metric value cache " << fileName);
+  }
+}
+
+template <typename TValue, unsigned int TImageDimension>
+void
+ExhaustiveMetricValueCache<TValue, TImageDimension>::Read(const std::string & fileName)
+{
+  std::ifstream stream(fileName, std::ios::in | std::ios::binary);
+  if (!stream)
+  {
+    itkExceptionMacro("Cannot open metric value cache " << fileName);
+  }
+
+  char          magic[MagicSize];
+  std::uint32_t dimension = 0;
+  std::uint32_t valueSize = 0;
+  std::uint32_t isInteger = 0;
+  stream.read(magic, sizeof(magic));
+  stream.read(reinterpret_cast<char *>(&dimension), sizeof(dimension));
+  stream.read(reinterpret_cast<char *>(&valueSize), sizeof(valueSize));
+  stream.read(reinterpret_cast<char *>(&isInteger), sizeof(isInteger));
+  if (!stream || std::memcmp(magic, GetMagic(), MagicSize) != 0)
+  {
+    itkExceptionMacro("File " << fileName << " is not a metric value cache");
+  }
+  if (dimension != Dimension || valueSize != sizeof(TValue) ||
+      isInteger != (std::numeric_limits<TValue>::is_integer ? 1u : 0u))
+  {
+    itkExceptionMacro("Metric value cache holds " << dimension << "-D values of " << valueSize << " bytes but "
+                                                  << Dimension << "-D values of " << sizeof(TValue)
+                                                  << " bytes were expected");
+  }
+
+  QuantumType quantum;
+  QuantumType origin;
+  for (unsigned int dim = 0; dim < Dimension; dim++)
+  {
+    stream.read(reinterpret_cast<char *>(&quantum[dim]), sizeof(double));
+    stream.read(reinterpret_cast<char *>(&origin[dim]), sizeof(double));
+  }
+  std::uint64_t numberOfEntries = 0;
+  stream.read(reinterpret_cast<char *>(&numberOfEntries), sizeof(numberOfEntries));
+  if (!stream)
+  {
+    itkExceptionMacro("Metric value cache " << fileName << " is truncated");
+  }
+  if (!this->IsQuantumSet())
+  {
+    m_Quantum = quantum;
+    m_QuantizationOrigin = origin;
+  }
+  else if (quantum != m_Quantum || origin != m_QuantizationOrigin)
+  {
+    itkExceptionMacro("Metric value cache " << fileName << " is quantized to " << quantum << " about " << origin
+                                            << " but " << m_Quantum << " about " << m_QuantizationOrigin
+                                            << " was expected");
+  }
+
+  m_Values.reserve(m_Values.size() + numberOfEntries);
+  for (std::uint64_t entry = 0; entry < numberOfEntries; entry++)
+  {
+    KeyType key;
+    TValue  value;
+    stream.read(reinterpret_cast<char *>(&key.Fingerprint), sizeof(FingerprintType));
+    stream.read(reinterpret_cast<char *>(key.Position.data()), sizeof(std::int64_t) * Dimension);
+    stream.read(reinterpret_cast<char *>(&value), sizeof(TValue));
+    if (!stream)
+    {
+      itkExceptionMacro("Metric value cache " << fileName << " is truncated");
+    }
+    m_Values[key] = value;
+  }
+  this->Modified();
+}
+
+template <typename TValue, unsigned int TImageDimension>
+auto
+ExhaustiveMetricValueCache<TValue, TImageDimension>::ComputeFingerprint(const void *          data,
+                                                                        const std::size_t     numberOfBytes,
+                                                                        const FingerprintType seed) -> FingerprintType
+{
+  // 64-bit FNV-1a
+  const auto *    bytes = static_cast<const unsigned char *>(data);
+  FingerprintType hash = seed;
+  for (std::size_t i = 0; i < numberOfBytes; i++)
+  {
+    hash ^= bytes[i];
+    hash *= 1099511628211ull;
+  }
+  return hash;
+}
+
+template <typename TValue, unsigned int TImageDimension>
+auto
+ExhaustiveMetricValueCache<TValue, TImageDimension>::ComputeFingerprint(const std::string &   text,
+                                                                        const FingerprintType seed) -> FingerprintType
+{
+  return ComputeFingerprint(text.data(), text.size(), seed);
+}
+
+template <typename TValue, unsigned int TImageDimension>
+template <typename TImage>
+auto
+ExhaustiveMetricValueCache<TValue, TImageDimension>::ComputeImageFingerprint(const TImage *  image,
+                                                                             FingerprintType seed) -> FingerprintType
+{
+  if (image == nullptr)
+  {
+    itkGenericExceptionMacro("Cannot fingerprint a null image");
+  }
+
+  const auto & region = image->GetBufferedRegion();
+  const auto & spacing = image->GetSpacing();
+  const auto & origin = image->GetOrigin();
+  const auto & direction = image->GetDirection();
+  for (unsigned int dim = 0; dim < TImage::ImageDimension; dim++)
+  {
+    const std::int64_t start = region.GetIndex()[dim];
+    const std::int64_t length = region.GetSize()[dim];
+    seed = ComputeFingerprint(&start, sizeof(start), seed);
+    seed = ComputeFingerprint(&length, sizeof(length), seed);
+    seed = ComputeFingerprint(&spacing[dim], sizeof(spacing[dim]), seed);
+    seed = ComputeFingerprint(&origin[dim], sizeof(origin[dim]), seed);
+    for (unsigned int column = 0; column < TImage::ImageDimension; column++)
+    {
+      seed = ComputeFingerprint(&direction[dim][column], sizeof(double), seed);
+    }
+  }
+  return ComputeFingerprint(
+    image->GetBufferPointer(), region.GetNumberOfPixels() * sizeof(typename TImage::PixelType), seed);
+}
+
+template <typename TValue, unsigned int TImageDimension>
+void
+ExhaustiveMetricValueCache<TValue, TImageDimension>::PrintSelf(std::ostream & os, Indent indent) const
+{
+  Superclass::PrintSelf(os, indent);
+
+  os << indent << "Quantum: " << m_Quantum << std::endl;
+  os << indent << "QuantizationOrigin: " << m_QuantizationOrigin << std::endl;
+  os << indent << "Fingerprint: " << m_Fingerprint << std::endl;
+  os << indent << "NumberOfEntries: " << m_Values.size() << std::endl;
+}
+
+} // namespace itk
+
+#endif // itkExhaustiveMetricValueCache_hxx
@@ -0,0 +1,288 @@
+/*=========================================================================
+ *
+ *  Copyright NumFOCUS
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *         https://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *=========================================================================*/
+#ifndef itkParallelExhaustiveSweep_h
+#define itkParallelExhaustiveSweep_h
+
+#include "itkMacro.h"
+#include "itkObject.h"
+#include "itkCommandExhaustiveLog.h"
+#include "itkExhaustiveMetricValueCache.h"
+#include "itkMultiThreaderBase.h"
+
+#include <atomic>
+#include <chrono>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace itk
+{
+/**
+ *\class ParallelExhaustiveSweep
+ *  \brief Fills a CommandExhaustiveLog by evaluating the exhaustive lattice on all cores.
+ *
+ * ExhaustiveOptimizerv4 visits the parameter lattice one metric evaluation at a time.
+ * When the metric dominates the cost of a sweep this leaves all but one core idle.
+ * ParallelExhaustiveSweep visits the same lattice, defined by the number of steps,
+ * scales and step length exactly as for ExhaustiveOptimizerv4, but splits it into
+ * blocks of consecutive samples that worker threads claim dynamically until the
+ * lattice is exhausted.
+ *
+ * Metrics are not safe to evaluate concurrently, so each worker thread owns one metric
+ * added through AddMetric(). Every metric must be fully initialized, observe its own
+ * transform, and otherwise be configured identically. The number of metrics sets the
+ * number of worker threads.
+ *
+ * Sample positions are computed with the same arithmetic as ExhaustiveOptimizerv4
+ * and workers write directly into the observer data array at disjoint offsets, so
+ * the logged surface is identical to the one produced through the StartEvent /
+ * IterationEvent path given identically configured metrics. Each worker keeps its
+ * own reductions of the observer (see CommandExhaustiveLog::BeginConcurrentWrites),
+ * merged once the workers finish.
+ *
+ * An observer restricted to a shard of the lattice (see
+ * CommandExhaustiveLog::SetShardRegion) is filled over its shard only, so that
+ * processes sweeping disjoint shards together cover the lattice once.
+ *
+ * The observer is initialized about the sweep center with a step size of StepLength
+ * times the scales, so that its origin and step size describe the positions that
+ * were evaluated.
+ *
+ * A subset of the lattice may be evaluated by listing sample offsets, for example
+ * those listed by CommandExhaustiveLog::GetMissingOffsets() after a resumed stream,
+ * one batch per sweep. The observer is
+ * then filled in place rather than reinitialized, and must already lie on the
+ * lattice of the sweep.
+ *
+ * With a value cache set, samples whose position is already cached are written
+ * into the observer without evaluating a metric, and the values of the samples
+ * that were evaluated are added to the cache once the sweep completes. Repeated
+ * sweeps over overlapping lattices then cost only the samples not seen before.
+ *
+ * When the observer records timing (see CommandExhaustiveLog::SetRecordTiming), the
+ * time of each metric evaluation is recorded rather than the time between samples.
+ *
+ * StartEvent and EndEvent are invoked on this object before and after the sweep.
+ * Batches of an observer delivering them (see CommandExhaustiveLog::SetBatchSize)
+ * are delivered on the thread calling StartSweep(), which also evaluates samples,
+ * those completed by other workers waiting until it next records a sample or the
+ * sweep ends.
+ *
+ * Template parameters for class ParallelExhaustiveSweep:
+ *
+ * - TValue = Element type stored at each location in the observer data image.
+ * - TImageDimension = Dimension of image equal to number of transform parameters
+ *
+ * \ingroup ITKOptimizationMonitor
+ */
+template <typename TValue, unsigned int TImageDimension>
+class ParallelExhaustiveSweep : public Object
+{
+public:
+  ITK_DISALLOW_COPY_AND_MOVE(ParallelExhaustiveSweep);
+
+  using Self = ParallelExhaustiveSweep;
+  using Superclass = Object;
+  using Pointer = SmartPointer<Self>;
+  using ConstPointer = SmartPointer<const Self>;
+  itkNewMacro(Self);
+  itkOverrideGetNameOfClassMacro(ParallelExhaustiveSweep);
+
+  /** Image dimension */
+  static constexpr unsigned int Dimension = TImageDimension;
+
+  /** Observer receiving the sampled values. */
+  using LogType = CommandExhaustiveLog<TValue, TImageDimension>;
+  using LogPointer = typename LogType::Pointer;
+
+  using OptimizerType = typename LogType::OptimizerType;
+  using MetricType = typename OptimizerType::MetricType;
+  using MetricPointer = typename MetricType::Pointer;
+  using MeasureType = typename MetricType::MeasureType;
+
+  using ParametersType = typename LogType::ParametersType;
+  using StepsType = typename LogType::StepsType;
+  using ScalesType = typename LogType::ScalesType;
+  using SizeValueType = typename LogType::SizeValueType;
+  using OffsetValueType = typename LogType::OffsetValueType;
+
+  /** Cache of previously evaluated samples. */
+  using CacheType = ExhaustiveMetricValueCache<TValue, TImageDimension>;
+  using CachePointer = typename CacheType::Pointer;
+
+  /** Add a metric to evaluate on one worker thread. */
+  void
+  AddMetric(MetricType * metric);
+
+  /** Remove all metrics. */
+  void
+  ClearMetrics();
+
+  /** Number of metrics added, equal to the number of worker threads. */
+  unsigned int
+  GetNumberOfMetrics() const
+  {
+    return static_cast<unsigned int>(m_Metrics.size());
+  }
+
+  /** Observer whose data array is filled by the sweep. Its center is set to the
+   *  sweep center when the sweep initializes it. */
+  itkSetObjectMacro(Observer, LogType);
+  itkGetModifiableObjectMacro(Observer, LogType);
+
+  /** Number of steps on each side of the initial position, as in ExhaustiveOptimizerv4. */
+  itkSetMacro(NumberOfSteps, StepsType);
+  itkGetConstReferenceMacro(NumberOfSteps, StepsType);
+
+  /** Parameter scales, as in ExhaustiveOptimizerv4. */
+  itkSetMacro(Scales, ScalesType);
+  itkGetConstReferenceMacro(Scales, ScalesType);
+
+  /** Step length multiplying the scales, as in ExhaustiveOptimizerv4. Defaults to 1. */
+  itkSetMacro(StepLength, double);
+  itkGetConstMacro(StepLength, double);
+
+  /** Lattice center. When empty, the parameters of the first metric are used
+   *  as ExhaustiveOptimizerv4 does. */
+  itkSetMacro(InitialPosition, ParametersType);
+  itkGetConstReferenceMacro(InitialPosition, ParametersType);
+
+  /** Number of consecutive lattice samples claimed by a worker at a time.
+   *  Zero uses one row along the first dimension. */
+  itkSetMacro(BlockSize, SizeValueType);
+  itkGetConstMacro(BlockSize, SizeValueType);
+
+  /** Linear offsets of the samples to evaluate, in observer data array order.
+   *  Empty, the default, evaluates the whole lattice after initializing the observer.
+   *  Otherwise the observer is initialized only if it has not been already. */
+  void
+  SetSampleOffsets(const std::vector<OffsetValueType> & offsets)
+  {
+    m_SampleOffsets = offsets;
+    this->Modified();
+  }
+  const std::vector<OffsetValueType> &
+  GetSampleOffsets() const
+  {
+    return m_SampleOffsets;
+  }
+
+  /** Optional cache consulted before, and updated after, evaluating samples. If its
+   *  quantum has not been set, it is quantized to the lattice step size about the
+   *  sweep center. Otherwise StartSweep() throws unless the lattice steps by whole
+   *  quanta from a quantization point. Updating the cache requires an observer that
+   *  stores the lattice. */
+  itkSetObjectMacro(ValueCache, CacheType);
+  itkGetModifiableObjectMacro(ValueCache, CacheType);
+
+  /** Number of samples taken from the value cache by the last sweep. */
+  itkGetConstMacro(NumberOfCachedSamples, SizeValueType);
+
+  /** Number of samples evaluated with a metric by the last sweep. */
+  itkGetConstMacro(NumberOfEvaluatedSamples, SizeValueType);
+
+  /** Evaluate the lattice samples and record them in the observer. */
+  void
+  StartSweep();
+
+protected:
+  ParallelExhaustiveSweep();
+  ~ParallelExhaustiveSweep() override = default;
+
+  void
+  PrintSelf(std::ostream & os, Indent indent) const override;
+
+private:
+  /** Static function used as a "callback" by the MultiThreader. */
+  static ITK_THREAD_RETURN_FUNCTION_CALL_CONVENTION
+  SweepThreaderCallback(void * arg);
+
+  /** Claim and evaluate blocks with the metric owned by the given work unit. */
+  void
+  ThreadedSweep(ThreadIdType workUnit);
+
+  /** Evaluate samples [begin, end) of the sweep with the given metric. */
+  void
+  SweepBlock(ThreadIdType workUnit, MetricType * metric, SizeValueType begin, SizeValueType end);
+
+  /** Evaluate one lattice sample with the given metric, writing it from a work unit. */
+  void
+  SweepSample(ThreadIdType          workUnit,
+              MetricType *          metric,
+              OffsetValueType       offset,
+              const SizeValueType * index,
+              ParametersType &      position);
+
+  /** Decompose a linear offset into a lattice index with dimension 0 varying fastest. */
+  void
+  ComputeLatticeIndex(OffsetValueType offset, SizeValueType * index) const;
+
+  /** Parameters at a lattice index. */
+  void
+  ComputePosition(const SizeValueType * index, ParametersType & position) const;
+
+  /** Quantize an unquantized cache to the sweep lattice, and check that the
+   *  lattice lies on the quantization of the cache. */
+  void
+  QuantizeCache();
+
+  /** Fill cached samples into the observer and list the rest for evaluation. */
+  void
+  FillFromCache();
+
+  /** Add the samples evaluated by the sweep to the cache. */
+  void
+  UpdateCache();
+
+private:
+  std::vector<MetricPointer> m_Metrics;
+  LogPointer                 m_Observer;
+
+  StepsType      m_NumberOfSteps;
+  ScalesType     m_Scales;
+  double         m_StepLength{ 1.0 };
+  ParametersType m_InitialPosition;
+  SizeValueType  m_BlockSize{ 0 };
+
+  std::vector<OffsetValueType> m_SampleOffsets;
+  CachePointer                 m_ValueCache;
+  SizeValueType                m_NumberOfCachedSamples{ 0 };
+  SizeValueType                m_NumberOfEvaluatedSamples{ 0 };
+
+  /** State shared by worker threads during StartSweep. */
+  ParametersType                       m_SweepCenter;
+  OffsetValueType                      m_SweepStart[TImageDimension];
+  SizeValueType                        m_SweepSize[TImageDimension];
+  SizeValueType                        m_SweepBlockSize{ 0 };
+  SizeValueType                        m_NumberOfSamples{ 0 };
+  SizeValueType                        m_NumberOfLatticeSamples{ 0 };
+  bool                                 m_TimingSamples{ false };
+  std::vector<OffsetValueType>         m_PendingOffsets;
+  const std::vector<OffsetValueType> * m_SweepOffsets{ nullptr };
+  std::atomic<SizeValueType>           m_NextBlock{ 0 };
+  std::atomic<bool>                    m_Abort{ false };
+  std::mutex                           m_ExceptionMutex;
+  std::string                          m_ExceptionDescription;
+};
+} // namespace itk
+
+#ifndef ITK_MANUAL_INSTANTIATION
+#  include "itkParallelExhaustiveSweep.hxx"
+#endif
+
+#endif // itkParallelExhaustiveSweep_h
@@ -0,0 +1,448 @@
+/*=========================================================================
+ *
+ *  Copyright NumFOCUS
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *         https://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *=========================================================================*/
+
+#ifndef itkParallelExhaustiveSweep_hxx
+#define itkParallelExhaustiveSweep_hxx
+
+#include "itkParallelExhaustiveSweep.h"
+
+#include "itkPlatformMultiThreader.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace itk
+{
+template <typename TValue, unsigned int TImageDimension>
+ParallelExhaustiveSweep<TValue, TImageDimension>::ParallelExhaustiveSweep()
+{
+  m_NumberOfSteps.SetSize(Dimension);
+  m_NumberOfSteps.Fill(0);
+  m_Scales.SetSize(Dimension);
+  m_Scales.Fill(1.0);
+  for (unsigned int dim = 0; dim < Dimension; dim++)
+  {
+    m_SweepStart[dim] = 0;
+    m_SweepSize[dim] = 1;
+  }
+}
+
+template <typename TValue, unsigned int TImageDimension>
+void
+ParallelExhaustiveSweep<TValue, TImageDimension>::AddMetric(MetricType * metric)
+{
+  if (metric == nullptr)
+  {
+    itkExceptionMacro("Cannot add a null metric");
+  }
+  m_Metrics.push_back(metric);
+  this->Modified();
+}
+
+template <typename TValue, unsigned int TImageDimension>
+void
+ParallelExhaustiveSweep<TValue, TImageDimension>::ClearMetrics()
+{
+  m_Metrics.clear();
+  this->Modified();
+}
+
+template <typename TValue, unsigned int TImageDimension>
+void
+ParallelExhaustiveSweep<TValue, TImageDimension>::StartSweep()
+{
+  if (m_Observer.IsNull())
+  {
+    itkExceptionMacro("Observer must be set before sweeping");
+  }
+  if (m_Metrics.empty())
+  {
+    itkExceptionMacro("At least one metric must be added before sweeping");
+  }
+  for (const auto & metric : m_Metrics)
+  {
+    if (metric->GetNumberOfParameters() != Dimension)
+    {
+      itkExceptionMacro("Metric has " << metric->GetNumberOfParameters() << " parameters but the sweep expects "
+                                      << Dimension);
+    }
+  }
+  if (m_NumberOfSteps.Size() != Dimension || m_Scales.Size() != Dimension)
+  {
+    itkExceptionMacro("Expected " << Dimension << " steps and scales but found " << m_NumberOfSteps.Size()
+                                  << " steps and " << m_Scales.Size() << " scales");
+  }
+
+  m_SweepCenter = (m_InitialPosition.Size() == Dimension) ? m_InitialPosition : m_Metrics[0]->GetParameters();
+
+  // The observer geometry follows the sweep, so that its origin and step size
+  // describe the positions actually evaluated
+  typename LogType::PointType center;
+  ScalesType                  stepSize(Dimension);
+  for (unsigned int dim = 0; dim < Dimension; dim++)
+  {
+    center[dim] = m_SweepCenter[dim];
+    stepSize[dim] = m_StepLength * m_Scales[dim];
+  }
+
+  if (m_SampleOffsets.empty() || !m_Observer->IsInitialized())
+  {
+    m_Observer->SetCenter(center);
+    m_Observer->Initialize(m_NumberOfSteps, stepSize);
+  }
+  for (unsigned int dim = 0; dim < Dimension; dim++)
+  {
+    if (m_Observer->GetLatticeSize()[dim] != 2 * m_NumberOfSteps[dim] + 1)
+    {
+      itkExceptionMacro("Observer lattice size " << m_Observer->GetLatticeSize() << " does not match the sweep");
+    }
+
+    // An observer initialized beforehand must lie on the lattice of the sweep
+    const double origin = center[dim] - m_NumberOfSteps[dim] * stepSize[dim];
+    const double tolerance = 1e-9 * std::max(1.0, std::abs(stepSize[dim]));
+    if (std::abs(m_Observer->GetStepSize()[dim] - stepSize[dim]) > tolerance ||
+        std::abs(m_Observer->GetOrigin()[dim] - origin) > tolerance)
+    {
+      itkExceptionMacro("Observer lattice with origin " << m_Observer->GetOrigin() << " and step size "
+                                                        << m_Observer->GetStepSize()
+                                                        << " does not match the sweep");
+    }
+  }
+
+  // Only the region stored by the observer, the whole lattice or a shard of it, is swept
+  const typename LogType::RegionType region = m_Observer->GetRegion();
+  m_NumberOfLatticeSamples = region.GetNumberOfPixels();
+  for (unsigned int dim = 0; dim < Dimension; dim++)
+  {
+    m_SweepStart[dim] = region.GetIndex(dim);
+    m_SweepSize[dim] = region.GetSize(dim);
+  }
+  m_SweepBlockSize = (m_BlockSize > 0) ? m_BlockSize : m_SweepSize[0];
+
+  for (const auto offset : m_SampleOffsets)
+  {
+    if (offset < 0 || static_cast<SizeValueType>(offset) >= m_NumberOfLatticeSamples)
+    {
+      itkExceptionMacro("Sample offset " << offset << " is outside the lattice of " << m_NumberOfLatticeSamples
+                                         << " samples");
+    }
+  }
+
+  if (m_ValueCache.IsNotNull())
+  {
+    this->QuantizeCache();
+  }
+
+  m_TimingSamples = m_Observer->GetTimingImage() != nullptr;
+  m_NextBlock = 0;
+  m_Abort = false;
+  m_ExceptionDescription.clear();
+
+  this->InvokeEvent(StartEvent());
+
+  m_SweepOffsets = m_SampleOffsets.empty() ? nullptr : &m_SampleOffsets;
+  m_NumberOfCachedSamples = 0;
+  if (m_ValueCache.IsNotNull())
+  {
+    this->FillFromCache();
+  }
+  m_NumberOfSamples = (m_SweepOffsets != nullptr) ? m_SweepOffsets->size() : m_NumberOfLatticeSamples;
+  m_NumberOfEvaluatedSamples = m_NumberOfSamples;
+
+  // Workers spend their time in metric evaluations that may be multithreaded
+  // through the global thread pool, so the workers themselves run on dedicated
+  // threads rather than on the pool.
+  const auto numberOfWorkUnits = static_cast<ThreadIdType>(m_Metrics.size());
+  auto       threader = PlatformMultiThreader::New();
+  threader->SetNumberOfWorkUnits(numberOfWorkUnits);
+  threader->SetSingleMethod(Self::SweepThreaderCallback, this);
+  m_Observer->BeginConcurrentWrites(numberOfWorkUnits);
+  threader->SingleMethodExecute();
+  m_Observer->EndConcurrentWrites();
+
+  // Leave metrics at the lattice center as found
+  for (const auto & metric : m_Metrics)
+  {
+    metric->SetParameters(m_SweepCenter);
+  }
+  m_Observer->FlushBatch();
+
+  if (!m_ExceptionDescription.empty())
+  {
+    itkExceptionMacro("Exhaustive sweep failed: " << m_ExceptionDescription);
+  }
+
+  if (m_ValueCache.IsNotNull())
+  {
+    this->UpdateCache();
+  }
+
+  this->InvokeEvent(EndEvent());
+}
+
+template <typename TValue, unsigned int TImageDimension>
+void
+ParallelExhaustiveSweep<TValue, TImageDimension>::QuantizeCache()
+{
+  typename CacheType::QuantumType stepSize;
+  typename CacheType::QuantumType origin;
+  for (unsigned int dim = 0; dim < Dimension; dim++)
+  {
+    stepSize[dim] = m_StepLength * m_Scales[dim];
+    origin[dim] = m_SweepCenter[dim] - static_cast<double>(m_NumberOfSteps[dim]) * stepSize[dim];
+  }
+
+  if (!m_ValueCache->IsQuantumSet())
+  {
+    typename CacheType::QuantumType center;
+    for (unsigned int dim = 0; dim < Dimension; dim++)
+    {
+      center[dim] = m_SweepCenter[dim];
+    }
+    m_ValueCache->SetQuantum(stepSize);
+    m_ValueCache->SetQuantizationOrigin(center);
+  }
+
+  // A lattice between quantization points would look up, and insert, values at
+  // the keys of neighboring positions
+  if (!m_ValueCache->IsOnQuantization(origin, stepSize))
+  {
+    itkExceptionMacro("Sweep lattice with origin " << origin << " and step size " << stepSize
+                                                   << " does not lie on the cache quantization of "
+                                                   << m_ValueCache->GetQuantum() << " about "
+                                                   << m_ValueCache->GetQuantizationOrigin());
+  }
+}
+
+template <typename TValue, unsigned int TImageDimension>
+void
+ParallelExhaustiveSweep<TValue, TImageDimension>::FillFromCache()
+{
+  SizeValueType  index[TImageDimension];
+  ParametersType position(Dimension);
+  TValue         value;
+  auto           fillOrDefer = [&](const OffsetValueType offset) {
+    this->ComputeLatticeIndex(offset, index);
+    this->ComputePosition(index, position);
+    if (m_ValueCache->Lookup(position, value))
+    {
+      m_Observer->SetValueAtOffset(offset, value);
+      ++m_NumberOfCachedSamples;
+    }
+    else
+    {
+      m_PendingOffsets.push_back(offset);
+    }
+  };
+
+  m_PendingOffsets.clear();
+  if (m_SampleOffsets.empty())
+  {
+    for (SizeValueType offset = 0; offset < m_NumberOfLatticeSamples; offset++)
+    {
+      fillOrDefer(static_cast<OffsetValueType>(offset));
+    }
+  }
+  else
+  {
+    for (const auto offset : m_SampleOffsets)
+    {
+      fillOrDefer(offset);
+    }
+  }
+  m_SweepOffsets = &m_PendingOffsets;
+}
+
+template <typename TValue, unsigned int TImageDimension>
+void
+ParallelExhaustiveSweep<TValue, TImageDimension>::UpdateCache()
+{
+  SizeValueType  index[TImageDimension];
+  ParametersType position(Dimension);
+  for (const auto offset : m_PendingOffsets)
+  {
+    this->ComputeLatticeIndex(offset, index);
+    this->ComputePosition(index, position);
+    m_ValueCache->Insert(position, m_Observer->GetValueAtOffset(offset));
+  }
+  m_PendingOffsets.clear();
+  m_PendingOffsets.shrink_to_fit();
+}
+
+template <typename TValue, unsigned int TImageDimension>
+ITK_THREAD_RETURN_FUNCTION_CALL_CONVENTION
+ParallelExhaustiveSweep<TValue, TImageDimension>::SweepThreaderCallback(void * arg)
+{
+  auto * workUnitInfo = static_cast<MultiThreaderBase::WorkUnitInfo *>(arg);
+  auto * self = static_cast<Self *>(workUnitInfo->UserData);
+
+  self->ThreadedSweep(workUnitInfo->WorkUnitID);
+
+  return ITK_THREAD_RETURN_DEFAULT_VALUE;
+}
+
+template <typename TValue, unsigned int TImageDimension>
+void
+ParallelExhaustiveSweep<TValue, TImageDimension>::ThreadedSweep(ThreadIdType workUnit)
+{
+  // The threader may run fewer work units than requested; blocks are claimed
+  // dynamically so any subset of metrics covers the whole lattice.
+  MetricType * metric = m_Metrics[workUnit % m_Metrics.size()];
+
+  try
+  {
+    while (!m_Abort)
+    {
+      const SizeValueType block = m_NextBlock++;
+      const SizeValueType begin = block * m_SweepBlockSize;
+      if (begin >= m_NumberOfSamples)
+      {
+        break;
+      }
+      const SizeValueType end = std::min(begin + m_SweepBlockSize, m_NumberOfSamples);
+
+      SweepBlock(workUnit, metric, begin, end);
+    }
+  }
+  catch (const std::exception & exception)
+  {
+    std::lock_guard<std::mutex> lock(m_ExceptionMutex);
+    if (m_ExceptionDescription.empty())
+    {
+      m_ExceptionDescription = exception.what();
+    }
+    m_Abort = true;
+  }
+}
+
+template <typename TValue, unsigned int TImageDimension>
+void
+ParallelExhaustiveSweep<TValue, TImageDimension>::SweepBlock(ThreadIdType  workUnit,
+                                                             MetricType *  metric,
+                                                             SizeValueType begin,
+                                                             SizeValueType end)
+{
+  SizeValueType  index[TImageDimension];
+  ParametersType position(Dimension);
+
+  if (m_SweepOffsets != nullptr)
+  {
+    // Listed samples are not contiguous, so each offset is decomposed separately
+    for (SizeValueType sample = begin; sample < end; sample++)
+    {
+      const OffsetValueType offset = (*m_SweepOffsets)[sample];
+      ComputeLatticeIndex(offset, index);
+      SweepSample(workUnit, metric, offset, index, position);
+    }
+    return;
+  }
+
+  ComputeLatticeIndex(static_cast<OffsetValueType>(begin), index);
+
+  for (SizeValueType offset = begin; offset < end; offset++)
+  {
+    SweepSample(workUnit, metric, static_cast<OffsetValueType>(offset), index, position);
+
+    // Advance the lattice index in optimizer order
+    for (unsigned int dim = 0; dim < Dimension; dim++)
+    {
+      if (++index[dim] < m_SweepSize[dim])
+      {
+        break;
+      }
+      index[dim] = 0;
+    }
+  }
+}
+
+template <typename TValue, unsigned int TImageDimension>
+void
+ParallelExhaustiveSweep<TValue, TImageDimension>::SweepSample(ThreadIdType          workUnit,
+                                                              MetricType *          metric,
+                                                              OffsetValueType       offset,
+                                                              const SizeValueType * index,
+                                                              ParametersType &      position)
+{
+  ComputePosition(index, position);
+
+  if (!m_TimingSamples)
+  {
+    metric->SetParameters(position);
+    const MeasureType value = metric->GetValue();
+    m_Observer->SetValueAtOffset(offset, static_cast<TValue>(value), workUnit);
+    return;
+  }
+
+  // Events of concurrent workers interleave, so each evaluation is timed on its own
+  const auto start = std::chrono::steady_clock::now();
+  metric->SetParameters(position);
+  const MeasureType value = metric->GetValue();
+  const auto        elapsed = std::chrono::steady_clock::now() - start;
+  m_Observer->SetValueAtOffset(offset, static_cast<TValue>(value), workUnit);
+  m_Observer->SetElapsedTimeAtOffset(offset, std::chrono::duration<double>(elapsed).count());
+}
+
+template <typename TValue, unsigned int TImageDimension>
+void
+ParallelExhaustiveSweep<TValue, TImageDimension>::ComputeLatticeIndex(const OffsetValueType offset,
+                                                                      SizeValueType *       index) const
+{
+  auto remainder = static_cast<SizeValueType>(offset);
+  for (unsigned int dim = 0; dim < Dimension; dim++)
+  {
+    index[dim] = remainder % m_SweepSize[dim];
+    remainder /= m_SweepSize[dim];
+  }
+}
+
+template <typename TValue, unsigned int TImageDimension>
+void
+ParallelExhaustiveSweep<TValue, TImageDimension>::ComputePosition(const SizeValueType * index,
+                                                                  ParametersType &      position) const
+{
+  // Same arithmetic as ExhaustiveOptimizerv4::IncrementIndex so that positions match bit for bit
+  for (unsigned int dim = 0; dim < Dimension; dim++)
+  {
+    const auto latticeIndex = static_cast<double>(m_SweepStart[dim] + static_cast<OffsetValueType>(index[dim]));
+    position[dim] =
+      (latticeIndex - static_cast<double>(m_NumberOfSteps[dim])) * m_StepLength * m_Scales[dim] + m_SweepCenter[dim];
+  }
+}
+
+template <typename TValue, unsigned int TImageDimension>
+void
+ParallelExhaustiveSweep<TValue, TImageDimension>::PrintSelf(std::ostream & os, Indent indent) const
+{
+  Superclass::PrintSelf(os, indent);
+
+  os << indent << "NumberOfMetrics: " << m_Metrics.size() << std::endl;
+  os << indent << "NumberOfSteps: " << m_NumberOfSteps << std::endl;
+  os << indent << "Scales: " << m_Scales << std::endl;
+  os << indent << "StepLength: " << m_StepLength << std::endl;
+  os << indent << "InitialPosition: " << m_InitialPosition << std::endl;
+  os << indent << "BlockSize: " << m_BlockSize << std::endl;
+  os << indent << "NumberOfSampleOffsets: " << m_SampleOffsets.size() << std::endl;
+  os << indent << "NumberOfCachedSamples: " << m_NumberOfCachedSamples << std::endl;
+  os << indent << "NumberOfEvaluatedSamples: " << m_NumberOfEvaluatedSamples << std::endl;
+  itkPrintSelfObjectMacro(Observer);
+  itkPrintSelfObjectMacro(ValueCache);
+}
+
+} // namespace itk
+
+#endif // itkParallelExhaustiveSweep_hxx
@@ -14,6 +14,7 @@ file(READ "${MY_CURRENT_DIR}/README.rst" DOCUMENTATION)
 itk_module(OptimizationMonitor
   DEPENDS
     ITKCommon
+    ITKImageFunction
     ITKOptimizersv4
   COMPILE_DEPENDS
     ITKImageSources
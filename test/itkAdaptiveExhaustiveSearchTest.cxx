@@ -0,0 +1,175 @@
+/*=========================================================================
+ *
+ *  Copyright NumFOCUS
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *         https://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *=========================================================================*/
+
+#include "itkAdaptiveExhaustiveSearch.h"
+#include "itkAnalyticTestMetric.h"
+#include "itkTestingMacros.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace
+{
+/** Quadratic basin with a shallow ripple, off the coarse lattice. */
+struct BasinSurface
+{
+  double
+  operator()(const itk::OptimizerParameters<double> & parameters) const
+  {
+    const double x = parameters[0] - 0.37;
+    const double y = parameters[1] + 0.81;
+    return x * x + 2.0 * y * y + 0.05 * std::sin(4.0 * parameters[0]) * std::sin(3.0 * parameters[1]);
+  }
+};
+
+using BasinMetric = itk::AnalyticTestMetric<BasinSurface, 2>;
+} // namespace
+
+int
+itkAdaptiveExhaustiveSearchTest(int, char *[])
+{
+  constexpr unsigned int Dimension = 2;
+  using SearchType = itk::AdaptiveExhaustiveSearch<double, Dimension>;
+  using LogType = SearchType::LogType;
+  using OptimizerType = SearchType::OptimizerType;
+
+  auto search = SearchType::New();
+  ITK_EXERCISE_BASIC_OBJECT_METHODS(search, AdaptiveExhaustiveSearch, Object);
+  ITK_TRY_EXPECT_EXCEPTION(search->StartSearch());
+  ITK_TRY_EXPECT_EXCEPTION(search->GetLog(0));
+
+  SearchType::StepsType steps(Dimension);
+  steps.Fill(10);
+  SearchType::ScalesType scales(Dimension);
+  scales.Fill(0.5);
+
+  auto metric = BasinMetric::New();
+  search->SetMetric(metric);
+  search->SetNumberOfSteps(steps);
+  search->SetScales(scales);
+  ITK_TEST_SET_GET_VALUE(3, search->GetNumberOfLevels());
+  ITK_TEST_SET_GET_VALUE(2, search->GetRefinementFactor());
+  ITK_TEST_SET_GET_VALUE(4, search->GetNumberOfCellsToRefine());
+
+  search->SetRefinementFactor(1);
+  ITK_TRY_EXPECT_EXCEPTION(search->StartSearch());
+  search->SetRefinementFactor(2);
+
+  // Evaluations reported by the search are those counted by the metric
+  itk::SizeValueType evaluations = metric->GetNumberOfEvaluations();
+  auto               countEvaluations = [&]() {
+    const itk::SizeValueType previous = evaluations;
+    evaluations = metric->GetNumberOfEvaluations();
+    return evaluations - previous;
+  };
+
+  itk::SizeValueType completedLevels = 0;
+  search->AddObserver(itk::IterationEvent(), [&](const itk::EventObject &) { ++completedLevels; });
+  ITK_TRY_EXPECT_NO_EXCEPTION(search->StartSearch());
+  ITK_TEST_EXPECT_EQUAL(completedLevels, 3);
+  ITK_TEST_EXPECT_EQUAL(search->GetNumberOfLogs(), 3);
+
+  // The coarse lattice is complete and each window holds 5 x 5 samples, every sweep
+  // first evaluating its center
+  constexpr itk::SizeValueType coarseSamples = 21 * 21;
+  ITK_TEST_EXPECT_EQUAL(search->GetNumberOfMetricEvaluations(), countEvaluations());
+  ITK_TEST_EXPECT_EQUAL(search->GetNumberOfMetricEvaluations(), coarseSamples + 1 + 2 * 4 * (25 + 1));
+
+  // Levels share the physical frame and halve the step size
+  const LogType * coarse = search->GetLog(0);
+  const LogType * finest = search->GetLog(2);
+  for (unsigned int level = 1; level < 3; level++)
+  {
+    const LogType * log = search->GetLog(level);
+    ITK_TEST_EXPECT_TRUE(log->GetUseChunkedStorage());
+    for (unsigned int dim = 0; dim < Dimension; dim++)
+    {
+      ITK_TEST_EXPECT_TRUE(std::abs(log->GetOrigin()[dim] - coarse->GetOrigin()[dim]) < 1e-12);
+      ITK_TEST_EXPECT_EQUAL(log->GetStepSize()[dim] * (1u << level), coarse->GetStepSize()[dim]);
+      ITK_TEST_EXPECT_EQUAL(log->GetSize(dim), 20 * (1u << level) + 1);
+    }
+  }
+  ITK_TRY_EXPECT_EXCEPTION(search->GetLog(3));
+
+  // The refined minimum matches that of an exhaustive sweep at the finest step size
+  OptimizerType::StepsType fineSteps(Dimension);
+  fineSteps.Fill(40);
+  OptimizerType::ScalesType fineScales(Dimension);
+  fineScales.Fill(0.125);
+  auto optimizer = OptimizerType::New();
+  optimizer->SetMetric(BasinMetric::New());
+  optimizer->SetNumberOfSteps(fineSteps);
+  optimizer->SetScales(fineScales);
+  ITK_TRY_EXPECT_NO_EXCEPTION(optimizer->StartOptimization());
+
+  const SearchType::ParametersType minimumPosition = search->GetMinimumMetricValuePosition();
+  ITK_TEST_EXPECT_TRUE(std::abs(search->GetMinimumMetricValue() - optimizer->GetMinimumMetricValue()) < 1e-12);
+  for (unsigned int dim = 0; dim < Dimension; dim++)
+  {
+    ITK_TEST_EXPECT_TRUE(std::abs(minimumPosition[dim] - optimizer->GetMinimumMetricValuePosition()[dim]) < 1e-12);
+  }
+  constexpr itk::SizeValueType fineSamples = 81 * 81;
+  ITK_TEST_EXPECT_TRUE(search->GetNumberOfMetricEvaluations() * 10 < fineSamples);
+
+  const LogType::ImageType * coarseImage = coarse->GetImage();
+  const double               coarseMinimum =
+    *std::min_element(coarseImage->GetBufferPointer(), coarseImage->GetBufferPointer() + coarseSamples);
+  ITK_TEST_EXPECT_TRUE(search->GetMinimumMetricValue() < coarseMinimum);
+
+  // Values come from the finest level sampled near a point
+  SearchType::PointType point;
+  point[0] = minimumPosition[0];
+  point[1] = minimumPosition[1];
+  ITK_TEST_EXPECT_EQUAL(search->GetFinestLevel(point), 2);
+  ITK_TEST_EXPECT_EQUAL(search->GetValue(point), search->GetMinimumMetricValue());
+  ITK_TEST_EXPECT_EQUAL(search->GetValue(minimumPosition), search->GetMinimumMetricValue());
+
+  point[0] += 0.25 * finest->GetStepSize()[0];
+  ITK_TEST_EXPECT_EQUAL(search->GetValue(point), search->GetMinimumMetricValue());
+
+  point.Fill(-4.0);
+  ITK_TEST_EXPECT_EQUAL(search->GetFinestLevel(point), 0);
+  ITK_TEST_EXPECT_EQUAL(search->GetValue(point), coarse->GetValue(point));
+  ITK_TEST_EXPECT_EQUAL(finest->GetValue(point), itk::NumericTraits<double>::max());
+
+  point.Fill(6.0);
+  ITK_TRY_EXPECT_EXCEPTION(search->GetValue(point));
+
+  // The metric is left at the lattice center
+  ITK_TEST_EXPECT_EQUAL(metric->GetParameters()[0], 0.0);
+
+  // A zero threshold refines only the lowest cell of each level
+  search->SetRefinementThreshold(0.0);
+  ITK_TEST_SET_GET_VALUE(0.0, search->GetRefinementThreshold());
+  countEvaluations();
+  ITK_TRY_EXPECT_NO_EXCEPTION(search->StartSearch());
+  ITK_TEST_EXPECT_EQUAL(search->GetNumberOfMetricEvaluations(), countEvaluations());
+  ITK_TEST_EXPECT_EQUAL(search->GetNumberOfMetricEvaluations(), coarseSamples + 1 + 2 * (25 + 1));
+  ITK_TEST_EXPECT_TRUE(std::abs(search->GetMinimumMetricValue() - optimizer->GetMinimumMetricValue()) < 1e-12);
+
+  // A single level is the plain exhaustive sweep
+  search->SetNumberOfLevels(1);
+  ITK_TRY_EXPECT_NO_EXCEPTION(search->StartSearch());
+  ITK_TEST_EXPECT_EQUAL(search->GetNumberOfLogs(), 1);
+  ITK_TEST_EXPECT_EQUAL(search->GetNumberOfMetricEvaluations(), countEvaluations());
+  ITK_TEST_EXPECT_EQUAL(search->GetNumberOfMetricEvaluations(), coarseSamples + 1);
+  ITK_TEST_EXPECT_EQUAL(search->GetMinimumMetricValue(), coarseMinimum);
+
+  std::cout << "Test finished." << std::endl;
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,163 @@
+/*=========================================================================
+ *
+ *  Copyright NumFOCUS
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *         https://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *=========================================================================*/
+
+#ifndef itkAnalyticTestMetric_h
+#define itkAnalyticTestMetric_h
+
+#include "itkObjectToObjectMetricBase.h"
+
+namespace itk
+{
+/**
+ *\class AnalyticTestMetric
+ *  \brief Metric given by a closed-form surface over the parameters, for tests.
+ *
+ * Tests of the optimizer observers need a metric whose value is known at every
+ * position without registering images. Each test supplies only the formula as
+ * TSurface, a default-constructible callable returning the value at a parameters
+ * array. State of the formula, such as a height or a choice among surfaces, is
+ * reached through GetSurface().
+ *
+ * The metric starts with VNumberOfParameters zero parameters, and otherwise takes
+ * its number of parameters from SetParameters(). The derivative is zero and
+ * UpdateTransformParameters() does nothing; tests of gradient optimizers override
+ * both.
+ *
+ * \ingroup ITKOptimizationMonitor
+ */
+template <typename TSurface, unsigned int VNumberOfParameters = 0>
+class AnalyticTestMetric : public ObjectToObjectMetricBaseTemplate<double>
+{
+public:
+  ITK_DISALLOW_COPY_AND_MOVE(AnalyticTestMetric);
+
+  using Self = AnalyticTestMetric;
+  using Superclass = ObjectToObjectMetricBaseTemplate<double>;
+  using Pointer = SmartPointer<Self>;
+  itkNewMacro(Self);
+  itkOverrideGetNameOfClassMacro(AnalyticTestMetric);
+
+  using SurfaceType = TSurface;
+
+  using typename Superclass::DerivativeType;
+  using typename Superclass::MeasureType;
+  using typename Superclass::NumberOfParametersType;
+  using typename Superclass::ParametersType;
+  using typename Superclass::ParametersValueType;
+
+  void
+  Initialize() override
+  {}
+
+  MeasureType
+  GetValue() const override
+  {
+    ++m_NumberOfEvaluations;
+    return m_Surface(this->GetParameters());
+  }
+
+  void
+  GetDerivative(DerivativeType & derivative) const override
+  {
+    derivative.SetSize(this->GetNumberOfParameters());
+    derivative.Fill(0.0);
+  }
+
+  void
+  GetValueAndDerivative(MeasureType & value, DerivativeType & derivative) const override
+  {
+    value = GetValue();
+    GetDerivative(derivative);
+  }
+
+  NumberOfParametersType
+  GetNumberOfParameters() const override
+  {
+    return this->GetParameters().Size();
+  }
+
+  NumberOfParametersType
+  GetNumberOfLocalParameters() const override
+  {
+    return this->GetNumberOfParameters();
+  }
+
+  void
+  SetParameters(ParametersType & parameters) override
+  {
+    m_Parameters = parameters;
+  }
+
+  const ParametersType &
+  GetParameters() const override
+  {
+    return m_Parameters;
+  }
+
+  bool
+  HasLocalSupport() const override
+  {
+    return false;
+  }
+
+  void
+  UpdateTransformParameters(const DerivativeType &, ParametersValueType) override
+  {}
+
+  bool
+  SupportsArbitraryVirtualDomainSamples() const override
+  {
+    return true;
+  }
+
+  /** Formula of the metric and its state. */
+  SurfaceType &
+  GetSurface()
+  {
+    return m_Surface;
+  }
+  const SurfaceType &
+  GetSurface() const
+  {
+    return m_Surface;
+  }
+
+  /** Number of calls to GetValue(). */
+  SizeValueType
+  GetNumberOfEvaluations() const
+  {
+    return m_NumberOfEvaluations;
+  }
+
+protected:
+  AnalyticTestMetric()
+  {
+    m_Parameters.SetSize(VNumberOfParameters);
+    m_Parameters.Fill(0.0);
+  }
+  ~AnalyticTestMetric() override = default;
+
+  ParametersType m_Parameters;
+
+private:
+  SurfaceType           m_Surface{};
+  mutable SizeValueType m_NumberOfEvaluations{ 0 };
+};
+} // namespace itk
+
+#endif // itkAnalyticTestMetric_h
@@ -0,0 +1,187 @@
+/*=========================================================================
+ *
+ *  Copyright NumFOCUS
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *         https://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *=========================================================================*/
+
+#include "itkCommandExhaustiveLog.h"
+#include "itkExhaustiveOptimizerv4.h"
+#include "itkParallelExhaustiveSweep.h"
+#include "itkAnalyticTestMetric.h"
+#include "itkTestingMacros.h"
+
+#include <algorithm>
+#include <cmath>
+#include <thread>
+#include <vector>
+
+namespace
+{
+constexpr unsigned int Dimension = 2;
+
+/** Tilted ripple surface. */
+struct RippleSurface
+{
+  double
+  operator()(const itk::OptimizerParameters<double> & parameters) const
+  {
+    return std::sin(3.0 * parameters[0]) * std::cos(2.0 * parameters[1]) + 0.1 * parameters[0];
+  }
+};
+
+using RippleMetric = itk::AnalyticTestMetric<RippleSurface, Dimension>;
+} // namespace
+
+int
+itkCommandExhaustiveLogBatchTest(int, char *[])
+{
+  using ObserverType = itk::CommandExhaustiveLog<double, Dimension>;
+  using OptimizerType = itk::ExhaustiveOptimizerv4<double>;
+  using SweepType = itk::ParallelExhaustiveSweep<double, Dimension>;
+
+  OptimizerType::StepsType steps(Dimension);
+  steps[0] = 4;
+  steps[1] = 3;
+  OptimizerType::ScalesType scales(Dimension);
+  scales.Fill(0.2);
+  constexpr itk::SizeValueType numberOfSamples = 9 * 7;
+
+  auto optimizer = OptimizerType::New();
+  optimizer->SetMetric(RippleMetric::New());
+  optimizer->SetNumberOfSteps(steps);
+  optimizer->SetScales(scales);
+
+  auto observer = ObserverType::New();
+  ITK_TEST_EXPECT_EQUAL(observer->GetBatchSize(), 0);
+  ITK_TEST_EXPECT_EQUAL(observer->GetBatchInterval(), 0.0);
+  observer->SetBatchSize(10);
+  ITK_TEST_SET_GET_VALUE(10, observer->GetBatchSize());
+  optimizer->AddObserver(itk::StartEvent(), observer);
+  optimizer->AddObserver(itk::IterationEvent(), observer);
+  optimizer->AddObserver(itk::EndEvent(), observer);
+
+  // Batches arrive as IterationEvent on the log, copied out here for checking
+  std::vector<itk::SizeValueType>   batchSizes;
+  std::vector<itk::OffsetValueType> offsets;
+  std::vector<double>               values;
+  unsigned int                      mismatches = 0;
+  const std::thread::id             mainThread = std::this_thread::get_id();
+  unsigned int                      offThreadBatches = 0;
+  observer->AddObserver(itk::IterationEvent(), [&](const itk::EventObject &) {
+    const itk::SizeValueType count = observer->GetBatchNumberOfSamples();
+    batchSizes.push_back(count);
+    if (std::this_thread::get_id() != mainThread)
+    {
+      ++offThreadBatches;
+    }
+    for (itk::SizeValueType sample = 0; sample < count; sample++)
+    {
+      const itk::OffsetValueType offset = observer->GetBatchOffsetBuffer()[sample];
+      offsets.push_back(offset);
+      values.push_back(observer->GetBatchValueBuffer()[sample]);
+
+      const ObserverType::IndexType index = observer->GetDataImage()->ComputeIndex(offset);
+      for (unsigned int dim = 0; dim < Dimension; dim++)
+      {
+        if (observer->GetBatchIndexBuffer()[sample * Dimension + dim] != index[dim])
+        {
+          ++mismatches;
+        }
+      }
+    }
+  });
+
+  ITK_TRY_EXPECT_NO_EXCEPTION(optimizer->StartOptimization());
+  ITK_TEST_EXPECT_TRUE(observer->IsStoredDensely());
+
+  // Full batches in optimizer order, the remainder delivered on EndEvent
+  ITK_TEST_EXPECT_EQUAL(batchSizes.size(), 7);
+  ITK_TEST_EXPECT_EQUAL(batchSizes.front(), 10);
+  ITK_TEST_EXPECT_EQUAL(batchSizes.back(), numberOfSamples % 10);
+  ITK_TEST_EXPECT_EQUAL(offsets.size(), numberOfSamples);
+  for (itk::SizeValueType sample = 0; sample < offsets.size(); sample++)
+  {
+    if (offsets[sample] != static_cast<itk::OffsetValueType>(sample) ||
+        values[sample] != observer->GetValueAtOffset(offsets[sample]))
+    {
+      ++mismatches;
+    }
+  }
+  ITK_TEST_EXPECT_EQUAL(mismatches, 0);
+
+  // Nothing is pending after a flush
+  observer->FlushBatch();
+  ITK_TEST_EXPECT_EQUAL(batchSizes.size(), 7);
+
+  // A time limit alone delivers everything at the end when samples come quickly
+  batchSizes.clear();
+  offsets.clear();
+  values.clear();
+  observer->SetBatchSize(0);
+  observer->SetBatchInterval(1.0e6);
+  ITK_TEST_SET_GET_VALUE(1.0e6, observer->GetBatchInterval());
+  ITK_TRY_EXPECT_NO_EXCEPTION(optimizer->StartOptimization());
+  ITK_TEST_EXPECT_EQUAL(batchSizes.size(), 1);
+  ITK_TEST_EXPECT_EQUAL(offsets.size(), numberOfSamples);
+
+  // and splits them when samples come slowly
+  batchSizes.clear();
+  offsets.clear();
+  values.clear();
+  observer->SetBatchInterval(1.0e-9);
+  ITK_TRY_EXPECT_NO_EXCEPTION(optimizer->StartOptimization());
+  ITK_TEST_EXPECT_TRUE(batchSizes.size() > 1);
+  ITK_TEST_EXPECT_EQUAL(offsets.size(), numberOfSamples);
+  ITK_TEST_EXPECT_EQUAL(mismatches, 0);
+
+  // Samples written concurrently by a parallel sweep are each delivered once, on
+  // the thread calling StartSweep
+  batchSizes.clear();
+  offsets.clear();
+  values.clear();
+  observer->SetBatchSize(8);
+  observer->SetBatchInterval(0.0);
+  observer->UseChunkedStorageOn();
+  auto sweep = SweepType::New();
+  sweep->SetObserver(observer);
+  sweep->SetNumberOfSteps(steps);
+  sweep->SetScales(scales);
+  sweep->AddMetric(RippleMetric::New());
+  sweep->AddMetric(RippleMetric::New());
+  sweep->AddMetric(RippleMetric::New());
+  ITK_TRY_EXPECT_NO_EXCEPTION(sweep->StartSweep());
+  ITK_TEST_EXPECT_TRUE(!observer->IsStoredDensely());
+
+  std::vector<unsigned int> deliveries(numberOfSamples, 0);
+  for (itk::SizeValueType sample = 0; sample < offsets.size(); sample++)
+  {
+    ++deliveries[offsets[sample]];
+    if (values[sample] != observer->GetValueAtOffset(offsets[sample]))
+    {
+      ++mismatches;
+    }
+  }
+  ITK_TEST_EXPECT_EQUAL(offsets.size(), numberOfSamples);
+  ITK_TEST_EXPECT_EQUAL(offThreadBatches, 0);
+  ITK_TEST_EXPECT_TRUE(std::all_of(batchSizes.begin(), batchSizes.end(), [](itk::SizeValueType size) {
+    return size > 0 && size <= 8;
+  }));
+  ITK_TEST_EXPECT_EQUAL(static_cast<itk::SizeValueType>(std::count(deliveries.begin(), deliveries.end(), 1u)),
+                        numberOfSamples);
+  ITK_TEST_EXPECT_EQUAL(mismatches, 0);
+
+  std::cout << "Test finished." << std::endl;
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,163 @@
+/*=========================================================================
+ *
+ *  Copyright NumFOCUS
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *         https://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *=========================================================================*/
+
+// Reports the per-iteration cost of CommandExhaustiveLog on IterationEvent by
+// timing an exhaustive sweep over a trivially cheap metric with and without the
+// observer attached, for 1 to 6 parameters and float and double values.
+//
+// Usage: itkCommandExhaustiveLogBenchmark [samplesPerSweep] [repetitions]
+
+#include "itkCommandExhaustiveLog.h"
+#include "itkExhaustiveOptimizerv4.h"
+#include "itkAnalyticTestMetric.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <limits>
+#include <type_traits>
+
+namespace
+{
+/** Sum of squared parameters, so that sweep time is dominated by optimizer and observer overhead. */
+struct SumOfSquaresSurface
+{
+  double
+  operator()(const itk::OptimizerParameters<double> & parameters) const
+  {
+    double value = 0.0;
+    for (unsigned int i = 0; i < parameters.Size(); i++)
+    {
+      value += parameters[i] * parameters[i];
+    }
+    return value;
+  }
+};
+
+template <unsigned int VDimension>
+using BenchmarkMetric = itk::AnalyticTestMetric<SumOfSquaresSurface, VDimension>;
+
+/** Best-of-n wall time of one exhaustive sweep centered at the origin, in nanoseconds. */
+double
+TimeSweep(itk::ExhaustiveOptimizerv4<double> * optimizer, unsigned int repetitions)
+{
+  // The optimizer leaves the metric at the last lattice position
+  itk::ExhaustiveOptimizerv4<double>::ParametersType center(optimizer->GetMetric()->GetNumberOfParameters());
+  center.Fill(0.0);
+
+  double best = std::numeric_limits<double>::max();
+  for (unsigned int r = 0; r < repetitions; r++)
+  {
+    optimizer->GetModifiableMetric()->SetParameters(center);
+    const auto start = std::chrono::steady_clock::now();
+    optimizer->StartOptimization();
+    const auto stop = std::chrono::steady_clock::now();
+    best = std::min(best, std::chrono::duration<double, std::nano>(stop - start).count());
+  }
+  return best;
+}
+
+template <typename TValue, unsigned int VDimension>
+bool
+RunBenchmark(double samplesPerSweep, unsigned int repetitions)
+{
+  using MetricType = BenchmarkMetric<VDimension>;
+  using OptimizerType = itk::ExhaustiveOptimizerv4<double>;
+  using ObserverType = itk::CommandExhaustiveLog<TValue, VDimension>;
+
+  // Steps per side giving about samplesPerSweep lattice samples
+  const auto stepsPerSide = std::max(
+    itk::SizeValueType{ 1 },
+    static_cast<itk::SizeValueType>(std::floor((std::pow(samplesPerSweep, 1.0 / VDimension) - 1.0) / 2.0)));
+
+  auto metric = MetricType::New();
+  auto optimizer = OptimizerType::New();
+  optimizer->SetMetric(metric);
+
+  typename OptimizerType::StepsType steps(VDimension);
+  steps.Fill(stepsPerSide);
+  optimizer->SetNumberOfSteps(steps);
+
+  typename OptimizerType::ScalesType scales(VDimension);
+  scales.Fill(1.0);
+  optimizer->SetScales(scales);
+
+  itk::SizeValueType numberOfSamples = 1;
+  for (unsigned int i = 0; i < VDimension; i++)
+  {
+    numberOfSamples *= 2 * stepsPerSide + 1;
+  }
+
+  const double withoutObserver = TimeSweep(optimizer, repetitions);
+
+  auto observer = ObserverType::New();
+  optimizer->AddObserver(itk::StartEvent(), observer);
+  optimizer->AddObserver(itk::IterationEvent(), observer);
+  const double withObserver = TimeSweep(optimizer, repetitions);
+
+  const double nsWithout = withoutObserver / numberOfSamples;
+  const double nsWith = withObserver / numberOfSamples;
+  std::cout << std::setw(3) << VDimension << std::setw(8) << (std::is_same<TValue, float>::value ? "float" : "double")
+            << std::setw(12) << numberOfSamples << std::fixed << std::setprecision(1) << std::setw(14) << nsWithout
+            << std::setw(14) << nsWith << std::setw(14) << (nsWith - nsWithout) << std::endl;
+
+  // Sanity check that the sweep was logged: the far corner holds D * steps^2
+  typename ObserverType::IndexType corner;
+  corner.Fill(2 * stepsPerSide);
+  const auto expected = static_cast<TValue>(VDimension * static_cast<double>(stepsPerSide * stepsPerSide));
+  if (observer->GetValue(corner) != expected)
+  {
+    std::cerr << "Unexpected logged value " << observer->GetValue(corner) << " at " << corner << ", expected "
+              << expected << std::endl;
+    return false;
+  }
+  return true;
+}
+
+template <typename TValue>
+bool
+RunBenchmarks(double samplesPerSweep, unsigned int repetitions)
+{
+  bool success = true;
+  success &= RunBenchmark<TValue, 1>(samplesPerSweep, repetitions);
+  success &= RunBenchmark<TValue, 2>(samplesPerSweep, repetitions);
+  success &= RunBenchmark<TValue, 3>(samplesPerSweep, repetitions);
+  success &= RunBenchmark<TValue, 4>(samplesPerSweep, repetitions);
+  success &= RunBenchmark<TValue, 5>(samplesPerSweep, repetitions);
+  success &= RunBenchmark<TValue, 6>(samplesPerSweep, repetitions);
+  return success;
+}
+} // namespace
+
+int
+main(int argc, char * argv[])
+{
+  const double       samplesPerSweep = (argc > 1) ? std::atof(argv[1]) : 1.0e6;
+  const unsigned int repetitions = (argc > 2) ? static_cast<unsigned int>(std::atoi(argv[2])) : 3;
+
+  std::cout << "  D    type     samples  ns/iter base   ns/iter log   ns/iter cost" << std::endl;
+
+  bool success = true;
+  success &= RunBenchmarks<float>(samplesPerSweep, std::max(repetitions, 1u));
+  success &= RunBenchmarks<double>(samplesPerSweep, std::max(repetitions, 1u));
+
+  return success ? EXIT_SUCCESS : EXIT_FAILURE;
+}
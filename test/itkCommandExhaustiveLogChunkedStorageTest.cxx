@@ -0,0 +1,152 @@
+/*=========================================================================
+ *
+ *  Copyright NumFOCUS
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *         https://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *=========================================================================*/
+
+#include "itkCommandExhaustiveLog.h"
+#include "itkTestingMacros.h"
+#include "itkImageRegionConstIteratorWithIndex.h"
+
+#include <thread>
+#include <vector>
+
+int
+itkCommandExhaustiveLogChunkedStorageTest(int, char *[])
+{
+  constexpr unsigned int Dimension = 3;
+  using ObserverType = itk::CommandExhaustiveLog<float, Dimension>;
+
+  ObserverType::StepsType steps(Dimension);
+  steps[0] = 10;
+  steps[1] = 10;
+  steps[2] = 1;
+
+  ObserverType::ScalesType scales(Dimension);
+  scales[0] = 0.1;
+  scales[1] = 1.0;
+  scales[2] = 1.0;
+
+  ObserverType::Pointer dense = ObserverType::New();
+  dense->SetFillValue(-1.0f);
+  dense->Initialize(steps, scales);
+  ITK_TEST_EXPECT_EQUAL(dense->GetNumberOfAllocatedChunks(), 0);
+
+  ObserverType::Pointer chunked = ObserverType::New();
+  ITK_TEST_SET_GET_BOOLEAN(chunked, UseChunkedStorage, true);
+  ObserverType::SizeType chunkSize;
+  chunkSize[0] = 4;
+  chunkSize[1] = 8;
+  chunkSize[2] = 1;
+  chunked->SetChunkSize(chunkSize);
+  ITK_TEST_SET_GET_VALUE(chunkSize, chunked->GetChunkSize());
+  chunked->SetFillValue(-1.0f);
+  ITK_TEST_SET_GET_VALUE(-1.0f, chunked->GetFillValue());
+  chunked->Initialize(steps, scales);
+
+  // Geometry is available before any value is written
+  ITK_TEST_EXPECT_EQUAL(chunked->GetNumberOfAllocatedChunks(), 0);
+  ITK_TEST_EXPECT_EQUAL(chunked->GetSize(0), 21);
+  ITK_TEST_EXPECT_EQUAL(chunked->GetSize(1), 21);
+  ITK_TEST_EXPECT_EQUAL(chunked->GetSize(2), 3);
+  ITK_TEST_EXPECT_EQUAL(chunked->GetStepSize()[0], 0.1);
+  ITK_TEST_EXPECT_EQUAL(chunked->GetOrigin(), dense->GetOrigin());
+
+  ObserverType::IndexType index;
+  index.Fill(0);
+  ITK_TEST_EXPECT_EQUAL(chunked->GetValue(index), -1.0f);
+
+  // Write a partial sweep: every other sample of the first plane
+  const ObserverType::OffsetValueType planeSize = 21 * 21;
+  for (ObserverType::OffsetValueType offset = 0; offset < planeSize; offset += 2)
+  {
+    chunked->SetValueAtOffset(offset, static_cast<float>(offset));
+    dense->SetValueAtOffset(offset, static_cast<float>(offset));
+  }
+
+  // 4x8x1 chunks split the lattice into a 6x3x3 grid; the first plane touches 6x3 chunks
+  ITK_TEST_EXPECT_EQUAL(chunked->GetNumberOfAllocatedChunks(), 18);
+
+  // Final corner sample allocates exactly one more chunk
+  index[0] = 20;
+  index[1] = 20;
+  index[2] = 2;
+  chunked->SetValueAtOffset(dense->GetImage()->ComputeOffset(index), 42.0f);
+  dense->SetValueAtOffset(dense->GetImage()->ComputeOffset(index), 42.0f);
+  ITK_TEST_EXPECT_EQUAL(chunked->GetNumberOfAllocatedChunks(), 19);
+  ITK_TEST_EXPECT_EQUAL(chunked->GetValue(index), 42.0f);
+
+  ObserverType::ParametersType position(Dimension);
+  position[0] = 1;
+  position[1] = 10;
+  position[2] = 1;
+  ITK_TEST_EXPECT_EQUAL(chunked->GetValue(position), 42.0f);
+
+  // Chunked lookups and the materialized image both agree with dense storage
+  ObserverType::ImagePointer materialized = chunked->GetImage();
+  ITK_TEST_EXPECT_EQUAL(materialized->GetLargestPossibleRegion(), dense->GetImage()->GetLargestPossibleRegion());
+  ITK_TEST_EXPECT_EQUAL(materialized->GetSpacing(), dense->GetImage()->GetSpacing());
+  ITK_TEST_EXPECT_TRUE(chunked->GetDataImage() != nullptr);
+
+  unsigned int mismatches = 0;
+  using IteratorType = itk::ImageRegionConstIteratorWithIndex<ObserverType::ImageType>;
+  IteratorType it(dense->GetImage(), dense->GetImage()->GetLargestPossibleRegion());
+  for (it.GoToBegin(); !it.IsAtEnd(); ++it)
+  {
+    if (it.Get() != chunked->GetValue(it.GetIndex()) || it.Get() != materialized->GetPixel(it.GetIndex()))
+    {
+      ++mismatches;
+    }
+  }
+  ITK_TEST_EXPECT_EQUAL(mismatches, 0);
+
+  // The materialized image is reused until a sample is written
+  ITK_TEST_EXPECT_EQUAL(chunked->GetImage().GetPointer(), materialized.GetPointer());
+  ITK_TEST_EXPECT_EQUAL(chunked->GetDataImage(), materialized.GetPointer());
+  chunked->SetValueAtOffset(1, 7.0f);
+  ObserverType::ImagePointer updated = chunked->GetImage();
+  ITK_TEST_EXPECT_TRUE(updated != materialized);
+  ITK_TEST_EXPECT_EQUAL(updated->GetBufferPointer()[1], 7.0f);
+  ITK_TEST_EXPECT_EQUAL(materialized->GetBufferPointer()[1], -1.0f);
+
+  // Concurrent readers share one copy materialized after the last write
+  chunked->SetValueAtOffset(2, 9.0f);
+  std::vector<ObserverType::ImagePointer> images(4);
+  std::vector<std::thread>                readers;
+  for (auto & image : images)
+  {
+    readers.emplace_back([&chunked, &image]() { image = chunked->GetImage(); });
+  }
+  for (auto & reader : readers)
+  {
+    reader.join();
+  }
+  unsigned int staleImages = 0;
+  for (const auto & image : images)
+  {
+    if (image != images.front() || image->GetBufferPointer()[2] != 9.0f)
+    {
+      ++staleImages;
+    }
+  }
+  ITK_TEST_EXPECT_EQUAL(staleImages, 0);
+
+  // Reinitialization releases all chunks
+  chunked->Initialize(steps, scales);
+  ITK_TEST_EXPECT_EQUAL(chunked->GetNumberOfAllocatedChunks(), 0);
+
+  std::cout << "Test finished." << std::endl;
+  return EXIT_SUCCESS;
+}
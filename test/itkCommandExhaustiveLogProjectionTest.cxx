@@ -0,0 +1,165 @@
+/*=========================================================================
+ *
+ *  Copyright NumFOCUS
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *         https://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *=========================================================================*/
+
+#include "itkCommandExhaustiveLog.h"
+#include "itkExhaustiveOptimizerv4.h"
+#include "itkAnalyticTestMetric.h"
+#include "itkTestingMacros.h"
+
+#include <cmath>
+#include <vector>
+
+namespace
+{
+constexpr unsigned int Dimension = 4;
+
+/** Smooth surface coupling neighboring parameters, so that no projection is trivial. */
+struct CoupledWaveSurface
+{
+  double
+  operator()(const itk::OptimizerParameters<double> & parameters) const
+  {
+    double value = 0.0;
+    for (unsigned int i = 0; i < Dimension; i++)
+    {
+      value += std::sin((i + 1) * parameters[i]) * std::cos(parameters[(i + 1) % Dimension]);
+      value += 0.01 * i * parameters[i];
+    }
+    return value;
+  }
+};
+
+using CoupledWaveMetric = itk::AnalyticTestMetric<CoupledWaveSurface, Dimension>;
+} // namespace
+
+int
+itkCommandExhaustiveLogProjectionTest(int, char *[])
+{
+  using ObserverType = itk::CommandExhaustiveLog<double, Dimension>;
+  using OptimizerType = itk::ExhaustiveOptimizerv4<double>;
+  using ImageType = ObserverType::ImageType;
+  using ProjectionImageType = ObserverType::ProjectionImageType;
+
+  OptimizerType::StepsType steps(Dimension);
+  steps[0] = 3;
+  steps[1] = 2;
+  steps[2] = 4;
+  steps[3] = 3;
+  OptimizerType::ScalesType scales(Dimension);
+  scales.Fill(0.4);
+  scales[3] = 0.7;
+
+  auto optimizer = OptimizerType::New();
+  optimizer->SetMetric(CoupledWaveMetric::New());
+  optimizer->SetNumberOfSteps(steps);
+  optimizer->SetScales(scales);
+
+  // Reference log keeping the whole lattice
+  auto full = ObserverType::New();
+  ITK_TEST_EXPECT_TRUE(full->GetStoreLattice());
+  ITK_TEST_EXPECT_TRUE(!full->GetComputeProjections());
+  optimizer->AddObserver(itk::StartEvent(), full);
+  optimizer->AddObserver(itk::IterationEvent(), full);
+
+  // Projections only
+  auto projected = ObserverType::New();
+  projected->ComputeProjectionsOn();
+  projected->StoreLatticeOff();
+  ITK_TEST_EXPECT_TRUE(projected->GetComputeProjections());
+  ITK_TEST_EXPECT_TRUE(!projected->GetStoreLattice());
+  optimizer->AddObserver(itk::StartEvent(), projected);
+  optimizer->AddObserver(itk::IterationEvent(), projected);
+
+  ITK_TRY_EXPECT_NO_EXCEPTION(optimizer->StartOptimization());
+
+  ITK_TEST_EXPECT_EQUAL(full->GetNumberOfProjections(), 0);
+  ITK_TEST_EXPECT_EQUAL(projected->GetNumberOfProjections(), Dimension * (Dimension - 1) / 2);
+  ITK_TRY_EXPECT_EXCEPTION(projected->GetImage());
+  ITK_TRY_EXPECT_EXCEPTION(projected->GetValueAtOffset(0));
+  ITK_TRY_EXPECT_EXCEPTION(projected->GetProjectionImage(1, 1));
+  ITK_TRY_EXPECT_EXCEPTION(full->GetProjectionImage(0, 1));
+
+  const ImageType *            image = full->GetImage();
+  const double *               buffer = image->GetBufferPointer();
+  const itk::SizeValueType     numberOfSamples = image->GetLargestPossibleRegion().GetNumberOfPixels();
+  const ImageType::SpacingType spacing = image->GetSpacing();
+  const ImageType::PointType   origin = image->GetOrigin();
+
+  unsigned int mismatches = 0;
+  for (unsigned int first = 0; first < Dimension; first++)
+  {
+    for (unsigned int second = first + 1; second < Dimension; second++)
+    {
+      const ProjectionImageType *                     projection = projected->GetProjectionImage(first, second);
+      const ObserverType::ProjectionArgminImageType * argmin = projected->GetProjectionArgminImage(first, second);
+      ITK_TEST_EXPECT_EQUAL(projection, projected->GetProjectionImage(second, first));
+      ITK_TEST_EXPECT_EQUAL(projection->GetSpacing()[0], spacing[first]);
+      ITK_TEST_EXPECT_EQUAL(projection->GetSpacing()[1], spacing[second]);
+      ITK_TEST_EXPECT_EQUAL(projection->GetOrigin()[1], origin[second]);
+
+      // Brute-force projection over the full lattice; the first minimum in lattice order wins
+      const ProjectionImageType::SizeType size = projection->GetLargestPossibleRegion().GetSize();
+      ITK_TEST_EXPECT_EQUAL(size[0], image->GetLargestPossibleRegion().GetSize()[first]);
+      ITK_TEST_EXPECT_EQUAL(size[1], image->GetLargestPossibleRegion().GetSize()[second]);
+      std::vector<double>               minimum(size[0] * size[1], 0.0);
+      std::vector<itk::OffsetValueType> offsets(size[0] * size[1], -1);
+      for (itk::SizeValueType sample = 0; sample < numberOfSamples; sample++)
+      {
+        const ImageType::IndexType index = image->ComputeIndex(sample);
+        const itk::SizeValueType   pixel = index[first] + index[second] * size[0];
+        if (offsets[pixel] < 0 || buffer[sample] < minimum[pixel])
+        {
+          minimum[pixel] = buffer[sample];
+          offsets[pixel] = static_cast<itk::OffsetValueType>(sample);
+        }
+      }
+
+      for (itk::SizeValueType pixel = 0; pixel < minimum.size(); pixel++)
+      {
+        if (projection->GetBufferPointer()[pixel] != minimum[pixel] ||
+            argmin->GetBufferPointer()[pixel] != offsets[pixel])
+        {
+          std::cerr << "Projection (" << first << ", " << second << ") differs at pixel " << pixel << std::endl;
+          ++mismatches;
+        }
+      }
+    }
+  }
+  ITK_TEST_EXPECT_EQUAL(mismatches, 0);
+
+  // The argmin locates the remaining parameters of the global minimum
+  const ProjectionImageType * projection = projected->GetProjectionImage(0, 1);
+  const auto *                argmin = projected->GetProjectionArgminImage(0, 1);
+  itk::SizeValueType          best = 0;
+  for (itk::SizeValueType pixel = 1; pixel < projection->GetLargestPossibleRegion().GetNumberOfPixels(); pixel++)
+  {
+    if (projection->GetBufferPointer()[pixel] < projection->GetBufferPointer()[best])
+    {
+      best = pixel;
+    }
+  }
+  ITK_TEST_EXPECT_EQUAL(projection->GetBufferPointer()[best], optimizer->GetMinimumMetricValue());
+  const ObserverType::PointType minimumPosition = projected->ComputePosition(argmin->GetBufferPointer()[best]);
+  for (unsigned int dim = 0; dim < Dimension; dim++)
+  {
+    ITK_TEST_EXPECT_TRUE(std::abs(minimumPosition[dim] - optimizer->GetMinimumMetricValuePosition()[dim]) < 1e-9);
+  }
+
+  std::cout << "Test finished." << std::endl;
+  return EXIT_SUCCESS;
+}
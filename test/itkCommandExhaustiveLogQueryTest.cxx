@@ -0,0 +1,185 @@
+/*=========================================================================
+ *
+ *  Copyright NumFOCUS
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *         https://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *=========================================================================*/
+
+#include "itkCommandExhaustiveLog.h"
+#include "itkExhaustiveOptimizerv4.h"
+#include "itkBSplineInterpolateImageFunction.h"
+#include "itkAnalyticTestMetric.h"
+#include "itkTestingMacros.h"
+
+#include <cmath>
+#include <vector>
+
+namespace
+{
+constexpr unsigned int Dimension = 2;
+
+/** Bilinear surface, reproduced exactly by multilinear interpolation. */
+struct SaddleSurface
+{
+  double height{ 1.0 };
+
+  template <typename TPosition>
+  double
+  operator()(const TPosition & position) const
+  {
+    return height + 2.0 * position[0] - 3.0 * position[1] + 0.5 * position[0] * position[1];
+  }
+};
+
+using SaddleMetric = itk::AnalyticTestMetric<SaddleSurface, Dimension>;
+} // namespace
+
+int
+itkCommandExhaustiveLogQueryTest(int, char *[])
+{
+  using ObserverType = itk::CommandExhaustiveLog<double, Dimension>;
+  using OptimizerType = itk::ExhaustiveOptimizerv4<double>;
+  using InterpolationEnum = ObserverType::InterpolationEnum;
+
+  // Lattice spanning [-1, 1] x [-0.6, 0.6]
+  OptimizerType::StepsType steps(Dimension);
+  steps[0] = 4;
+  steps[1] = 3;
+  OptimizerType::ScalesType scales(Dimension);
+  scales[0] = 0.25;
+  scales[1] = 0.2;
+
+  auto metric = SaddleMetric::New();
+  auto optimizer = OptimizerType::New();
+  optimizer->SetMetric(metric);
+  optimizer->SetNumberOfSteps(steps);
+  optimizer->SetScales(scales);
+
+  auto observer = ObserverType::New();
+  std::vector<double> unanswered(Dimension, 0.0);
+  ITK_TRY_EXPECT_EXCEPTION(observer->GetValues(unanswered));
+  ITK_TEST_EXPECT_TRUE(std::isnan(observer->GetOutsideValue()));
+  ITK_TEST_EXPECT_EQUAL(observer->GetNumberOfQueryWorkUnits(), 1);
+  optimizer->AddObserver(itk::StartEvent(), observer);
+  optimizer->AddObserver(itk::IterationEvent(), observer);
+  ITK_TRY_EXPECT_NO_EXCEPTION(optimizer->StartOptimization());
+
+  // Positions sweeping the lattice hull and beyond, one row per position
+  constexpr itk::SizeValueType numberOfPoints = 30000;
+  std::vector<double>          positions(numberOfPoints * Dimension);
+  for (itk::SizeValueType point = 0; point < numberOfPoints; point++)
+  {
+    positions[point * Dimension] = -1.2 + 2.4 * std::fmod(0.618034 * point, 1.0);
+    positions[point * Dimension + 1] = -0.7 + 1.4 * std::fmod(0.754878 * point, 1.0);
+  }
+
+  const std::vector<double> nearest = observer->GetValues(positions);
+  const std::vector<double> linear = observer->GetValues(positions, InterpolationEnum::Linear);
+  const std::vector<double> bspline = observer->GetValues(positions, InterpolationEnum::BSpline);
+  ITK_TEST_EXPECT_EQUAL(nearest.size(), numberOfPoints);
+
+  // Reference B-spline interpolation of the same samples
+  using InterpolatorType = itk::BSplineInterpolateImageFunction<ObserverType::ImageType, double, double>;
+  auto interpolator = InterpolatorType::New();
+  interpolator->SetSplineOrder(3);
+  interpolator->SetInputImage(observer->GetImage());
+
+  unsigned int mismatches = 0;
+  unsigned int outside = 0;
+  for (itk::SizeValueType point = 0; point < numberOfPoints; point++)
+  {
+    const double * position = &positions[point * Dimension];
+    ObserverType::PointType physicalPoint;
+    physicalPoint[0] = position[0];
+    physicalPoint[1] = position[1];
+
+    const bool insideHull = std::abs(position[0]) <= 1.0 && std::abs(position[1]) <= 0.6;
+    const bool insideNearest = observer->GetDataImage()->GetLargestPossibleRegion().IsInside(
+      observer->GetDataImage()->TransformPhysicalPointToIndex(physicalPoint));
+    if (!insideHull)
+    {
+      ++outside;
+      mismatches += !std::isnan(linear[point]) || !std::isnan(bspline[point]);
+    }
+    else if (std::abs(linear[point] - SaddleSurface{ 1.0 }(position)) > 1e-9 ||
+             std::abs(bspline[point] - interpolator->Evaluate(physicalPoint)) > 1e-9)
+    {
+      std::cerr << "Interpolation differs at " << physicalPoint << std::endl;
+      ++mismatches;
+    }
+
+    if (insideNearest ? nearest[point] != observer->GetValue(physicalPoint) : !std::isnan(nearest[point]))
+    {
+      std::cerr << "Nearest sample differs at " << physicalPoint << std::endl;
+      ++mismatches;
+    }
+  }
+  ITK_TEST_EXPECT_EQUAL(mismatches, 0);
+  ITK_TEST_EXPECT_TRUE(outside > 0 && outside < numberOfPoints);
+
+  // B-spline interpolation passes through the samples
+  std::vector<double> samplePositions;
+  for (itk::OffsetValueType offset = 0; offset < 9 * 7; offset++)
+  {
+    const ObserverType::PointType sample = observer->ComputePosition(offset);
+    samplePositions.push_back(sample[0]);
+    samplePositions.push_back(sample[1]);
+  }
+  const std::vector<double> atSamples = observer->GetValues(samplePositions, InterpolationEnum::BSpline);
+  for (itk::OffsetValueType offset = 0; offset < 9 * 7; offset++)
+  {
+    mismatches += std::abs(atSamples[offset] - observer->GetValueAtOffset(offset)) > 1e-9;
+  }
+  ITK_TEST_EXPECT_EQUAL(mismatches, 0);
+
+  // Split across threads, batches give the same answers
+  observer->SetNumberOfQueryWorkUnits(4);
+  ITK_TEST_SET_GET_VALUE(4, observer->GetNumberOfQueryWorkUnits());
+  observer->SetOutsideValue(-100.0);
+  ITK_TEST_SET_GET_VALUE(-100.0, observer->GetOutsideValue());
+  std::vector<double> threaded(numberOfPoints);
+  observer->GetValues(positions.data(), numberOfPoints, threaded.data(), InterpolationEnum::Linear);
+  for (itk::SizeValueType point = 0; point < numberOfPoints; point++)
+  {
+    mismatches += std::isnan(linear[point]) ? threaded[point] != -100.0 : threaded[point] != linear[point];
+  }
+  ITK_TEST_EXPECT_EQUAL(mismatches, 0);
+
+  // New samples are interpolated once recorded, B-spline coefficients included
+  metric->GetSurface().height = 3.0;
+  ITK_TRY_EXPECT_NO_EXCEPTION(optimizer->StartOptimization());
+  const std::vector<double> raised = observer->GetValues(positions, InterpolationEnum::BSpline);
+  for (itk::SizeValueType point = 0; point < numberOfPoints; point++)
+  {
+    mismatches += std::isnan(bspline[point]) ? raised[point] != -100.0
+                                             : std::abs(raised[point] - bspline[point] - 2.0) > 1e-9;
+  }
+  ITK_TEST_EXPECT_EQUAL(mismatches, 0);
+
+  // Chunked storage gives the same answers
+  observer->UseChunkedStorageOn();
+  metric->GetSurface().height = 1.0;
+  ITK_TRY_EXPECT_NO_EXCEPTION(optimizer->StartOptimization());
+  ITK_TEST_EXPECT_TRUE(observer->GetValues(positions, InterpolationEnum::Linear) == threaded);
+
+  // Rows must be complete, and samples stored
+  positions.pop_back();
+  ITK_TRY_EXPECT_EXCEPTION(observer->GetValues(positions));
+  observer->StoreLatticeOff();
+  ITK_TRY_EXPECT_NO_EXCEPTION(optimizer->StartOptimization());
+  ITK_TRY_EXPECT_EXCEPTION(observer->GetValues(samplePositions));
+
+  std::cout << "Test finished." << std::endl;
+  return EXIT_SUCCESS;
+}
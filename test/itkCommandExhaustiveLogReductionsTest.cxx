@@ -0,0 +1,266 @@
+/*=========================================================================
+ *
+ *  Copyright NumFOCUS
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *         https://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *=========================================================================*/
+
+#include "itkCommandExhaustiveLog.h"
+#include "itkExhaustiveOptimizerv4.h"
+#include "itkParallelExhaustiveSweep.h"
+#include "itkAnalyticTestMetric.h"
+#include "itkTestingMacros.h"
+
+#include <algorithm>
+#include <cmath>
+#include <utility>
+#include <vector>
+
+namespace
+{
+/** Egg-crate surface with many basins of slightly different depths. */
+struct EggCrateSurface
+{
+  double
+  operator()(const itk::OptimizerParameters<double> & parameters) const
+  {
+    return std::sin(parameters[0]) * std::sin(parameters[1]) + 0.01 * parameters[0] + 0.02 * parameters[1];
+  }
+};
+
+using EggCrateMetric = itk::AnalyticTestMetric<EggCrateSurface, 2>;
+} // namespace
+
+int
+itkCommandExhaustiveLogReductionsTest(int, char *[])
+{
+  constexpr unsigned int Dimension = 2;
+  using ObserverType = itk::CommandExhaustiveLog<double, Dimension>;
+  using OptimizerType = itk::ExhaustiveOptimizerv4<double>;
+  using ImageType = ObserverType::ImageType;
+
+  OptimizerType::StepsType steps(Dimension);
+  steps.Fill(12);
+  OptimizerType::ScalesType scales(Dimension);
+  scales.Fill(0.5);
+
+  auto metric = EggCrateMetric::New();
+  auto optimizer = OptimizerType::New();
+  optimizer->SetMetric(metric);
+  optimizer->SetNumberOfSteps(steps);
+  optimizer->SetScales(scales);
+
+  constexpr itk::SizeValueType numberOfMinima = 3;
+  constexpr itk::SizeValueType numberOfBins = 10;
+  constexpr double             histogramMinimum = -1.5;
+  constexpr double             histogramMaximum = 1.5;
+
+  auto observer = ObserverType::New();
+  observer->ComputeStatisticsOn();
+  ITK_TEST_EXPECT_TRUE(observer->GetComputeStatistics());
+  observer->SetNumberOfLocalMinima(numberOfMinima);
+  ITK_TEST_SET_GET_VALUE(numberOfMinima, observer->GetNumberOfLocalMinima());
+  observer->SetLocalMinimaRadius(1);
+  ITK_TEST_SET_GET_VALUE(1, observer->GetLocalMinimaRadius());
+  observer->SetNumberOfHistogramBins(numberOfBins);
+  ITK_TEST_SET_GET_VALUE(numberOfBins, observer->GetNumberOfHistogramBins());
+  observer->SetHistogramMinimum(histogramMinimum);
+  ITK_TEST_SET_GET_VALUE(histogramMinimum, observer->GetHistogramMinimum());
+  observer->SetHistogramMaximum(histogramMaximum);
+  ITK_TEST_SET_GET_VALUE(histogramMaximum, observer->GetHistogramMaximum());
+
+  optimizer->AddObserver(itk::StartEvent(), observer);
+  optimizer->AddObserver(itk::IterationEvent(), observer);
+
+  // Reductions are current on every iteration
+  itk::SizeValueType iterations = 0;
+  unsigned int       staleReads = 0;
+  optimizer->AddObserver(itk::IterationEvent(), [&](const itk::EventObject &) {
+    if (observer->GetNumberOfRecordedSamples() != ++iterations || observer->GetMinimumValue() > observer->GetMean())
+    {
+      ++staleReads;
+    }
+  });
+
+  ITK_TRY_EXPECT_NO_EXCEPTION(optimizer->StartOptimization());
+  ITK_TEST_EXPECT_EQUAL(staleReads, 0);
+
+  // Reference reductions from a full pass over the image
+  const ImageType *         image = observer->GetImage();
+  const double *            buffer = image->GetBufferPointer();
+  const itk::SizeValueType  numberOfSamples = image->GetLargestPossibleRegion().GetNumberOfPixels();
+  const ImageType::SizeType size = image->GetLargestPossibleRegion().GetSize();
+  ITK_TEST_EXPECT_EQUAL(observer->GetNumberOfRecordedSamples(), numberOfSamples);
+
+  const auto minimum = std::min_element(buffer, buffer + numberOfSamples);
+  const auto maximum = std::max_element(buffer, buffer + numberOfSamples);
+  double     sum = 0.0;
+  for (itk::SizeValueType i = 0; i < numberOfSamples; i++)
+  {
+    sum += buffer[i];
+  }
+  const double mean = sum / numberOfSamples;
+  double       sumOfSquares = 0.0;
+  for (itk::SizeValueType i = 0; i < numberOfSamples; i++)
+  {
+    sumOfSquares += (buffer[i] - mean) * (buffer[i] - mean);
+  }
+
+  ITK_TEST_EXPECT_EQUAL(observer->GetMinimumValue(), *minimum);
+  ITK_TEST_EXPECT_EQUAL(observer->GetMaximumValue(), *maximum);
+  ITK_TEST_EXPECT_EQUAL(observer->GetMinimumValue(), optimizer->GetMinimumMetricValue());
+  ITK_TEST_EXPECT_EQUAL(observer->GetMaximumValue(), optimizer->GetMaximumMetricValue());
+  ObserverType::PointType minimumPosition;
+  image->TransformIndexToPhysicalPoint(image->ComputeIndex(minimum - buffer), minimumPosition);
+  ITK_TEST_EXPECT_EQUAL(observer->GetMinimumPosition(), minimumPosition);
+  ITK_TEST_EXPECT_TRUE(std::abs(observer->GetMean() - mean) < 1e-12);
+  ITK_TEST_EXPECT_TRUE(std::abs(observer->GetVariance() - sumOfSquares / numberOfSamples) < 1e-12);
+
+  ObserverType::HistogramType histogram(numberOfBins, 0);
+  for (itk::SizeValueType i = 0; i < numberOfSamples; i++)
+  {
+    const double position = (buffer[i] - histogramMinimum) * (numberOfBins / (histogramMaximum - histogramMinimum));
+    ++histogram[std::min(numberOfBins - 1, static_cast<itk::SizeValueType>(std::max(0.0, position)))];
+  }
+  ITK_TEST_EXPECT_TRUE(observer->GetHistogram() == histogram);
+
+  // Deepest samples lower than their 8 neighbors
+  auto findLocalMinima = [&size](const ImageType * lattice) {
+    const double *                                       samples = lattice->GetBufferPointer();
+    std::vector<std::pair<double, itk::OffsetValueType>> found;
+    for (itk::SizeValueType i = 0; i < lattice->GetLargestPossibleRegion().GetNumberOfPixels(); i++)
+    {
+      const ImageType::IndexType index = lattice->ComputeIndex(i);
+      bool                       isMinimum = true;
+      for (int dy = -1; dy <= 1; dy++)
+      {
+        for (int dx = -1; dx <= 1; dx++)
+        {
+          ImageType::IndexType neighbor = index;
+          neighbor[0] += dx;
+          neighbor[1] += dy;
+          if ((dx != 0 || dy != 0) && neighbor[0] >= 0 && neighbor[1] >= 0 &&
+              neighbor[0] < static_cast<itk::IndexValueType>(size[0]) &&
+              neighbor[1] < static_cast<itk::IndexValueType>(size[1]) && lattice->GetPixel(neighbor) <= samples[i])
+          {
+            isMinimum = false;
+          }
+        }
+      }
+      if (isMinimum)
+      {
+        found.emplace_back(samples[i], static_cast<itk::OffsetValueType>(i));
+      }
+    }
+    std::sort(found.begin(), found.end());
+    return found;
+  };
+  auto countMismatches = [&image](const ObserverType::LocalMinimaContainerType &              minima,
+                                  const std::vector<std::pair<double, itk::OffsetValueType>> & expected) {
+    unsigned int mismatches = 0;
+    for (itk::SizeValueType i = 0; i < std::min<itk::SizeValueType>(minima.size(), expected.size()); i++)
+    {
+      ObserverType::PointType position;
+      image->TransformIndexToPhysicalPoint(image->ComputeIndex(expected[i].second), position);
+      if (minima[i].Value != expected[i].first || minima[i].Offset != expected[i].second ||
+          minima[i].Position != position)
+      {
+        std::cerr << "Local minimum " << i << " is " << minima[i].Value << " at " << minima[i].Position << " but "
+                  << expected[i].first << " at " << position << " was expected" << std::endl;
+        ++mismatches;
+      }
+    }
+    return mismatches;
+  };
+
+  const std::vector<std::pair<double, itk::OffsetValueType>> localMinima = findLocalMinima(image);
+  ITK_TEST_EXPECT_TRUE(localMinima.size() > numberOfMinima);
+
+  const ObserverType::LocalMinimaContainerType minima = observer->GetLocalMinima();
+  ITK_TEST_EXPECT_EQUAL(minima.size(), numberOfMinima);
+  ITK_TEST_EXPECT_EQUAL(countMismatches(minima, localMinima), 0);
+  ITK_TEST_EXPECT_EQUAL(minima[0].Value, observer->GetMinimumValue());
+
+  // Reductions of a parallel sweep, kept by each worker and merged, match the
+  // optimizer pass, and local minima are found in the stored lattice
+  using SweepType = itk::ParallelExhaustiveSweep<double, Dimension>;
+  auto swept = ObserverType::New();
+  swept->ComputeStatisticsOn();
+  swept->SetNumberOfLocalMinima(numberOfMinima);
+  swept->SetNumberOfHistogramBins(numberOfBins);
+  swept->SetHistogramMinimum(histogramMinimum);
+  swept->SetHistogramMaximum(histogramMaximum);
+  swept->ComputeProjectionsOn();
+
+  auto sweep = SweepType::New();
+  for (unsigned int i = 0; i < 4; i++)
+  {
+    sweep->AddMetric(EggCrateMetric::New());
+  }
+  sweep->SetObserver(swept);
+  sweep->SetNumberOfSteps(steps);
+  sweep->SetScales(scales);
+  sweep->SetBlockSize(7);
+  ITK_TRY_EXPECT_NO_EXCEPTION(sweep->StartSweep());
+
+  ITK_TEST_EXPECT_EQUAL(swept->GetNumberOfRecordedSamples(), numberOfSamples);
+  ITK_TEST_EXPECT_EQUAL(swept->GetMinimumValue(), observer->GetMinimumValue());
+  ITK_TEST_EXPECT_EQUAL(swept->GetMaximumValue(), observer->GetMaximumValue());
+  ITK_TEST_EXPECT_EQUAL(swept->GetMinimumPosition(), observer->GetMinimumPosition());
+  ITK_TEST_EXPECT_EQUAL(swept->GetMaximumPosition(), observer->GetMaximumPosition());
+  ITK_TEST_EXPECT_TRUE(std::abs(swept->GetMean() - observer->GetMean()) < 1e-12);
+  ITK_TEST_EXPECT_TRUE(std::abs(swept->GetVariance() - observer->GetVariance()) < 1e-12);
+  ITK_TEST_EXPECT_TRUE(swept->GetHistogram() == observer->GetHistogram());
+  ITK_TEST_EXPECT_EQUAL(countMismatches(swept->GetLocalMinima(), localMinima), 0);
+
+  // With two parameters the only projection is the lattice itself
+  const ObserverType::ProjectionImageType *       projection = swept->GetProjectionImage(0, 1);
+  const ObserverType::ProjectionArgminImageType * argmin = swept->GetProjectionArgminImage(0, 1);
+  unsigned int                                    projectionMismatches = 0;
+  for (itk::SizeValueType i = 0; i < numberOfSamples; i++)
+  {
+    if (projection->GetBufferPointer()[i] != buffer[i] ||
+        argmin->GetBufferPointer()[i] != static_cast<itk::OffsetValueType>(i))
+    {
+      ++projectionMismatches;
+    }
+  }
+  ITK_TEST_EXPECT_EQUAL(projectionMismatches, 0);
+
+  // Samples written directly are included in the statistics and local minima
+  observer->SetValueAtOffset(0, -10.0);
+  ITK_TEST_EXPECT_EQUAL(observer->GetNumberOfRecordedSamples(), numberOfSamples + 1);
+  ITK_TEST_EXPECT_EQUAL(observer->GetMinimumValue(), -10.0);
+  ITK_TEST_EXPECT_EQUAL(observer->GetMinimumPosition(), observer->GetOrigin());
+  const ObserverType::LocalMinimaContainerType rewrittenMinima = observer->GetLocalMinima();
+  ITK_TEST_EXPECT_EQUAL(rewrittenMinima.size(), numberOfMinima);
+  ITK_TEST_EXPECT_EQUAL(rewrittenMinima[0].Value, -10.0);
+  ITK_TEST_EXPECT_EQUAL(rewrittenMinima[0].Offset, 0);
+  ITK_TEST_EXPECT_EQUAL(countMismatches(rewrittenMinima, findLocalMinima(observer->GetImage())), 0);
+
+  // Reductions restart at initialization and are off by default
+  auto plain = ObserverType::New();
+  ITK_TEST_EXPECT_TRUE(!plain->GetComputeStatistics());
+  plain->Initialize(steps, scales);
+  plain->SetValueAtOffset(0, 1.0);
+  ITK_TEST_EXPECT_EQUAL(plain->GetNumberOfRecordedSamples(), 0);
+  ITK_TEST_EXPECT_TRUE(plain->GetLocalMinima().empty());
+  ITK_TEST_EXPECT_TRUE(plain->GetHistogram().empty());
+
+  observer->SetHistogramMaximum(histogramMinimum);
+  ITK_TRY_EXPECT_EXCEPTION(observer->Initialize(steps, scales));
+
+  std::cout << "Test finished." << std::endl;
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,186 @@
+/*=========================================================================
+ *
+ *  Copyright NumFOCUS
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *         https://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *=========================================================================*/
+
+#include "itkCommandExhaustiveLog.h"
+#include "itkExhaustiveOptimizerv4.h"
+#include "itkAnalyticTestMetric.h"
+#include "itkTestingMacros.h"
+
+#include <cmath>
+#include <vector>
+
+namespace
+{
+constexpr unsigned int Dimension = 2;
+
+/** Paraboloid raised by a settable height, standing for successive image pairs. */
+struct RaisedBowlSurface
+{
+  double height{ 0.0 };
+
+  double
+  operator()(const itk::OptimizerParameters<double> & parameters) const
+  {
+    return parameters[0] * parameters[0] + 2.0 * parameters[1] * parameters[1] + height;
+  }
+};
+
+using RaisedBowlMetric = itk::AnalyticTestMetric<RaisedBowlSurface, Dimension>;
+
+using ObserverType = itk::CommandExhaustiveLog<double, Dimension>;
+
+/** Count samples of an image that differ from the bowl at the given height. */
+unsigned int
+CountMismatches(const ObserverType::ImageType * image, double height)
+{
+  unsigned int mismatches = 0;
+  const auto   numberOfSamples = image->GetLargestPossibleRegion().GetNumberOfPixels();
+  for (itk::SizeValueType offset = 0; offset < numberOfSamples; offset++)
+  {
+    ObserverType::PointType position;
+    image->TransformIndexToPhysicalPoint(image->ComputeIndex(offset), position);
+    const double expected = position[0] * position[0] + 2.0 * position[1] * position[1] + height;
+    if (std::abs(image->GetBufferPointer()[offset] - expected) > 1e-12)
+    {
+      ++mismatches;
+    }
+  }
+  return mismatches;
+}
+} // namespace
+
+int
+itkCommandExhaustiveLogReuseTest(int, char *[])
+{
+  using OptimizerType = itk::ExhaustiveOptimizerv4<double>;
+
+  OptimizerType::StepsType steps(Dimension);
+  steps[0] = 3;
+  steps[1] = 2;
+  OptimizerType::ScalesType scales(Dimension);
+  scales.Fill(0.1);
+  constexpr itk::SizeValueType numberOfSamples = 7 * 5;
+
+  auto metric = RaisedBowlMetric::New();
+  auto optimizer = OptimizerType::New();
+  optimizer->SetMetric(metric);
+  optimizer->SetNumberOfSteps(steps);
+  optimizer->SetScales(scales);
+
+  auto observer = ObserverType::New();
+  ITK_TEST_EXPECT_TRUE(observer->GetPixelContainer() == nullptr);
+  ITK_TEST_EXPECT_TRUE(!observer->GetRetainLevels());
+  optimizer->AddObserver(itk::StartEvent(), observer);
+  optimizer->AddObserver(itk::IterationEvent(), observer);
+
+  // Successive pairs over the same lattice refill the same buffer
+  ITK_TRY_EXPECT_NO_EXCEPTION(optimizer->StartOptimization());
+  const double * buffer = observer->GetDataImage()->GetBufferPointer();
+  metric->GetSurface().height = 1.0;
+  ITK_TRY_EXPECT_NO_EXCEPTION(optimizer->StartOptimization());
+  ITK_TEST_EXPECT_EQUAL(observer->GetDataImage()->GetBufferPointer(), buffer);
+  ITK_TEST_EXPECT_EQUAL(CountMismatches(observer->GetDataImage(), 1.0), 0);
+  ITK_TEST_EXPECT_EQUAL(observer->GetNumberOfLevels(), 0);
+
+  // A new center moves the reused lattice
+  ObserverType::PointType center;
+  center[0] = 0.5;
+  center[1] = -0.25;
+  observer->SetCenter(center);
+  ITK_TRY_EXPECT_NO_EXCEPTION(optimizer->StartOptimization());
+  ITK_TEST_EXPECT_EQUAL(observer->GetDataImage()->GetBufferPointer(), buffer);
+  ITK_TEST_EXPECT_TRUE(std::abs(observer->GetOrigin()[0] - 0.2) < 1e-12);
+  center.Fill(0.0);
+  observer->SetCenter(center);
+
+  // An image still held elsewhere keeps its samples
+  const ObserverType::ImagePointer held = observer->GetImage();
+  metric->GetSurface().height = 2.0;
+  ITK_TRY_EXPECT_NO_EXCEPTION(optimizer->StartOptimization());
+  ITK_TEST_EXPECT_TRUE(observer->GetDataImage()->GetBufferPointer() != buffer);
+  ITK_TEST_EXPECT_EQUAL(held->GetBufferPointer(), buffer);
+  ITK_TEST_EXPECT_EQUAL(CountMismatches(observer->GetDataImage(), 2.0), 0);
+
+  // A supplied container receives the lattice in place
+  std::vector<double> memory(numberOfSamples);
+  auto                container = ObserverType::PixelContainerType::New();
+  container->SetImportPointer(memory.data(), memory.size(), false);
+  observer->SetPixelContainer(container);
+  ITK_TEST_EXPECT_EQUAL(observer->GetPixelContainer(), container.GetPointer());
+  ITK_TRY_EXPECT_NO_EXCEPTION(optimizer->StartOptimization());
+  ITK_TEST_EXPECT_EQUAL(observer->GetDataImage()->GetBufferPointer(), memory.data());
+  ITK_TEST_EXPECT_EQUAL(memory[numberOfSamples - 1], observer->GetValueAtOffset(numberOfSamples - 1));
+  ITK_TEST_EXPECT_EQUAL(CountMismatches(observer->GetDataImage(), 2.0), 0);
+
+  // and is grown for a larger lattice
+  steps[1] = 4;
+  optimizer->SetNumberOfSteps(steps);
+  ITK_TRY_EXPECT_NO_EXCEPTION(optimizer->StartOptimization());
+  ITK_TEST_EXPECT_EQUAL(observer->GetDataImage()->GetPixelContainer(), container.GetPointer());
+  ITK_TEST_EXPECT_TRUE(container->Size() >= 7 * 9);
+  ITK_TEST_EXPECT_EQUAL(CountMismatches(observer->GetDataImage(), 2.0), 0);
+  observer->SetPixelContainer(nullptr);
+
+  // Each level of a multi-level run, here one optimization per level, is retained
+  observer->RetainLevelsOn();
+  ITK_TEST_EXPECT_TRUE(observer->GetRetainLevels());
+  constexpr unsigned int numberOfLevels = 3;
+  for (unsigned int level = 0; level < numberOfLevels; level++)
+  {
+    scales.Fill(0.4 / (1 << level));
+    optimizer->SetScales(scales);
+    metric->GetSurface().height = static_cast<double>(level);
+    ITK_TRY_EXPECT_NO_EXCEPTION(optimizer->StartOptimization());
+    ITK_TEST_EXPECT_EQUAL(observer->GetNumberOfLevels(), level + 1);
+  }
+  for (unsigned int level = 0; level < numberOfLevels; level++)
+  {
+    const ObserverType::ImagePointer image = observer->GetLevelImage(level);
+    ITK_TEST_EXPECT_EQUAL(image->GetSpacing()[0], 0.4 / (1 << level));
+    ITK_TEST_EXPECT_EQUAL(CountMismatches(image, static_cast<double>(level)), 0);
+  }
+  ITK_TEST_EXPECT_EQUAL(observer->GetLevelImage(numberOfLevels - 1), observer->GetImage());
+  ITK_TEST_EXPECT_TRUE(observer->GetLevelImage(0)->GetBufferPointer() !=
+                       observer->GetLevelImage(1)->GetBufferPointer());
+  ITK_TRY_EXPECT_EXCEPTION(observer->GetLevelImage(numberOfLevels));
+
+  // A supplied container holds only one of the levels
+  observer->ClearLevels();
+  ITK_TEST_EXPECT_EQUAL(observer->GetNumberOfLevels(), 0);
+  observer->SetPixelContainer(container);
+  ITK_TRY_EXPECT_NO_EXCEPTION(optimizer->StartOptimization());
+  ITK_TRY_EXPECT_NO_EXCEPTION(optimizer->StartOptimization());
+  ITK_TEST_EXPECT_EQUAL(observer->GetNumberOfLevels(), 2);
+  ITK_TEST_EXPECT_EQUAL(observer->GetLevelImage(0)->GetPixelContainer(), container.GetPointer());
+  ITK_TEST_EXPECT_TRUE(observer->GetLevelImage(1)->GetPixelContainer() != container.GetPointer());
+  ITK_TEST_EXPECT_EQUAL(CountMismatches(observer->GetLevelImage(1), 2.0), 0);
+
+  // Chunked levels are materialized when the next level starts
+  observer->ClearLevels();
+  observer->SetPixelContainer(nullptr);
+  observer->UseChunkedStorageOn();
+  ITK_TRY_EXPECT_NO_EXCEPTION(optimizer->StartOptimization());
+  metric->GetSurface().height = 5.0;
+  ITK_TRY_EXPECT_NO_EXCEPTION(optimizer->StartOptimization());
+  ITK_TEST_EXPECT_EQUAL(observer->GetNumberOfLevels(), 2);
+  ITK_TEST_EXPECT_EQUAL(CountMismatches(observer->GetLevelImage(0), 2.0), 0);
+  ITK_TEST_EXPECT_EQUAL(CountMismatches(observer->GetLevelImage(1), 5.0), 0);
+
+  std::cout << "Test finished." << std::endl;
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,229 @@
+/*=========================================================================
+ *
+ *  Copyright NumFOCUS
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *         https://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *=========================================================================*/
+
+#include "itkCommandExhaustiveLog.h"
+#include "itkExhaustiveLogStreamImageSource.h"
+#include "itkTestingMacros.h"
+#include "itkImageFileWriter.h"
+#include "itkImageFileReader.h"
+#include "itkImageRegionConstIteratorWithIndex.h"
+
+#include <cstdint>
+#include <fstream>
+#include <string>
+#include <vector>
+
+int
+itkCommandExhaustiveLogStreamTest(int argc, char * argv[])
+{
+  if (argc < 3)
+  {
+    std::cout << "Usage: OptimizationMonitorTestDriver itkCommandExhaustiveLogStreamTest streamFile outputImage"
+              << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  constexpr unsigned int Dimension = 2;
+  using ObserverType = itk::CommandExhaustiveLog<float, Dimension>;
+  using StreamSourceType = itk::ExhaustiveLogStreamImageSource<float, Dimension>;
+  using OffsetValueType = ObserverType::OffsetValueType;
+
+  ObserverType::StepsType steps(Dimension);
+  steps[0] = 5;
+  steps[1] = 3;
+
+  ObserverType::ScalesType scales(Dimension);
+  scales[0] = 0.5;
+  scales[1] = 2.0;
+
+  ObserverType::PointType center;
+  center[0] = 1.0;
+  center[1] = -4.0;
+
+  const OffsetValueType numberOfSamples = 11 * 7;
+  auto                  expectedValue = [](OffsetValueType offset) { return 0.25f * static_cast<float>(offset); };
+
+  // Record the first samples of a sweep, then stop as if the process crashed
+  {
+    ObserverType::Pointer observer = ObserverType::New();
+    observer->SetCenter(center);
+    observer->SetStreamFileName(argv[1]);
+    ITK_TEST_SET_GET_VALUE(std::string(argv[1]), observer->GetStreamFileName());
+    observer->SetStreamFlushInterval(8);
+    ITK_TEST_SET_GET_VALUE(8, observer->GetStreamFlushInterval());
+    observer->Initialize(steps, scales);
+
+    for (OffsetValueType offset = 0; offset < numberOfSamples; offset += 2)
+    {
+      observer->SetValueAtOffset(offset, expectedValue(offset));
+    }
+    observer->CloseStream();
+  }
+
+  // Simulate a record cut short by the crash
+  {
+    std::ofstream stream(argv[1], std::ios::out | std::ios::binary | std::ios::app);
+    stream.write("xyz", 3);
+  }
+
+  // Resume: written samples are restored and the rest are reported missing
+  ObserverType::Pointer resumed = ObserverType::New();
+  resumed->SetFillValue(-1.0f);
+  resumed->SetStreamFileName(argv[1]);
+  itk::SizeValueType numberOfMissingSamples = 0;
+  ITK_TRY_EXPECT_NO_EXCEPTION(numberOfMissingSamples = resumed->ResumeStream());
+
+  ITK_TEST_EXPECT_EQUAL(resumed->GetSize(0), 11);
+  ITK_TEST_EXPECT_EQUAL(resumed->GetSize(1), 7);
+  ITK_TEST_EXPECT_EQUAL(resumed->GetStepSize()[1], 2.0);
+  ITK_TEST_EXPECT_EQUAL(resumed->GetCenter(), center);
+  ITK_TEST_EXPECT_EQUAL(numberOfMissingSamples, static_cast<itk::SizeValueType>(numberOfSamples / 2));
+
+  unsigned int mismatches = 0;
+  for (OffsetValueType offset = 0; offset < numberOfSamples; offset++)
+  {
+    const float expected = (offset % 2 == 0) ? expectedValue(offset) : -1.0f;
+    if (resumed->GetValue(resumed->GetImage()->ComputeIndex(offset)) != expected)
+    {
+      ++mismatches;
+    }
+  }
+  ITK_TEST_EXPECT_EQUAL(mismatches, 0);
+
+  // Complete the sweep a batch of missing samples at a time; new records go after
+  // the last complete record
+  constexpr itk::SizeValueType batchSize = 5;
+  itk::SizeValueType           numberOfListedSamples = 0;
+  std::vector<OffsetValueType> missing = resumed->GetMissingOffsets(0, batchSize);
+  while (!missing.empty())
+  {
+    ITK_TEST_EXPECT_TRUE(missing.size() <= batchSize);
+    for (const auto offset : missing)
+    {
+      ITK_TEST_EXPECT_TRUE(offset % 2 == 1);
+      resumed->SetValueAtOffset(offset, expectedValue(offset));
+    }
+    numberOfListedSamples += missing.size();
+    missing = resumed->GetMissingOffsets(missing.back() + 1, batchSize);
+  }
+  ITK_TEST_EXPECT_EQUAL(numberOfListedSamples, numberOfMissingSamples);
+  ITK_TEST_EXPECT_EQUAL(resumed->GetMissingOffsets(-3, 1).front(), 1);
+  resumed->CloseStream();
+
+  // Convert the finished stream to an image file
+  StreamSourceType::Pointer source = StreamSourceType::New();
+  ITK_EXERCISE_BASIC_OBJECT_METHODS(source, ExhaustiveLogStreamImageSource, ImageSource);
+  source->SetFileName(argv[1]);
+  source->SetFillValue(-1.0f);
+
+  using WriterType = itk::ImageFileWriter<StreamSourceType::OutputImageType>;
+  WriterType::Pointer writer = WriterType::New();
+  writer->SetInput(source->GetOutput());
+  writer->SetFileName(argv[2]);
+  ITK_TRY_EXPECT_NO_EXCEPTION(writer->Update());
+  ITK_TEST_EXPECT_EQUAL(source->GetNumberOfRecords(), static_cast<itk::SizeValueType>(numberOfSamples));
+
+  auto converted = itk::ReadImage<StreamSourceType::OutputImageType>(argv[2]);
+  ITK_TEST_EXPECT_EQUAL(converted->GetOrigin(), resumed->GetOrigin());
+  ITK_TEST_EXPECT_EQUAL(converted->GetSpacing(), resumed->GetStepSize());
+
+  mismatches = 0;
+  itk::ImageRegionConstIteratorWithIndex<StreamSourceType::OutputImageType> it(
+    converted, converted->GetLargestPossibleRegion());
+  for (it.GoToBegin(); !it.IsAtEnd(); ++it)
+  {
+    if (it.Get() != expectedValue(converted->ComputeOffset(it.GetIndex())))
+    {
+      ++mismatches;
+    }
+  }
+  ITK_TEST_EXPECT_EQUAL(mismatches, 0);
+
+  // Records with offsets outside the lattice, negative once read as signed, are skipped
+  const std::string corruptFileName = std::string(argv[1]) + ".corrupt";
+  {
+    std::ifstream input(argv[1], std::ios::in | std::ios::binary);
+    std::ofstream output(corruptFileName, std::ios::out | std::ios::binary | std::ios::trunc);
+    output << input.rdbuf();
+    for (const std::uint64_t offset : { std::uint64_t{ 1 } << 63, ~std::uint64_t{ 0 },
+                                        static_cast<std::uint64_t>(numberOfSamples) })
+    {
+      const float value = 1e6f;
+      output.write(reinterpret_cast<const char *>(&offset), sizeof(offset));
+      output.write(reinterpret_cast<const char *>(&value), sizeof(value));
+    }
+  }
+  StreamSourceType::Pointer corruptSource = StreamSourceType::New();
+  corruptSource->SetFileName(corruptFileName);
+  ITK_TRY_EXPECT_NO_EXCEPTION(corruptSource->Update());
+  ITK_TEST_EXPECT_EQUAL(corruptSource->GetNumberOfRecords(), static_cast<itk::SizeValueType>(numberOfSamples + 3));
+  mismatches = 0;
+  const float * corruptBuffer = corruptSource->GetOutput()->GetBufferPointer();
+  for (OffsetValueType offset = 0; offset < numberOfSamples; offset++)
+  {
+    if (corruptBuffer[offset] != expectedValue(offset))
+    {
+      ++mismatches;
+    }
+  }
+  ITK_TEST_EXPECT_EQUAL(mismatches, 0);
+
+  // Streams of another value type are rejected
+  using DoubleObserverType = itk::CommandExhaustiveLog<double, Dimension>;
+  DoubleObserverType::Pointer mismatched = DoubleObserverType::New();
+  mismatched->SetStreamFileName(argv[1]);
+  ITK_TRY_EXPECT_EXCEPTION(mismatched->ResumeStream());
+
+  // Initializing a resumed log for the lattice of its stream appends to the stream
+  // rather than recreating it; another lattice is refused until a stream is set
+  const std::string reinitializedFileName = std::string(argv[1]) + ".reinitialized";
+  {
+    std::ifstream input(argv[1], std::ios::in | std::ios::binary);
+    std::ofstream output(reinitializedFileName, std::ios::out | std::ios::binary | std::ios::trunc);
+    output << input.rdbuf();
+  }
+  ObserverType::Pointer reinitialized = ObserverType::New();
+  reinitialized->SetStreamFileName(reinitializedFileName);
+  ITK_TRY_EXPECT_NO_EXCEPTION(reinitialized->ResumeStream());
+  ITK_TRY_EXPECT_NO_EXCEPTION(reinitialized->Initialize(steps, scales));
+  reinitialized->SetValueAtOffset(0, 100.0f);
+  reinitialized->CloseStream();
+
+  StreamSourceType::Pointer appended = StreamSourceType::New();
+  appended->SetFileName(reinitializedFileName);
+  ITK_TRY_EXPECT_NO_EXCEPTION(appended->Update());
+  ITK_TEST_EXPECT_EQUAL(appended->GetNumberOfRecords(), static_cast<itk::SizeValueType>(numberOfSamples + 1));
+  ITK_TEST_EXPECT_EQUAL(appended->GetOutput()->GetBufferPointer()[0], 100.0f);
+  ITK_TEST_EXPECT_EQUAL(appended->GetOutput()->GetBufferPointer()[1], expectedValue(1));
+
+  ObserverType::StepsType otherSteps(Dimension);
+  otherSteps.Fill(2);
+  ITK_TRY_EXPECT_EXCEPTION(reinitialized->Initialize(otherSteps, scales));
+  reinitialized->SetStreamFileName(reinitializedFileName);
+  ITK_TRY_EXPECT_NO_EXCEPTION(reinitialized->Initialize(otherSteps, scales));
+  reinitialized->CloseStream();
+
+  StreamSourceType::Pointer recreated = StreamSourceType::New();
+  recreated->SetFileName(reinitializedFileName);
+  ITK_TRY_EXPECT_NO_EXCEPTION(recreated->Update());
+  ITK_TEST_EXPECT_EQUAL(recreated->GetNumberOfRecords(), 0);
+  ITK_TEST_EXPECT_EQUAL(recreated->GetOutput()->GetLargestPossibleRegion().GetSize(0), 5);
+
+  std::cout << "Test finished." << std::endl;
+  return EXIT_SUCCESS;
+}
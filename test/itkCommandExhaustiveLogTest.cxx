@@ -114,6 +114,10 @@ itkCommandExhaustiveLogTest(int argc, char * argv[])
   optimizer->AddObserver(itk::StartEvent(), observer);
   optimizer->AddObserver(itk::IterationEvent(), observer);
 
+  // An observer that misses the StartEvent ignores the iterations
+  ObserverType::Pointer unstarted = ObserverType::New();
+  optimizer->AddObserver(itk::IterationEvent(), unstarted);
+
   try
   {
     registration->Update();
@@ -130,6 +134,8 @@ itkCommandExhaustiveLogTest(int argc, char * argv[])
     return EXIT_FAILURE;
   }
 
+  ITK_TEST_EXPECT_TRUE(!unstarted->IsInitialized());
+
   // Verify observer parameters were initialized correctly
   ITK_TEST_EXPECT_EQUAL(ObserverType::Dimension, 3);
 
@@ -192,6 +198,43 @@ itkCommandExhaustiveLogTest(int argc, char * argv[])
   ITK_TEST_EXPECT_EQUAL(optimizer->GetMaximumMetricValue(), observer->GetValue(position));
 
 
+  // The lattice follows the step length of the optimizer, so that the log positions
+  // are those the optimizer evaluated
+  TransformType::Pointer halfStepTransform = TransformType::New();
+  halfStepTransform->SetFixedParameters(transform->GetFixedParameters());
+  MetricType::Pointer halfStepMetric = MetricType::New();
+  halfStepMetric->SetFixedImage(fixedImage);
+  halfStepMetric->SetMovingImage(movingImage);
+  halfStepMetric->SetMovingTransform(halfStepTransform);
+  halfStepMetric->Initialize();
+
+  OptimizerType::Pointer halfStep = OptimizerType::New();
+  halfStep->SetMetric(halfStepMetric);
+  halfStep->SetNumberOfSteps(steps);
+  halfStep->SetScales(scales);
+  halfStep->SetStepLength(0.5);
+
+  ObserverType::Pointer halfStepObserver = ObserverType::New();
+  halfStepObserver->SetCenter(center);
+  halfStep->AddObserver(itk::StartEvent(), halfStepObserver);
+  halfStep->AddObserver(itk::IterationEvent(), halfStepObserver);
+  ITK_TRY_EXPECT_NO_EXCEPTION(halfStep->StartOptimization());
+
+  ITK_TEST_EXPECT_EQUAL(halfStepObserver->GetSize(0), 21);
+  ITK_TEST_EXPECT_EQUAL(halfStepObserver->GetStepSize()[0], 0.05);
+  ITK_TEST_EXPECT_EQUAL(halfStepObserver->GetStepSize()[1], 0.5);
+  ITK_TEST_EXPECT_EQUAL(halfStepObserver->GetOrigin()[1], -5.0);
+
+  position[0] = -0.5;
+  position[1] = -5;
+  position[2] = -0.5;
+  index.Fill(0);
+  ITK_TEST_EXPECT_EQUAL(halfStepObserver->GetValue(index), halfStepObserver->GetValue(position));
+  ITK_TEST_EXPECT_EQUAL(halfStep->GetMinimumMetricValue(),
+                        halfStepObserver->GetValue(halfStep->GetMinimumMetricValuePosition()));
+  ITK_TEST_EXPECT_EQUAL(halfStep->GetMaximumMetricValue(),
+                        halfStepObserver->GetValue(halfStep->GetMaximumMetricValuePosition()));
+
   // Write out a 2D data slice for visualization and baseline comparison
   ObserverType::ImagePointer image = observer->GetImage();
 
@@ -0,0 +1,153 @@
+/*=========================================================================
+ *
+ *  Copyright NumFOCUS
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *         https://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *=========================================================================*/
+
+#include "itkCommandExhaustiveLog.h"
+#include "itkExhaustiveOptimizerv4.h"
+#include "itkParallelExhaustiveSweep.h"
+#include "itkAnalyticTestMetric.h"
+#include "itkTestingMacros.h"
+
+#include <chrono>
+#include <cmath>
+
+namespace
+{
+constexpr unsigned int Dimension = 2;
+
+/** Paraboloid whose evaluation takes longer away from the first parameter origin,
+ *  as a metric does when large transforms map samples outside the moving image. */
+struct SlowEdgeSurface
+{
+  double
+  operator()(const itk::OptimizerParameters<double> & parameters) const
+  {
+    // Busy wait of 4 ms at the outermost slices along the first parameter
+    const auto cost = std::chrono::microseconds(static_cast<long>(4000.0 * std::abs(parameters[0])));
+    const auto start = std::chrono::steady_clock::now();
+    while (std::chrono::steady_clock::now() - start < cost)
+    {
+    }
+    return parameters[0] * parameters[0] + parameters[1] * parameters[1];
+  }
+};
+
+using SlowEdgeMetric = itk::AnalyticTestMetric<SlowEdgeSurface, Dimension>;
+} // namespace
+
+int
+itkCommandExhaustiveLogTimingTest(int, char *[])
+{
+  using ObserverType = itk::CommandExhaustiveLog<double, Dimension>;
+  using OptimizerType = itk::ExhaustiveOptimizerv4<double>;
+  using SweepType = itk::ParallelExhaustiveSweep<double, Dimension>;
+
+  // Five slices along the first parameter at -1, -0.5, 0, 0.5 and 1
+  OptimizerType::StepsType steps(Dimension);
+  steps[0] = 2;
+  steps[1] = 1;
+  OptimizerType::ScalesType scales(Dimension);
+  scales[0] = 0.5;
+  scales[1] = 0.25;
+  constexpr itk::SizeValueType numberOfSamples = 5 * 3;
+
+  auto optimizer = OptimizerType::New();
+  optimizer->SetMetric(SlowEdgeMetric::New());
+  optimizer->SetNumberOfSteps(steps);
+  optimizer->SetScales(scales);
+
+  auto observer = ObserverType::New();
+  ITK_TEST_EXPECT_TRUE(!observer->GetRecordTiming());
+  ITK_TEST_EXPECT_EQUAL(observer->GetNumberOfSlowestSamples(), 0);
+  optimizer->AddObserver(itk::StartEvent(), observer);
+  optimizer->AddObserver(itk::IterationEvent(), observer);
+
+  // Nothing is timed by default
+  ITK_TRY_EXPECT_NO_EXCEPTION(optimizer->StartOptimization());
+  ITK_TEST_EXPECT_TRUE(observer->GetTimingImage() == nullptr);
+  ITK_TEST_EXPECT_EQUAL(observer->GetNumberOfTimedSamples(), 0);
+  ITK_TEST_EXPECT_TRUE(observer->GetSlowestSamples().empty());
+  ITK_TEST_EXPECT_TRUE(observer->GetMeanElapsedTimePerSlice(0).empty());
+
+  observer->RecordTimingOn();
+  ITK_TEST_EXPECT_TRUE(observer->GetRecordTiming());
+  observer->SetNumberOfSlowestSamples(3);
+  ITK_TEST_SET_GET_VALUE(3, observer->GetNumberOfSlowestSamples());
+  ITK_TRY_EXPECT_NO_EXCEPTION(optimizer->StartOptimization());
+
+  // The timing image is aligned with the data image and sums to the total
+  const ObserverType::TimingImageType * timing = observer->GetTimingImage();
+  ITK_TEST_EXPECT_TRUE(timing != nullptr);
+  ITK_TEST_EXPECT_EQUAL(timing->GetLargestPossibleRegion(), observer->GetRegion());
+  ITK_TEST_EXPECT_EQUAL(timing->GetSpacing(), observer->GetStepSize());
+  ITK_TEST_EXPECT_EQUAL(timing->GetOrigin(), observer->GetOrigin());
+  ITK_TEST_EXPECT_EQUAL(observer->GetNumberOfTimedSamples(), numberOfSamples);
+  double sum = 0.0;
+  for (itk::SizeValueType offset = 0; offset < numberOfSamples; offset++)
+  {
+    ITK_TEST_EXPECT_TRUE(timing->GetBufferPointer()[offset] > 0.0);
+    sum += timing->GetBufferPointer()[offset];
+  }
+  ITK_TEST_EXPECT_TRUE(std::abs(sum - observer->GetTotalElapsedTime()) < 1e-12);
+
+  // Outer slices along the first parameter cost 4 ms per sample and the center none
+  const std::vector<double> means = observer->GetMeanElapsedTimePerSlice(0);
+  ITK_TEST_EXPECT_EQUAL(means.size(), 5);
+  ITK_TEST_EXPECT_TRUE(means[0] >= 0.004 && means[4] >= 0.004);
+  ITK_TEST_EXPECT_TRUE(means[1] > means[2] && means[3] > means[2]);
+  ITK_TEST_EXPECT_TRUE(means[2] < 0.002);
+  ITK_TEST_EXPECT_EQUAL(observer->GetMeanElapsedTimePerSlice(1).size(), 3);
+  ITK_TRY_EXPECT_EXCEPTION(observer->GetMeanElapsedTimePerSlice(Dimension));
+
+  // The slowest samples come from the outer slices, slowest first
+  const ObserverType::SlowSamplesContainerType slowest = observer->GetSlowestSamples();
+  ITK_TEST_EXPECT_EQUAL(slowest.size(), 3);
+  for (itk::SizeValueType sample = 0; sample < slowest.size(); sample++)
+  {
+    ITK_TEST_EXPECT_EQUAL(std::abs(slowest[sample].Position[0]), 1.0);
+    ITK_TEST_EXPECT_EQUAL(slowest[sample].ElapsedTime, timing->GetBufferPointer()[slowest[sample].Offset]);
+    ITK_TEST_EXPECT_EQUAL(slowest[sample].Position, observer->ComputePosition(slowest[sample].Offset));
+    if (sample > 0)
+    {
+      ITK_TEST_EXPECT_TRUE(slowest[sample].ElapsedTime <= slowest[sample - 1].ElapsedTime);
+    }
+  }
+
+  // A parallel sweep times each evaluation, whatever the order of the workers
+  auto sweep = SweepType::New();
+  sweep->SetObserver(observer);
+  sweep->SetNumberOfSteps(steps);
+  sweep->SetScales(scales);
+  sweep->AddMetric(SlowEdgeMetric::New());
+  sweep->AddMetric(SlowEdgeMetric::New());
+  ITK_TRY_EXPECT_NO_EXCEPTION(sweep->StartSweep());
+  ITK_TEST_EXPECT_EQUAL(observer->GetNumberOfTimedSamples(), numberOfSamples);
+  const std::vector<double> sweepMeans = observer->GetMeanElapsedTimePerSlice(0);
+  ITK_TEST_EXPECT_TRUE(sweepMeans[0] >= 0.004 && sweepMeans[4] >= 0.004);
+  ITK_TEST_EXPECT_TRUE(sweepMeans[2] < 0.002);
+  ITK_TEST_EXPECT_EQUAL(std::abs(observer->GetSlowestSamples().front().Position[0]), 1.0);
+
+  // Timing samples written directly is ignored while timing is off
+  observer->RecordTimingOff();
+  ITK_TRY_EXPECT_NO_EXCEPTION(optimizer->StartOptimization());
+  observer->SetElapsedTimeAtOffset(0, 1.0);
+  ITK_TEST_EXPECT_EQUAL(observer->GetNumberOfTimedSamples(), 0);
+  ITK_TEST_EXPECT_EQUAL(observer->GetTotalElapsedTime(), 0.0);
+
+  std::cout << "Test finished." << std::endl;
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,377 @@
+/*=========================================================================
+ *
+ *  Copyright NumFOCUS
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *         https://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *=========================================================================*/
+
+#include "itkCommandMultiMetricExhaustiveLog.h"
+#include "itkCommandExhaustiveLog.h"
+#include "itkExhaustiveOptimizerv4.h"
+#include "itkAnalyticTestMetric.h"
+#include "itkTestingMacros.h"
+#include "itkTranslationTransform.h"
+
+#include <cmath>
+
+namespace
+{
+constexpr unsigned int Dimension = 2;
+
+/** Translation counting its parameter updates and mapped points. */
+class CountingTransform : public itk::TranslationTransform<double, Dimension>
+{
+public:
+  ITK_DISALLOW_COPY_AND_MOVE(CountingTransform);
+
+  using Self = CountingTransform;
+  using Superclass = itk::TranslationTransform<double, Dimension>;
+  using Pointer = itk::SmartPointer<Self>;
+  itkNewMacro(Self);
+
+  using typename Superclass::InputPointType;
+  using typename Superclass::OutputPointType;
+  using typename Superclass::ParametersType;
+
+  void
+  SetParameters(const ParametersType & parameters) override
+  {
+    ++m_NumberOfParameterUpdates;
+    Superclass::SetParameters(parameters);
+  }
+
+  OutputPointType
+  TransformPoint(const InputPointType & point) const override
+  {
+    ++m_NumberOfMappedPoints;
+    return Superclass::TransformPoint(point);
+  }
+
+  itk::SizeValueType
+  GetNumberOfParameterUpdates() const
+  {
+    return m_NumberOfParameterUpdates;
+  }
+
+  itk::SizeValueType
+  GetNumberOfMappedPoints() const
+  {
+    return m_NumberOfMappedPoints;
+  }
+
+protected:
+  CountingTransform() = default;
+  ~CountingTransform() override = default;
+
+private:
+  itk::SizeValueType         m_NumberOfParameterUpdates{ 0 };
+  mutable itk::SizeValueType m_NumberOfMappedPoints{ 0 };
+};
+
+/** One of several analytic surfaces, standing in for different image metrics. The
+ *  surface is evaluated at the origin mapped by a translation transform, which
+ *  several metrics may share as image metrics share their moving transform. */
+struct TranslatedSurface
+{
+  CountingTransform::Pointer transform{ CountingTransform::New() };
+  unsigned int               surface{ 0 };
+
+  template <typename TPosition>
+  static double
+  Evaluate(const TPosition & position, unsigned int choice)
+  {
+    const double x = position[0];
+    const double y = position[1];
+    switch (choice)
+    {
+      case 0:
+        return x * x + 2.0 * y * y;
+      case 1:
+        return std::cos(x) * std::sin(y);
+      default:
+        return -std::exp(-(x - 0.2) * (x - 0.2) - y * y);
+    }
+  }
+
+  double
+  operator()(const itk::OptimizerParameters<double> &) const
+  {
+    CountingTransform::InputPointType origin;
+    origin.Fill(0.0);
+    return Evaluate(transform->TransformPoint(origin), surface);
+  }
+};
+
+/** Keeps its parameters in the transform of its surface. */
+class SurfaceMetric : public itk::AnalyticTestMetric<TranslatedSurface, Dimension>
+{
+public:
+  ITK_DISALLOW_COPY_AND_MOVE(SurfaceMetric);
+
+  using Self = SurfaceMetric;
+  using Superclass = itk::AnalyticTestMetric<TranslatedSurface, Dimension>;
+  using Pointer = itk::SmartPointer<Self>;
+  itkNewMacro(Self);
+
+  using typename Superclass::ParametersType;
+
+  void
+  SetParameters(ParametersType & parameters) override
+  {
+    GetSurface().transform->SetParameters(parameters);
+  }
+
+  const ParametersType &
+  GetParameters() const override
+  {
+    return GetSurface().transform->GetParameters();
+  }
+
+protected:
+  SurfaceMetric() = default;
+  ~SurfaceMetric() override = default;
+};
+} // namespace
+
+int
+itkCommandMultiMetricExhaustiveLogTest(int, char *[])
+{
+  using ObserverType = itk::CommandMultiMetricExhaustiveLog<double, Dimension>;
+  using OptimizerType = itk::ExhaustiveOptimizerv4<double>;
+  using ScalarLogType = itk::CommandExhaustiveLog<double, Dimension>;
+  constexpr unsigned int numberOfChannels = 3;
+
+  auto observer = ObserverType::New();
+  ITK_EXERCISE_BASIC_OBJECT_METHODS(observer, CommandMultiMetricExhaustiveLog, Command);
+  ITK_TEST_EXPECT_TRUE(!observer->IsInitialized());
+  ITK_TEST_EXPECT_EQUAL(observer->GetNumberOfChannels(), 0);
+  ITK_TEST_EXPECT_TRUE(observer->GetChannelLayout() == ObserverType::ChannelLayoutEnum::Interleaved);
+  ITK_TRY_EXPECT_EXCEPTION(observer->GetImage());
+  ITK_TRY_EXPECT_EXCEPTION(observer->AddMetric(nullptr));
+
+  // The optimizer metric fills channel 0 and the added metrics the following ones
+  SurfaceMetric::Pointer metrics[numberOfChannels];
+  for (unsigned int channel = 0; channel < numberOfChannels; channel++)
+  {
+    metrics[channel] = SurfaceMetric::New();
+    metrics[channel]->GetSurface().surface = channel;
+  }
+  for (unsigned int channel = 1; channel < numberOfChannels; channel++)
+  {
+    observer->AddMetric(metrics[channel]);
+  }
+  ITK_TEST_EXPECT_EQUAL(observer->GetNumberOfMetrics(), numberOfChannels - 1);
+
+  OptimizerType::StepsType steps(Dimension);
+  steps[0] = 4;
+  steps[1] = 3;
+  OptimizerType::ScalesType scales(Dimension);
+  scales[0] = 0.1;
+  scales[1] = 0.25;
+  ObserverType::PointType center;
+  center[0] = 0.1;
+  center[1] = -0.2;
+  OptimizerType::ParametersType initial(Dimension);
+  initial[0] = center[0];
+  initial[1] = center[1];
+
+  auto optimizer = OptimizerType::New();
+  metrics[0]->SetParameters(initial);
+  optimizer->SetMetric(metrics[0]);
+  optimizer->SetNumberOfSteps(steps);
+  optimizer->SetScales(scales);
+  optimizer->AddObserver(itk::StartEvent(), observer);
+  optimizer->AddObserver(itk::IterationEvent(), observer);
+
+  // A scalar log of the same sweep for reference
+  auto scalar = ScalarLogType::New();
+  scalar->SetCenter(center);
+  optimizer->AddObserver(itk::StartEvent(), scalar);
+  optimizer->AddObserver(itk::IterationEvent(), scalar);
+
+  observer->SetCenter(center);
+  ITK_TEST_SET_GET_VALUE(center, observer->GetCenter());
+  observer->SetFillValue(-1.0);
+  ITK_TEST_SET_GET_VALUE(-1.0, observer->GetFillValue());
+
+  for (const auto layout : { ObserverType::ChannelLayoutEnum::Interleaved, ObserverType::ChannelLayoutEnum::Planar })
+  {
+    observer->SetChannelLayout(layout);
+    ITK_TEST_EXPECT_TRUE(observer->GetChannelLayout() == layout);
+    ITK_TRY_EXPECT_NO_EXCEPTION(optimizer->StartOptimization());
+
+    ITK_TEST_EXPECT_TRUE(observer->IsInitialized());
+    ITK_TEST_EXPECT_EQUAL(observer->GetNumberOfChannels(), numberOfChannels);
+    ITK_TEST_EXPECT_EQUAL(observer->GetNumberOfSamples(), 9 * 7);
+    ITK_TEST_EXPECT_EQUAL(observer->GetRegion(), scalar->GetRegion());
+    for (unsigned int dim = 0; dim < Dimension; dim++)
+    {
+      ITK_TEST_EXPECT_EQUAL(observer->GetOrigin()[dim], scalar->GetOrigin()[dim]);
+      ITK_TEST_EXPECT_EQUAL(observer->GetStepSize()[dim], scalar->GetStepSize()[dim]);
+    }
+
+    // Each added metric is evaluated once per sample during the single sweep
+    for (unsigned int channel = 1; channel < numberOfChannels; channel++)
+    {
+      ITK_TEST_EXPECT_EQUAL(metrics[channel]->GetNumberOfEvaluations(), observer->GetNumberOfSamples());
+      ITK_TEST_EXPECT_EQUAL(metrics[channel]->GetSurface().transform->GetNumberOfParameterUpdates(),
+                            observer->GetNumberOfSamples());
+    }
+
+    // Every channel holds its metric at the sample position, in all views
+    const ObserverType::VectorImagePointer image = observer->GetImage();
+    unsigned int                           mismatches = 0;
+    const auto numberOfSamples = static_cast<itk::OffsetValueType>(observer->GetNumberOfSamples());
+    for (itk::OffsetValueType offset = 0; offset < numberOfSamples; offset++)
+    {
+      const ObserverType::PointType position = observer->ComputePosition(offset);
+      const ObserverType::IndexType index = image->ComputeIndex(offset);
+      const ObserverType::PixelType pixel = observer->GetPixel(index);
+      const ObserverType::PixelType imagePixel = image->GetPixel(index);
+      if (observer->GetValueAtOffset(offset, 0) != scalar->GetValueAtOffset(offset))
+      {
+        ++mismatches;
+      }
+      for (unsigned int channel = 0; channel < numberOfChannels; channel++)
+      {
+        const double value = observer->GetValueAtOffset(offset, channel);
+        if (std::abs(value - TranslatedSurface::Evaluate(position, channel)) > 1e-12 ||
+            observer->GetValue(index, channel) != value || observer->GetValue(position, channel) != value ||
+            pixel[channel] != value || imagePixel[channel] != value ||
+            observer->GetChannelImage(channel)->GetPixel(index) != value)
+        {
+          std::cerr << "Mismatch at offset " << offset << " in channel " << channel << std::endl;
+          ++mismatches;
+        }
+      }
+    }
+    ITK_TEST_EXPECT_EQUAL(mismatches, 0);
+    ITK_TEST_EXPECT_EQUAL(observer->GetValue(optimizer->GetMinimumMetricValuePosition(), 0),
+                          optimizer->GetMinimumMetricValue());
+
+    // The stored layout is shared without a copy, the other one is assembled
+    if (layout == ObserverType::ChannelLayoutEnum::Interleaved)
+    {
+      ITK_TEST_EXPECT_EQUAL(observer->GetImage().GetPointer(), image.GetPointer());
+      ITK_TEST_EXPECT_TRUE(observer->GetChannelImage(1) != observer->GetChannelImage(1));
+    }
+    else
+    {
+      ITK_TEST_EXPECT_TRUE(observer->GetImage() != image);
+      ITK_TEST_EXPECT_EQUAL(observer->GetChannelImage(1).GetPointer(), observer->GetChannelImage(1).GetPointer());
+    }
+    ITK_TEST_EXPECT_EQUAL(image->GetNumberOfComponentsPerPixel(), numberOfChannels);
+    ITK_TEST_EXPECT_EQUAL(image->GetSpacing()[1], scales[1]);
+
+    // Out of range channels and positions are refused
+    ObserverType::IndexType outside;
+    outside.Fill(0);
+    outside[1] = 7;
+    ITK_TRY_EXPECT_EXCEPTION(observer->GetValue(outside, 0));
+    ITK_TRY_EXPECT_EXCEPTION(observer->GetValue(image->ComputeIndex(0), numberOfChannels));
+    ITK_TRY_EXPECT_EXCEPTION(observer->GetChannelImage(numberOfChannels));
+    ObserverType::PointType distant = center;
+    distant[0] += 10.0;
+    ITK_TRY_EXPECT_EXCEPTION(observer->GetValue(distant, 1));
+    ITK_TRY_EXPECT_EXCEPTION(observer->GetValue(OptimizerType::ParametersType(Dimension + 1), 1));
+
+    // Fresh metrics restart the evaluation counts for the next layout
+    for (unsigned int channel = 1; channel < numberOfChannels; channel++)
+    {
+      metrics[channel] = SurfaceMetric::New();
+      metrics[channel]->GetSurface().surface = channel;
+    }
+    observer->ClearMetrics();
+    for (unsigned int channel = 1; channel < numberOfChannels; channel++)
+    {
+      observer->AddMetric(metrics[channel]);
+    }
+  }
+
+  // Metrics sharing the transform of the optimizer metric find it moved, so the sweep
+  // sets its parameters no more often than without them; each metric maps its point
+  // once per sample
+  auto sharedTransform = CountingTransform::New();
+  metrics[0]->GetSurface().transform = sharedTransform;
+  observer->ClearMetrics();
+  metrics[0]->SetParameters(initial);
+  itk::SizeValueType parameterUpdates = sharedTransform->GetNumberOfParameterUpdates();
+  itk::SizeValueType mappedPoints = sharedTransform->GetNumberOfMappedPoints();
+  ITK_TRY_EXPECT_NO_EXCEPTION(optimizer->StartOptimization());
+  const itk::SizeValueType optimizerParameterUpdates =
+    sharedTransform->GetNumberOfParameterUpdates() - parameterUpdates;
+  const itk::SizeValueType optimizerMappedPoints = sharedTransform->GetNumberOfMappedPoints() - mappedPoints;
+  ITK_TEST_EXPECT_EQUAL(optimizerMappedPoints, observer->GetNumberOfSamples());
+
+  for (unsigned int channel = 1; channel < numberOfChannels; channel++)
+  {
+    metrics[channel] = SurfaceMetric::New();
+    metrics[channel]->GetSurface().surface = channel;
+    metrics[channel]->GetSurface().transform = sharedTransform;
+    observer->AddMetric(metrics[channel]);
+  }
+  metrics[0]->SetParameters(initial);
+  parameterUpdates = sharedTransform->GetNumberOfParameterUpdates();
+  mappedPoints = sharedTransform->GetNumberOfMappedPoints();
+  ITK_TRY_EXPECT_NO_EXCEPTION(optimizer->StartOptimization());
+  ITK_TEST_EXPECT_EQUAL(sharedTransform->GetNumberOfParameterUpdates() - parameterUpdates, optimizerParameterUpdates);
+  ITK_TEST_EXPECT_EQUAL(sharedTransform->GetNumberOfMappedPoints() - mappedPoints,
+                        numberOfChannels * optimizerMappedPoints);
+  unsigned int sharedMismatches = 0;
+  for (itk::OffsetValueType offset = 0; offset < static_cast<itk::OffsetValueType>(observer->GetNumberOfSamples());
+       offset++)
+  {
+    for (unsigned int channel = 0; channel < numberOfChannels; channel++)
+    {
+      if (std::abs(observer->GetValueAtOffset(offset, channel) -
+                   TranslatedSurface::Evaluate(observer->ComputePosition(offset), channel)) > 1e-12)
+      {
+        ++sharedMismatches;
+      }
+    }
+  }
+  ITK_TEST_EXPECT_EQUAL(sharedMismatches, 0);
+
+  // Metrics with their own transform are given back their parameters on EndEvent,
+  // while those sharing the optimizer transform are left to the optimizer
+  auto                          independent = SurfaceMetric::New();
+  OptimizerType::ParametersType home(Dimension);
+  home[0] = 3.0;
+  home[1] = -2.0;
+  independent->SetParameters(home);
+  observer->AddMetric(independent);
+  optimizer->AddObserver(itk::EndEvent(), observer);
+  metrics[0]->SetParameters(initial);
+  parameterUpdates = sharedTransform->GetNumberOfParameterUpdates();
+  ITK_TRY_EXPECT_NO_EXCEPTION(optimizer->StartOptimization());
+  ITK_TEST_EXPECT_EQUAL(independent->GetParameters(), home);
+  ITK_TEST_EXPECT_EQUAL(independent->GetSurface().transform->GetNumberOfParameterUpdates(),
+                        observer->GetNumberOfSamples() + 2);
+  ITK_TEST_EXPECT_EQUAL(sharedTransform->GetNumberOfParameterUpdates() - parameterUpdates, optimizerParameterUpdates);
+
+  // Unwritten samples hold the fill value, and the channels follow the metrics
+  observer->ClearMetrics();
+  ITK_TEST_EXPECT_EQUAL(observer->GetNumberOfMetrics(), 0);
+  observer->Initialize(steps, scales);
+  ITK_TEST_EXPECT_EQUAL(observer->GetNumberOfChannels(), 1);
+  ITK_TEST_EXPECT_EQUAL(observer->GetValueAtOffset(5, 0), -1.0);
+  observer->SetValueAtOffset(5, 0, 2.5);
+  ITK_TEST_EXPECT_EQUAL(observer->GetChannelImage(0)->GetBufferPointer()[5], 2.5);
+
+  // Steps and scales must match the dimension of the lattice
+  ITK_TRY_EXPECT_EXCEPTION(observer->Initialize(OptimizerType::StepsType(3), OptimizerType::ScalesType(3)));
+
+  std::cout << "Test finished." << std::endl;
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,269 @@
+/*=========================================================================
+ *
+ *  Copyright NumFOCUS
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *         https://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *=========================================================================*/
+
+#include "itkCommandTrajectoryLog.h"
+#include "itkCommandExhaustiveLog.h"
+#include "itkGradientDescentOptimizerv4.h"
+#include "itkLBFGSOptimizerv4.h"
+#include "itkRegularStepGradientDescentOptimizerv4.h"
+#include "itkAnalyticTestMetric.h"
+#include "itkTestingMacros.h"
+
+#include <cmath>
+#include <vector>
+
+namespace
+{
+constexpr unsigned int Dimension = 2;
+
+/** Elliptic bowl with its minimum at (0.3, -0.2). */
+struct BowlSurface
+{
+  double
+  operator()(const itk::OptimizerParameters<double> & parameters) const
+  {
+    const double x = parameters[0] - 0.3;
+    const double y = parameters[1] + 0.2;
+    return x * x + 2.0 * y * y;
+  }
+};
+
+/** The bowl with its derivative, starting gradient optimizers at (-0.6, 0.7). */
+class BowlMetric : public itk::AnalyticTestMetric<BowlSurface, Dimension>
+{
+public:
+  ITK_DISALLOW_COPY_AND_MOVE(BowlMetric);
+
+  using Self = BowlMetric;
+  using Superclass = itk::AnalyticTestMetric<BowlSurface, Dimension>;
+  using Pointer = itk::SmartPointer<Self>;
+  itkNewMacro(Self);
+
+  using typename Superclass::DerivativeType;
+  using typename Superclass::ParametersType;
+  using typename Superclass::ParametersValueType;
+
+  /** Norm of the gradient at a position. */
+  static double
+  ComputeGradientNorm(const ParametersType & position)
+  {
+    const double dx = 2.0 * (position[0] - 0.3);
+    const double dy = 4.0 * (position[1] + 0.2);
+    return std::sqrt(dx * dx + dy * dy);
+  }
+
+  // As for image metrics, the derivative points downhill
+  void
+  GetDerivative(DerivativeType & derivative) const override
+  {
+    derivative.SetSize(Dimension);
+    derivative[0] = -2.0 * (m_Parameters[0] - 0.3);
+    derivative[1] = -4.0 * (m_Parameters[1] + 0.2);
+  }
+
+  void
+  UpdateTransformParameters(const DerivativeType & update, ParametersValueType factor) override
+  {
+    for (unsigned int i = 0; i < Dimension; i++)
+    {
+      m_Parameters[i] += update[i] * factor;
+    }
+  }
+
+  void
+  Reset()
+  {
+    m_Parameters[0] = -0.6;
+    m_Parameters[1] = 0.7;
+  }
+
+protected:
+  BowlMetric() { Reset(); }
+  ~BowlMetric() override = default;
+};
+} // namespace
+
+int
+itkCommandTrajectoryLogTest(int, char *[])
+{
+  using OptimizerType = itk::GradientDescentOptimizerv4Template<double>;
+  using TrajectoryType = itk::CommandTrajectoryLog<OptimizerType>;
+  using LogType = itk::CommandExhaustiveLog<double, Dimension>;
+
+  auto trajectory = TrajectoryType::New();
+  ITK_EXERCISE_BASIC_OBJECT_METHODS(trajectory, CommandTrajectoryLog, Command);
+  ITK_TEST_EXPECT_EQUAL(trajectory->GetCapacity(), 1024);
+  constexpr itk::SizeValueType capacity = 16;
+  trajectory->SetCapacity(capacity);
+  ITK_TEST_SET_GET_VALUE(capacity, trajectory->GetCapacity());
+
+  auto metric = BowlMetric::New();
+  auto optimizer = OptimizerType::New();
+  optimizer->SetMetric(metric);
+  optimizer->SetLearningRate(0.1);
+  optimizer->SetNumberOfIterations(40);
+  optimizer->SetConvergenceWindowSize(50);
+  optimizer->AddObserver(itk::StartEvent(), trajectory);
+  optimizer->AddObserver(itk::IterationEvent(), trajectory);
+
+  // Ad-hoc observer recording the same fields after the trajectory log, the position
+  // being that reached by the step of each iteration
+  std::vector<double>                        values;
+  std::vector<OptimizerType::ParametersType> positions;
+  optimizer->AddObserver(itk::IterationEvent(), [&](const itk::EventObject &) {
+    values.push_back(optimizer->GetValue());
+    positions.push_back(optimizer->GetCurrentPosition());
+  });
+
+  ITK_TRY_EXPECT_NO_EXCEPTION(optimizer->StartOptimization());
+
+  const itk::SizeValueType numberOfIterations = values.size();
+  ITK_TEST_EXPECT_EQUAL(numberOfIterations, 40);
+  ITK_TEST_EXPECT_EQUAL(trajectory->GetNumberOfIterations(), numberOfIterations);
+  ITK_TEST_EXPECT_EQUAL(trajectory->GetNumberOfRecords(), capacity);
+  ITK_TEST_EXPECT_EQUAL(trajectory->GetNumberOfParameters(), Dimension);
+  ITK_TEST_EXPECT_EQUAL(trajectory->GetFirstSlot(), numberOfIterations % capacity);
+
+  // The ring holds the last iterations, oldest first. Each record holds the position
+  // the step of its iteration started from, with the value and gradient norm of the
+  // metric there rather than those of the step.
+  unsigned int mismatches = 0;
+  for (itk::SizeValueType record = 0; record < capacity; record++)
+  {
+    const itk::SizeValueType            iteration = numberOfIterations - capacity + record;
+    const itk::SizeValueType            slot = trajectory->GetSlot(record);
+    const OptimizerType::ParametersType position = trajectory->GetPosition(record);
+    const double                        gradientNorm = BowlMetric::ComputeGradientNorm(position);
+    if (trajectory->GetValue(record) != values[iteration] || trajectory->GetValueBuffer()[slot] != values[iteration] ||
+        trajectory->GetValue(record) != BowlSurface{}(position) || trajectory->GetLearningRate(record) != 0.1 ||
+        std::abs(trajectory->GetGradientNorm(record) - gradientNorm) > 1e-12 * gradientNorm ||
+        trajectory->GetGradientNormBuffer()[slot] != trajectory->GetGradientNorm(record) ||
+        position != positions[iteration - 1] || trajectory->GetParameterBuffer(1)[slot] != positions[iteration - 1][1])
+    {
+      std::cerr << "Record " << record << " differs from iteration " << iteration << std::endl;
+      ++mismatches;
+    }
+  }
+  ITK_TEST_EXPECT_EQUAL(mismatches, 0);
+  ITK_TEST_EXPECT_TRUE(trajectory->GetValue(capacity - 1) < trajectory->GetValue(0));
+  ITK_TRY_EXPECT_EXCEPTION(trajectory->GetParameterBuffer(Dimension));
+
+  // A second run reuses the buffers in place
+  const double * valueBuffer = trajectory->GetValueBuffer();
+  const double * parameterBuffer = trajectory->GetParameterBuffer(0);
+  optimizer->SetNumberOfIterations(5);
+  metric->Reset();
+  values.clear();
+  positions.clear();
+  ITK_TRY_EXPECT_NO_EXCEPTION(optimizer->StartOptimization());
+  ITK_TEST_EXPECT_EQUAL(trajectory->GetNumberOfIterations(), 5);
+  ITK_TEST_EXPECT_EQUAL(trajectory->GetNumberOfRecords(), 5);
+  ITK_TEST_EXPECT_EQUAL(trajectory->GetFirstSlot(), 0);
+  ITK_TEST_EXPECT_EQUAL(trajectory->GetValueBuffer(), valueBuffer);
+  ITK_TEST_EXPECT_EQUAL(trajectory->GetParameterBuffer(0), parameterBuffer);
+  ITK_TEST_EXPECT_EQUAL(trajectory->GetValue(4), values[4]);
+
+  // The first record is the starting position
+  ITK_TEST_EXPECT_EQUAL(trajectory->GetPosition(0)[0], -0.6);
+  ITK_TEST_EXPECT_EQUAL(trajectory->GetPosition(0)[1], 0.7);
+  ITK_TEST_EXPECT_EQUAL(trajectory->GetValue(0), BowlSurface{}(trajectory->GetPosition(0)));
+
+  // Regular step gradient descent normalizes its gradient, which leaves no gradient
+  // norm to recover
+  using RegularStepOptimizerType = itk::RegularStepGradientDescentOptimizerv4<double>;
+  auto regularStep = RegularStepOptimizerType::New();
+  auto regularStepTrajectory = TrajectoryType::New();
+  metric->Reset();
+  regularStep->SetMetric(metric);
+  regularStep->SetLearningRate(0.1);
+  regularStep->SetNumberOfIterations(5);
+  regularStep->AddObserver(itk::StartEvent(), regularStepTrajectory);
+  regularStep->AddObserver(itk::IterationEvent(), regularStepTrajectory);
+  ITK_TRY_EXPECT_NO_EXCEPTION(regularStep->StartOptimization());
+  ITK_TEST_EXPECT_TRUE(regularStepTrajectory->GetNumberOfRecords() > 0);
+  ITK_TEST_EXPECT_TRUE(std::isnan(regularStepTrajectory->GetGradientNorm(0)));
+
+  // Positions map onto the nearest sample of an exhaustive log
+  LogType::PointType center;
+  center.Fill(0.0);
+  LogType::StepsType steps(Dimension);
+  steps.Fill(10);
+  LogType::ScalesType scales(Dimension);
+  scales.Fill(0.1);
+  LogType::IndexType index;
+  auto               log = LogType::New();
+  ITK_TRY_EXPECT_EXCEPTION(trajectory->ComputeLogIndex(0, log.GetPointer(), index));
+  log->SetCenter(center);
+  log->Initialize(steps, scales);
+
+  for (itk::SizeValueType record = 0; record < trajectory->GetNumberOfRecords(); record++)
+  {
+    ITK_TEST_EXPECT_TRUE(trajectory->ComputeLogIndex(record, log.GetPointer(), index));
+    const LogType::PointType            sample = log->ComputePosition(log->GetDataImage()->ComputeOffset(index));
+    const OptimizerType::ParametersType position = trajectory->GetPosition(record);
+    for (unsigned int dim = 0; dim < Dimension; dim++)
+    {
+      ITK_TEST_EXPECT_TRUE(std::abs(sample[dim] - position[dim]) <= 0.05 + 1e-12);
+    }
+  }
+  ITK_TRY_EXPECT_EXCEPTION(trajectory->ComputeLogIndex(5, log.GetPointer(), index));
+
+  // Positions outside the lattice do not map
+  center[0] = 5.0;
+  auto distant = LogType::New();
+  distant->SetCenter(center);
+  distant->Initialize(steps, scales);
+  ITK_TEST_EXPECT_TRUE(!trajectory->ComputeLogIndex(0, distant.GetPointer(), index));
+
+  auto volume = itk::CommandExhaustiveLog<double, 3>::New();
+  LogType::StepsType volumeSteps(3);
+  volumeSteps.Fill(1);
+  LogType::ScalesType volumeScales(3);
+  volumeScales.Fill(1.0);
+  volume->Initialize(volumeSteps, volumeScales);
+  itk::CommandExhaustiveLog<double, 3>::IndexType volumeIndex;
+  ITK_TRY_EXPECT_EXCEPTION(trajectory->ComputeLogIndex(0, volume.GetPointer(), volumeIndex));
+
+  // Optimizers without a learning rate record NaN, and vnl-based ones report their
+  // cached derivative
+  using LBFGSOptimizerType = itk::LBFGSOptimizerv4Template<double>;
+  auto lbfgsTrajectory = itk::CommandTrajectoryLog<LBFGSOptimizerType>::New();
+  auto lbfgs = LBFGSOptimizerType::New();
+  metric->Reset();
+  lbfgs->SetMetric(metric);
+  lbfgs->SetNumberOfIterations(20);
+  lbfgs->AddObserver(itk::StartEvent(), lbfgsTrajectory);
+  lbfgs->AddObserver(itk::IterationEvent(), lbfgsTrajectory);
+  ITK_TRY_EXPECT_NO_EXCEPTION(lbfgs->StartOptimization());
+
+  ITK_TEST_EXPECT_TRUE(lbfgsTrajectory->GetNumberOfRecords() > 0);
+  const itk::SizeValueType last = lbfgsTrajectory->GetNumberOfRecords() - 1;
+  ITK_TEST_EXPECT_TRUE(std::isnan(lbfgsTrajectory->GetLearningRate(last)));
+  ITK_TEST_EXPECT_TRUE(std::isfinite(lbfgsTrajectory->GetGradientNorm(last)));
+  ITK_TEST_EXPECT_TRUE(std::abs(lbfgsTrajectory->GetPosition(last)[0] - 0.3) < 1e-3);
+
+  // Observing an optimizer of another type records nothing
+  auto mismatched = TrajectoryType::New();
+  lbfgs->AddObserver(itk::IterationEvent(), mismatched);
+  metric->Reset();
+  ITK_TRY_EXPECT_NO_EXCEPTION(lbfgs->StartOptimization());
+  ITK_TEST_EXPECT_EQUAL(mismatched->GetNumberOfIterations(), 0);
+
+  std::cout << "Test finished." << std::endl;
+  return EXIT_SUCCESS;
+}
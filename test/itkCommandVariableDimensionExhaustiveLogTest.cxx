@@ -0,0 +1,178 @@
+/*=========================================================================
+ *
+ *  Copyright NumFOCUS
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *         https://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *=========================================================================*/
+
+#include "itkCommandVariableDimensionExhaustiveLog.h"
+#include "itkCommandExhaustiveLog.h"
+#include "itkExhaustiveOptimizerv4.h"
+#include "itkAnalyticTestMetric.h"
+#include "itkTestingMacros.h"
+
+#include <cmath>
+
+namespace
+{
+/** Smooth surface over any number of parameters, coupling neighbors. */
+struct ChainSurface
+{
+  double
+  operator()(const itk::OptimizerParameters<double> & parameters) const
+  {
+    const unsigned int n = parameters.Size();
+    double             value = 0.0;
+    for (unsigned int i = 0; i < n; i++)
+    {
+      value += std::sin((i + 1) * parameters[i]) + 0.1 * parameters[i] * parameters[(i + 1) % n];
+    }
+    return value;
+  }
+};
+
+/** Takes its number of parameters from the position it is given. */
+using ChainMetric = itk::AnalyticTestMetric<ChainSurface>;
+} // namespace
+
+int
+itkCommandVariableDimensionExhaustiveLogTest(int, char *[])
+{
+  using ObserverType = itk::CommandVariableDimensionExhaustiveLog<double>;
+  using OptimizerType = itk::ExhaustiveOptimizerv4<double>;
+
+  auto observer = ObserverType::New();
+  ITK_EXERCISE_BASIC_OBJECT_METHODS(observer, CommandVariableDimensionExhaustiveLog, Command);
+  ITK_TEST_EXPECT_TRUE(!observer->IsInitialized());
+  ITK_TEST_EXPECT_EQUAL(observer->GetDimension(), 0);
+
+  // Six parameters, as for an Euler3DTransform
+  constexpr unsigned int       dimension = 6;
+  OptimizerType::StepsType     steps(dimension);
+  OptimizerType::ScalesType    scales(dimension);
+  ObserverType::ParametersType center(dimension);
+  for (unsigned int dim = 0; dim < dimension; dim++)
+  {
+    steps[dim] = 1 + dim % 2;
+    scales[dim] = 0.1 * (dim + 1);
+    center[dim] = 0.05 * dim;
+  }
+
+  auto metric = ChainMetric::New();
+  metric->SetParameters(center);
+  auto optimizer = OptimizerType::New();
+  optimizer->SetMetric(metric);
+  optimizer->SetNumberOfSteps(steps);
+  optimizer->SetScales(scales);
+
+  observer->SetCenter(center);
+  ITK_TEST_SET_GET_VALUE(center, observer->GetCenter());
+  observer->SetFillValue(-1.0);
+  ITK_TEST_SET_GET_VALUE(-1.0, observer->GetFillValue());
+  optimizer->AddObserver(itk::StartEvent(), observer);
+  optimizer->AddObserver(itk::IterationEvent(), observer);
+
+  // An observer that misses the StartEvent ignores the iterations
+  auto unstarted = ObserverType::New();
+  optimizer->AddObserver(itk::IterationEvent(), unstarted);
+  ITK_TRY_EXPECT_NO_EXCEPTION(optimizer->StartOptimization());
+
+  ITK_TEST_EXPECT_TRUE(!unstarted->IsInitialized());
+  ITK_TEST_EXPECT_EQUAL(unstarted->GetNumberOfSamples(), 0);
+  ITK_TEST_EXPECT_TRUE(observer->IsInitialized());
+  ITK_TEST_EXPECT_EQUAL(observer->GetDimension(), dimension);
+  ITK_TEST_EXPECT_EQUAL(observer->GetNumberOfSamples(), 3 * 5 * 3 * 5 * 3 * 5);
+  ITK_TEST_EXPECT_EQUAL(observer->GetSize(1), 5);
+  ITK_TEST_EXPECT_EQUAL(observer->GetNumberOfSteps(1), 2);
+  ITK_TEST_EXPECT_EQUAL(observer->GetStride(2), 15);
+  ITK_TEST_EXPECT_EQUAL(observer->GetSize(dimension), 0);
+  ITK_TEST_EXPECT_EQUAL(observer->GetStepSize()[3], scales[3]);
+
+  // Every sample holds the metric at its position
+  unsigned int mismatches = 0;
+  const auto   numberOfSamples = static_cast<itk::OffsetValueType>(observer->GetNumberOfSamples());
+  for (itk::OffsetValueType offset = 0; offset < numberOfSamples; offset++)
+  {
+    const double                  value = observer->GetBufferPointer()[offset];
+    const ObserverType::IndexType index = observer->ComputeIndex(offset);
+    if (std::abs(value - metric->GetSurface()(observer->ComputePosition(offset))) > 1e-12 ||
+        observer->ComputeOffset(index) != offset || observer->GetValue(index) != value ||
+        observer->GetValueAtOffset(offset) != value)
+    {
+      std::cerr << "Mismatch at offset " << offset << std::endl;
+      ++mismatches;
+    }
+  }
+  ITK_TEST_EXPECT_EQUAL(mismatches, 0);
+  ITK_TEST_EXPECT_EQUAL(observer->GetValue(optimizer->GetMinimumMetricValuePosition()),
+                        optimizer->GetMinimumMetricValue());
+
+  // Queries outside the lattice are refused
+  ObserverType::IndexType outside(dimension);
+  outside.Fill(0);
+  outside[4] = 3;
+  ITK_TRY_EXPECT_EXCEPTION(observer->GetValue(outside));
+  ITK_TRY_EXPECT_EXCEPTION(observer->GetValue(ObserverType::IndexType(dimension - 1)));
+  ObserverType::ParametersType distant = center;
+  distant[0] += 10.0;
+  ITK_TRY_EXPECT_EXCEPTION(observer->GetValue(distant));
+
+  // Samples match CommandExhaustiveLog where both can be instantiated
+  constexpr unsigned int   volumeDimension = 3;
+  OptimizerType::StepsType volumeSteps(volumeDimension);
+  volumeSteps[0] = 3;
+  volumeSteps[1] = 1;
+  volumeSteps[2] = 2;
+  OptimizerType::ScalesType volumeScales(volumeDimension);
+  volumeScales.Fill(0.25);
+  ObserverType::ParametersType volumeCenter(volumeDimension);
+  volumeCenter.Fill(0.0);
+  metric->SetParameters(volumeCenter);
+  optimizer->SetNumberOfSteps(volumeSteps);
+  optimizer->SetScales(volumeScales);
+  optimizer->SetStepLength(2.0);
+
+  auto fixed = itk::CommandExhaustiveLog<double, volumeDimension>::New();
+  optimizer->AddObserver(itk::StartEvent(), fixed);
+  optimizer->AddObserver(itk::IterationEvent(), fixed);
+  observer->SetCenter(ObserverType::ParametersType());
+  ITK_TRY_EXPECT_NO_EXCEPTION(optimizer->StartOptimization());
+
+  ITK_TEST_EXPECT_EQUAL(observer->GetDimension(), volumeDimension);
+  ITK_TEST_EXPECT_EQUAL(observer->GetNumberOfSamples(),
+                        fixed->GetImage()->GetLargestPossibleRegion().GetNumberOfPixels());
+  for (itk::OffsetValueType offset = 0; offset < static_cast<itk::OffsetValueType>(observer->GetNumberOfSamples());
+       offset++)
+  {
+    if (observer->GetValueAtOffset(offset) != fixed->GetValueAtOffset(offset))
+    {
+      ++mismatches;
+    }
+  }
+  ITK_TEST_EXPECT_EQUAL(mismatches, 0);
+  for (unsigned int dim = 0; dim < volumeDimension; dim++)
+  {
+    ITK_TEST_EXPECT_EQUAL(observer->GetOrigin()[dim], fixed->GetOrigin()[dim]);
+    ITK_TEST_EXPECT_EQUAL(observer->GetStepSize()[dim], 2.0 * volumeScales[dim]);
+  }
+
+  // The lattice must be consistent with the center
+  observer->SetCenter(center);
+  ITK_TRY_EXPECT_EXCEPTION(observer->Initialize(volumeSteps, volumeScales));
+  ITK_TRY_EXPECT_EXCEPTION(observer->Initialize(steps, volumeScales));
+  ITK_TRY_EXPECT_EXCEPTION(observer->Initialize(OptimizerType::StepsType(), OptimizerType::ScalesType()));
+
+  std::cout << "Test finished." << std::endl;
+  return EXIT_SUCCESS;
+}
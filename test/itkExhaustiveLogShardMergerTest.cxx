@@ -0,0 +1,155 @@
+/*=========================================================================
+ *
+ *  Copyright NumFOCUS
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *         https://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *=========================================================================*/
+
+#include "itkExhaustiveLogShardMerger.h"
+#include "itkImageFileReader.h"
+#include "itkImageRegionConstIteratorWithIndex.h"
+#include "itkTestingMacros.h"
+
+#include <fstream>
+#include <string>
+#include <vector>
+
+// Checks the image merged by the ExhaustiveLogMergeShards program from the shards
+// written by itkExhaustiveLogShardTest, and that inconsistent shard sets are refused.
+int
+itkExhaustiveLogShardMergerTest(int argc, char * argv[])
+{
+  if (argc < 5)
+  {
+    std::cout << "Usage: OptimizationMonitorTestDriver itkExhaustiveLogShardMergerTest mergedImage shardStream "
+                 "shardStream shardStream"
+              << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  constexpr unsigned int Dimension = 3;
+  using MergerType = itk::ExhaustiveLogShardMerger<double, Dimension>;
+  using StreamSourceType = itk::ExhaustiveLogStreamImageSource<double, Dimension>;
+  using ImageType = MergerType::OutputImageType;
+
+  const std::string              mergedFileName = argv[1];
+  const std::vector<std::string> shardFileNames(argv + 2, argv + 5);
+
+  auto merger = MergerType::New();
+  ITK_EXERCISE_BASIC_OBJECT_METHODS(merger, ExhaustiveLogShardMerger, ImageSource);
+  ITK_TRY_EXPECT_EXCEPTION(merger->Update());
+
+  for (const auto & fileName : shardFileNames)
+  {
+    merger->AddFileName(fileName);
+  }
+  ITK_TEST_EXPECT_EQUAL(merger->GetFileNames().size(), shardFileNames.size());
+  ITK_TRY_EXPECT_NO_EXCEPTION(merger->Update());
+  const ImageType * merged = merger->GetOutput();
+
+  // The program writes the same image
+  ImageType::Pointer written = itk::ReadImage<ImageType>(mergedFileName);
+  ITK_TEST_EXPECT_EQUAL(written->GetLargestPossibleRegion(), merged->GetLargestPossibleRegion());
+  ITK_TEST_EXPECT_EQUAL(written->GetOrigin(), merged->GetOrigin());
+  ITK_TEST_EXPECT_EQUAL(written->GetSpacing(), merged->GetSpacing());
+
+  unsigned int mismatches = 0;
+  using IteratorType = itk::ImageRegionConstIteratorWithIndex<ImageType>;
+  IteratorType it(merged, merged->GetLargestPossibleRegion());
+  for (it.GoToBegin(); !it.IsAtEnd(); ++it)
+  {
+    if (written->GetPixel(it.GetIndex()) != it.Get())
+    {
+      ++mismatches;
+    }
+  }
+  ITK_TEST_EXPECT_EQUAL(mismatches, 0);
+
+  // Every shard lands at its own region of the lattice
+  itk::SizeValueType numberOfRecords = 0;
+  for (const auto & fileName : shardFileNames)
+  {
+    auto shard = StreamSourceType::New();
+    shard->SetFileName(fileName);
+    shard->Update();
+    numberOfRecords += shard->GetNumberOfRecords();
+
+    const ImageType * shardImage = shard->GetOutput();
+    ITK_TEST_EXPECT_EQUAL(shardImage->GetOrigin(), merged->GetOrigin());
+    ITK_TEST_EXPECT_TRUE(merged->GetLargestPossibleRegion().IsInside(shardImage->GetLargestPossibleRegion()));
+    IteratorType shardIt(shardImage, shardImage->GetLargestPossibleRegion());
+    for (shardIt.GoToBegin(); !shardIt.IsAtEnd(); ++shardIt)
+    {
+      if (merged->GetPixel(shardIt.GetIndex()) != shardIt.Get())
+      {
+        std::cerr << "Mismatch at " << shardIt.GetIndex() << " of " << fileName << std::endl;
+        ++mismatches;
+      }
+    }
+  }
+  ITK_TEST_EXPECT_EQUAL(mismatches, 0);
+  ITK_TEST_EXPECT_EQUAL(merger->GetNumberOfRecords(), numberOfRecords);
+  ITK_TEST_EXPECT_EQUAL(numberOfRecords, merged->GetLargestPossibleRegion().GetNumberOfPixels());
+
+  // A missing shard leaves part of the lattice uncovered
+  auto missing = MergerType::New();
+  missing->SetFileNames({ shardFileNames[0], shardFileNames[2] });
+  ITK_TRY_EXPECT_EXCEPTION(missing->Update());
+
+  // A shard given twice overlaps itself
+  auto overlapping = MergerType::New();
+  overlapping->SetFileNames(shardFileNames);
+  overlapping->AddFileName(shardFileNames[1]);
+  ITK_TRY_EXPECT_EXCEPTION(overlapping->Update());
+
+  // Shards covering the lattice must each be complete
+  std::ifstream                reference(shardFileNames[2], std::ios::in | std::ios::binary);
+  StreamSourceType::RegionType region;
+  StreamSourceType::SizeType   latticeSize;
+  ImageType::SpacingType       spacing;
+  ImageType::PointType         origin;
+  StreamSourceType::ReadHeader(reference, region, latticeSize, spacing, origin);
+  reference.close();
+
+  const std::string incompleteFileName = mergedFileName + ".incomplete.bin";
+  {
+    std::ofstream stream(incompleteFileName, std::ios::out | std::ios::binary | std::ios::trunc);
+    StreamSourceType::WriteHeader(stream, region, latticeSize, spacing, origin);
+    StreamSourceType::WriteRecord(stream, 0, 1.0);
+    StreamSourceType::WriteRecord(stream, 0, 2.0);
+  }
+  auto incomplete = MergerType::New();
+  incomplete->SetFileNames({ shardFileNames[0], shardFileNames[1], incompleteFileName });
+  ITK_TRY_EXPECT_EXCEPTION(incomplete->Update());
+
+  // Shards must come from the same lattice
+  const std::string shiftedFileName = mergedFileName + ".shifted.bin";
+  {
+    ImageType::PointType shiftedOrigin = origin;
+    shiftedOrigin[0] += 0.5 * spacing[0];
+    std::ofstream stream(shiftedFileName, std::ios::out | std::ios::binary | std::ios::trunc);
+    StreamSourceType::WriteHeader(stream, region, latticeSize, spacing, shiftedOrigin);
+    for (itk::OffsetValueType offset = 0; offset < static_cast<itk::OffsetValueType>(region.GetNumberOfPixels());
+         offset++)
+    {
+      StreamSourceType::WriteRecord(stream, offset, 0.0);
+    }
+  }
+  auto shifted = MergerType::New();
+  shifted->SetFileNames({ shardFileNames[0], shardFileNames[1], shiftedFileName });
+  ITK_TRY_EXPECT_EXCEPTION(shifted->Update());
+
+  std::cout << "Test finished." << std::endl;
+  return EXIT_SUCCESS;
+}
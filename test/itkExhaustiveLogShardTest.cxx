@@ -0,0 +1,177 @@
+/*=========================================================================
+ *
+ *  Copyright NumFOCUS
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *         https://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *=========================================================================*/
+
+#include "itkCommandExhaustiveLog.h"
+#include "itkParallelExhaustiveSweep.h"
+#include "itkExhaustiveOptimizerv4.h"
+#include "itkAnalyticTestMetric.h"
+#include "itkImageRegionSplitterSlowDimension.h"
+#include "itkImageRegionConstIteratorWithIndex.h"
+#include "itkTestingMacros.h"
+
+#include <cmath>
+#include <cstdlib>
+
+namespace
+{
+constexpr unsigned int Dimension = 3;
+
+/** Smooth surface with a distinct value at every lattice sample. */
+struct ShardedSurface
+{
+  double
+  operator()(const itk::OptimizerParameters<double> & parameters) const
+  {
+    return std::cos(parameters[0] - 0.2) * std::sin(2.0 * parameters[1] + 0.1) +
+           0.3 * parameters[2] * parameters[2] + 0.01 * parameters[0];
+  }
+};
+
+using ShardedSurfaceMetric = itk::AnalyticTestMetric<ShardedSurface, Dimension>;
+} // namespace
+
+// Sweeps one shard of a lattice split across processes, as each node of a cluster
+// would, streaming it to a file for ExhaustiveLogShardMerger.
+int
+itkExhaustiveLogShardTest(int argc, char * argv[])
+{
+  if (argc < 4)
+  {
+    std::cout << "Usage: OptimizationMonitorTestDriver itkExhaustiveLogShardTest shardNumber numberOfShards shardStream"
+              << std::endl;
+    return EXIT_FAILURE;
+  }
+  const auto shardNumber = static_cast<unsigned int>(std::atoi(argv[1]));
+  const auto numberOfShards = static_cast<unsigned int>(std::atoi(argv[2]));
+
+  using ObserverType = itk::CommandExhaustiveLog<double, Dimension>;
+  using SweepType = itk::ParallelExhaustiveSweep<double, Dimension>;
+  using OptimizerType = itk::ExhaustiveOptimizerv4<double>;
+  using RegionType = ObserverType::RegionType;
+
+  OptimizerType::StepsType steps(Dimension);
+  steps[0] = 4;
+  steps[1] = 3;
+  steps[2] = 2;
+  OptimizerType::ScalesType scales(Dimension);
+  scales.Fill(0.3);
+  scales[2] = 0.5;
+
+  ShardedSurfaceMetric::Pointer        metric = ShardedSurfaceMetric::New();
+  ShardedSurfaceMetric::ParametersType initial(Dimension);
+  initial[0] = 0.5;
+  initial[1] = -0.25;
+  initial[2] = 0.0;
+  metric->SetParameters(initial);
+  ObserverType::PointType center;
+  for (unsigned int dim = 0; dim < Dimension; dim++)
+  {
+    center[dim] = initial[dim];
+  }
+
+  // Every process derives its shard from the whole lattice region alone
+  ObserverType::SizeType latticeSize;
+  for (unsigned int dim = 0; dim < Dimension; dim++)
+  {
+    latticeSize[dim] = 2 * steps[dim] + 1;
+  }
+  RegionType shardRegion(latticeSize);
+  auto       splitter = itk::ImageRegionSplitterSlowDimension::New();
+  ITK_TEST_EXPECT_EQUAL(splitter->GetNumberOfSplits(shardRegion, numberOfShards), numberOfShards);
+  splitter->GetSplit(shardNumber, numberOfShards, shardRegion);
+
+  // Reference over the whole lattice
+  auto optimizer = OptimizerType::New();
+  optimizer->SetMetric(metric);
+  optimizer->SetNumberOfSteps(steps);
+  optimizer->SetScales(scales);
+
+  auto full = ObserverType::New();
+  full->SetCenter(center);
+  optimizer->AddObserver(itk::StartEvent(), full);
+  optimizer->AddObserver(itk::IterationEvent(), full);
+
+  // A shard observing the optimizer ignores samples outside it
+  auto observed = ObserverType::New();
+  observed->SetShardRegion(shardRegion);
+  ITK_TEST_SET_GET_VALUE(shardRegion, observed->GetShardRegion());
+  optimizer->AddObserver(itk::StartEvent(), observed);
+  optimizer->AddObserver(itk::IterationEvent(), observed);
+  ITK_TRY_EXPECT_NO_EXCEPTION(optimizer->StartOptimization());
+
+  // The shard of this process, swept in parallel and streamed
+  auto shard = ObserverType::New();
+  shard->SetCenter(center);
+  shard->SetShardRegion(shardRegion);
+  shard->SetStreamFileName(argv[3]);
+
+  auto sweep = SweepType::New();
+  sweep->SetObserver(shard);
+  sweep->SetNumberOfSteps(steps);
+  sweep->SetScales(scales);
+  sweep->AddMetric(ShardedSurfaceMetric::New());
+  sweep->AddMetric(ShardedSurfaceMetric::New());
+  ITK_TRY_EXPECT_NO_EXCEPTION(sweep->StartSweep());
+  shard->CloseStream();
+
+  ITK_TEST_EXPECT_EQUAL(shard->GetRegion(), shardRegion);
+  ITK_TEST_EXPECT_EQUAL(shard->GetLatticeSize(), latticeSize);
+  ITK_TEST_EXPECT_EQUAL(shard->GetImage()->GetBufferedRegion(), shardRegion);
+  ITK_TEST_EXPECT_EQUAL(shard->GetOrigin(), full->GetOrigin());
+  ITK_TEST_EXPECT_EQUAL(shard->GetStepSize(), full->GetStepSize());
+  ITK_TEST_EXPECT_EQUAL(sweep->GetNumberOfEvaluatedSamples(), shardRegion.GetNumberOfPixels());
+  for (unsigned int dim = 0; dim < Dimension; dim++)
+  {
+    ITK_TEST_EXPECT_EQUAL(shard->GetNumberOfSteps(dim), steps[dim]);
+  }
+
+  // Samples are indexed by their lattice index in every shard
+  unsigned int mismatches = 0;
+  using IteratorType = itk::ImageRegionConstIteratorWithIndex<ObserverType::ImageType>;
+  IteratorType it(full->GetImage(), shardRegion);
+  for (it.GoToBegin(); !it.IsAtEnd(); ++it)
+  {
+    if (shard->GetValue(it.GetIndex()) != it.Get() || observed->GetValue(it.GetIndex()) != it.Get())
+    {
+      std::cerr << "Mismatch at " << it.GetIndex() << ": full " << it.Get() << " shard "
+                << shard->GetValue(it.GetIndex()) << " observed " << observed->GetValue(it.GetIndex()) << std::endl;
+      ++mismatches;
+    }
+  }
+  ITK_TEST_EXPECT_EQUAL(mismatches, 0);
+
+  // Offsets count samples of the shard
+  const ObserverType::IndexType lastIndex = shardRegion.GetUpperIndex();
+  ITK_TEST_EXPECT_EQUAL(shard->GetValueAtOffset(shardRegion.GetNumberOfPixels() - 1), full->GetValue(lastIndex));
+  const ObserverType::PointType firstPosition =
+    full->ComputePosition(full->GetImage()->ComputeOffset(shardRegion.GetIndex()));
+  for (unsigned int dim = 0; dim < Dimension; dim++)
+  {
+    ITK_TEST_EXPECT_TRUE(std::abs(shard->ComputePosition(0)[dim] - firstPosition[dim]) < 1e-12);
+  }
+
+  // A shard must lie inside the lattice
+  RegionType outside = shardRegion;
+  outside.SetIndex(2, static_cast<itk::IndexValueType>(latticeSize[2]) - 1);
+  auto invalid = ObserverType::New();
+  invalid->SetShardRegion(outside);
+  ITK_TRY_EXPECT_EXCEPTION(invalid->Initialize(steps, scales));
+
+  std::cout << "Test finished." << std::endl;
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,247 @@
+/*=========================================================================
+ *
+ *  Copyright NumFOCUS
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *         https://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *=========================================================================*/
+
+#include "itkExhaustiveMetricValueCache.h"
+#include "itkParallelExhaustiveSweep.h"
+#include "itkCommandExhaustiveLog.h"
+#include "itkTestingMacros.h"
+
+#include "itkImageFileReader.h"
+#include "itkEuler2DTransform.h"
+#include "itkMeanSquaresImageToImageMetricv4.h"
+#include "itkCenteredTransformInitializer.h"
+#include "itkImageRegionConstIteratorWithIndex.h"
+
+#include <algorithm>
+#include <cmath>
+
+int
+itkExhaustiveMetricValueCacheTest(int argc, char * argv[])
+{
+  if (argc < 4)
+  {
+    std::cout << "Usage: OptimizationMonitorTestDriver itkExhaustiveMetricValueCacheTest fixedImage movingImage "
+                 "cacheFile"
+              << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  using FixedImageType = itk::Image<double, 2>;
+  using MovingImageType = itk::Image<double, 2>;
+  using TransformType = itk::Euler2DTransform<double>;
+  using MetricType = itk::MeanSquaresImageToImageMetricv4<FixedImageType, MovingImageType>;
+  using TransformInitializerType = itk::CenteredTransformInitializer<TransformType, FixedImageType, MovingImageType>;
+  using ObserverType = itk::CommandExhaustiveLog<double, TransformType::ParametersDimension>;
+  using SweepType = itk::ParallelExhaustiveSweep<double, TransformType::ParametersDimension>;
+  using CacheType = itk::ExhaustiveMetricValueCache<double, TransformType::ParametersDimension>;
+
+  FixedImageType::Pointer  fixedImage = itk::ReadImage<FixedImageType>(argv[1]);
+  MovingImageType::Pointer movingImage = itk::ReadImage<MovingImageType>(argv[2]);
+
+  TransformType::Pointer            transform = TransformType::New();
+  TransformInitializerType::Pointer initializer = TransformInitializerType::New();
+  initializer->SetTransform(transform);
+  initializer->SetFixedImage(fixedImage);
+  initializer->SetMovingImage(movingImage);
+  initializer->InitializeTransform();
+
+  SweepType::StepsType steps(TransformType::ParametersDimension);
+  steps[0] = 2;
+  steps[1] = 2;
+  steps[2] = 1;
+
+  SweepType::ScalesType scales(TransformType::ParametersDimension);
+  scales[0] = 0.1;
+  scales[1] = 1.0;
+  scales[2] = 1.0;
+
+  const SweepType::ParametersType center = transform->GetParameters();
+  SweepType::ParametersType       shiftedCenter = center;
+  shiftedCenter[1] += scales[1];
+
+  auto toPoint = [](const SweepType::ParametersType & parameters) {
+    ObserverType::PointType point;
+    for (unsigned int i = 0; i < TransformType::ParametersDimension; i++)
+    {
+      point[i] = parameters[i];
+    }
+    return point;
+  };
+
+  // The fingerprint identifies the metric and both images
+  CacheType::Pointer cache = CacheType::New();
+  ITK_EXERCISE_BASIC_OBJECT_METHODS(cache, ExhaustiveMetricValueCache, Object);
+
+  CacheType::FingerprintType fingerprint = CacheType::ComputeFingerprint(MetricType::New()->GetNameOfClass());
+  fingerprint = CacheType::ComputeImageFingerprint(fixedImage.GetPointer(), fingerprint);
+  fingerprint = CacheType::ComputeImageFingerprint(movingImage.GetPointer(), fingerprint);
+  ITK_TEST_EXPECT_TRUE(fingerprint != CacheType::ComputeImageFingerprint(movingImage.GetPointer()));
+  cache->SetFingerprint(fingerprint);
+  ITK_TEST_SET_GET_VALUE(fingerprint, cache->GetFingerprint());
+
+  // Positions cannot be quantized before the quantum is known
+  double value = 0.0;
+  ITK_TEST_EXPECT_TRUE(!cache->IsQuantumSet());
+  ITK_TRY_EXPECT_EXCEPTION(cache->Lookup(center, value));
+
+  auto sweepAround = [&](const SweepType::ParametersType & sweepCenter,
+                         CacheType *                       valueCache,
+                         double                            stepLength = 1.0,
+                         bool                              onQuantization = true) {
+    SweepType::Pointer sweep = SweepType::New();
+    for (unsigned int i = 0; i < 2; i++)
+    {
+      MetricType::Pointer metric = MetricType::New();
+      metric->SetFixedImage(fixedImage);
+      metric->SetMovingImage(movingImage);
+      metric->SetMovingTransform(transform->Clone());
+      metric->SetMaximumNumberOfWorkUnits(1);
+      metric->Initialize();
+      sweep->AddMetric(metric);
+    }
+    ObserverType::Pointer observer = ObserverType::New();
+    observer->SetCenter(toPoint(sweepCenter));
+    sweep->SetObserver(observer);
+    sweep->SetNumberOfSteps(steps);
+    sweep->SetScales(scales);
+    sweep->SetStepLength(stepLength);
+    sweep->SetInitialPosition(sweepCenter);
+    sweep->SetValueCache(valueCache);
+    if (onQuantization)
+    {
+      ITK_TRY_EXPECT_NO_EXCEPTION(sweep->StartSweep());
+    }
+    else
+    {
+      ITK_TRY_EXPECT_EXCEPTION(sweep->StartSweep());
+    }
+    return sweep;
+  };
+
+  constexpr itk::SizeValueType numberOfSamples = 5 * 5 * 3;
+
+  // The first sweep evaluates everything and fills the cache
+  SweepType::Pointer first = sweepAround(center, cache);
+  ITK_TEST_EXPECT_EQUAL(first->GetNumberOfCachedSamples(), 0);
+  ITK_TEST_EXPECT_EQUAL(first->GetNumberOfEvaluatedSamples(), numberOfSamples);
+  ITK_TEST_EXPECT_EQUAL(cache->GetNumberOfEntries(), numberOfSamples);
+  ITK_TEST_EXPECT_TRUE(cache->IsQuantumSet());
+  ITK_TEST_EXPECT_EQUAL(cache->GetQuantum()[0], 0.1);
+  ITK_TEST_EXPECT_EQUAL(cache->GetQuantizationOrigin()[1], center[1]);
+
+  ITK_TEST_EXPECT_TRUE(cache->Lookup(center, value));
+  ITK_TEST_EXPECT_EQUAL(value, first->GetObserver()->GetValue(toPoint(center)));
+
+  // Shifting the center by one step leaves one new row of samples to evaluate
+  SweepType::Pointer shifted = sweepAround(shiftedCenter, cache);
+  ITK_TEST_EXPECT_EQUAL(shifted->GetNumberOfCachedSamples(), 5 * 4 * 3);
+  ITK_TEST_EXPECT_EQUAL(shifted->GetNumberOfEvaluatedSamples(), 5 * 1 * 3);
+  ITK_TEST_EXPECT_EQUAL(cache->GetNumberOfEntries(), 5 * 6 * 3);
+
+  // The reused samples match a sweep that evaluates them all
+  SweepType::Pointer reference = sweepAround(shiftedCenter, nullptr);
+  using IteratorType = itk::ImageRegionConstIteratorWithIndex<ObserverType::ImageType>;
+  const ObserverType::ImageType * referenceImage = reference->GetObserver()->GetImage();
+  IteratorType                    it(referenceImage, referenceImage->GetLargestPossibleRegion());
+  unsigned int                    mismatches = 0;
+  for (it.GoToBegin(); !it.IsAtEnd(); ++it)
+  {
+    const double cached = shifted->GetObserver()->GetValue(it.GetIndex());
+    if (std::abs(cached - it.Get()) > 1e-9 * std::max(1.0, std::abs(it.Get())))
+    {
+      std::cerr << "Mismatch at " << it.GetIndex() << ": cached " << cached << " evaluated " << it.Get() << std::endl;
+      ++mismatches;
+    }
+  }
+  ITK_TEST_EXPECT_EQUAL(mismatches, 0);
+
+  // A sweep between the quantization points of a filled cache is refused rather
+  // than served the values of neighboring positions
+  SweepType::ParametersType halfShiftedCenter = center;
+  halfShiftedCenter[1] += 0.5 * scales[1];
+  SweepType::Pointer halfShifted = sweepAround(halfShiftedCenter, cache, 1.0, false);
+  ITK_TEST_EXPECT_EQUAL(halfShifted->GetNumberOfCachedSamples(), 0);
+  ITK_TEST_EXPECT_EQUAL(cache->GetNumberOfEntries(), 5 * 6 * 3);
+
+  // Neither is a sweep whose step is not a whole number of quanta
+  sweepAround(center, cache, 1.5, false);
+
+  // Saved values are reused by a later process
+  ITK_TRY_EXPECT_NO_EXCEPTION(cache->Write(argv[3]));
+
+  CacheType::Pointer restored = CacheType::New();
+  restored->SetFingerprint(fingerprint);
+  ITK_TRY_EXPECT_NO_EXCEPTION(restored->Read(argv[3]));
+  ITK_TEST_EXPECT_EQUAL(restored->GetNumberOfEntries(), cache->GetNumberOfEntries());
+  ITK_TEST_EXPECT_EQUAL(restored->GetQuantum(), cache->GetQuantum());
+  ITK_TEST_EXPECT_EQUAL(restored->GetQuantizationOrigin(), cache->GetQuantizationOrigin());
+
+  SweepType::Pointer repeated = sweepAround(shiftedCenter, restored);
+  ITK_TEST_EXPECT_EQUAL(repeated->GetNumberOfCachedSamples(), numberOfSamples);
+  ITK_TEST_EXPECT_EQUAL(repeated->GetNumberOfEvaluatedSamples(), 0);
+
+  // Values cached for other images are not reused
+  restored->SetFingerprint(fingerprint + 1);
+  SweepType::Pointer otherImages = sweepAround(center, restored);
+  ITK_TEST_EXPECT_EQUAL(otherImages->GetNumberOfCachedSamples(), 0);
+
+  // Caches quantized differently cannot be merged
+  CacheType::Pointer mismatched = CacheType::New();
+  CacheType::QuantumType quantum;
+  quantum.Fill(0.5);
+  mismatched->SetQuantum(quantum);
+  ITK_TRY_EXPECT_EXCEPTION(mismatched->Read(argv[3]));
+
+  // A finished log seeds the cache
+  CacheType::Pointer seeded = CacheType::New();
+  seeded->SetQuantum(cache->GetQuantum());
+  seeded->SetQuantizationOrigin(cache->GetQuantizationOrigin());
+  seeded->SetFingerprint(fingerprint);
+  ITK_TRY_EXPECT_NO_EXCEPTION(seeded->InsertLog(reference->GetObserver()));
+  ITK_TEST_EXPECT_EQUAL(seeded->GetNumberOfEntries(), numberOfSamples);
+  ITK_TEST_EXPECT_TRUE(seeded->Lookup(shiftedCenter, value));
+  ITK_TEST_EXPECT_EQUAL(value, reference->GetObserver()->GetValue(toPoint(shiftedCenter)));
+
+  seeded->Clear();
+  ITK_TEST_EXPECT_EQUAL(seeded->GetNumberOfEntries(), 0);
+  ITK_TEST_EXPECT_TRUE(!seeded->Lookup(shiftedCenter, value));
+
+  // With a longer step, a log seeds a cache on the lattice the sweep looks up
+  SweepType::Pointer longStep = sweepAround(center, nullptr, 2.0);
+  CacheType::Pointer longStepCache = CacheType::New();
+  longStepCache->SetFingerprint(fingerprint);
+  ITK_TRY_EXPECT_NO_EXCEPTION(longStepCache->InsertLog(longStep->GetObserver()));
+  ITK_TEST_EXPECT_EQUAL(longStepCache->GetQuantum()[0], 2.0 * scales[0]);
+  ITK_TEST_EXPECT_TRUE(std::abs(longStepCache->GetQuantizationOrigin()[1] - center[1]) < 1e-12);
+
+  SweepType::Pointer longStepRepeated = sweepAround(center, longStepCache, 2.0);
+  ITK_TEST_EXPECT_EQUAL(longStepRepeated->GetNumberOfCachedSamples(), numberOfSamples);
+  ITK_TEST_EXPECT_EQUAL(longStepRepeated->GetNumberOfEvaluatedSamples(), 0);
+
+  // Logs off the quantization grid are refused rather than silently never matched
+  ITK_TRY_EXPECT_EXCEPTION(longStepCache->InsertLog(reference->GetObserver()));
+  CacheType::Pointer offGrid = CacheType::New();
+  offGrid->SetQuantum(cache->GetQuantum());
+  CacheType::QuantumType offGridOrigin = cache->GetQuantizationOrigin();
+  offGridOrigin[0] += 0.5 * scales[0];
+  offGrid->SetQuantizationOrigin(offGridOrigin);
+  ITK_TRY_EXPECT_EXCEPTION(offGrid->InsertLog(reference->GetObserver()));
+
+  std::cout << "Test finished." << std::endl;
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,225 @@
+/*=========================================================================
+ *
+ *  Copyright NumFOCUS
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *         https://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *=========================================================================*/
+
+#include "itkParallelExhaustiveSweep.h"
+#include "itkCommandExhaustiveLog.h"
+#include "itkTestingMacros.h"
+
+#include "itkImageFileReader.h"
+#include "itkEuler2DTransform.h"
+#include "itkExhaustiveOptimizerv4.h"
+#include "itkMeanSquaresImageToImageMetricv4.h"
+#include "itkCenteredTransformInitializer.h"
+#include "itkImageRegionConstIteratorWithIndex.h"
+
+#include <cmath>
+
+int
+itkParallelExhaustiveSweepTest(int argc, char * argv[])
+{
+  if (argc < 3)
+  {
+    std::cout << "Usage: OptimizationMonitorTestDriver itkParallelExhaustiveSweepTest fixedImage movingImage"
+              << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  using FixedImageType = itk::Image<double, 2>;
+  using MovingImageType = itk::Image<double, 2>;
+  using TransformType = itk::Euler2DTransform<double>;
+  using OptimizerType = itk::ExhaustiveOptimizerv4<double>;
+  using MetricType = itk::MeanSquaresImageToImageMetricv4<FixedImageType, MovingImageType>;
+  using TransformInitializerType = itk::CenteredTransformInitializer<TransformType, FixedImageType, MovingImageType>;
+  using ObserverType = itk::CommandExhaustiveLog<double, TransformType::ParametersDimension>;
+  using SweepType = itk::ParallelExhaustiveSweep<double, TransformType::ParametersDimension>;
+
+  FixedImageType::Pointer  fixedImage = itk::ReadImage<FixedImageType>(argv[1]);
+  MovingImageType::Pointer movingImage = itk::ReadImage<MovingImageType>(argv[2]);
+
+  TransformType::Pointer            transform = TransformType::New();
+  TransformInitializerType::Pointer initializer = TransformInitializerType::New();
+  initializer->SetTransform(transform);
+  initializer->SetFixedImage(fixedImage);
+  initializer->SetMovingImage(movingImage);
+  initializer->InitializeTransform();
+
+  // Each metric observes its own transform and is otherwise identical
+  auto createMetric = [&]() {
+    MetricType::Pointer metric = MetricType::New();
+    metric->SetFixedImage(fixedImage);
+    metric->SetMovingImage(movingImage);
+    metric->SetMovingTransform(transform->Clone());
+    metric->SetMaximumNumberOfWorkUnits(1);
+    metric->Initialize();
+    return metric;
+  };
+
+  OptimizerType::StepsType steps(TransformType::ParametersDimension);
+  steps[0] = 4;
+  steps[1] = 3;
+  steps[2] = 2;
+
+  OptimizerType::ScalesType scales(TransformType::ParametersDimension);
+  scales[0] = 0.1;
+  scales[1] = 1.0;
+  scales[2] = 1.0;
+
+  ObserverType::PointType center;
+  for (unsigned int i = 0; i < TransformType::ParametersDimension; i++)
+  {
+    center[i] = transform->GetParameters()[i];
+  }
+
+  // Serial reference through StartEvent / IterationEvent
+  OptimizerType::Pointer optimizer = OptimizerType::New();
+  optimizer->SetMetric(createMetric());
+  optimizer->SetNumberOfSteps(steps);
+  optimizer->SetScales(scales);
+
+  ObserverType::Pointer serialObserver = ObserverType::New();
+  serialObserver->SetCenter(center);
+  optimizer->AddObserver(itk::StartEvent(), serialObserver);
+  optimizer->AddObserver(itk::IterationEvent(), serialObserver);
+  ITK_TRY_EXPECT_NO_EXCEPTION(optimizer->StartOptimization());
+
+  // Parallel sweep over the same lattice
+  SweepType::Pointer sweep = SweepType::New();
+  ITK_EXERCISE_BASIC_OBJECT_METHODS(sweep, ParallelExhaustiveSweep, Object);
+
+  ITK_TRY_EXPECT_EXCEPTION(sweep->StartSweep());
+
+  ObserverType::Pointer parallelObserver = ObserverType::New();
+  parallelObserver->SetCenter(center);
+  sweep->SetObserver(parallelObserver);
+  sweep->SetNumberOfSteps(steps);
+  sweep->SetScales(scales);
+  sweep->SetBlockSize(7); // Blocks straddle lattice rows
+  ITK_TEST_SET_GET_VALUE(7, sweep->GetBlockSize());
+
+  ITK_TRY_EXPECT_EXCEPTION(sweep->StartSweep());
+
+  constexpr unsigned int numberOfWorkers = 4;
+  for (unsigned int i = 0; i < numberOfWorkers; i++)
+  {
+    sweep->AddMetric(createMetric());
+  }
+  ITK_TEST_EXPECT_EQUAL(sweep->GetNumberOfMetrics(), numberOfWorkers);
+
+  ITK_TRY_EXPECT_NO_EXCEPTION(sweep->StartSweep());
+
+  ITK_TEST_EXPECT_EQUAL(parallelObserver->GetSize(0), 9);
+  ITK_TEST_EXPECT_EQUAL(parallelObserver->GetSize(1), 7);
+  ITK_TEST_EXPECT_EQUAL(parallelObserver->GetSize(2), 5);
+  ITK_TEST_EXPECT_EQUAL(parallelObserver->GetOrigin(), serialObserver->GetOrigin());
+
+  // Every sample must match the serial path exactly
+  unsigned int mismatches = 0;
+  using IteratorType = itk::ImageRegionConstIteratorWithIndex<ObserverType::ImageType>;
+  IteratorType it(serialObserver->GetImage(), serialObserver->GetImage()->GetLargestPossibleRegion());
+  for (it.GoToBegin(); !it.IsAtEnd(); ++it)
+  {
+    if (it.Get() != parallelObserver->GetValue(it.GetIndex()))
+    {
+      std::cerr << "Mismatch at " << it.GetIndex() << ": serial " << it.Get() << " parallel "
+                << parallelObserver->GetValue(it.GetIndex()) << std::endl;
+      ++mismatches;
+    }
+  }
+  ITK_TEST_EXPECT_EQUAL(mismatches, 0);
+
+  // Minimum found by the optimizer is logged by the parallel sweep
+  ITK_TEST_EXPECT_EQUAL(optimizer->GetMinimumMetricValue(),
+                        parallelObserver->GetValue(optimizer->GetMinimumMetricValuePosition()));
+
+  // Evaluate only every third sample into an observer filled with a sentinel
+  ObserverType::Pointer subsetObserver = ObserverType::New();
+  subsetObserver->SetCenter(center);
+  subsetObserver->SetFillValue(-1.0);
+  subsetObserver->Initialize(steps, scales);
+  sweep->SetObserver(subsetObserver);
+
+  std::vector<SweepType::OffsetValueType> offsets;
+  const auto numberOfSamples =
+    static_cast<SweepType::OffsetValueType>(serialObserver->GetImage()->GetLargestPossibleRegion().GetNumberOfPixels());
+  for (SweepType::OffsetValueType offset = 0; offset < numberOfSamples; offset += 3)
+  {
+    offsets.push_back(offset);
+  }
+  sweep->SetSampleOffsets(offsets);
+  ITK_TEST_EXPECT_EQUAL(sweep->GetSampleOffsets().size(), offsets.size());
+  ITK_TRY_EXPECT_NO_EXCEPTION(sweep->StartSweep());
+
+  mismatches = 0;
+  for (it.GoToBegin(); !it.IsAtEnd(); ++it)
+  {
+    const auto   offset = serialObserver->GetImage()->ComputeOffset(it.GetIndex());
+    const double expected = (offset % 3 == 0) ? it.Get() : -1.0;
+    if (subsetObserver->GetValue(it.GetIndex()) != expected)
+    {
+      ++mismatches;
+    }
+  }
+  ITK_TEST_EXPECT_EQUAL(mismatches, 0);
+
+  offsets.push_back(numberOfSamples);
+  sweep->SetSampleOffsets(offsets);
+  ITK_TRY_EXPECT_EXCEPTION(sweep->StartSweep());
+
+  // A longer step widens the observer lattice about the sweep center, whatever
+  // center the observer held before
+  ObserverType::Pointer stepObserver = ObserverType::New();
+  sweep->SetObserver(stepObserver);
+  sweep->SetSampleOffsets({});
+  sweep->SetStepLength(2.0);
+  ITK_TRY_EXPECT_NO_EXCEPTION(sweep->StartSweep());
+  ITK_TEST_EXPECT_EQUAL(stepObserver->GetCenter(), center);
+  for (unsigned int dim = 0; dim < TransformType::ParametersDimension; dim++)
+  {
+    ITK_TEST_EXPECT_EQUAL(stepObserver->GetStepSize()[dim], 2.0 * scales[dim]);
+    ITK_TEST_EXPECT_TRUE(std::abs(stepObserver->GetOrigin()[dim] - (center[dim] - 4.0 * steps[dim] * scales[dim])) <
+                         1e-12);
+  }
+
+  MetricType::Pointer           reference = createMetric();
+  OptimizerType::ParametersType position(TransformType::ParametersDimension);
+  mismatches = 0;
+  for (SweepType::OffsetValueType offset = 0; offset < numberOfSamples; offset += 5)
+  {
+    const ObserverType::PointType point = stepObserver->ComputePosition(offset);
+    for (unsigned int dim = 0; dim < TransformType::ParametersDimension; dim++)
+    {
+      position[dim] = point[dim];
+    }
+    reference->SetParameters(position);
+    if (std::abs(reference->GetValue() - stepObserver->GetValueAtOffset(offset)) > 1e-9)
+    {
+      std::cerr << "Sample at offset " << offset << " was not taken at " << point << std::endl;
+      ++mismatches;
+    }
+  }
+  ITK_TEST_EXPECT_EQUAL(mismatches, 0);
+
+  // An observer initialized on another lattice is not filled in place
+  subsetObserver->Initialize(steps, scales);
+  sweep->SetObserver(subsetObserver);
+  sweep->SetSampleOffsets({ 0, 1 });
+  ITK_TRY_EXPECT_EXCEPTION(sweep->StartSweep());
+
+  std::cout << "Test finished." << std::endl;
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,65 @@
+def GetArrayView(self):
+    """NumPy view of the lattice sharing its memory. Axes are in NumPy order, the
+    last axis varying parameter 0, as for itk.array_view_from_image. Only a
+    lattice stored densely may be viewed; the view is valid until the next
+    initialization."""
+    import itk
+
+    if not self.IsStoredDensely():
+        raise RuntimeError("Only a lattice stored densely can be viewed without copying")
+    return itk.array_view_from_image(self.GetDataImage())
+
+def GetAxisCoordinates(self):
+    """Parameter values of the samples along each axis of GetArrayView(), in the
+    same axis order."""
+    import numpy as np
+
+    region = self.GetRegion()
+    origin = self.GetOrigin()
+    step = self.GetStepSize()
+    coordinates = []
+    for dim in range(region.GetImageDimension()):
+        lattice_index = region.GetIndex()[dim] + np.arange(region.GetSize()[dim])
+        coordinates.append(origin[dim] + lattice_index * step[dim])
+    return coordinates[::-1]
+
+def GetXarrayView(self):
+    """xarray.DataArray around GetArrayView(), without copying, with dimensions
+    named parameter0, parameter1, ... and their values as coordinates."""
+    import xarray as xr
+
+    view = self.GetArrayView()
+    dims = ["parameter" + str(dim) for dim in reversed(range(view.ndim))]
+    return xr.DataArray(view, coords=dict(zip(dims, self.GetAxisCoordinates())), dims=dims)
+
+def _BatchBufferView(self, pointer, dtype, shape):
+    """NumPy view of a batch buffer returned as a raw pointer."""
+    import ctypes
+    import numpy as np
+
+    dtype = np.dtype(dtype)
+    count = int(np.prod(shape))
+    if count == 0:
+        return np.empty(shape, dtype=dtype)
+    memory = (ctypes.c_byte * (count * dtype.itemsize)).from_address(int(pointer))
+    return np.frombuffer(memory, dtype=dtype).reshape(shape)
+
+def AddBatchObserver(self, callback):
+    """Call callback(indices, values) for each batch of recorded samples, set up
+    with SetBatchSize or SetBatchInterval. indices holds one row of lattice indices
+    per sample, parameter 0 first, and values one value per sample. Both are NumPy
+    views of the batch buffers, valid during the call only. During a
+    ParallelExhaustiveSweep callback runs on the thread that called StartSweep.
+    Returns the observer tag."""
+    import itk
+    import numpy as np
+
+    value_type, dimension = itk.template(self)[1]
+
+    def deliver():
+        count = self.GetBatchNumberOfSamples()
+        indices = self._BatchBufferView(self.GetBatchIndexBuffer(), np.intp, (count, dimension))
+        values = self._BatchBufferView(self.GetBatchValueBuffer(), value_type.dtype, (count,))
+        callback(indices, values)
+
+    return self.AddObserver(itk.IterationEvent(), deliver)
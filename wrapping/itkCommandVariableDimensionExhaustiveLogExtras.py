@@ -0,0 +1,28 @@
+def GetArrayView(self):
+    """NumPy view of the lattice sharing its memory. Axes are in NumPy order, the
+    last axis varying parameter 0, as for CommandExhaustiveLog.GetArrayView. The
+    view is valid until the next initialization."""
+    import ctypes
+    import itk
+    import numpy as np
+
+    if not self.IsInitialized():
+        raise RuntimeError("The lattice has not been initialized")
+    dtype = np.dtype(itk.template(self)[1][0].dtype)
+    shape = tuple(self.GetSize(dim) for dim in reversed(range(self.GetDimension())))
+    memory = (ctypes.c_byte * (self.GetNumberOfSamples() * dtype.itemsize)).from_address(
+        int(self.GetBufferPointer())
+    )
+    return np.frombuffer(memory, dtype=dtype).reshape(shape)
+
+def GetAxisCoordinates(self):
+    """Parameter values of the samples along each axis of GetArrayView(), in the
+    same axis order."""
+    import numpy as np
+
+    origin = self.GetOrigin()
+    step = self.GetStepSize()
+    coordinates = []
+    for dim in range(self.GetDimension()):
+        coordinates.append(origin[dim] + np.arange(self.GetSize(dim)) * step[dim])
+    return coordinates[::-1]